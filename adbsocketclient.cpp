@@ -1,6 +1,6 @@
 #include "adbsocketclient.h"
+#include "bridgesocketworker.h"
 #include <QDebug>
-#include <QHostAddress>
 #include <QFileInfo>
 #include <QDir>
 #include <QJsonDocument>
@@ -14,40 +14,48 @@
  */
 AdbSocketClient::AdbSocketClient(QObject *parent)
     : QObject(parent)
-    , m_socket(new QTcpSocket(this))
-    , m_connected(false)
+    , m_ioThread(new QThread(this))
+    , m_worker(new BridgeSocketWorker())
+    , m_connected(0)
+    , m_scanning(0)
     , m_reconnectTimer(new QTimer(this))
     , m_reconnectAttempts(0)
     , m_connectionState(Disconnected)
     , m_transferRole(Unknown)
     , m_connectionCheckTimer(new QTimer(this))
     , m_isProcessingCommands(false)
-{
-    // Conexiones para eventos del socket
-    connect(m_socket, &QTcpSocket::readyRead, this, &AdbSocketClient::readFromSocket);
-
-    connect(m_socket, &QTcpSocket::connected, this, [this]() {
-        m_connected = true;
-        m_reconnectAttempts = 0;
-        qDebug() << "Socket conectado a Bridge Client";
-        setConnectionState(Connected);
-        emit connected();
-    });
-
-    connect(m_socket, &QTcpSocket::disconnected, this, [this]() {
-        m_connected = false;
-        qDebug() << "Socket desconectado de Bridge Client";
-        setConnectionState(Disconnected);
-        emit disconnected();
-
-        // Intentar reconectar automáticamente
-        if (m_reconnectAttempts < MAX_RECONNECT_ATTEMPTS) {
-            m_reconnectTimer->start(RECONNECT_INTERVAL);
-        }
-    });
-
-    connect(m_socket, static_cast<void(QTcpSocket::*)(QAbstractSocket::SocketError)>(&QTcpSocket::error),
-            this, &AdbSocketClient::handleSocketError);
+    , m_binaryEncoding(true)
+{
+    qRegisterMetaType<QList<DataItem>>("QList<DataItem>");
+
+    // El socket y la decodificación de respuestas van en el hilo de E/S del cliente
+    m_ioThread->setObjectName("BridgeClientIO");
+    m_worker->moveToThread(m_ioThread);
+    m_ioThread->start();
+
+    // Eventos del socket (conexiones entre hilos: llegan encolados a este objeto)
+    connect(m_worker, &BridgeSocketWorker::socketDisconnected, this, &AdbSocketClient::handleSocketDisconnected);
+    connect(m_worker, &BridgeSocketWorker::socketError, this, &AdbSocketClient::handleSocketError);
+
+    // Respuestas ya decodificadas: se reemiten tal cual
+    connect(m_worker, &BridgeSocketWorker::deviceInfoReceived, this, &AdbSocketClient::deviceInfoReceived);
+    connect(m_worker, &BridgeSocketWorker::scanStarted, this, &AdbSocketClient::scanStarted);
+    connect(m_worker, &BridgeSocketWorker::scanProgress, this, &AdbSocketClient::scanProgress);
+    connect(m_worker, &BridgeSocketWorker::scanCompleted, this, &AdbSocketClient::scanCompleted);
+    connect(m_worker, &BridgeSocketWorker::scanError, this, &AdbSocketClient::scanError);
+    connect(m_worker, &BridgeSocketWorker::scanCompleted, this, [this]() { m_scanning.storeRelease(0); });
+    connect(m_worker, &BridgeSocketWorker::scanError, this, [this]() { m_scanning.storeRelease(0); });
+    connect(m_worker, &BridgeSocketWorker::mediaDataReceived, this, &AdbSocketClient::mediaDataReceived);
+    connect(m_worker, &BridgeSocketWorker::filesDataReceived, this, &AdbSocketClient::filesDataReceived);
+    connect(m_worker, &BridgeSocketWorker::fileReady, this, &AdbSocketClient::fileReady);
+    connect(m_worker, &BridgeSocketWorker::fileRangeReady, this, &AdbSocketClient::fileRangeReady);
+    connect(m_worker, &BridgeSocketWorker::fileSaved, this, &AdbSocketClient::fileSaved);
+    connect(m_worker, &BridgeSocketWorker::pongReceived, this, &AdbSocketClient::pongReceived);
+    connect(m_worker, &BridgeSocketWorker::errorReceived, this, &AdbSocketClient::errorOccurred);
+    connect(m_worker, &BridgeSocketWorker::contactsDataReceived, this, &AdbSocketClient::contactsDataReceived);
+    connect(m_worker, &BridgeSocketWorker::messagesDataReceived, this, &AdbSocketClient::messagesDataReceived);
+    connect(m_worker, &BridgeSocketWorker::fileTransferProgress, this, &AdbSocketClient::fileTransferProgress);
+    connect(m_worker, &BridgeSocketWorker::unknownResponseReceived, this, &AdbSocketClient::unknownResponseReceived);
 
     // Configurar timers
     connect(m_reconnectTimer, &QTimer::timeout, this, &AdbSocketClient::reconnectTimer);
@@ -67,6 +75,11 @@ AdbSocketClient::AdbSocketClient(QObject *parent)
 AdbSocketClient::~AdbSocketClient()
 {
     disconnectFromDevice();
+
+    // Con el hilo parado, el worker (y su socket) se destruyen desde aquí
+    m_ioThread->quit();
+    m_ioThread->wait();
+    delete m_worker;
 }
 
 /**
@@ -74,21 +87,44 @@ AdbSocketClient::~AdbSocketClient()
  */
 bool AdbSocketClient::connectToDevice(const QString &deviceId)
 {
-    if (m_connected) {
+    if (m_connected.loadAcquire()) {
         disconnectFromDevice();
     }
 
     m_deviceId = deviceId;
     setConnectionState(Connecting);
 
-    // Conectar al socket local con puerto redirigido por ADB
-    m_socket->connectToHost(QHostAddress::LocalHost, PORT);
-    if (!m_socket->waitForConnected(5000)) {
-        qWarning() << "Failed to connect to Bridge Client socket:" << m_socket->errorString();
+    // Conectar al socket local con puerto redirigido por ADB (en el hilo de E/S, esperando el resultado)
+    bool ok = false;
+    QString errorMessage;
+    BridgeSocketWorker *worker = m_worker;
+    bool binaryEncoding = m_binaryEncoding;
+    QMetaObject::invokeMethod(worker, [worker, binaryEncoding, &ok, &errorMessage]() {
+        ok = worker->connectToHost(PORT, 5000, &errorMessage);
+        if (ok && binaryEncoding) {
+            worker->requestCborEncoding(); // Antes que cualquier otro comando
+        }
+    }, Qt::BlockingQueuedConnection);
+
+    return finishConnect(ok, errorMessage);
+}
+
+/**
+ * Estado y señales tras un intento de conexión del socket
+ */
+bool AdbSocketClient::finishConnect(bool ok, const QString &errorMessage)
+{
+    if (!ok) {
+        qWarning() << "Failed to connect to Bridge Client socket:" << errorMessage;
         setConnectionState(Error);
         return false;
     }
 
+    m_connected.storeRelease(1);
+    m_reconnectAttempts = 0;
+    qDebug() << "Socket conectado a Bridge Client";
+    setConnectionState(Connected);
+    emit connected();
     return true;
 }
 
@@ -97,13 +133,14 @@ bool AdbSocketClient::connectToDevice(const QString &deviceId)
  */
 void AdbSocketClient::disconnectFromDevice()
 {
-    if (m_socket->state() != QTcpSocket::UnconnectedState) {
-        m_socket->disconnectFromHost();
-        if (m_socket->state() != QTcpSocket::UnconnectedState)
-            m_socket->waitForDisconnected(1000);
-    }
+    // El cierre deliberado no debe provocar una reconexión
+    bool wasConnected = m_connected.fetchAndStoreOrdered(0);
+    m_scanning.storeRelease(0);
+    BridgeSocketWorker *worker = m_worker;
+    QMetaObject::invokeMethod(worker, [worker]() {
+        worker->disconnectFromHost();
+    }, Qt::BlockingQueuedConnection);
 
-    m_connected = false;
     m_reconnectTimer->stop();
     m_reconnectAttempts = 0;
 
@@ -115,6 +152,10 @@ void AdbSocketClient::disconnectFromDevice()
         m_commandQueue.clear();
         m_isProcessingCommands = false;
     }
+
+    if (wasConnected) {
+        emit disconnected();
+    }
 }
 
 /**
@@ -122,7 +163,20 @@ void AdbSocketClient::disconnectFromDevice()
  */
 bool AdbSocketClient::isConnected() const
 {
-    return m_connected;
+    return m_connected.loadAcquire();
+}
+
+void AdbSocketClient::setBinaryEncodingEnabled(bool enabled)
+{
+    m_binaryEncoding = enabled;
+}
+
+void AdbSocketClient::setFastJsonEnabled(bool enabled)
+{
+    BridgeSocketWorker *worker = m_worker;
+    QMetaObject::invokeMethod(worker, [worker, enabled]() {
+        worker->setFastJsonEnabled(enabled);
+    }, Qt::QueuedConnection);
 }
 
 /**
@@ -142,12 +196,40 @@ bool AdbSocketClient::setRole(const QString &role)
     return sendCommand(QString("SET_ROLE:%1").arg(role));
 }
 
+/**
+ * Filtros de escaneo: {"types":[..],"roots":[..],"from":ms,"to":ms,"minSize":bytes}
+ */
+QJsonObject ScanFilter::toJson() const
+{
+    QJsonObject json;
+    if (!types.isEmpty()) json["types"] = QJsonArray::fromStringList(types);
+    if (!rootFolders.isEmpty()) json["roots"] = QJsonArray::fromStringList(rootFolders);
+    if (from.isValid()) json["from"] = from.toMSecsSinceEpoch();
+    if (to.isValid()) json["to"] = to.toMSecsSinceEpoch();
+    if (minSize >= 0) json["minSize"] = minSize;
+    return json;
+}
+
 /**
  * Inicia un escaneo en el dispositivo
  */
-bool AdbSocketClient::startScan()
+bool AdbSocketClient::startScan(const ScanFilter &filter)
 {
-    return sendCommand("START_SCAN");
+    bool sent;
+    if (filter.isEmpty()) {
+        sent = sendCommand("START_SCAN");
+    } else {
+        // JSON compacto en una sola línea: el comando termina en '\n'
+        QByteArray json = QJsonDocument(filter.toJson()).toJson(QJsonDocument::Compact);
+        sent = sendCommand("START_SCAN:" + QString::fromUtf8(json));
+    }
+    if (sent) m_scanning.storeRelease(1);
+    return sent;
+}
+
+bool AdbSocketClient::isScanning() const
+{
+    return m_scanning.loadAcquire();
 }
 
 /**
@@ -166,6 +248,15 @@ bool AdbSocketClient::requestFile(const QString &filePath)
     return sendCommand(QString("GET_FILE:%1").arg(filePath));
 }
 
+/**
+ * Solicita un rango de bytes de un archivo
+ */
+bool AdbSocketClient::requestFileRange(const QString &filePath, qint64 offset, qint64 length)
+{
+    // La ruta va al final porque puede contener ':'
+    return sendCommand(QString("GET_FILE_RANGE:%1:%2:%3").arg(offset).arg(length).arg(filePath));
+}
+
 /**
  * Guarda un archivo en el dispositivo
  */
@@ -215,6 +306,98 @@ bool AdbSocketClient::setupBridgeClient(const QString &deviceId, const QString &
     return connectToDevice(deviceId);
 }
 
+/**
+ * Configura Bridge Client en el hilo de E/S y avisa con setupFinished()
+ */
+void AdbSocketClient::setupBridgeClientAsync(const QString &deviceId, const QString &adbPath)
+{
+    if (m_connected.loadAcquire()) {
+        disconnectFromDevice();
+    }
+
+    m_deviceId = deviceId;
+    m_adbPath = adbPath;
+    setConnectionState(Connecting);
+
+    QString apkPath = QDir::cleanPath(QCoreApplication::applicationDirPath() + "/tools/bridgeclient.apk");
+    BridgeSocketWorker *worker = m_worker;
+    bool binaryEncoding = m_binaryEncoding;
+
+    // El destructor espera a este hilo, así que el cliente sigue vivo al encolar el resultado
+    QMetaObject::invokeMethod(worker, [this, worker, deviceId, adbPath, apkPath, binaryEncoding]() {
+        QString errorMessage;
+        bool ok = prepareBridgeApp(deviceId, adbPath, apkPath, &errorMessage);
+        if (ok) {
+            // La app tarda un momento en abrir su servidor tras am start
+            for (int attempt = 0; attempt < SETUP_CONNECT_ATTEMPTS; ++attempt) {
+                ok = worker->connectToHost(PORT, 2000, &errorMessage);
+                if (ok) break;
+                QThread::msleep(500);
+            }
+            if (ok && binaryEncoding) {
+                worker->requestCborEncoding(); // Antes que cualquier otro comando
+            }
+        }
+
+        QMetaObject::invokeMethod(this, [this, ok, errorMessage]() {
+            if (!ok) emit errorOccurred(errorMessage);
+            emit setupFinished(finishConnect(ok, errorMessage));
+        }, Qt::QueuedConnection);
+    }, Qt::QueuedConnection);
+}
+
+/**
+ * Instala (si falta), redirige el puerto y lanza la app, esperando a cada orden
+ */
+bool AdbSocketClient::prepareBridgeApp(const QString &deviceId, const QString &adbPath, const QString &apkPath,
+                                       QString *errorMessage)
+{
+    if (adbPath.isEmpty()) {
+        *errorMessage = "ADB path is empty";
+        return false;
+    }
+
+    auto runAdb = [&adbPath](const QStringList &args, int timeoutMs, QByteArray *output) {
+        QProcess process;
+        process.start(adbPath, args);
+        if (!process.waitForFinished(timeoutMs)) {
+            process.kill();
+            process.waitForFinished(1000);
+            return false;
+        }
+        if (output) *output = process.readAllStandardOutput();
+        return process.exitStatus() == QProcess::NormalExit && process.exitCode() == 0;
+    };
+
+    QByteArray packages;
+    runAdb(QStringList() << "-s" << deviceId << "shell" << "pm" << "list" << "packages" << "com.laniakeapos.bridgeclient",
+           5000, &packages);
+    if (!packages.contains("com.laniakeapos.bridgeclient")) {
+        if (!QFileInfo(apkPath).isFile()) {
+            *errorMessage = "Bridge Client APK not found at: " + apkPath;
+            return false;
+        }
+        if (!runAdb(QStringList() << "-s" << deviceId << "install" << "-r" << apkPath, INSTALL_TIMEOUT, nullptr)) {
+            *errorMessage = "Failed to install Bridge Client app";
+            return false;
+        }
+    }
+
+    if (!runAdb(QStringList() << "-s" << deviceId << "forward" << QString("tcp:%1").arg(PORT) << QString("tcp:%1").arg(PORT),
+                5000, nullptr)) {
+        *errorMessage = "Failed to forward TCP port";
+        return false;
+    }
+
+    if (!runAdb(QStringList() << "-s" << deviceId << "shell" << "am" << "start"
+                              << "-n" << "com.laniakeapos.bridgeclient/.MainActivity" << "-e" << "role" << "source",
+                10000, nullptr)) {
+        *errorMessage = "Failed to launch Bridge Client app";
+        return false;
+    }
+    return true;
+}
+
 /**
  * Obtiene el estado actual de la conexión
  */
@@ -282,36 +465,32 @@ bool AdbSocketClient::cancelOperation()
 }
 
 /**
- * Lee datos desde el socket
+ * Maneja errores del socket
  */
-void AdbSocketClient::readFromSocket()
+void AdbSocketClient::handleSocketError(const QString &errorMessage)
 {
-    // Leer datos del socket
-    QByteArray data = m_socket->readAll();
-    m_buffer.append(QString::fromUtf8(data));
-
-    // Procesar líneas completas
-    while (m_buffer.contains('\n')) {
-        int lineEnd = m_buffer.indexOf('\n');
-        QString line = m_buffer.left(lineEnd).trimmed();
-        m_buffer = m_buffer.mid(lineEnd + 1);
+    qWarning() << "Socket error:" << errorMessage;
 
-        if (!line.isEmpty()) {
-            processResponse(line);
-        }
-    }
+    setConnectionState(Error);
+    emit errorOccurred(QString("Socket error: %1").arg(errorMessage));
 }
 
 /**
- * Maneja errores del socket
+ * Maneja el cierre de la conexión por parte del dispositivo
  */
-void AdbSocketClient::handleSocketError(QAbstractSocket::SocketError error)
+void AdbSocketClient::handleSocketDisconnected()
 {
-    Q_UNUSED(error);
-    qWarning() << "Socket error:" << m_socket->errorString();
+    if (!m_connected.fetchAndStoreOrdered(0)) return; // Cierre pedido por disconnectFromDevice()
+    m_scanning.storeRelease(0);
 
-    setConnectionState(Error);
-    emit errorOccurred(QString("Socket error: %1").arg(m_socket->errorString()));
+    qDebug() << "Socket desconectado de Bridge Client";
+    setConnectionState(Disconnected);
+    emit disconnected();
+
+    // Intentar reconectar automáticamente
+    if (m_reconnectAttempts < MAX_RECONNECT_ATTEMPTS) {
+        m_reconnectTimer->start(RECONNECT_INTERVAL);
+    }
 }
 
 /**
@@ -364,7 +543,7 @@ void AdbSocketClient::onLaunchAppFinished(int exitCode, QProcess::ExitStatus exi
  */
 void AdbSocketClient::reconnectTimer()
 {
-    if (!m_connected && !m_deviceId.isEmpty() && m_reconnectAttempts < MAX_RECONNECT_ATTEMPTS) {
+    if (!m_connected.loadAcquire() && !m_deviceId.isEmpty() && m_reconnectAttempts < MAX_RECONNECT_ATTEMPTS) {
         m_reconnectAttempts++;
         qDebug() << "Attempting to reconnect to Bridge Client, attempt" << m_reconnectAttempts;
 
@@ -410,7 +589,7 @@ void AdbSocketClient::processNextCommand()
  */
 void AdbSocketClient::checkConnectionState()
 {
-    if (m_connected) {
+    if (m_connected.loadAcquire()) {
         // Enviar ping para verificar que la conexión sigue activa
         ping();
     }
@@ -510,21 +689,23 @@ bool AdbSocketClient::launchApp(const QString &deviceId, const QString &adbPath,
  */
 bool AdbSocketClient::sendCommand(const QString &command)
 {
-    if (!m_connected) {
+    if (!m_connected.loadAcquire()) {
         qWarning() << "Cannot send command, not connected to Bridge Client:" << command;
         return false;
     }
 
+    // La escritura se hace en el hilo de E/S; un fallo allí se notifica como error del socket
     QByteArray data = command.toUtf8() + "\n";
-    qint64 bytesWritten = m_socket->write(data);
-
-    if (bytesWritten != data.size()) {
-        qWarning() << "Failed to write command to socket:" << command;
-        return false;
-    }
+    BridgeSocketWorker *worker = m_worker;
+    QMetaObject::invokeMethod(worker, [worker, data, command]() {
+        if (!worker->sendLine(data)) {
+            qWarning() << "Failed to write command to socket:" << command;
+            emit worker->socketError("No se pudo escribir el comando " + command.section(':', 0, 0));
+        }
+    }, Qt::QueuedConnection);
 
     qDebug() << "Command sent:" << command;
-    return m_socket->flush();
+    return true;
 }
 
 /**
@@ -548,127 +729,6 @@ bool AdbSocketClient::enqueueCommand(const QString &command)
     return true;
 }
 
-/**
- * Procesa una respuesta del dispositivo
- */
-void AdbSocketClient::processResponse(const QString &response)
-{
-    qDebug() << "Received response:" << response;
-
-    // Parsear la respuesta según el protocolo
-    if (response.startsWith("CONNECTED:")) {
-        qDebug() << "Connected to Bridge Client:" << response.mid(10);
-    }
-    else if (response.startsWith("DEVICE_INFO:")) {
-        QString jsonStr = response.mid(12);
-        QJsonDocument doc = QJsonDocument::fromJson(jsonStr.toUtf8());
-        if (doc.isObject()) {
-            emit deviceInfoReceived(doc.object());
-        }
-    }
-    else if (response.startsWith("ROLE_SET:")) {
-        QString role = response.mid(9);
-        qDebug() << "Role set to:" << role;
-    }
-    else if (response == "SCAN_STARTED") {
-        emit scanStarted();
-    }
-    else if (response.startsWith("SCAN_PROGRESS:")) {
-        int progress = response.mid(14).toInt();
-        emit scanProgress(progress);
-    }
-    else if (response == "SCAN_COMPLETED") {
-        emit scanCompleted();
-    }
-    else if (response.startsWith("SCAN_ERROR:")) {
-        QString error = response.mid(11);
-        emit scanError(error);
-    }
-    else if (response.startsWith("MEDIA_COUNT:")) {
-        int count = response.mid(12).toInt();
-        qDebug() << "Media files count:" << count;
-    }
-    else if (response.startsWith("MEDIA_DATA:")) {
-        // Formato: MEDIA_DATA:index:count:jsondata
-        QStringList parts = response.mid(11).split(':', QString::SkipEmptyParts);
-        if (parts.size() >= 3) {
-            int index = parts[0].toInt();
-            int count = parts[1].toInt();
-
-            // Reconstruir el JSON (puede contener ':' internos)
-            QString jsonStr = parts.mid(2).join(':');
-            QJsonDocument doc = QJsonDocument::fromJson(jsonStr.toUtf8());
-            if (doc.isArray()) {
-                emit mediaDataReceived(index, count, doc.array());
-            }
-        }
-    }
-    else if (response.startsWith("FILES_COUNT:")) {
-        int count = response.mid(12).toInt();
-        qDebug() << "Files count:" << count;
-    }
-    else if (response.startsWith("FILES_DATA:")) {
-        // Formato: FILES_DATA:index:count:jsondata
-        QStringList parts = response.mid(11).split(':', QString::SkipEmptyParts);
-        if (parts.size() >= 3) {
-            int index = parts[0].toInt();
-            int count = parts[1].toInt();
-
-            // Reconstruir el JSON (puede contener ':' internos)
-            QString jsonStr = parts.mid(2).join(':');
-            QJsonDocument doc = QJsonDocument::fromJson(jsonStr.toUtf8());
-            if (doc.isArray()) {
-                emit filesDataReceived(index, count, doc.array());
-            }
-        }
-    }
-    else if (response.startsWith("FILE_READY:")) {
-        QString filePath = response.mid(11);
-        emit fileReady(filePath);
-    }
-    else if (response.startsWith("FILE_SAVED:")) {
-        QString result = response.mid(11);
-        emit fileSaved(result);
-    }
-    else if (response == "PONG") {
-        emit pongReceived();
-    }
-    else if (response.startsWith("ERROR:")) {
-        QString error = response.mid(6);
-        emit errorOccurred(error);
-    }
-    else if (response.startsWith("CONTACTS_DATA:")) {
-        // Formato: CONTACTS_DATA:jsondata
-        QString jsonStr = response.mid(14);
-        QJsonDocument doc = QJsonDocument::fromJson(jsonStr.toUtf8());
-        if (doc.isArray()) {
-            emit contactsDataReceived(doc.array());
-        }
-    }
-    else if (response.startsWith("MESSAGES_DATA:")) {
-        // Formato: MESSAGES_DATA:jsondata
-        QString jsonStr = response.mid(14);
-        QJsonDocument doc = QJsonDocument::fromJson(jsonStr.toUtf8());
-        if (doc.isArray()) {
-            emit messagesDataReceived(doc.array());
-        }
-    }
-    else if (response.startsWith("FILE_TRANSFER_PROGRESS:")) {
-        // Formato: FILE_TRANSFER_PROGRESS:path:bytesReceived:totalBytes
-        QStringList parts = response.mid(22).split(':', QString::SkipEmptyParts);
-        if (parts.size() >= 3) {
-            QString filePath = parts[0];
-            qint64 bytesReceived = parts[1].toLongLong();
-            qint64 totalBytes = parts[2].toLongLong();
-
-            emit fileTransferProgress(filePath, bytesReceived, totalBytes);
-        }
-    }
-    else {
-        emit unknownResponseReceived(response);
-    }
-}
-
 /**
  * Establece el estado de conexión y emite la señal correspondiente
  */
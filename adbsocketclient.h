@@ -3,7 +3,7 @@
 
 #include <QObject>
 #include <QProcess>
-#include <QTcpSocket>
+#include <QThread>
 #include <QString>
 #include <QJsonObject>
 #include <QJsonArray>
@@ -13,6 +13,35 @@
 #include <QCoreApplication>
 #include <QMutex>
 #include <QQueue>
+#include <QDateTime>
+#include <QStringList>
+#include <QAtomicInt>
+#include "dataitemstore.h"
+
+class BridgeSocketWorker;
+
+/**
+ * @brief Filtros que Bridge Client aplica en el dispositivo durante un escaneo
+ *
+ * Los campos vacíos no restringen. Lo que no pasa el filtro no se serializa ni se
+ * envía por USB.
+ */
+struct ScanFilter {
+    QStringList types;           ///< Tipos de datos ("photos", "contacts"...)
+    QStringList rootFolders;     ///< Directorios del dispositivo, con sus subdirectorios
+    QDateTime from;              ///< Fecha mínima (inválida: sin límite)
+    QDateTime to;                ///< Fecha máxima, incluida (inválida: sin límite)
+    qint64 minSize = -1;         ///< Tamaño mínimo en bytes (-1: sin límite)
+
+    bool isEmpty() const {
+        return types.isEmpty() && rootFolders.isEmpty() && !from.isValid() && !to.isValid() && minSize < 0;
+    }
+
+    /**
+     * @brief Serializa los filtros presentes para el comando START_SCAN
+     */
+    QJsonObject toJson() const;
+};
 
 /**
  * @brief Clase cliente para comunicación con Bridge Client Android vía socket TCP
@@ -20,6 +49,10 @@
  * Esta clase maneja la comunicación bidireccional con la aplicación Bridge Client
  * en dispositivos Android, utilizando un socket TCP redirigido a través de ADB.
  * Permite enviar comandos, recibir respuestas y gestionar el estado de la conexión.
+ *
+ * El socket y la decodificación de las respuestas viven en un hilo de E/S propio de
+ * cada cliente (BridgeSocketWorker): los comandos se encolan hacia ese hilo y las
+ * respuestas ya decodificadas llegan a los consumidores como señales encoladas.
  */
 class AdbSocketClient : public QObject
 {
@@ -73,6 +106,20 @@ public:
      */
     bool isConnected() const;
 
+    /**
+     * @brief Negociar CBOR para los lotes de datos en las próximas conexiones (activado por defecto)
+     *
+     * Si Bridge Client no lo admite, los lotes siguen llegando en JSON.
+     */
+    void setBinaryEncodingEnabled(bool enabled);
+
+    /**
+     * @brief Leer los lotes JSON directamente del texto, sin QJsonDocument (activado por defecto)
+     *
+     * Un lote que no se pueda leer así se decodifica siempre con QJsonDocument.
+     */
+    void setFastJsonEnabled(bool enabled);
+
     /**
      * @brief Establecer el rol del dispositivo
      * @param role Rol ("source" o "destination")
@@ -82,9 +129,20 @@ public:
 
     /**
      * @brief Iniciar el escaneo del dispositivo
+     *
+     * Sin filtros envía START_SCAN; con filtros, START_SCAN:{json} (ver ScanFilter::toJson()).
+     * @param filter Filtros a aplicar en el dispositivo
      * @return true si el comando se envió correctamente, false en caso contrario
      */
-    bool startScan();
+    bool startScan(const ScanFilter &filter = ScanFilter());
+
+    /**
+     * @brief Indica si hay un escaneo en curso (se puede consultar desde cualquier hilo)
+     *
+     * Mientras dura, los lotes de contactos y mensajes que llegan son los del escaneo.
+     * @return true desde que se envía START_SCAN hasta SCAN_COMPLETED, un error o la desconexión
+     */
+    bool isScanning() const;
 
     /**
      * @brief Obtener información del dispositivo
@@ -99,6 +157,18 @@ public:
      */
     bool requestFile(const QString &filePath);
 
+    /**
+     * @brief Solicitar un rango de bytes de un archivo
+     *
+     * Bridge Client copia el rango a una ruta de intercambio y responde con
+     * FILE_RANGE_READY:offset:length:md5:rutaIntercambio
+     * @param filePath Ruta del archivo en el dispositivo
+     * @param offset Offset inicial del rango
+     * @param length Longitud del rango en bytes
+     * @return true si el comando se envió correctamente, false en caso contrario
+     */
+    bool requestFileRange(const QString &filePath, qint64 offset, qint64 length);
+
     /**
      * @brief Guardar un archivo en el dispositivo
      * @param fileInfo Información sobre el archivo a guardar
@@ -120,6 +190,17 @@ public:
      */
     bool setupBridgeClient(const QString &deviceId, const QString &adbPath);
 
+    /**
+     * @brief Configurar y conectar Bridge Client sin bloquear el hilo que llama
+     *
+     * Las órdenes adb (comprobar/instalar la app, reenvío de puerto, lanzarla) y la
+     * conexión del socket se ejecutan en el hilo de E/S. El resultado llega con
+     * setupFinished(); si tuvo éxito se emite antes connected().
+     * @param deviceId Identificador del dispositivo
+     * @param adbPath Ruta al ejecutable ADB
+     */
+    void setupBridgeClientAsync(const QString &deviceId, const QString &adbPath);
+
     /**
      * @brief Obtener el estado actual de conexión
      * @return Estado de conexión
@@ -177,6 +258,12 @@ signals:
      */
     void errorOccurred(const QString &errorMessage);
 
+    /**
+     * @brief Señal emitida al terminar setupBridgeClientAsync()
+     * @param success true si Bridge Client quedó conectado
+     */
+    void setupFinished(bool success);
+
     // Señales para respuestas
     /**
      * @brief Señal emitida cuando se recibe información del dispositivo
@@ -210,17 +297,17 @@ signals:
      * @brief Señal emitida con lotes de datos multimedia
      * @param index Índice del lote actual
      * @param count Total de lotes
-     * @param mediaData Array JSON con datos multimedia
+     * @param items Elementos del lote (llegados en JSON o en CBOR)
      */
-    void mediaDataReceived(int index, int count, const QJsonArray &mediaData);
+    void mediaDataReceived(int index, int count, const QList<DataItem> &items);
 
     /**
      * @brief Señal emitida con lotes de datos de archivos
      * @param index Índice del lote actual
      * @param count Total de lotes
-     * @param filesData Array JSON con datos de archivos
+     * @param items Elementos del lote (llegados en JSON o en CBOR)
      */
-    void filesDataReceived(int index, int count, const QJsonArray &filesData);
+    void filesDataReceived(int index, int count, const QList<DataItem> &items);
 
     /**
      * @brief Señal emitida cuando un archivo solicitado está listo
@@ -228,6 +315,15 @@ signals:
      */
     void fileReady(const QString &filePath);
 
+    /**
+     * @brief Señal emitida cuando un rango solicitado está listo en el dispositivo
+     * @param offset Offset del rango dentro del archivo original
+     * @param length Longitud del rango
+     * @param md5 MD5 (hex) del rango calculado en el dispositivo
+     * @param stagedPath Ruta de intercambio con el contenido del rango
+     */
+    void fileRangeReady(qint64 offset, qint64 length, const QString &md5, const QString &stagedPath);
+
     /**
      * @brief Señal emitida cuando un archivo se ha guardado
      * @param result Resultado de la operación
@@ -247,15 +343,15 @@ signals:
 
     /**
      * @brief Señal emitida cuando se reciben datos de contactos
-     * @param contactsData Array JSON con datos de contactos
+     * @param contacts Contactos recibidos
      */
-    void contactsDataReceived(const QJsonArray &contactsData);
+    void contactsDataReceived(const QList<DataItem> &contacts);
 
     /**
      * @brief Señal emitida cuando se reciben datos de mensajes
-     * @param messagesData Array JSON con datos de mensajes
+     * @param messages Mensajes recibidos
      */
-    void messagesDataReceived(const QJsonArray &messagesData);
+    void messagesDataReceived(const QList<DataItem> &messages);
 
     /**
      * @brief Señal emitida cuando cambia el estado de la conexión
@@ -273,15 +369,15 @@ signals:
 
 private slots:
     /**
-     * @brief Slot para leer datos del socket
+     * @brief Slot para manejar errores del socket
+     * @param errorMessage Descripción del error
      */
-    void readFromSocket();
+    void handleSocketError(const QString &errorMessage);
 
     /**
-     * @brief Slot para manejar errores del socket
-     * @param error Código de error
+     * @brief Slot para manejar el cierre de la conexión por el dispositivo
      */
-    void handleSocketError(QAbstractSocket::SocketError error);
+    void handleSocketDisconnected();
 
     /**
      * @brief Slot para procesar finalización del comando adb forward
@@ -354,6 +450,21 @@ private:
      */
     bool launchApp(const QString &deviceId, const QString &adbPath, const QString &role);
 
+    /**
+     * @brief Prepara la app en el dispositivo esperando a cada orden adb (hilo de E/S)
+     * @param apkPath APK a instalar si la app no está
+     * @param errorMessage Mensaje de error de salida
+     * @return true si la app quedó lanzada y el puerto redirigido
+     */
+    static bool prepareBridgeApp(const QString &deviceId, const QString &adbPath, const QString &apkPath,
+                                 QString *errorMessage);
+
+    /**
+     * @brief Actualiza el estado tras intentar conectar el socket
+     * @return ok
+     */
+    bool finishConnect(bool ok, const QString &errorMessage);
+
     /**
      * @brief Enviar un comando al dispositivo
      * @param command Comando a enviar
@@ -368,12 +479,6 @@ private:
      */
     bool enqueueCommand(const QString &command);
 
-    /**
-     * @brief Procesar una respuesta recibida
-     * @param response Texto de la respuesta
-     */
-    void processResponse(const QString &response);
-
     /**
      * @brief Establecer el estado de conexión
      * @param state Nuevo estado
@@ -381,12 +486,13 @@ private:
     void setConnectionState(ConnectionState state);
 
     // Variables miembro
-    QTcpSocket *m_socket;             ///< Socket TCP para comunicación
+    QThread *m_ioThread;             ///< Hilo de E/S del socket
+    BridgeSocketWorker *m_worker;    ///< Socket y decodificación (vive en m_ioThread)
     QProcess m_adbProcess;           ///< Proceso para comandos ADB
     QString m_deviceId;              ///< ID del dispositivo conectado
     QString m_adbPath;               ///< Ruta al ejecutable ADB
-    bool m_connected;                ///< Flag de conexión activa
-    QString m_buffer;                ///< Buffer para datos recibidos
+    QAtomicInt m_connected;          ///< Flag de conexión activa (se consulta desde otros hilos)
+    QAtomicInt m_scanning;           ///< Escaneo en curso (se consulta desde otros hilos)
     QTimer *m_reconnectTimer;        ///< Timer para reconexión automática
     int m_reconnectAttempts;         ///< Contador de intentos de reconexión
     ConnectionState m_connectionState; ///< Estado actual de la conexión
@@ -395,6 +501,7 @@ private:
     QQueue<QString> m_commandQueue;  ///< Cola de comandos pendientes
     QTimer *m_connectionCheckTimer;  ///< Timer para verificar estado periódicamente
     bool m_isProcessingCommands;     ///< Flag para control de procesamiento de cola
+    bool m_binaryEncoding;           ///< Pedir CBOR al conectar
 
     // Constantes
     static const int PORT = 38300;                ///< Puerto para comunicación ADB
@@ -402,6 +509,8 @@ private:
     static const int MAX_RECONNECT_ATTEMPTS = 3;  ///< Máximo de intentos de reconexión
     static const int CONNECTION_CHECK_INTERVAL = 10000; ///< 10 segundos para verificación
     static const int COMMAND_TIMEOUT = 30000;     ///< 30 segundos de timeout por comando
+    static const int INSTALL_TIMEOUT = 120000;    ///< 2 minutos para instalar la APK
+    static const int SETUP_CONNECT_ATTEMPTS = 5;  ///< Intentos de conexión mientras arranca la app
 };
 
 #endif // ADBSOCKETCLIENT_H
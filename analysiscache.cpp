@@ -0,0 +1,222 @@
+#include "analysiscache.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <QSaveFile>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include "backuparchive.h"
+
+/**
+ * Constructor: por defecto usa el directorio de caché de la aplicación
+ */
+AnalysisCache::AnalysisCache(const QString &rootPath)
+    : m_rootPath(rootPath)
+{
+    if (m_rootPath.isEmpty()) {
+        m_rootPath = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/analysis";
+    }
+}
+
+QString AnalysisCache::rootPath() const
+{
+    return m_rootPath;
+}
+
+/**
+ * Directorio del dispositivo (el ID puede contener ':' u otros caracteres no válidos en rutas)
+ */
+QString AnalysisCache::deviceDirectory(const QString &deviceId) const
+{
+    QByteArray hash = QCryptographicHash::hash(deviceId.toUtf8(), QCryptographicHash::Md5).toHex();
+    return m_rootPath + "/" + QString::fromLatin1(hash);
+}
+
+QString AnalysisCache::dataSetPath(const QString &deviceId, const QString &dataType) const
+{
+    return deviceDirectory(deviceId) + "/" + dataType + ".mdbcache";
+}
+
+/**
+ * Lee el manifiesto; uno de otra versión se trata como vacío
+ */
+QJsonObject AnalysisCache::readManifest(const QString &deviceId) const
+{
+    QFile file(deviceDirectory(deviceId) + "/manifest.json");
+    if (!file.open(QIODevice::ReadOnly)) return QJsonObject();
+
+    QJsonObject manifest = QJsonDocument::fromJson(file.readAll()).object();
+    if (manifest.value("version").toInt() != FORMAT_VERSION || manifest.value("deviceId").toString() != deviceId) {
+        return QJsonObject();
+    }
+    return manifest;
+}
+
+bool AnalysisCache::writeManifest(const QString &deviceId, const QJsonObject &manifest) const
+{
+    QSaveFile file(deviceDirectory(deviceId) + "/manifest.json");
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    file.write(QJsonDocument(manifest).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+QString AnalysisCache::token(const QString &deviceId, const QString &dataType) const
+{
+    QMutexLocker locker(&m_mutex);
+    return readManifest(deviceId).value("types").toObject().value(dataType).toObject().value("token").toString();
+}
+
+QDateTime AnalysisCache::savedAt(const QString &deviceId, const QString &dataType) const
+{
+    QMutexLocker locker(&m_mutex);
+    qint64 ms = readManifest(deviceId).value("types").toObject().value(dataType).toObject().value("savedAt").toVariant().toLongLong();
+    return ms > 0 ? QDateTime::fromMSecsSinceEpoch(ms) : QDateTime();
+}
+
+QJsonObject AnalysisCache::scanInfo(const QString &deviceId, const QString &dataType) const
+{
+    QMutexLocker locker(&m_mutex);
+    return readManifest(deviceId).value("types").toObject().value(dataType).toObject().value("scan").toObject();
+}
+
+/**
+ * Carga un DataSet si el testigo sigue siendo el mismo
+ */
+bool AnalysisCache::load(const QString &deviceId, const QString &dataType, const QString &token, DataSet &dataSet) const
+{
+    if (token.isEmpty()) return false;
+
+    QMutexLocker locker(&m_mutex);
+    QJsonObject entry = readManifest(deviceId).value("types").toObject().value(dataType).toObject();
+    if (entry.isEmpty() || entry.value("token").toString() != token) return false;
+    return readDataSet(deviceId, dataType, entry, dataSet);
+}
+
+/**
+ * Carga la última versión guardada sin comprobar el testigo
+ */
+bool AnalysisCache::loadLatest(const QString &deviceId, const QString &dataType, DataSet &dataSet) const
+{
+    QMutexLocker locker(&m_mutex);
+    QJsonObject entry = readManifest(deviceId).value("types").toObject().value(dataType).toObject();
+    if (entry.isEmpty()) return false;
+    return readDataSet(deviceId, dataType, entry, dataSet);
+}
+
+/**
+ * Reconstruye un DataSet desde su índice mapeado
+ */
+bool AnalysisCache::readDataSet(const QString &deviceId, const QString &dataType, const QJsonObject &entry,
+                                DataSet &dataSet) const
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    BackupArchiveReader reader;
+    QString error;
+    if (!reader.open(dataSetPath(deviceId, dataType), &error)) {
+        qWarning() << "Caché de análisis no válida para" << deviceId << dataType << ":" << error;
+        return false;
+    }
+
+    dataSet = reader.dataSet(dataType);
+    if (dataSet.items.size() != entry.value("items").toInt()) {
+        qWarning() << "Caché de análisis incompleta para" << deviceId << dataType;
+        return false;
+    }
+    dataSet.duplicateCount = entry.value("duplicates").toInt();
+    dataSet.duplicateSize = entry.value("duplicateSize").toString().toLongLong();
+
+    qDebug() << "Caché de análisis:" << deviceId << dataType << dataSet.items.size()
+             << "elementos en" << timer.elapsed() << "ms";
+    return true;
+}
+
+/**
+ * Escribe el DataSet en un archivo temporal, lo renombra y actualiza el manifiesto
+ */
+bool AnalysisCache::store(const QString &deviceId, const QString &dataType, const QString &token, const DataSet &dataSet,
+                          const QJsonObject &scanInfo)
+{
+    if (token.isEmpty()) return false;
+
+    QMutexLocker locker(&m_mutex);
+    QString directory = deviceDirectory(deviceId);
+    if (!QDir().mkpath(directory)) {
+        qWarning() << "No se pudo crear el directorio de caché:" << directory;
+        return false;
+    }
+
+    QString path = dataSetPath(deviceId, dataType);
+    QString tempPath = path + ".tmp";
+    QFile::remove(tempPath); // El escritor añade al final de un respaldo existente
+
+    BackupArchiveWriter writer;
+    QString error;
+    bool ok = writer.open(tempPath, &error);
+    for (int i = 0; ok && i < dataSet.items.size(); ++i) {
+        ok = writer.appendRecord(dataType, dataSet.items.at(i));
+    }
+    ok = ok && writer.finish(&error);
+
+    if (ok) {
+        QFile::remove(path);
+        ok = QFile::rename(tempPath, path);
+    }
+    if (!ok) {
+        qWarning() << "No se pudo guardar la caché de análisis de" << deviceId << dataType << ":" << error;
+        QFile::remove(tempPath);
+        removeEntry(deviceId, dataType);
+        return false;
+    }
+
+    QJsonObject manifest = readManifest(deviceId);
+    manifest["version"] = FORMAT_VERSION;
+    manifest["deviceId"] = deviceId;
+
+    QJsonObject entry;
+    entry["token"] = token;
+    entry["items"] = dataSet.items.size();
+    entry["totalSize"] = QString::number(dataSet.totalSize);
+    entry["duplicates"] = dataSet.duplicateCount;
+    entry["duplicateSize"] = QString::number(dataSet.duplicateSize);
+    entry["savedAt"] = QString::number(QDateTime::currentMSecsSinceEpoch());
+    if (!scanInfo.isEmpty()) entry["scan"] = scanInfo;
+
+    QJsonObject types = manifest.value("types").toObject();
+    types[dataType] = entry;
+    manifest["types"] = types;
+    return writeManifest(deviceId, manifest);
+}
+
+/**
+ * Elimina entradas de la caché
+ */
+void AnalysisCache::invalidate(const QString &deviceId, const QString &dataType)
+{
+    QMutexLocker locker(&m_mutex);
+    if (dataType.isEmpty()) {
+        QDir(deviceDirectory(deviceId)).removeRecursively();
+        return;
+    }
+    removeEntry(deviceId, dataType);
+}
+
+/**
+ * Quita un tipo del manifiesto y borra su archivo (con m_mutex tomado)
+ */
+void AnalysisCache::removeEntry(const QString &deviceId, const QString &dataType)
+{
+    QJsonObject manifest = readManifest(deviceId);
+    QJsonObject types = manifest.value("types").toObject();
+    if (types.contains(dataType)) {
+        types.remove(dataType);
+        manifest["types"] = types;
+        writeManifest(deviceId, manifest);
+    }
+    QFile::remove(dataSetPath(deviceId, dataType));
+}
@@ -0,0 +1,108 @@
+#ifndef ANALYSISCACHE_H
+#define ANALYSISCACHE_H
+
+#include <QString>
+#include <QDateTime>
+#include <QJsonObject>
+#include <QMutex>
+#include "dataanalyzer.h"
+
+/*
+ * Caché en disco de los análisis, un directorio por dispositivo:
+ *
+ *   <raíz>/<md5 del ID>/manifest.json      ID, versión y, por tipo, testigo de cambios,
+ *                                          número de elementos, tamaño, duplicados, fecha
+ *                                          de guardado y datos del recorrido ("scan")
+ *   <raíz>/<md5 del ID>/<tipo>.mdbcache    DataSet en formato de respaldo (.mdbarchive)
+ *                                          solo con registros: el índice se mapea al cargar
+ *
+ * El testigo lo calcula quien analiza (huella barata de los datos del dispositivo);
+ * un DataSet solo se devuelve si el testigo guardado coincide con el actual.
+ *
+ * Los métodos públicos se pueden llamar desde cualquier hilo: DataAnalyzer guarda
+ * desde su hilo de E/S y carga desde el de la interfaz.
+ */
+
+/**
+ * @class AnalysisCache
+ * @brief Guarda y recupera DataSets analizados por dispositivo y tipo de datos
+ */
+class AnalysisCache
+{
+public:
+    /**
+     * @brief Constructor
+     * @param rootPath Directorio raíz de la caché (vacío para el de caché de la aplicación)
+     */
+    explicit AnalysisCache(const QString &rootPath = QString());
+
+    /**
+     * @brief Directorio raíz de la caché
+     */
+    QString rootPath() const;
+
+    /**
+     * @brief Testigo guardado para un tipo, o vacío si no hay entrada
+     */
+    QString token(const QString &deviceId, const QString &dataType) const;
+
+    /**
+     * @brief Fecha en que se guardó un tipo, o inválida si no hay entrada
+     */
+    QDateTime savedAt(const QString &deviceId, const QString &dataType) const;
+
+    /**
+     * @brief Carga un DataSet si su testigo coincide con el indicado
+     * @param deviceId ID del dispositivo
+     * @param dataType Tipo de datos
+     * @param token Testigo actual del dispositivo
+     * @param dataSet DataSet de salida
+     * @return false si no hay entrada, el testigo no coincide o el archivo no es válido
+     */
+    bool load(const QString &deviceId, const QString &dataType, const QString &token, DataSet &dataSet) const;
+
+    /**
+     * @brief Carga la última versión guardada de un tipo sin comprobar el testigo
+     *
+     * Sirve de base para los análisis incrementales, que solo piden al dispositivo
+     * lo que cambió desde entonces.
+     * @return false si no hay entrada o el archivo no es válido
+     */
+    bool loadLatest(const QString &deviceId, const QString &dataType, DataSet &dataSet) const;
+
+    /**
+     * @brief Datos del recorrido que produjo la entrada de un tipo, o vacío si no hay
+     *
+     * Los guarda quien analiza (filas contadas en el dispositivo, mayor _id, hora del
+     * dispositivo...) para el siguiente análisis incremental.
+     */
+    QJsonObject scanInfo(const QString &deviceId, const QString &dataType) const;
+
+    /**
+     * @brief Guarda (reemplazando) el DataSet de un tipo junto con su testigo
+     * @param scanInfo Datos del recorrido (ver scanInfo())
+     * @return true si se escribieron el DataSet y el manifiesto
+     */
+    bool store(const QString &deviceId, const QString &dataType, const QString &token, const DataSet &dataSet,
+               const QJsonObject &scanInfo = QJsonObject());
+
+    /**
+     * @brief Elimina la entrada de un tipo, o todas las del dispositivo si dataType está vacío
+     */
+    void invalidate(const QString &deviceId, const QString &dataType = QString());
+
+private:
+    QString deviceDirectory(const QString &deviceId) const;
+    QString dataSetPath(const QString &deviceId, const QString &dataType) const;
+    QJsonObject readManifest(const QString &deviceId) const;
+    bool readDataSet(const QString &deviceId, const QString &dataType, const QJsonObject &entry, DataSet &dataSet) const;
+    bool writeManifest(const QString &deviceId, const QJsonObject &manifest) const;
+    void removeEntry(const QString &deviceId, const QString &dataType);
+
+    QString m_rootPath;
+    mutable QMutex m_mutex; // Serializa el acceso a los archivos de la caché
+
+    static const int FORMAT_VERSION = 4; // Cambia si cambia lo que producen los análisis
+};
+
+#endif // ANALYSISCACHE_H
@@ -0,0 +1,641 @@
+#include "backuparchive.h"
+#include <QDebug>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtEndian>
+#include <QVector>
+#include <QSet>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+const char HEADER_MAGIC[8] = {'M', 'D', 'B', 'A', 'R', 'C', '0', '1'};
+const char FOOTER_MAGIC[8] = {'M', 'D', 'B', 'I', 'D', 'X', '0', '1'};
+const quint32 FORMAT_VERSION = 1;
+const int HEADER_SIZE = 16;
+const int FOOTER_SIZE = 32;
+const int RECORD_SIZE = 72;
+const qint64 INVALID_DATE = std::numeric_limits<qint64>::min();
+
+// Offsets de los campos dentro de un registro del índice
+enum RecordField {
+    FieldDataOffset = 0,
+    FieldDataSize = 8,
+    FieldItemSize = 16,
+    FieldDateTime = 24,
+    FieldType = 32,
+    FieldId = 40,
+    FieldName = 48,
+    FieldPath = 56,
+    FieldMeta = 64
+};
+
+void putU32(char *dest, quint32 value) { qToLittleEndian(value, reinterpret_cast<uchar *>(dest)); }
+void putU64(char *dest, quint64 value) { qToLittleEndian(value, reinterpret_cast<uchar *>(dest)); }
+quint32 getU32(const uchar *src) { return qFromLittleEndian<quint32>(src); }
+quint64 getU64(const uchar *src) { return qFromLittleEndian<quint64>(src); }
+
+} // namespace
+
+/**
+ * Constructor del escritor
+ */
+BackupArchiveWriter::BackupArchiveWriter()
+    : m_position(0)
+    , m_entryOpen(false)
+{
+}
+
+BackupArchiveWriter::~BackupArchiveWriter()
+{
+    if (m_file.isOpen()) {
+        finish();
+    }
+}
+
+/**
+ * Abre un archivo para escritura; si ya es un respaldo válido se añade al final
+ */
+bool BackupArchiveWriter::open(const QString &path, QString *errorMessage)
+{
+    if (m_file.isOpen()) {
+        if (errorMessage) *errorMessage = "El escritor ya tiene un archivo abierto";
+        return false;
+    }
+
+    m_entries.clear();
+    m_buffer.clear();
+    m_buffer.reserve(WRITE_BUFFER_SIZE);
+
+    // Conservar el índice de un respaldo previo para reescribirlo completo al final
+    qint64 validSize = -1;
+    if (QFileInfo(path).size() > 0) {
+        BackupArchiveReader reader;
+        QString readError;
+        if (!reader.open(path, &readError)) {
+            if (errorMessage) *errorMessage = "El archivo existe pero no es un respaldo válido: " + readError;
+            return false;
+        }
+        m_entries.reserve(reader.entryCount());
+        for (int i = 0; i < reader.entryCount(); ++i) {
+            m_entries.append(reader.entry(i));
+        }
+        validSize = reader.validSize();
+    }
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        if (errorMessage) *errorMessage = QString("No se pudo abrir %1: %2").arg(path, m_file.errorString());
+        return false;
+    }
+
+    // Descartar los restos de un añadido interrumpido (datos sin índice tras el último pie)
+    if (validSize >= 0 && m_file.size() > validSize) {
+        qWarning() << "Descartando" << (m_file.size() - validSize) << "bytes de un añadido incompleto en" << path;
+        if (!m_file.resize(validSize)) {
+            if (errorMessage) *errorMessage = QString("No se pudo recortar %1: %2").arg(path, m_file.errorString());
+            m_file.close();
+            return false;
+        }
+    }
+
+    m_position = m_file.size();
+    m_file.seek(m_position);
+
+    if (m_position == 0) {
+        char header[HEADER_SIZE];
+        memcpy(header, HEADER_MAGIC, 8);
+        putU32(header + 8, FORMAT_VERSION);
+        putU32(header + 12, 0);
+        writeRaw(header, HEADER_SIZE);
+    }
+
+    qDebug() << "Archivo de respaldo abierto para escritura:" << path << "Entradas previas:" << m_entries.size();
+    return true;
+}
+
+bool BackupArchiveWriter::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+/**
+ * Comienza una entrada con contenido de archivo
+ */
+bool BackupArchiveWriter::beginEntry(const QString &dataType, const DataItem &item)
+{
+    if (!m_file.isOpen() || m_entryOpen) return false;
+
+    m_currentEntry.dataType = dataType;
+    m_currentEntry.item = item;
+    m_currentEntry.dataOffset = m_position;
+    m_currentEntry.dataSize = 0;
+    m_entryOpen = true;
+    return true;
+}
+
+bool BackupArchiveWriter::writeData(const char *data, qint64 size)
+{
+    if (!m_entryOpen) return false;
+    if (!writeRaw(data, size)) return false;
+    m_currentEntry.dataSize += size;
+    return true;
+}
+
+bool BackupArchiveWriter::endEntry()
+{
+    if (!m_entryOpen) return false;
+    m_entries.append(m_currentEntry);
+    m_entryOpen = false;
+    return true;
+}
+
+void BackupArchiveWriter::abortEntry()
+{
+    m_entryOpen = false;
+}
+
+/**
+ * Añade un registro sin contenido de archivo
+ */
+bool BackupArchiveWriter::appendRecord(const QString &dataType, const DataItem &item)
+{
+    if (!m_file.isOpen() || m_entryOpen) return false;
+
+    BackupArchiveEntry entry;
+    entry.dataType = dataType;
+    entry.item = item;
+    entry.dataOffset = m_position;
+    entry.dataSize = 0;
+    m_entries.append(entry);
+    return true;
+}
+
+int BackupArchiveWriter::entryCount() const
+{
+    return m_entries.size();
+}
+
+/**
+ * Escribe el índice ordenado por (tipo, ruta) y el pie, y cierra el archivo
+ */
+bool BackupArchiveWriter::finish(QString *errorMessage)
+{
+    if (!m_file.isOpen()) return true;
+    if (m_entryOpen) abortEntry();
+
+    // Preparar claves UTF-8 una sola vez para ordenar
+    struct IndexRow {
+        QByteArray type;
+        QByteArray path;
+        int entry;
+    };
+    QVector<IndexRow> rows;
+    rows.reserve(m_entries.size());
+
+    // Al añadir a un respaldo existente, un elemento guardado otra vez (mismo tipo y ruta,
+    // o mismo id si es un registro sin ruta) sustituye al anterior: se recorre desde el final
+    // y solo entra la última copia, cuyos bytes son los más recientes
+    QSet<QByteArray> seen;
+    for (int i = m_entries.size() - 1; i >= 0; --i) {
+        const BackupArchiveEntry &entry = m_entries[i];
+        QByteArray type = entry.dataType.toUtf8();
+        QByteArray path = entry.item.filePath.toUtf8();
+        QByteArray key = type + '\0' + (path.isEmpty() ? '\1' + entry.item.id.toUtf8() : path);
+        if (!path.isEmpty() || !entry.item.id.isEmpty()) {
+            if (seen.contains(key)) continue;
+            seen.insert(key);
+        }
+        rows.append({type, path, i});
+    }
+    std::reverse(rows.begin(), rows.end());
+    std::stable_sort(rows.begin(), rows.end(), [](const IndexRow &a, const IndexRow &b) {
+        if (a.type != b.type) return a.type < b.type;
+        return a.path < b.path;
+    });
+
+    QByteArray records(rows.size() * RECORD_SIZE, '\0');
+    QByteArray strings;
+    auto addString = [&strings](char *field, const QByteArray &value) {
+        putU32(field, static_cast<quint32>(strings.size()));
+        putU32(field + 4, static_cast<quint32>(value.size()));
+        strings.append(value);
+    };
+
+    for (int r = 0; r < rows.size(); ++r) {
+        const BackupArchiveEntry &entry = m_entries[rows[r].entry];
+        char *record = records.data() + r * RECORD_SIZE;
+
+        putU64(record + FieldDataOffset, static_cast<quint64>(entry.dataOffset));
+        putU64(record + FieldDataSize, static_cast<quint64>(entry.dataSize));
+        putU64(record + FieldItemSize, static_cast<quint64>(entry.item.size));
+        putU64(record + FieldDateTime, static_cast<quint64>(entry.item.dateTime.isValid()
+                                                            ? entry.item.dateTime.toMSecsSinceEpoch()
+                                                            : INVALID_DATE));
+        addString(record + FieldType, rows[r].type);
+        addString(record + FieldId, entry.item.id.toUtf8());
+        addString(record + FieldName, entry.item.displayName.toUtf8());
+        addString(record + FieldPath, rows[r].path);
+        addString(record + FieldMeta, entry.item.data.isEmpty()
+                                      ? QByteArray()
+                                      : QJsonDocument(QJsonObject::fromVariantMap(entry.item.data)).toJson(QJsonDocument::Compact));
+    }
+
+    qint64 indexOffset = m_position;
+    char indexHeader[8];
+    putU32(indexHeader, RECORD_SIZE);
+    putU32(indexHeader + 4, static_cast<quint32>(rows.size()));
+
+    bool ok = writeRaw(indexHeader, sizeof(indexHeader))
+              && writeRaw(records.constData(), records.size())
+              && writeRaw(strings.constData(), strings.size());
+
+    char footer[FOOTER_SIZE];
+    putU64(footer, static_cast<quint64>(indexOffset));
+    putU64(footer + 8, static_cast<quint64>(m_position - indexOffset));
+    putU32(footer + 16, static_cast<quint32>(rows.size()));
+    putU32(footer + 20, 0);
+    memcpy(footer + 24, FOOTER_MAGIC, 8);
+
+    ok = ok && writeRaw(footer, FOOTER_SIZE) && flushBuffer();
+    if (!ok && errorMessage) *errorMessage = m_lastError;
+
+    qDebug() << "Archivo de respaldo cerrado:" << m_file.fileName() << "Entradas:" << rows.size()
+             << "Tamaño:" << m_position;
+
+    m_file.close();
+    m_entries.clear();
+    m_buffer.clear();
+    m_buffer.squeeze();
+    return ok;
+}
+
+/**
+ * Escribe en el búfer; los bloques grandes van directos al archivo
+ */
+bool BackupArchiveWriter::writeRaw(const char *data, qint64 size)
+{
+    if (size <= 0) return true;
+
+    if (m_buffer.size() + size > WRITE_BUFFER_SIZE && !flushBuffer()) {
+        return false;
+    }
+
+    if (size >= WRITE_BUFFER_SIZE) {
+        if (m_file.write(data, size) != size) {
+            m_lastError = m_file.errorString();
+            return false;
+        }
+    } else {
+        m_buffer.append(data, static_cast<int>(size));
+    }
+
+    m_position += size;
+    return true;
+}
+
+bool BackupArchiveWriter::flushBuffer()
+{
+    if (m_buffer.isEmpty()) return true;
+
+    if (m_file.write(m_buffer) != m_buffer.size()) {
+        m_lastError = m_file.errorString();
+        return false;
+    }
+    m_buffer.resize(0);
+    return true;
+}
+
+/**
+ * Constructor del lector
+ */
+BackupArchiveReader::BackupArchiveReader()
+    : m_index(nullptr)
+    , m_indexSize(0)
+    , m_count(0)
+    , m_strings(nullptr)
+    , m_stringsSize(0)
+    , m_validSize(0)
+{
+}
+
+BackupArchiveReader::~BackupArchiveReader()
+{
+    close();
+}
+
+/**
+ * Abre un respaldo, localiza el último pie válido y mapea su índice
+ */
+bool BackupArchiveReader::open(const QString &path, QString *errorMessage)
+{
+    close();
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        if (errorMessage) *errorMessage = m_file.errorString();
+        return false;
+    }
+
+    qint64 fileSize = m_file.size();
+    char header[HEADER_SIZE];
+    if (fileSize < HEADER_SIZE + FOOTER_SIZE
+        || m_file.read(header, HEADER_SIZE) != HEADER_SIZE
+        || memcmp(header, HEADER_MAGIC, 8) != 0) {
+        if (errorMessage) *errorMessage = "Formato de respaldo no reconocido";
+        close();
+        return false;
+    }
+
+    qint64 indexOffset = 0;
+    qint64 footerPos = findValidFooter(fileSize, indexOffset, m_indexSize);
+    if (footerPos < 0) {
+        if (errorMessage) *errorMessage = "Respaldo incompleto: no hay ningún índice válido";
+        close();
+        return false;
+    }
+    m_validSize = footerPos + FOOTER_SIZE;
+    if (m_validSize < fileSize) {
+        qWarning() << "Respaldo con un añadido incompleto, se usa el índice anterior:" << path
+                   << "Bytes sin índice:" << (fileSize - m_validSize);
+    }
+
+    m_index = m_file.map(indexOffset, m_indexSize);
+    if (!m_index) {
+        if (errorMessage) *errorMessage = "No se pudo mapear el índice: " + m_file.errorString();
+        close();
+        return false;
+    }
+
+    quint32 recordSize = getU32(m_index);
+    m_count = static_cast<int>(getU32(m_index + 4));
+    qint64 recordsEnd = 8 + static_cast<qint64>(m_count) * RECORD_SIZE;
+    if (recordSize != RECORD_SIZE || recordsEnd > m_indexSize) {
+        if (errorMessage) *errorMessage = "Versión de índice no soportada";
+        close();
+        return false;
+    }
+
+    m_strings = m_index + recordsEnd;
+    m_stringsSize = m_indexSize - recordsEnd;
+    return true;
+}
+
+/**
+ * Valida el pie situado en footerPos: su índice debe terminar justo donde empieza el pie
+ */
+bool BackupArchiveReader::readFooter(qint64 footerPos, qint64 &indexOffset, qint64 &indexSize)
+{
+    char footer[FOOTER_SIZE];
+    if (footerPos < HEADER_SIZE
+        || !m_file.seek(footerPos)
+        || m_file.read(footer, FOOTER_SIZE) != FOOTER_SIZE
+        || memcmp(footer + 24, FOOTER_MAGIC, 8) != 0) {
+        return false;
+    }
+
+    const uchar *footerData = reinterpret_cast<const uchar *>(footer);
+    qint64 offset = static_cast<qint64>(getU64(footerData));
+    qint64 size = static_cast<qint64>(getU64(footerData + 8));
+    quint32 count = getU32(footerData + 16);
+    if (offset < HEADER_SIZE || size < 8 || offset > footerPos || footerPos - offset != size) {
+        return false;
+    }
+
+    // La cabecera del índice debe coincidir con el pie
+    char indexHeader[8];
+    if (!m_file.seek(offset) || m_file.read(indexHeader, 8) != 8) return false;
+    const uchar *headerData = reinterpret_cast<const uchar *>(indexHeader);
+    if (getU32(headerData) != RECORD_SIZE || getU32(headerData + 4) != count
+        || 8 + static_cast<qint64>(count) * RECORD_SIZE > size) {
+        return false;
+    }
+
+    indexOffset = offset;
+    indexSize = size;
+    return true;
+}
+
+/**
+ * Pie al final del archivo o, si un añadido se interrumpió, el último pie válido anterior
+ */
+qint64 BackupArchiveReader::findValidFooter(qint64 fileSize, qint64 &indexOffset, qint64 &indexSize)
+{
+    if (readFooter(fileSize - FOOTER_SIZE, indexOffset, indexSize)) {
+        return fileSize - FOOTER_SIZE;
+    }
+
+    // Buscar hacia atrás la firma del pie, por bloques (solo ocurre al recuperar un respaldo)
+    const QByteArray magic(FOOTER_MAGIC, 8);
+    const qint64 blockSize = 1024 * 1024;
+    qint64 end = fileSize;
+    while (end > HEADER_SIZE) {
+        qint64 start = qMax<qint64>(HEADER_SIZE, end - blockSize);
+        qint64 readEnd = qMin(fileSize, end + magic.size() - 1); // Firmas que cruzan el límite del bloque
+        if (!m_file.seek(start)) return -1;
+        QByteArray block = m_file.read(readEnd - start);
+
+        int pos = block.lastIndexOf(magic);
+        while (pos >= 0) {
+            qint64 footerPos = start + pos - 24;
+            if (footerPos + FOOTER_SIZE <= fileSize && readFooter(footerPos, indexOffset, indexSize)) {
+                return footerPos;
+            }
+            pos = pos > 0 ? block.lastIndexOf(magic, pos - 1) : -1;
+        }
+        end = start;
+    }
+    return -1;
+}
+
+void BackupArchiveReader::close()
+{
+    if (m_index) {
+        m_file.unmap(m_index);
+        m_index = nullptr;
+    }
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+    m_indexSize = 0;
+    m_count = 0;
+    m_strings = nullptr;
+    m_stringsSize = 0;
+    m_validSize = 0;
+}
+
+bool BackupArchiveReader::isOpen() const
+{
+    return m_index != nullptr;
+}
+
+int BackupArchiveReader::entryCount() const
+{
+    return m_count;
+}
+
+QString BackupArchiveReader::fileName() const
+{
+    return m_file.fileName();
+}
+
+qint64 BackupArchiveReader::validSize() const
+{
+    return m_validSize;
+}
+
+const uchar *BackupArchiveReader::record(int index) const
+{
+    return m_index + 8 + static_cast<qint64>(index) * RECORD_SIZE;
+}
+
+/**
+ * Devuelve una cadena de la tabla sin copiarla (fromRawData sobre el mapeo)
+ */
+QByteArray BackupArchiveReader::recordString(const uchar *rec, int fieldOffset) const
+{
+    quint32 offset = getU32(rec + fieldOffset);
+    quint32 length = getU32(rec + fieldOffset + 4);
+    if (static_cast<qint64>(offset) + length > m_stringsSize) {
+        return QByteArray();
+    }
+    return QByteArray::fromRawData(reinterpret_cast<const char *>(m_strings + offset), static_cast<int>(length));
+}
+
+QByteArray BackupArchiveReader::recordType(int index) const
+{
+    return recordString(record(index), FieldType);
+}
+
+QByteArray BackupArchiveReader::recordPath(int index) const
+{
+    return recordString(record(index), FieldPath);
+}
+
+/**
+ * Primer registro con (tipo, ruta) >= (type, path)
+ */
+int BackupArchiveReader::lowerBound(const QByteArray &type, const QByteArray &path) const
+{
+    int low = 0;
+    int high = m_count;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        QByteArray midType = recordType(mid);
+        bool less = midType < type || (midType == type && recordPath(mid) < path);
+        if (less) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/**
+ * Decodifica la entrada i del índice
+ */
+BackupArchiveEntry BackupArchiveReader::entry(int index) const
+{
+    BackupArchiveEntry result;
+    result.dataOffset = 0;
+    result.dataSize = 0;
+    result.item.size = 0;
+    if (index < 0 || index >= m_count) return result;
+
+    const uchar *rec = record(index);
+    result.dataOffset = static_cast<qint64>(getU64(rec + FieldDataOffset));
+    result.dataSize = static_cast<qint64>(getU64(rec + FieldDataSize));
+    result.dataType = QString::fromUtf8(recordString(rec, FieldType));
+    result.item.size = static_cast<qint64>(getU64(rec + FieldItemSize));
+
+    qint64 dateMs = static_cast<qint64>(getU64(rec + FieldDateTime));
+    if (dateMs != INVALID_DATE) {
+        result.item.dateTime = QDateTime::fromMSecsSinceEpoch(dateMs);
+    }
+
+    result.item.id = QString::fromUtf8(recordString(rec, FieldId));
+    result.item.displayName = QString::fromUtf8(recordString(rec, FieldName));
+    result.item.filePath = QString::fromUtf8(recordString(rec, FieldPath));
+
+    QByteArray meta = recordString(rec, FieldMeta);
+    if (!meta.isEmpty()) {
+        result.item.data = QJsonDocument::fromJson(meta).object().toVariantMap();
+    }
+    return result;
+}
+
+/**
+ * Tipos de datos presentes (saltando de tipo en tipo con búsqueda binaria)
+ */
+QStringList BackupArchiveReader::dataTypes() const
+{
+    QStringList types;
+    int index = 0;
+    while (index < m_count) {
+        QByteArray type = recordType(index);
+        types << QString::fromUtf8(type);
+        // Siguiente tipo: primer registro mayor que cualquier ruta de este tipo
+        QByteArray nextType = type;
+        nextType.append('\0');
+        index = lowerBound(nextType, QByteArray());
+    }
+    return types;
+}
+
+/**
+ * Busca una entrada por ruta original
+ */
+int BackupArchiveReader::findEntry(const QString &filePath, const QString &dataType) const
+{
+    QByteArray path = filePath.toUtf8();
+    const QStringList types = dataType.isEmpty() ? dataTypes() : QStringList(dataType);
+
+    for (const QString &type : types) {
+        QByteArray typeKey = type.toUtf8();
+        int index = lowerBound(typeKey, path);
+        if (index < m_count && recordType(index) == typeKey && recordPath(index) == path) {
+            return index;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Tamaño del rango del índice de ese tipo
+ */
+int BackupArchiveReader::entryCount(const QString &dataType) const
+{
+    QByteArray typeKey = dataType.toUtf8();
+    QByteArray nextType = typeKey;
+    nextType.append('\0');
+    return lowerBound(nextType, QByteArray()) - lowerBound(typeKey, QByteArray());
+}
+
+/**
+ * Reconstruye un DataSet a partir del rango del índice de ese tipo
+ */
+DataSet BackupArchiveReader::dataSet(const QString &dataType) const
+{
+    DataSet result;
+    result.type = dataType;
+    result.isSupported = true;
+    result.totalSize = 0;
+
+    QByteArray typeKey = dataType.toUtf8();
+    QByteArray nextType = typeKey;
+    nextType.append('\0');
+    int begin = lowerBound(typeKey, QByteArray());
+    int end = lowerBound(nextType, QByteArray());
+
+    result.items.reserve(end - begin);
+    for (int i = begin; i < end; ++i) {
+        BackupArchiveEntry archived = entry(i);
+        result.totalSize += archived.item.size;
+        result.items.append(archived.item);
+    }
+    return result;
+}
@@ -0,0 +1,207 @@
+#ifndef BACKUPARCHIVE_H
+#define BACKUPARCHIVE_H
+
+#include <QString>
+#include <QStringList>
+#include <QFile>
+#include <QList>
+#include <QByteArray>
+#include "dataanalyzer.h"
+
+/*
+ * Formato del archivo de respaldo (.mdbarchive), todo en little endian:
+ *
+ *   [cabecera 16 B]  "MDBARC01" + versión (u32) + reservado (u32)
+ *   [datos]          contenidos de archivo concatenados, escritos secuencialmente
+ *   [índice]         recordSize (u32) + count (u32) + count registros de 72 B + tabla de cadenas
+ *   [pie 32 B]       offset del índice (u64) + tamaño (u64) + count (u32) + reservado (u32) + "MDBIDX01"
+ *
+ * El archivo solo crece: al añadir elementos a un respaldo existente se escriben los
+ * datos nuevos tras el pie anterior y después un índice completo y un pie nuevos.
+ * Si un añadido se interrumpe antes de escribir su pie, el lector usa el último pie
+ * válido (el del respaldo anterior) y el siguiente añadido descarta los bytes sobrantes.
+ * Los registros del índice están ordenados por (tipo, ruta), lo que permite buscar
+ * por ruta o recorrer un tipo con búsqueda binaria directamente sobre el índice mapeado.
+ */
+
+// Entrada del índice de un archivo de respaldo
+struct BackupArchiveEntry {
+    QString dataType;     // Tipo de datos ("photos", "contacts", ...)
+    DataItem item;        // Elemento original (filePath es la ruta en el dispositivo origen)
+    qint64 dataOffset;    // Offset del contenido dentro del archivo
+    qint64 dataSize;      // Tamaño del contenido (0 para registros sin archivo)
+};
+
+/**
+ * @class BackupArchiveWriter
+ * @brief Escritor append-only de archivos de respaldo
+ *
+ * Agrupa las escrituras en un búfer grande para que el disco reciba bloques
+ * secuenciales. El índice se escribe al llamar a finish().
+ */
+class BackupArchiveWriter
+{
+public:
+    BackupArchiveWriter();
+    ~BackupArchiveWriter();
+
+    /**
+     * @brief Abre un archivo para escritura; si ya es un respaldo válido se añade al final
+     * @param path Ruta del archivo
+     * @param errorMessage Mensaje de error de salida (opcional)
+     * @return true si se abrió correctamente
+     */
+    bool open(const QString &path, QString *errorMessage = nullptr);
+
+    /**
+     * @brief Indica si hay un archivo abierto
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Comienza una entrada con contenido de archivo
+     * @param dataType Tipo de datos
+     * @param item Elemento a guardar
+     * @return false si ya hay una entrada abierta o el archivo no está abierto
+     */
+    bool beginEntry(const QString &dataType, const DataItem &item);
+
+    /**
+     * @brief Escribe contenido de la entrada abierta
+     */
+    bool writeData(const char *data, qint64 size);
+
+    /**
+     * @brief Cierra la entrada abierta y la añade al índice
+     */
+    bool endEntry();
+
+    /**
+     * @brief Descarta la entrada abierta (sus bytes quedan sin referenciar)
+     */
+    void abortEntry();
+
+    /**
+     * @brief Añade un registro sin contenido de archivo (contactos, mensajes...)
+     */
+    bool appendRecord(const QString &dataType, const DataItem &item);
+
+    /**
+     * @brief Escribe el índice y el pie y cierra el archivo
+     * @param errorMessage Mensaje de error de salida (opcional)
+     * @return true si el archivo quedó consistente
+     */
+    bool finish(QString *errorMessage = nullptr);
+
+    /**
+     * @brief Número de entradas (incluidas las de respaldos anteriores)
+     */
+    int entryCount() const;
+
+private:
+    bool flushBuffer();
+    bool writeRaw(const char *data, qint64 size);
+
+    QFile m_file;
+    QByteArray m_buffer;
+    qint64 m_position;
+    QList<BackupArchiveEntry> m_entries;
+    bool m_entryOpen;
+    BackupArchiveEntry m_currentEntry;
+    QString m_lastError;
+
+    static const int WRITE_BUFFER_SIZE = 8 * 1024 * 1024; // 8 MB
+};
+
+/**
+ * @class BackupArchiveReader
+ * @brief Lector de archivos de respaldo con índice mapeado en memoria
+ *
+ * Solo se leen el pie y el índice (mapeado con QFile::map); los registros se
+ * decodifican bajo demanda, por lo que abrir y explorar un respaldo con cientos
+ * de miles de elementos no requiere leer los datos.
+ */
+class BackupArchiveReader
+{
+public:
+    BackupArchiveReader();
+    ~BackupArchiveReader();
+
+    /**
+     * @brief Abre un archivo de respaldo y mapea su índice
+     * @param path Ruta del archivo
+     * @param errorMessage Mensaje de error de salida (opcional)
+     * @return true si el archivo es un respaldo válido
+     */
+    bool open(const QString &path, QString *errorMessage = nullptr);
+
+    /**
+     * @brief Cierra el archivo y libera el mapeo
+     */
+    void close();
+
+    bool isOpen() const;
+
+    /**
+     * @brief Número de entradas del índice
+     */
+    int entryCount() const;
+
+    /**
+     * @brief Decodifica la entrada i del índice
+     */
+    BackupArchiveEntry entry(int index) const;
+
+    /**
+     * @brief Tipos de datos presentes en el respaldo
+     */
+    QStringList dataTypes() const;
+
+    /**
+     * @brief Busca una entrada por ruta original
+     * @param filePath Ruta en el dispositivo origen
+     * @param dataType Tipo de datos (vacío para buscar en todos)
+     * @return Índice de la entrada o -1 si no existe
+     */
+    int findEntry(const QString &filePath, const QString &dataType = QString()) const;
+
+    /**
+     * @brief Número de entradas de un tipo, contado en el índice sin decodificarlas
+     */
+    int entryCount(const QString &dataType) const;
+
+    /**
+     * @brief Reconstruye un DataSet a partir del índice
+     * @param dataType Tipo de datos
+     */
+    DataSet dataSet(const QString &dataType) const;
+
+    /**
+     * @brief Ruta del archivo abierto
+     */
+    QString fileName() const;
+
+    /**
+     * @brief Bytes hasta el final del pie usado; lo que haya detrás es un añadido interrumpido
+     */
+    qint64 validSize() const;
+
+private:
+    bool readFooter(qint64 footerPos, qint64 &indexOffset, qint64 &indexSize);
+    qint64 findValidFooter(qint64 fileSize, qint64 &indexOffset, qint64 &indexSize);
+    QByteArray recordString(const uchar *record, int fieldOffset) const;
+    QByteArray recordType(int index) const;
+    QByteArray recordPath(int index) const;
+    int lowerBound(const QByteArray &type, const QByteArray &path) const;
+    const uchar *record(int index) const;
+
+    QFile m_file;
+    uchar *m_index;
+    qint64 m_indexSize;
+    int m_count;
+    const uchar *m_strings;
+    qint64 m_stringsSize;
+    qint64 m_validSize;
+};
+
+#endif // BACKUPARCHIVE_H
@@ -0,0 +1,524 @@
+#include "benchmarks.h"
+#include "devicemanager.h"
+#include "dataanalyzer.h"
+#include "datatransfermanager.h"
+#include "lineframer.h"
+#include "scanpayload.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+#include <QRegularExpression>
+#include <QStringList>
+#include <QSet>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QCborStreamWriter>
+#include <cstdio>
+
+/**
+ * Mide el coste por elemento del motor de transferencia copiando muchos archivos
+ * pequeños entre dos directorios locales: --benchmark-transfer [archivos]
+ */
+int runTransferBenchmark(int fileCount)
+{
+    QLoggingCategory::setFilterRules("*.debug=false"); // El log por elemento distorsiona la medida
+
+    QTemporaryDir workDir;
+    if (!workDir.isValid()) {
+        fprintf(stderr, "No se pudo crear el directorio de trabajo\n");
+        return 1;
+    }
+
+    QString sourceRoot = workDir.filePath("origen");
+    QString destRoot = workDir.filePath("destino");
+    QDir().mkpath(sourceRoot + "/DCIM");
+    QDir().mkpath(destRoot);
+
+    QByteArray payload(4096, 'x');
+    for (int i = 0; i < fileCount; ++i) {
+        QFile file(sourceRoot + QString("/DCIM/IMG_%1.jpg").arg(i, 6, 10, QChar('0')));
+        if (!file.open(QIODevice::WriteOnly) || file.write(payload) != payload.size()) {
+            fprintf(stderr, "No se pudo crear %s\n", qPrintable(file.fileName()));
+            return 1;
+        }
+    }
+
+    DeviceManager deviceManager;
+    DataAnalyzer dataAnalyzer(&deviceManager);
+    QString sourceId = deviceManager.addLocalDevice(sourceRoot, "Origen");
+    QString destId = deviceManager.addLocalDevice(destRoot, "Destino");
+
+    // Mismo modelo de hilos que la aplicación: el motor en su propio hilo
+    QThread engineThread;
+    engineThread.setObjectName("TransferEngine");
+    DataTransferManager *manager = new DataTransferManager(&deviceManager, &dataAnalyzer);
+    manager->moveToThread(&engineThread);
+    QObject::connect(&engineThread, &QThread::finished, manager, &QObject::deleteLater);
+    engineThread.start();
+
+    QElapsedTimer timer;
+    int exitCode = 1;
+
+    QObject::connect(&dataAnalyzer, &DataAnalyzer::analysisComplete, qApp, [&](const QString &deviceId) {
+        if (deviceId != sourceId) return;
+        timer.start();
+        if (!manager->startTransfer(sourceId, destId, QStringList() << "photos")) {
+            fprintf(stderr, "No se pudo iniciar la transferencia\n");
+            QCoreApplication::exit(1);
+        }
+    });
+
+    QObject::connect(manager, &DataTransferManager::transferFinished, qApp, [&](bool success, const QString &message) {
+        qint64 elapsedUs = timer.nsecsElapsed() / 1000;
+        DataTransferManager::SchedulingLatencyStats stats = manager->schedulingLatencyStats();
+
+        printf("Archivos: %d (%lld bytes cada uno)\n", fileCount, static_cast<long long>(payload.size()));
+        printf("Resultado: %s\n", qPrintable(message));
+        printf("Tiempo total: %.1f ms\n", elapsedUs / 1000.0);
+        printf("Por elemento: %.1f us (%.0f elementos/s)\n",
+               static_cast<double>(elapsedUs) / qMax(1, fileCount),
+               elapsedUs > 0 ? fileCount * 1000000.0 / elapsedUs : 0.0);
+        printf("Pasos encolados: %d, espera media %lld us, p95 %lld us, max %lld us\n",
+               stats.samples, static_cast<long long>(stats.meanUs),
+               static_cast<long long>(stats.p95Us), static_cast<long long>(stats.maxUs));
+
+        exitCode = success ? 0 : 1;
+        QCoreApplication::quit();
+    });
+
+    if (!dataAnalyzer.analyzeDevice(sourceId)) {
+        fprintf(stderr, "No se pudo analizar el origen\n");
+    } else {
+        QCoreApplication::exec();
+    }
+
+    engineThread.quit();
+    engineThread.wait();
+    return exitCode;
+}
+
+namespace {
+
+// Texto libre de la fila i: contiene comas, que los parsers anteriores cortaban
+QString expectedText(const QString &dataType, int i)
+{
+    if (dataType == "contacts") return QString("García, Ana %1").arg(i);
+    if (dataType == "messages") return QString("Hola, ¿quedamos el día %1? Vale, hasta luego").arg(i % 28 + 1);
+    return QString("+34 600 %1").arg(i, 6, 10, QChar('0'));
+}
+
+// Salida sintética con el formato de "adb shell content query"
+QByteArray syntheticOutput(const QString &dataType, int rows)
+{
+    QByteArray output;
+    output.reserve(rows * 110);
+    qint64 baseDate = 1700000000000LL;
+    for (int i = 0; i < rows; ++i) {
+        QString line;
+        if (dataType == "contacts") {
+            line = QString("Row: %1 _id=%2, display_name=%3, times_contacted=%4, last_time_contacted=%5\n")
+                       .arg(i).arg(i + 1).arg(expectedText(dataType, i)).arg(i % 50).arg(baseDate / 1000 + i);
+        } else if (dataType == "messages") {
+            line = QString("Row: %1 _id=%2, address=+34600%3, body=%4, date=%5\n")
+                       .arg(i).arg(i + 1).arg(i % 100000, 6, 10, QChar('0'))
+                       .arg(expectedText(dataType, i)).arg(baseDate + i * 1000LL);
+        } else {
+            line = QString("Row: %1 _id=%2, number=%3, date=%4, duration=%5, type=%6\n")
+                       .arg(i).arg(i + 1).arg(expectedText(dataType, i)).arg(baseDate + i * 1000LL)
+                       .arg(i % 600).arg(i % 3 + 1);
+        }
+        output.append(line.toUtf8());
+    }
+    return output;
+}
+
+// Texto libre que se comprueba en cada tipo de datos
+QString parsedText(const QString &dataType, const DataItem &item)
+{
+    if (dataType == "messages") return item.data.value("body").toString();
+    if (dataType == "contacts") return item.displayName;
+    return item.displayName.section(" - ", 1);
+}
+
+struct ParseMeasure {
+    int rows;
+    int intactTexts;
+    qint64 elapsedNs;
+};
+
+// Parsers anteriores: salida completa en un QString, split y una expresión regular por línea
+ParseMeasure measureLegacy(const QString &dataType, const QByteArray &output)
+{
+    QRegularExpression re;
+    if (dataType == "contacts") {
+        re.setPattern("Row:\\s\\d+\\s_id=(\\d+),.*display_name=([^,]+),.*times_contacted=(\\d+),.*last_time_contacted=(\\d+)");
+    } else if (dataType == "messages") {
+        re.setPattern("Row:\\s\\d+\\s_id=(\\d+),\\s*address=([^,]+),\\s*body=([^,]+),\\s*date=(\\d+)");
+    } else {
+        re.setPattern("Row:\\s\\d+\\s_id=(\\d+),\\s*number=([^,]+),\\s*date=(\\d+),\\s*duration=(\\d+),\\s*type=(\\d+)");
+    }
+
+    ParseMeasure measure = {0, 0, 0};
+    QElapsedTimer timer;
+    timer.start();
+
+    QString text = QString::fromUtf8(output);
+    const QStringList lines = text.split('\n', Qt::SkipEmptyParts);
+    int index = 0;
+    for (const QString &line : lines) {
+        QRegularExpressionMatch match = re.match(line);
+        if (!match.hasMatch()) { ++index; continue; }
+
+        DataItem item;
+        item.id = match.captured(1);
+        if (dataType == "contacts") {
+            item.displayName = match.captured(2).trimmed();
+            item.dateTime = QDateTime::fromMSecsSinceEpoch(match.captured(4).toLongLong() * 1000);
+        } else if (dataType == "messages") {
+            item.displayName = QString("Mensaje de %1").arg(match.captured(2).trimmed());
+            item.data["body"] = match.captured(3).trimmed();
+            item.dateTime = QDateTime::fromMSecsSinceEpoch(match.captured(4).toLongLong());
+        } else {
+            item.displayName = QString("Llamada %1 - %2").arg("Entrante", match.captured(2).trimmed());
+            item.dateTime = QDateTime::fromMSecsSinceEpoch(match.captured(3).toLongLong());
+        }
+
+        measure.rows++;
+        if (parsedText(dataType, item) == expectedText(dataType, index)) measure.intactTexts++;
+        ++index;
+    }
+
+    measure.elapsedNs = timer.nsecsElapsed();
+    return measure;
+}
+
+// Parsers actuales: LineFramer + ContentQueryParser, con la salida en trozos como la de un QProcess
+ParseMeasure measureCurrent(const QString &dataType, const QByteArray &output)
+{
+    ParseMeasure measure = {0, 0, 0};
+    QElapsedTimer timer;
+    timer.start();
+
+    const int chunkSize = 64 * 1024;
+    LineFramer framer;
+    QByteArray line;
+    DataItem item;
+    int index = 0;
+    for (int offset = 0; offset <= output.size(); offset += chunkSize) {
+        if (offset < output.size()) {
+            framer.append(output.mid(offset, chunkSize));
+        } else {
+            framer.finish();
+        }
+        while (framer.nextLine(line)) {
+            if (DataAnalyzer::parseAndroidRow(dataType, line, item)) {
+                measure.rows++;
+                if (parsedText(dataType, item) == expectedText(dataType, index)) measure.intactTexts++;
+            }
+            ++index;
+        }
+    }
+
+    measure.elapsedNs = timer.nsecsElapsed();
+    return measure;
+}
+
+double rowsPerSecond(const ParseMeasure &measure)
+{
+    return measure.elapsedNs > 0 ? measure.rows * 1e9 / measure.elapsedNs : 0.0;
+}
+
+} // namespace
+
+/**
+ * Filas por segundo de los parsers de contactos, mensajes y llamadas, antes y después
+ * de sustituir las expresiones regulares: --benchmark-parsers [filas]
+ */
+int runParserBenchmark(int rowCount)
+{
+    printf("Filas por tipo: %d\n", rowCount);
+    printf("%-10s %14s %14s %9s %18s\n", "Tipo", "Antes (f/s)", "Ahora (f/s)", "Mejora", "Textos íntegros");
+
+    bool allIntact = true;
+    for (const QString &dataType : {QString("contacts"), QString("messages"), QString("calls")}) {
+        QByteArray output = syntheticOutput(dataType, rowCount);
+        ParseMeasure before = measureLegacy(dataType, output);
+        ParseMeasure after = measureCurrent(dataType, output);
+
+        double speedup = rowsPerSecond(before) > 0 ? rowsPerSecond(after) / rowsPerSecond(before) : 0.0;
+        printf("%-10s %14.0f %14.0f %8.1fx %8d -> %d\n", qPrintable(dataType),
+               rowsPerSecond(before), rowsPerSecond(after), speedup, before.intactTexts, after.intactTexts);
+
+        allIntact = allIntact && after.rows == rowCount && after.intactTexts == rowCount;
+    }
+
+    return allIntact ? 0 : 1;
+}
+
+/**
+ * Mezcla de lotes anterior: QList<DataItem> y conjunto de rutas reconstruido en cada lote
+ */
+static void legacyMerge(QList<DataItem> &existingItems, qint64 &totalSize, const QList<DataItem> &items)
+{
+    QSet<QString> existingPaths;
+    for (const DataItem &item : existingItems) {
+        existingPaths.insert(item.filePath);
+    }
+
+    for (const DataItem &item : items) {
+        if (!existingPaths.contains(item.filePath)) {
+            existingItems.append(item);
+            totalSize += item.size;
+        }
+    }
+}
+
+/**
+ * Mide la mezcla de un escaneo de Bridge Client entregado en lotes de 400 elementos
+ * (como MEDIA_DATA) y la memoria por elemento del DataSet resultante: --benchmark-merge [elementos]
+ */
+int runMergeBenchmark(int itemCount)
+{
+    const int chunkSize = 400;
+    QList<QList<DataItem>> chunks;
+    for (int start = 0; start < itemCount; start += chunkSize) {
+        QList<DataItem> chunk;
+        for (int i = start; i < qMin(itemCount, start + chunkSize); ++i) {
+            DataItem item;
+            item.filePath = QString("/sdcard/DCIM/Camera/IMG_%1.jpg").arg(i, 7, 10, QChar('0'));
+            item.id = item.filePath;
+            item.displayName = item.filePath.mid(item.filePath.lastIndexOf('/') + 1);
+            item.size = 2 * 1024 * 1024;
+            item.dateTime = QDateTime::fromSecsSinceEpoch(1600000000 + i, Qt::UTC);
+            item.data["mediaType"] = "photos";
+            item.data["mimeType"] = "image/jpeg";
+            chunk.append(item);
+        }
+        chunks.append(chunk);
+    }
+    // Un lote repetido: los duplicados no deben añadirse
+    chunks.append(chunks.first());
+
+    QElapsedTimer timer;
+    timer.start();
+    QList<DataItem> beforeItems;
+    qint64 beforeTotal = 0;
+    for (const QList<DataItem> &chunk : chunks) {
+        legacyMerge(beforeItems, beforeTotal, chunk);
+    }
+    double beforeMs = timer.nsecsElapsed() / 1e6;
+
+    timer.restart();
+    DataSet after;
+    after.type = "photos";
+    after.isSupported = true;
+    after.totalSize = 0;
+    for (const QList<DataItem> &chunk : chunks) {
+        DataAnalyzer::mergeItems(after, chunk);
+    }
+    double afterMs = timer.nsecsElapsed() / 1e6;
+
+    printf("Elementos: %d en %d lotes\n", itemCount, static_cast<int>(chunks.size()));
+    printf("%-22s %12s %12s\n", "", "Tiempo (ms)", "Elementos");
+    printf("%-22s %12.1f %12d\n", "Antes (QSet por lote)", beforeMs, static_cast<int>(beforeItems.size()));
+    printf("%-22s %12.1f %12d\n", "Ahora (índice)", afterMs, static_cast<int>(after.items.size()));
+    printf("Mejora: %.1fx\n", afterMs > 0 ? beforeMs / afterMs : 0.0);
+    if (!after.items.isEmpty()) {
+        printf("Memoria del DataSet: %lld bytes por elemento (%lld sin el índice de rutas)\n",
+               static_cast<long long>(after.memoryUsage() / after.items.size()),
+               static_cast<long long>(after.items.memoryUsage() / after.items.size()));
+    }
+
+    // El almacén compacto debe devolver exactamente lo que se guardó
+    bool same = beforeItems.size() == itemCount && after.items.size() == itemCount
+                && beforeTotal == after.totalSize;
+    for (int i = 0; same && i < itemCount; i += 997) {
+        DataItem stored = after.items.at(i);
+        const DataItem &original = beforeItems.at(i);
+        same = stored.filePath == original.filePath && stored.id == original.id
+               && stored.displayName == original.displayName && stored.size == original.size
+               && stored.dateTime == original.dateTime && stored.data == original.data;
+    }
+    return same ? 0 : 1;
+}
+
+namespace {
+
+QJsonObject syntheticScanRecord(ScanPayload::Kind kind, int i)
+{
+    QJsonObject obj;
+    if (kind == ScanPayload::Media) {
+        QString path = QString("/sdcard/DCIM/Camera/IMG_%1.jpg").arg(i, 7, 10, QChar('0'));
+        obj["path"] = path;
+        obj["name"] = path.mid(path.lastIndexOf('/') + 1);
+        obj["size"] = qint64(2 * 1024 * 1024 + i);
+        obj["type"] = "IMAGE";
+        obj["dateModified"] = qint64(1600000000000LL + i * 1000LL);
+        obj["mimeType"] = "image/jpeg";
+    } else {
+        obj["id"] = QString::number(i + 1);
+        obj["threadId"] = QString::number(i % 500);
+        obj["address"] = QString("+3460%1").arg(i % 10000000, 7, 10, QChar('0'));
+        obj["date"] = qint64(1600000000000LL + i * 1000LL);
+        obj["body"] = QString("Mensaje de prueba %1: nos vemos a las %2:00, \"¿vale?\"").arg(i).arg(i % 24);
+        obj["isRead"] = (i % 3) != 0;
+        obj["type"] = 1 + (i % 2);
+    }
+    return obj;
+}
+
+/**
+ * Codifica un valor JSON en CBOR como lo haría Bridge Client (números enteros como enteros)
+ */
+void writeCbor(QCborStreamWriter &writer, const QJsonValue &value)
+{
+    if (value.isObject()) {
+        const QJsonObject obj = value.toObject();
+        writer.startMap(obj.size());
+        for (auto it = obj.constBegin(); it != obj.constEnd(); ++it) {
+            writer.append(it.key());
+            writeCbor(writer, it.value());
+        }
+        writer.endMap();
+    } else if (value.isArray()) {
+        const QJsonArray array = value.toArray();
+        writer.startArray(array.size());
+        for (const QJsonValue &element : array) {
+            writeCbor(writer, element);
+        }
+        writer.endArray();
+    } else if (value.isString()) {
+        writer.append(value.toString());
+    } else if (value.isBool()) {
+        writer.append(value.toBool());
+    } else if (value.isDouble()) {
+        double number = value.toDouble();
+        if (number == static_cast<double>(static_cast<qint64>(number))) {
+            writer.append(static_cast<qint64>(number));
+        } else {
+            writer.append(number);
+        }
+    } else {
+        writer.append(nullptr);
+    }
+}
+
+bool sameItems(const QList<DataItem> &a, const QList<DataItem> &b)
+{
+    if (a.size() != b.size()) return false;
+    for (int i = 0; i < a.size(); ++i) {
+        if (a[i].id != b[i].id || a[i].displayName != b[i].displayName || a[i].filePath != b[i].filePath
+            || a[i].size != b[i].size || a[i].dateTime != b[i].dateTime || a[i].data != b[i].data) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+/**
+ * Bytes y velocidad de decodificación de MEDIA_DATA y MESSAGES_DATA en JSON (con QJsonDocument
+ * y leído directamente del texto) frente a CBOR (cabecera y binario leído en flujo):
+ * --benchmark-scan-payload [elementos]
+ */
+int runScanPayloadBenchmark(int itemCount)
+{
+    const int chunkSize = 400; // Lotes de MEDIA_DATA; los mensajes llegan en un único lote
+    printf("Elementos por tipo: %d\n", itemCount);
+    printf("%-9s %12s %12s %7s %12s %12s %12s %8s\n", "Tipo", "JSON (B)", "CBOR (B)", "Ahorro",
+           "DOM (e/s)", "Directo (e/s)", "CBOR (e/s)", "Iguales");
+
+    bool allSame = true;
+    for (ScanPayload::Kind kind : {ScanPayload::Media, ScanPayload::Messages}) {
+        const QByteArray prefix = kind == ScanPayload::Media ? "MEDIA_DATA" : "MESSAGES_DATA";
+        const int batch = kind == ScanPayload::Media ? chunkSize : qMax(1, itemCount);
+        const int count = (itemCount + batch - 1) / batch;
+
+        // Mensajes tal como llegan por el socket, en las dos codificaciones
+        QList<QByteArray> jsonLines;
+        QList<QByteArray> cborHeaders;
+        QList<QByteArray> cborPayloads;
+        qint64 jsonBytes = 0;
+        qint64 cborBytes = 0;
+        for (int index = 0; index < count; ++index) {
+            QJsonArray array;
+            for (int i = index * batch; i < qMin(itemCount, (index + 1) * batch); ++i) {
+                array.append(syntheticScanRecord(kind, i));
+            }
+            QByteArray chunkPrefix = kind == ScanPayload::Media
+                ? QByteArray::number(index) + ":" + QByteArray::number(count) + ":" : QByteArray();
+
+            QByteArray line = prefix + ":" + chunkPrefix + QJsonDocument(array).toJson(QJsonDocument::Compact) + "\n";
+            QByteArray payload;
+            {
+                QCborStreamWriter writer(&payload);
+                writeCbor(writer, array);
+            }
+            QByteArray header = prefix + "_CBOR:" + chunkPrefix + QByteArray::number(payload.size()) + "\n";
+
+            jsonBytes += line.size();
+            cborBytes += header.size() + payload.size();
+            jsonLines.append(line);
+            cborHeaders.append(header);
+            cborPayloads.append(payload);
+        }
+
+        // Texto JSON de cada línea, sin el prefijo
+        QList<QByteArray> jsonTexts;
+        for (const QByteArray &line : jsonLines) {
+            int start = prefix.size() + 1;
+            if (kind == ScanPayload::Media) {
+                start = line.indexOf(':', line.indexOf(':', start) + 1) + 1;
+            }
+            jsonTexts.append(line.mid(start, line.size() - start - 1));
+        }
+
+        // JSON: documento completo y conversión a DataItem
+        QElapsedTimer timer;
+        timer.start();
+        QList<DataItem> jsonItems;
+        for (const QByteArray &json : jsonTexts) {
+            QJsonDocument doc = QJsonDocument::fromJson(json);
+            jsonItems.append(ScanPayload::fromJson(kind, doc.array()));
+        }
+        qint64 jsonNs = timer.nsecsElapsed();
+
+        // JSON leído directamente del texto, solo los campos usados
+        timer.restart();
+        QList<DataItem> directItems;
+        bool directOk = true;
+        for (const QByteArray &json : jsonTexts) {
+            directOk = ScanPayload::fromJsonText(kind, json, directItems) && directOk;
+        }
+        qint64 directNs = timer.nsecsElapsed();
+
+        // CBOR: lectura en flujo directamente a los campos
+        timer.restart();
+        QList<DataItem> cborItems;
+        for (int index = 0; index < cborPayloads.size(); ++index) {
+            ScanPayload::fromCbor(kind, cborPayloads[index], cborItems);
+        }
+        qint64 cborNs = timer.nsecsElapsed();
+
+        double jsonRate = jsonNs > 0 ? jsonItems.size() * 1e9 / jsonNs : 0.0;
+        double directRate = directNs > 0 ? directItems.size() * 1e9 / directNs : 0.0;
+        double cborRate = cborNs > 0 ? cborItems.size() * 1e9 / cborNs : 0.0;
+        bool same = jsonItems.size() == itemCount && directOk
+                    && sameItems(jsonItems, directItems) && sameItems(jsonItems, cborItems);
+        printf("%-9s %12lld %12lld %6.0f%% %12.0f %12.0f %12.0f %8s\n",
+               kind == ScanPayload::Media ? "media" : "messages",
+               static_cast<long long>(jsonBytes), static_cast<long long>(cborBytes),
+               jsonBytes > 0 ? 100.0 * (jsonBytes - cborBytes) / jsonBytes : 0.0,
+               jsonRate, directRate, cborRate, same ? "sí" : "no");
+
+        allSame = allSame && same;
+    }
+
+    return allSame ? 0 : 1;
+}
@@ -0,0 +1,39 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+/*
+ * Mediciones sin interfaz que se lanzan desde la línea de comandos
+ * (necesitan una QCoreApplication creada).
+ */
+
+/**
+ * @brief Copia muchos archivos pequeños entre dos dispositivos locales y mide el coste por elemento
+ * @param fileCount Número de archivos
+ * @return Código de salida del proceso
+ */
+int runTransferBenchmark(int fileCount);
+
+/**
+ * @brief Compara los parsers de "content query" anteriores (expresiones regulares) con los actuales
+ * @param rowCount Filas sintéticas por tipo de datos
+ * @return Código de salida del proceso
+ */
+int runParserBenchmark(int rowCount);
+
+/**
+ * @brief Compara la mezcla de lotes de Bridge Client anterior (QSet por lote) con la indexada
+ *        e informa de la memoria por elemento del DataSet resultante
+ * @param itemCount Elementos del escaneo sintético
+ * @return Código de salida del proceso
+ */
+int runMergeBenchmark(int itemCount);
+
+/**
+ * @brief Compara los lotes de escaneo de Bridge Client en JSON (con DOM y sin él) y en
+ *        CBOR: bytes en el cable y velocidad de decodificación hasta DataItem
+ * @param itemCount Elementos sintéticos por tipo de datos
+ * @return Código de salida del proceso
+ */
+int runScanPayloadBenchmark(int itemCount);
+
+#endif // BENCHMARKS_H
@@ -0,0 +1,345 @@
+#include "bridgesocketworker.h"
+#include <QDebug>
+#include <QHostAddress>
+#include <QJsonDocument>
+
+BridgeSocketWorker::BridgeSocketWorker(QObject *parent)
+    : QObject(parent)
+    , m_socket(new QTcpSocket(this)) // Hijo: se mueve de hilo junto con el worker
+    , m_encodingPending(false)
+    , m_encodingTimer(new QTimer(this))
+    , m_fastJson(true)
+{
+    // Sin respuesta a tiempo, un ERROR posterior es de otro comando y no del cambio de codificación
+    m_encodingTimer->setSingleShot(true);
+    connect(m_encodingTimer, &QTimer::timeout, this, [this]() {
+        if (m_encodingPending) qDebug() << "No reply to SET_ENCODING, assuming JSON";
+        m_encodingPending = false;
+    });
+
+    connect(m_socket, &QTcpSocket::readyRead, this, &BridgeSocketWorker::readFromSocket);
+    connect(m_socket, &QTcpSocket::disconnected, this, &BridgeSocketWorker::socketDisconnected);
+    connect(m_socket, &QAbstractSocket::errorOccurred, this, [this](QAbstractSocket::SocketError) {
+        emit socketError(m_socket->errorString());
+    });
+}
+
+/**
+ * Conecta con Bridge Client a través del puerto redirigido
+ */
+bool BridgeSocketWorker::connectToHost(quint16 port, int timeoutMs, QString *errorMessage)
+{
+    m_framer.clear();
+    m_binaryChunk = BinaryChunk();
+    m_encodingPending = false;
+    m_encodingTimer->stop();
+    m_socket->connectToHost(QHostAddress::LocalHost, port);
+    if (!m_socket->waitForConnected(timeoutMs)) {
+        if (errorMessage) *errorMessage = m_socket->errorString();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Cierra la conexión actual
+ */
+void BridgeSocketWorker::disconnectFromHost()
+{
+    if (m_socket->state() != QTcpSocket::UnconnectedState) {
+        m_socket->disconnectFromHost();
+        if (m_socket->state() != QTcpSocket::UnconnectedState)
+            m_socket->waitForDisconnected(1000);
+    }
+    m_framer.clear();
+    m_binaryChunk = BinaryChunk();
+}
+
+/**
+ * Escribe un comando en el socket
+ */
+bool BridgeSocketWorker::sendLine(const QByteArray &line)
+{
+    if (m_socket->state() != QTcpSocket::ConnectedState) {
+        return false;
+    }
+
+    qint64 bytesWritten = m_socket->write(line);
+    if (bytesWritten != line.size()) {
+        return false;
+    }
+    return m_socket->flush();
+}
+
+/**
+ * Solicita la codificación CBOR para los lotes de datos
+ */
+void BridgeSocketWorker::requestCborEncoding()
+{
+    if (sendLine("SET_ENCODING:cbor\n")) {
+        m_encodingPending = true;
+        m_encodingTimer->start(ENCODING_REPLY_TIMEOUT);
+    }
+}
+
+void BridgeSocketWorker::setFastJsonEnabled(bool enabled)
+{
+    m_fastJson = enabled;
+}
+
+/**
+ * Lee datos desde el socket
+ */
+void BridgeSocketWorker::readFromSocket()
+{
+    m_framer.append(m_socket->readAll());
+
+    // Procesar líneas completas y los lotes binarios anunciados por ellas
+    forever {
+        if (m_binaryChunk.length >= 0) {
+            QByteArray payload;
+            if (!m_framer.takeBytes(m_binaryChunk.length, payload)) break;
+            processBinaryChunk(payload);
+            m_binaryChunk.length = -1;
+            continue;
+        }
+
+        QByteArray line;
+        if (!m_framer.nextLine(line)) break;
+        QByteArray response = line.trimmed();
+        if (!response.isEmpty()) {
+            processResponse(response);
+        }
+        if (m_socket->state() != QTcpSocket::ConnectedState) {
+            // Conexión abortada por una cabecera no válida: lo que queda es binario sin marco
+            m_framer.clear();
+            break;
+        }
+    }
+}
+
+/**
+ * "índice:total:json" sin partir el JSON (puede contener ':' y ocupar varios MB)
+ */
+bool BridgeSocketWorker::parseChunk(ScanPayload::Kind kind, const QByteArray &payload, int &index, int &count,
+                                    QList<DataItem> &items) const
+{
+    int first = payload.indexOf(':');
+    int second = first >= 0 ? payload.indexOf(':', first + 1) : -1;
+    if (second < 0) return false;
+
+    index = payload.left(first).toInt();
+    count = payload.mid(first + 1, second - first - 1).toInt();
+
+    QByteArray json = QByteArray::fromRawData(payload.constData() + second + 1, payload.size() - second - 1);
+    return parseItems(kind, json, items);
+}
+
+/**
+ * Lectura directa del texto; QJsonDocument solo si está desactivada o el lote no encaja
+ */
+bool BridgeSocketWorker::parseItems(ScanPayload::Kind kind, const QByteArray &json, QList<DataItem> &items) const
+{
+    if (m_fastJson && ScanPayload::fromJsonText(kind, json, items)) {
+        return true;
+    }
+
+    QJsonDocument doc = QJsonDocument::fromJson(json);
+    if (!doc.isArray()) return false;
+    items = ScanPayload::fromJson(kind, doc.array());
+    return true;
+}
+
+/**
+ * Cabecera "índice:total:bytes" (medios y archivos) o "bytes" (contactos y mensajes)
+ */
+void BridgeSocketWorker::expectBinaryChunk(ScanPayload::Kind kind, const QByteArray &header)
+{
+    QList<QByteArray> parts = header.split(':');
+    bool chunked = kind == ScanPayload::Media || kind == ScanPayload::Files;
+    bool ok = false;
+    int length = parts.size() == (chunked ? 3 : 1) ? parts.last().toInt(&ok) : -1;
+    if (!ok || length < 0 || length > MAX_BINARY_CHUNK) {
+        // Sin longitud válida no se puede saltar el binario: la conexión queda desincronizada
+        qWarning() << "Invalid CBOR chunk header:" << header;
+        emit socketError("Cabecera de lote CBOR no válida");
+        m_socket->abort();
+        return;
+    }
+
+    m_binaryChunk.kind = kind;
+    m_binaryChunk.index = chunked ? parts[0].toInt() : 0;
+    m_binaryChunk.count = chunked ? parts[1].toInt() : 1;
+    m_binaryChunk.length = length;
+}
+
+/**
+ * Decodifica un lote CBOR; si está corrupto se emite lo leído hasta el error
+ */
+void BridgeSocketWorker::processBinaryChunk(const QByteArray &payload)
+{
+    QList<DataItem> items;
+    if (!ScanPayload::fromCbor(m_binaryChunk.kind, payload, items)) {
+        qWarning() << "Invalid CBOR data chunk," << items.size() << "items decoded before the error";
+    }
+    emitItems(m_binaryChunk.kind, m_binaryChunk.index, m_binaryChunk.count, items);
+}
+
+void BridgeSocketWorker::emitItems(ScanPayload::Kind kind, int index, int count, const QList<DataItem> &items)
+{
+    switch (kind) {
+    case ScanPayload::Media:
+        emit mediaDataReceived(index, count, items);
+        break;
+    case ScanPayload::Files:
+        emit filesDataReceived(index, count, items);
+        break;
+    case ScanPayload::Contacts:
+        emit contactsDataReceived(items);
+        break;
+    case ScanPayload::Messages:
+        emit messagesDataReceived(items);
+        break;
+    }
+}
+
+/**
+ * Procesa una respuesta del dispositivo
+ */
+void BridgeSocketWorker::processResponse(const QByteArray &response)
+{
+    // Los lotes de datos pueden ocupar megas: solo se registra el principio
+    qDebug() << "Received response:" << (response.size() > 120 ? response.left(120) + "..." : response);
+
+    // SET_ENCODING va antes que cualquier otro comando: su respuesta es la primera que
+    // llega después (el saludo CONNECTED puede adelantarse porque no responde a nada)
+    bool encodingReply = m_encodingPending && !response.startsWith("CONNECTED:");
+    if (encodingReply) {
+        m_encodingPending = false;
+        m_encodingTimer->stop();
+    }
+
+    // Parsear la respuesta según el protocolo
+    if (response.startsWith("CONNECTED:")) {
+        qDebug() << "Connected to Bridge Client:" << response.mid(10);
+    }
+    else if (response.startsWith("DEVICE_INFO:")) {
+        QJsonDocument doc = QJsonDocument::fromJson(response.mid(12));
+        if (doc.isObject()) {
+            emit deviceInfoReceived(doc.object());
+        }
+    }
+    else if (response.startsWith("ENCODING:")) {
+        // Las cabeceras *_CBOR identifican cada lote binario: no hace falta recordar el modo
+        qDebug() << "Bridge Client data encoding:" << response.mid(9);
+    }
+    else if (response.startsWith("ROLE_SET:")) {
+        qDebug() << "Role set to:" << response.mid(9);
+    }
+    else if (response == "SCAN_STARTED") {
+        emit scanStarted();
+    }
+    else if (response.startsWith("SCAN_PROGRESS:")) {
+        emit scanProgress(response.mid(14).toInt());
+    }
+    else if (response == "SCAN_COMPLETED") {
+        emit scanCompleted();
+    }
+    else if (response.startsWith("SCAN_ERROR:")) {
+        emit scanError(QString::fromUtf8(response.mid(11)));
+    }
+    else if (response.startsWith("MEDIA_COUNT:")) {
+        qDebug() << "Media files count:" << response.mid(12).toInt();
+    }
+    else if (response.startsWith("MEDIA_DATA:")) {
+        // Formato: MEDIA_DATA:index:count:jsondata
+        int index = 0, count = 0;
+        QList<DataItem> items;
+        if (parseChunk(ScanPayload::Media, response.mid(11), index, count, items)) {
+            emit mediaDataReceived(index, count, items);
+        }
+    }
+    else if (response.startsWith("MEDIA_DATA_CBOR:")) {
+        // Formato: MEDIA_DATA_CBOR:index:count:bytes, seguido de los bytes CBOR
+        expectBinaryChunk(ScanPayload::Media, response.mid(16));
+    }
+    else if (response.startsWith("FILES_COUNT:")) {
+        qDebug() << "Files count:" << response.mid(12).toInt();
+    }
+    else if (response.startsWith("FILES_DATA:")) {
+        // Formato: FILES_DATA:index:count:jsondata
+        int index = 0, count = 0;
+        QList<DataItem> items;
+        if (parseChunk(ScanPayload::Files, response.mid(11), index, count, items)) {
+            emit filesDataReceived(index, count, items);
+        }
+    }
+    else if (response.startsWith("FILES_DATA_CBOR:")) {
+        // Formato: FILES_DATA_CBOR:index:count:bytes, seguido de los bytes CBOR
+        expectBinaryChunk(ScanPayload::Files, response.mid(16));
+    }
+    else if (response.startsWith("FILE_READY:")) {
+        emit fileReady(QString::fromUtf8(response.mid(11)));
+    }
+    else if (response.startsWith("FILE_RANGE_READY:")) {
+        // Formato: FILE_RANGE_READY:offset:length:md5:stagedPath
+        QStringList parts = QString::fromUtf8(response.mid(17)).split(':');
+        if (parts.size() >= 4) {
+            qint64 offset = parts[0].toLongLong();
+            qint64 length = parts[1].toLongLong();
+            QString md5 = parts[2];
+            QString stagedPath = parts.mid(3).join(':');
+            emit fileRangeReady(offset, length, md5, stagedPath);
+        }
+    }
+    else if (response.startsWith("FILE_SAVED:")) {
+        emit fileSaved(QString::fromUtf8(response.mid(11)));
+    }
+    else if (response == "PONG") {
+        emit pongReceived();
+    }
+    else if (response.startsWith("ERROR:")) {
+        if (encodingReply) {
+            // Bridge Client sin soporte de SET_ENCODING: se sigue con JSON
+            qDebug() << "Bridge Client does not support CBOR, using JSON:" << response.mid(6);
+            return;
+        }
+        emit errorReceived(QString::fromUtf8(response.mid(6)));
+    }
+    else if (response.startsWith("CONTACTS_DATA:")) {
+        // Formato: CONTACTS_DATA:jsondata
+        QList<DataItem> items;
+        if (parseItems(ScanPayload::Contacts, response.mid(14), items)) {
+            emit contactsDataReceived(items);
+        }
+    }
+    else if (response.startsWith("CONTACTS_DATA_CBOR:")) {
+        // Formato: CONTACTS_DATA_CBOR:bytes, seguido de los bytes CBOR
+        expectBinaryChunk(ScanPayload::Contacts, response.mid(19));
+    }
+    else if (response.startsWith("MESSAGES_DATA:")) {
+        // Formato: MESSAGES_DATA:jsondata
+        QList<DataItem> items;
+        if (parseItems(ScanPayload::Messages, response.mid(14), items)) {
+            emit messagesDataReceived(items);
+        }
+    }
+    else if (response.startsWith("MESSAGES_DATA_CBOR:")) {
+        // Formato: MESSAGES_DATA_CBOR:bytes, seguido de los bytes CBOR
+        expectBinaryChunk(ScanPayload::Messages, response.mid(19));
+    }
+    else if (response.startsWith("FILE_TRANSFER_PROGRESS:")) {
+        // Formato: FILE_TRANSFER_PROGRESS:path:bytesReceived:totalBytes
+        QStringList parts = QString::fromUtf8(response.mid(22)).split(':', Qt::SkipEmptyParts);
+        if (parts.size() >= 3) {
+            QString filePath = parts[0];
+            qint64 bytesReceived = parts[1].toLongLong();
+            qint64 totalBytes = parts[2].toLongLong();
+
+            emit fileTransferProgress(filePath, bytesReceived, totalBytes);
+        }
+    }
+    else {
+        emit unknownResponseReceived(QString::fromUtf8(response));
+    }
+}
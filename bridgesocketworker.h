@@ -0,0 +1,158 @@
+#ifndef BRIDGESOCKETWORKER_H
+#define BRIDGESOCKETWORKER_H
+
+#include <QObject>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QByteArray>
+#include <QString>
+#include <QJsonObject>
+#include <QJsonArray>
+#include "lineframer.h"
+#include "scanpayload.h"
+
+/**
+ * @class BridgeSocketWorker
+ * @brief Socket de Bridge Client y decodificación de sus respuestas, en un hilo de E/S
+ *
+ * AdbSocketClient crea un worker por dispositivo y lo mueve a su propio hilo. El
+ * worker lee el socket, separa las líneas y decodifica el JSON (líneas MEDIA_DATA de
+ * varios MB) fuera del hilo de la interfaz; cada respuesta sale como una señal ya
+ * tipada que AdbSocketClient reemite y que llega encolada a sus consumidores.
+ *
+ * Los lotes de datos pueden llegar también en CBOR si Bridge Client acepta
+ * SET_ENCODING:cbor: una cabecera de texto con la longitud (MEDIA_DATA_CBOR:índice:total:bytes,
+ * FILES_DATA_CBOR:índice:total:bytes, CONTACTS_DATA_CBOR:bytes, MESSAGES_DATA_CBOR:bytes)
+ * seguida de ese número de bytes binarios. En ambos casos los lotes se convierten aquí
+ * en DataItems (ScanPayload).
+ */
+class BridgeSocketWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BridgeSocketWorker(QObject *parent = nullptr);
+
+    /**
+     * @brief Conecta con el puerto local redirigido por ADB (bloquea hasta timeoutMs)
+     * @param errorMessage Descripción del error si no se pudo conectar
+     * @return true si la conexión quedó establecida
+     */
+    bool connectToHost(quint16 port, int timeoutMs, QString *errorMessage);
+
+    /**
+     * @brief Cierra la conexión (espera hasta 1 s a que se complete)
+     */
+    void disconnectFromHost();
+
+    /**
+     * @brief Escribe un comando terminado en '\n'
+     * @return false si no hay conexión o no se pudo escribir
+     */
+    bool sendLine(const QByteArray &line);
+
+    /**
+     * @brief Pide a Bridge Client que envíe los lotes de datos en CBOR
+     *
+     * Si responde ENCODING:cbor, los lotes siguientes llegan en binario; si responde
+     * con un error (versión antigua), ese error no se propaga y se sigue con JSON.
+     */
+    void requestCborEncoding();
+
+    /**
+     * @brief Leer los lotes JSON sin DOM (ScanPayload::fromJsonText), activado por defecto
+     *
+     * Desactivado, o si un lote no se puede leer así, se usa QJsonDocument.
+     */
+    void setFastJsonEnabled(bool enabled);
+
+signals:
+    /**
+     * @brief Señal emitida cuando el dispositivo cierra la conexión
+     */
+    void socketDisconnected();
+
+    /**
+     * @brief Señal emitida ante un error del socket
+     */
+    void socketError(const QString &errorMessage);
+
+    // Respuestas decodificadas (ver las señales homónimas de AdbSocketClient)
+    void deviceInfoReceived(const QJsonObject &deviceInfo);
+    void scanStarted();
+    void scanProgress(int progress);
+    void scanCompleted();
+    void scanError(const QString &errorMessage);
+    void mediaDataReceived(int index, int count, const QList<DataItem> &items);
+    void filesDataReceived(int index, int count, const QList<DataItem> &items);
+    void fileReady(const QString &filePath);
+    void fileRangeReady(qint64 offset, qint64 length, const QString &md5, const QString &stagedPath);
+    void fileSaved(const QString &result);
+    void pongReceived();
+    void errorReceived(const QString &errorMessage);
+    void contactsDataReceived(const QList<DataItem> &contacts);
+    void messagesDataReceived(const QList<DataItem> &messages);
+    void fileTransferProgress(const QString &filePath, qint64 bytesReceived, qint64 totalBytes);
+    void unknownResponseReceived(const QString &response);
+
+private slots:
+    /**
+     * @brief Lee lo disponible y procesa las líneas completas
+     */
+    void readFromSocket();
+
+private:
+    /**
+     * @brief Procesa una respuesta (una línea sin '\n')
+     */
+    void processResponse(const QByteArray &response);
+
+    /**
+     * @brief Decodifica un lote "índice:total:json"
+     * @return false si la línea no tiene ese formato o el JSON no es un array
+     */
+    bool parseChunk(ScanPayload::Kind kind, const QByteArray &payload, int &index, int &count,
+                    QList<DataItem> &items) const;
+
+    /**
+     * @brief Convierte el JSON de un lote, sin DOM si es posible
+     * @return false si el JSON no es un array
+     */
+    bool parseItems(ScanPayload::Kind kind, const QByteArray &json, QList<DataItem> &items) const;
+
+    /**
+     * @brief Interpreta una cabecera de lote CBOR y deja pendiente la lectura del binario
+     * @param header Parte de la cabecera tras el prefijo ("índice:total:bytes" o "bytes")
+     */
+    void expectBinaryChunk(ScanPayload::Kind kind, const QByteArray &header);
+
+    /**
+     * @brief Decodifica un lote CBOR completo y emite la señal de su tipo
+     */
+    void processBinaryChunk(const QByteArray &payload);
+
+    /**
+     * @brief Emite la señal de datos correspondiente al tipo de lote
+     */
+    void emitItems(ScanPayload::Kind kind, int index, int count, const QList<DataItem> &items);
+
+    // Lote binario anunciado por una cabecera y aún no leído
+    struct BinaryChunk {
+        ScanPayload::Kind kind = ScanPayload::Media;
+        int index = 0;
+        int count = 1;
+        int length = -1;   // -1: no hay lote pendiente
+    };
+
+    QTcpSocket *m_socket;
+    LineFramer m_framer;           // Respuestas aún incompletas
+    BinaryChunk m_binaryChunk;
+    bool m_encodingPending;        // SET_ENCODING enviado y sin respuesta
+    QTimer *m_encodingTimer;       // Deja de esperar la respuesta a SET_ENCODING
+    bool m_fastJson;               // Lotes JSON sin QJsonDocument
+
+    static const int MAX_BINARY_CHUNK = 256 * 1024 * 1024;
+    static const int ENCODING_REPLY_TIMEOUT = 5000; // ms
+};
+
+#endif // BRIDGESOCKETWORKER_H
@@ -0,0 +1,181 @@
+#include "contentqueryparser.h"
+#include <QtAlgorithms>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MDB_HAVE_SSE2 1
+#endif
+
+/**
+ * Constructor: precalcula los marcadores de cada columna
+ */
+ContentQueryParser::ContentQueryParser(const QList<QByteArray> &columns, int freeTextColumn)
+    : m_freeTextColumn(freeTextColumn)
+{
+    for (int i = 0; i < columns.size(); ++i) {
+        m_markers.append(i == 0 ? columns[i] + '=' : ", " + columns[i] + '=');
+    }
+    m_begin.resize(columns.size());
+    m_end.resize(columns.size());
+}
+
+/**
+ * Separa una fila: de izquierda a derecha hasta la columna de texto libre y de
+ * derecha a izquierda a partir de ella
+ */
+bool ContentQueryParser::parseRow(const QByteArray &line)
+{
+    const int columnCount = m_markers.size();
+    if (columnCount == 0) return false;
+
+    const char *p = line.constData();
+    const char *end = p + line.size();
+
+    // "Row: N "
+    if (line.size() < 5 || memcmp(p, "Row: ", 5) != 0) return false;
+    p += 5;
+    const char *digits = p;
+    while (p < end && *p >= '0' && *p <= '9') ++p;
+    if (p == digits || p == end || *p != ' ') return false;
+    ++p;
+
+    const QByteArray &first = m_markers[0];
+    if (end - p < first.size() || memcmp(p, first.constData(), first.size()) != 0) return false;
+    m_begin[0] = p + first.size();
+
+    int column = 1;
+    for (; column < columnCount && column - 1 != m_freeTextColumn; ++column) {
+        const char *marker = findMarker(m_begin[column - 1], end, column);
+        if (!marker) return false;
+        m_end[column - 1] = marker;
+        m_begin[column] = marker + m_markers[column].size();
+    }
+
+    // Tras la columna de texto libre, el marcador válido es el último
+    const char *limit = end;
+    for (int k = columnCount - 1; k >= column; --k) {
+        const char *marker = findMarkerReverse(m_begin[column - 1], limit, k);
+        if (!marker) return false;
+        m_begin[k] = marker + m_markers[k].size();
+        m_end[k] = limit;
+        limit = marker;
+    }
+    m_end[column - 1] = limit;
+    return true;
+}
+
+QByteArray ContentQueryParser::value(int column) const
+{
+    return QByteArray::fromRawData(m_begin[column], static_cast<int>(m_end[column] - m_begin[column]));
+}
+
+QString ContentQueryParser::text(int column) const
+{
+    const char *begin = m_begin[column];
+    const char *end = m_end[column];
+    while (begin < end && *begin == ' ') ++begin;
+    while (end > begin && end[-1] == ' ') --end;
+    return QString::fromUtf8(begin, static_cast<int>(end - begin));
+}
+
+qint64 ContentQueryParser::integer(int column) const
+{
+    return parseInteger(m_begin[column], m_end[column]);
+}
+
+/**
+ * Busca ", colK=" hacia delante
+ */
+const char *ContentQueryParser::findMarker(const char *begin, const char *end, int column) const
+{
+    const QByteArray &marker = m_markers[column];
+    while (begin < end) {
+        const char *comma = findByte(begin, end, ',');
+        if (comma == end) return nullptr;
+        if (end - comma >= marker.size() && memcmp(comma, marker.constData(), marker.size()) == 0) {
+            return comma;
+        }
+        begin = comma + 1;
+    }
+    return nullptr;
+}
+
+/**
+ * Busca el último ", colK=" en [begin, end)
+ */
+const char *ContentQueryParser::findMarkerReverse(const char *begin, const char *end, int column) const
+{
+    const QByteArray &marker = m_markers[column];
+    const char *searchEnd = end;
+    while (searchEnd > begin) {
+        const char *comma = findLastByte(begin, searchEnd, ',');
+        if (!comma) return nullptr;
+        if (end - comma >= marker.size() && memcmp(comma, marker.constData(), marker.size()) == 0) {
+            return comma;
+        }
+        searchEnd = comma;
+    }
+    return nullptr;
+}
+
+/**
+ * Primera aparición de un byte, 16 bytes por iteración con SSE2
+ */
+const char *ContentQueryParser::findByte(const char *begin, const char *end, char byte)
+{
+#ifdef MDB_HAVE_SSE2
+    const __m128i needle = _mm_set1_epi8(byte);
+    while (end - begin >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+        if (mask) return begin + qCountTrailingZeroBits(static_cast<quint32>(mask));
+        begin += 16;
+    }
+#endif
+    for (; begin < end; ++begin) {
+        if (*begin == byte) return begin;
+    }
+    return end;
+}
+
+/**
+ * Última aparición de un byte, 16 bytes por iteración con SSE2
+ */
+const char *ContentQueryParser::findLastByte(const char *begin, const char *end, char byte)
+{
+#ifdef MDB_HAVE_SSE2
+    const __m128i needle = _mm_set1_epi8(byte);
+    while (end - begin >= 16) {
+        const char *block = end - 16;
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+        if (mask) return block + 31 - qCountLeadingZeroBits(static_cast<quint32>(mask));
+        end = block;
+    }
+#endif
+    while (end > begin) {
+        --end;
+        if (*end == byte) return end;
+    }
+    return nullptr;
+}
+
+/**
+ * Entero decimal sin pasar por QString
+ */
+qint64 ContentQueryParser::parseInteger(const char *begin, const char *end, bool *ok)
+{
+    bool negative = begin < end && *begin == '-';
+    if (negative) ++begin;
+
+    quint64 value = 0;
+    const char *p = begin;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+        value = value * 10 + static_cast<quint64>(*p - '0');
+    }
+
+    if (ok) *ok = p > begin && p == end;
+    if (p == begin || p != end) return 0;
+    return negative ? -static_cast<qint64>(value) : static_cast<qint64>(value);
+}
@@ -0,0 +1,80 @@
+#ifndef CONTENTQUERYPARSER_H
+#define CONTENTQUERYPARSER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QVector>
+
+/**
+ * @class ContentQueryParser
+ * @brief Tokenizador de filas de "adb shell content query" sin expresiones regulares
+ *
+ * Una fila tiene la forma "Row: N col1=valor1, col2=valor2, ...". Los valores se
+ * delimitan buscando ", colK=" con las columnas de la proyección en orden; la búsqueda
+ * de comas usa SSE2 cuando está disponible y los valores se devuelven sin copiarlos.
+ *
+ * Como los valores no van escapados, una columna de texto libre (el cuerpo de un SMS,
+ * un nombre) puede contener ", otraColumna=". Por eso el límite que sigue a esa
+ * columna se busca desde el final de la fila: las columnas posteriores deben ser
+ * numéricas o al menos no contener el texto de sus propios marcadores.
+ */
+class ContentQueryParser
+{
+public:
+    /**
+     * @brief Constructor
+     * @param columns Columnas de la proyección, en el orden de la consulta
+     * @param freeTextColumn Índice de la columna de texto libre, o -1 si no hay
+     */
+    explicit ContentQueryParser(const QList<QByteArray> &columns, int freeTextColumn = -1);
+
+    /**
+     * @brief Separa una fila en valores
+     * @param line Línea sin salto de línea final
+     * @return false si la línea no es una fila con todas las columnas
+     */
+    bool parseRow(const QByteArray &line);
+
+    /**
+     * @brief Valor de una columna de la última fila (sin copia, válido mientras lo sea la línea)
+     */
+    QByteArray value(int column) const;
+
+    /**
+     * @brief Valor de una columna como texto, sin espacios en los extremos
+     */
+    QString text(int column) const;
+
+    /**
+     * @brief Valor de una columna como entero (0 si es NULL o no es un número)
+     */
+    qint64 integer(int column) const;
+
+    /**
+     * @brief Primera aparición de un byte en [begin, end), o end si no aparece
+     */
+    static const char *findByte(const char *begin, const char *end, char byte);
+
+    /**
+     * @brief Última aparición de un byte en [begin, end), o nullptr si no aparece
+     */
+    static const char *findLastByte(const char *begin, const char *end, char byte);
+
+    /**
+     * @brief Convierte un entero decimal con signo opcional
+     * @param ok Se pone a false si el texto no es un número completo (opcional)
+     */
+    static qint64 parseInteger(const char *begin, const char *end, bool *ok = nullptr);
+
+private:
+    const char *findMarker(const char *begin, const char *end, int column) const;
+    const char *findMarkerReverse(const char *begin, const char *end, int column) const;
+
+    QVector<QByteArray> m_markers;   // "col=" para la primera columna, ", col=" para las demás
+    int m_freeTextColumn;
+    QVector<const char *> m_begin;   // Inicio del valor de cada columna
+    QVector<const char *> m_end;     // Fin del valor de cada columna
+};
+
+#endif // CONTENTQUERYPARSER_H
@@ -1,6 +1,5 @@
 #include "dataanalyzer.h"
 #include <QDebug>
-#include <QRegularExpression>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
@@ -9,6 +8,43 @@
 #include <QDateTime>
 #include <QTimer>
 #include <QMutexLocker>
+#include <QDirIterator>
+#include <QCryptographicHash>
+#include <QStorageInfo>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QAtomicInteger>
+#include <algorithm>
+#include "backuparchive.h"
+#include "analysiscache.h"
+#include "lineframer.h"
+#include "contentqueryparser.h"
+#include "datatransfermanager.h"
+#include "devicetransport.h"
+
+/**
+ * Generación para un DataSet nuevo; 0 queda libre para "ninguna todavía"
+ */
+quint64 DataSet::nextGeneration()
+{
+    static QAtomicInteger<quint64> counter(0);
+    return counter.fetchAndAddRelaxed(1) + 1;
+}
+
+/**
+ * Memoria aproximada de un DataSet: almacén compacto más el índice de rutas
+ */
+qint64 DataSet::memoryUsage() const
+{
+    qint64 bytes = items.memoryUsage();
+
+    // Por entrada: nodo de la tabla (~32 B) y cabecera de la cadena (~24 B) más sus caracteres
+    for (auto it = pathIndex.constBegin(); it != pathIndex.constEnd(); ++it) {
+        bytes += 56 + qint64(it.key().size()) * 2;
+    }
+    bytes += qint64(pathIndex.capacity()) * qint64(sizeof(void *));
+    return bytes;
+}
 
 /**
  * Constructor de la clase DataAnalyzer
@@ -16,15 +52,54 @@
 DataAnalyzer::DataAnalyzer(DeviceManager *deviceManager, QObject *parent)
     : QObject(parent)
     , m_deviceManager(deviceManager)
-    , m_analysisProcess(new QProcess(this))
-    , m_isAnalyzing(false)
+    , m_maxConcurrentTasks(4)
+    , m_androidMediaRoots(defaultAndroidMediaRoots())
+    , m_analysisCache(new AnalysisCache())
+    , m_ioThread(new QThread(this))
+    , m_ioContext(new QObject())
+    , m_cacheEnabled(true)
+    , m_lazyRecordFields(true)
+    , m_duplicateDetection(true)
+    , m_backgroundEnabled(true)
+    , m_transferActive(false)
 {
-    // Conectar la señal finished del proceso
-    connect(m_analysisProcess, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
-            this, &DataAnalyzer::onAnalysisProcessFinished);
+    m_ioThread->setObjectName("DataAnalyzerIO");
+    m_ioContext->moveToThread(m_ioThread);
+    m_ioThread->start();
 
     // Conectar señal interna para procesar la cola
     connect(this, &DataAnalyzer::analysisFinishedForDevice, this, &DataAnalyzer::processNextAnalysisTask, Qt::QueuedConnection);
+
+    // Análisis en segundo plano de los dispositivos autorizados en cuanto aparecen. Bridge Client
+    // se prepara a la vez sin bloquear; el análisis que lo necesita espera a bridgeClientSetupFinished
+    connect(m_deviceManager, &DeviceManager::deviceConnected, this, [this](const DeviceInfo &device) {
+        if (!device.authorized) return;
+        if (device.type == "android") m_deviceManager->startBridgeClientSetup(device.id);
+        startBackgroundAnalysis(device.id);
+    });
+    connect(m_deviceManager, &DeviceManager::deviceAuthorizationChanged, this, [this](const QString &deviceId, bool authorized) {
+        if (!authorized) return;
+        m_deviceManager->startBridgeClientSetup(deviceId); // Solo actúa con dispositivos Android
+        startBackgroundAnalysis(deviceId);
+    });
+    connect(m_deviceManager, &DeviceManager::bridgeClientSetupFinished, this, [this](const QString &deviceId, bool success) {
+        if (!m_bridgeWaits.contains(deviceId)) return;
+        BridgeWait wait = m_bridgeWaits.take(deviceId);
+        qDebug() << "Bridge Client de" << deviceId << (success ? "listo" : "no disponible") << ", empieza el análisis";
+        startDeviceAnalysis(deviceId, wait.quickScan, wait.background, false);
+    });
+    connect(m_deviceManager, &DeviceManager::deviceDisconnected, this, [this](const QString &deviceId) {
+        m_deferredAnalyses.remove(deviceId);
+        m_bridgeWaits.remove(deviceId);
+        cancelBackgroundAnalysis(deviceId);
+        closeItemFeeds(deviceId, QString(), "Dispositivo desconectado durante el análisis");
+    });
+
+    // Cada bloque publicado llega también a las transferencias que ya lo esperan
+    connect(this, &DataAnalyzer::dataSetUpdated, this, &DataAnalyzer::feedSubscribers);
+    connect(this, &DataAnalyzer::dataSetUpdated, this, [this](const QString &deviceId, const QString &dataType) {
+        m_itemIndexes.remove(deviceId + "/" + dataType); // Se reconstruye en la próxima consulta
+    });
 }
 
 /**
@@ -32,7 +107,12 @@ DataAnalyzer::DataAnalyzer(DeviceManager *deviceManager, QObject *parent)
  */
 DataAnalyzer::~DataAnalyzer()
 {
-    // QProcess se limpia automáticamente debido a la propiedad del padre
+    // Los QProcess de las tareas se limpian automáticamente debido a la propiedad del padre
+    // El trabajo de disco en curso termina antes de liberar la caché que usa
+    m_ioThread->quit();
+    m_ioThread->wait();
+    delete m_ioContext;
+    delete m_analysisCache;
 }
 
 /**
@@ -40,6 +120,25 @@ DataAnalyzer::~DataAnalyzer()
  */
 bool DataAnalyzer::analyzeDevice(const QString &deviceId, bool quickScan)
 {
+    return startDeviceAnalysis(deviceId, quickScan, false);
+}
+
+/**
+ * Pone en cola las tareas de análisis de un dispositivo
+ */
+bool DataAnalyzer::startDeviceAnalysis(const QString &deviceId, bool quickScan, bool background, bool waitForBridge)
+{
+    // El análisis del usuario sustituye al de segundo plano: lo que está en cola se descarta
+    // y, si aún hay tareas en curso, se empieza cuando terminen
+    if (!background && m_backgroundDevices.contains(deviceId)) {
+        cancelBackgroundAnalysis(deviceId);
+        if (m_backgroundDevices.contains(deviceId)) {
+            qDebug() << "Análisis de" << deviceId << "aplazado hasta que termine el de segundo plano";
+            m_deferredAnalyses[deviceId] = quickScan;
+            return true;
+        }
+    }
+
     DeviceInfo device = m_deviceManager->getDeviceInfo(deviceId);
     if (device.id.isEmpty()) {
         qWarning() << "AnalyzeDevice: Dispositivo no encontrado:" << deviceId;
@@ -55,17 +154,22 @@ bool DataAnalyzer::analyzeDevice(const QString &deviceId, bool quickScan)
     // Comprobar si Bridge Client está disponible para este dispositivo
     bool useBridgeClient = false;
     if (device.type == "android") {
-        // Inicializar Bridge Client si no está ya conectado
-        if (!m_deviceManager->isBridgeClientConnected(deviceId)) {
-            useBridgeClient = m_deviceManager->setupBridgeClient(deviceId);
-            if (useBridgeClient) {
-                qDebug() << "Bridge Client inicializado para el dispositivo:" << deviceId;
-            } else {
-                qDebug() << "No se pudo inicializar Bridge Client, usando ADB directo";
-            }
-        } else {
+        // La configuración de Bridge Client corre en su hilo de E/S: si está en curso (o el
+        // usuario la pide de nuevo) el análisis espera a bridgeClientSetupFinished
+        if (m_deviceManager->isBridgeClientConnected(deviceId)) {
             useBridgeClient = true;
             qDebug() << "Bridge Client ya conectado para el dispositivo:" << deviceId;
+        } else if (waitForBridge &&
+                   (m_deviceManager->isBridgeClientSettingUp(deviceId) ||
+                    (!background && m_deviceManager->startBridgeClientSetup(deviceId)))) {
+            // El análisis del usuario sustituye al de segundo plano que esperaba
+            if (!background || !m_bridgeWaits.contains(deviceId)) {
+                m_bridgeWaits[deviceId] = BridgeWait{quickScan, background};
+            }
+            qDebug() << "Análisis de" << deviceId << "a la espera de Bridge Client";
+            return true;
+        } else {
+            qDebug() << "Bridge Client no disponible, usando ADB directo";
         }
     }
 
@@ -78,27 +182,71 @@ bool DataAnalyzer::analyzeDevice(const QString &deviceId, bool quickScan)
     }
     locker.unlock();
 
+    // Las colas abiertas mientras este análisis esperaba empiezan desde el DataSet vacío
+    for (auto it = m_feeds.begin(); it != m_feeds.end(); ++it) {
+        if (!it.key().startsWith(deviceId + "/")) continue;
+        for (FeedSubscription &subscription : it.value()) {
+            subscription.offset = 0;
+        }
+    }
+
     // Poner en cola las tareas de análisis
     QStringList dataTypesToAnalyze;
     if (device.type == "android") {
         // Tipos de datos a analizar para Android
-        dataTypesToAnalyze << "photos" << "videos" << "contacts" << "messages" << "calls";
+        // Los cuatro tipos de archivo salen de un único recorrido de medios
+        dataTypesToAnalyze << "photos" << "videos" << "music" << "documents"
+                           << "contacts" << "messages" << "calls";
 
         // Si tenemos Bridge Client, podemos ampliar tipos
         if (useBridgeClient) {
-            dataTypesToAnalyze << "music" << "documents" << "applications";
+            dataTypesToAnalyze << "applications";
         }
     } else if (device.type == "ios") {
         // Tipos de datos a analizar para iOS
         dataTypesToAnalyze << "photos" << "contacts" << "messages" << "calls";
+    } else if (device.type == "local") {
+        // Un directorio local solo contiene archivos
+        dataTypesToAnalyze << "photos" << "videos" << "music" << "documents";
+    } else if (device.type == "archive") {
+        // Los tipos presentes se leen del índice del respaldo
+        BackupArchiveReader reader;
+        if (reader.open(m_deviceManager->getLocalDevicePath(deviceId))) {
+            dataTypesToAnalyze = reader.dataTypes();
+        }
+        if (dataTypesToAnalyze.isEmpty()) {
+            closeItemFeeds(deviceId, QString());
+            emit analysisStarted(deviceId);
+            emit analysisComplete(deviceId);
+            return true;
+        }
     } else {
+        closeItemFeeds(deviceId, QString(), "Tipo de dispositivo no soportado: " + device.type);
         emit analysisError(deviceId, "all", "Tipo de dispositivo no soportado: " + device.type);
         return false;
     }
 
+    // Solo el análisis completo entrega elementos a las colas; las de tipos que no se analizan se cierran
+    QStringList feedKeys = m_feeds.keys();
+    for (const QString &key : qAsConst(feedKeys)) {
+        QString type = key.mid(deviceId.size() + 1);
+        if (key.startsWith(deviceId + "/") && (quickScan || !dataTypesToAnalyze.contains(type))) {
+            closeItemFeeds(deviceId, type, "El tipo no se analiza en este dispositivo");
+        }
+    }
+    if (!quickScan) {
+        for (const QString &type : qAsConst(dataTypesToAnalyze)) {
+            m_typesInAnalysis.insert(deviceId + "/" + type);
+        }
+    }
+
     // Resetear contador de tareas pendientes y emitir analysisStarted
     m_pendingTasksPerDevice[deviceId] = dataTypesToAnalyze.size();
-    emit analysisStarted(deviceId);
+    if (background) {
+        m_backgroundDevices.insert(deviceId);
+    } else {
+        emit analysisStarted(deviceId);
+    }
 
     // Si estamos usando Bridge Client y es una exploración completa, limpiar trackeo
     if (useBridgeClient && !quickScan) {
@@ -119,47 +267,321 @@ bool DataAnalyzer::analyzeDevice(const QString &deviceId, bool quickScan)
         }
     }
 
-    // Empezar a procesar la cola si no está ya en ejecución
-    if (!m_isAnalyzing) {
-        m_isAnalyzing = true;
-        QMetaObject::invokeMethod(this, "processNextAnalysisTask", Qt::QueuedConnection);
-    }
+    // Lanzar las tareas que quepan (las demás arrancan al terminar otras)
+    QMetaObject::invokeMethod(this, "processNextAnalysisTask", Qt::QueuedConnection);
 
     return true;
 }
 
 /**
- * Procesa la siguiente tarea de análisis en la cola
+ * Lanza tareas de la cola hasta alcanzar el límite de tareas simultáneas
  */
 void DataAnalyzer::processNextAnalysisTask()
 {
-    if (m_analysisQueue.isEmpty()) {
-        m_isAnalyzing = false;
-        // No quedan tareas para ningún dispositivo
+    // Las tareas de segundo plano ceden el paso a las del usuario y, durante una
+    // transferencia, se ejecutan de una en una
+    int backgroundRunning = 0;
+    for (const QString &key : qAsConst(m_runningTasks)) {
+        if (m_backgroundDevices.contains(key.left(key.lastIndexOf('/')))) ++backgroundRunning;
+    }
+    bool foregroundQueued = false;
+    for (const AnalysisTask &queued : qAsConst(m_analysisQueue)) {
+        if (!m_backgroundDevices.contains(queued.deviceId)) {
+            foregroundQueued = true;
+            break;
+        }
+    }
+    int backgroundLimit = m_transferActive ? 1 : m_maxConcurrentTasks;
+
+    int index = 0;
+    while (m_runningTasks.size() < m_maxConcurrentTasks && index < m_analysisQueue.size()) {
+        const AnalysisTask &queued = m_analysisQueue.at(index);
+
+        bool background = m_backgroundDevices.contains(queued.deviceId);
+        if (background && (foregroundQueued || backgroundRunning >= backgroundLimit)) {
+            ++index;
+            continue;
+        }
+
+        // Las respuestas de Bridge Client no identifican la petición: una tarea por dispositivo
+        if (queued.useBridgeClient && m_bridgeTasks.contains(queued.deviceId)) {
+            ++index;
+            continue;
+        }
+
+        AnalysisTask task = m_analysisQueue.takeAt(index);
+        m_runningTasks.insert(task.deviceId + "/" + task.dataType);
+        if (background) ++backgroundRunning;
+        qDebug() << "Procesando tarea de análisis para dispositivo:"
+                 << task.deviceId
+                 << "Tipo:" << task.dataType
+                 << "Usando Bridge Client:" << task.useBridgeClient
+                 << "En curso:" << m_runningTasks.size();
+
+        // Puede finalizar dentro de la llamada (análisis locales o simulados)
+        startAnalysisTask(task);
+    }
+}
+
+/**
+ * Establece el número máximo de tareas de análisis simultáneas
+ */
+void DataAnalyzer::setMaxConcurrentTasks(int maxTasks)
+{
+    m_maxConcurrentTasks = qMax(1, maxTasks);
+}
+
+/**
+ * Activa o desactiva la caché de análisis en disco
+ */
+void DataAnalyzer::setAnalysisCacheEnabled(bool enabled)
+{
+    m_cacheEnabled = enabled;
+}
+
+/**
+ * Descarta la caché de un dispositivo
+ */
+void DataAnalyzer::invalidateAnalysisCache(const QString &deviceId)
+{
+    // En el hilo de E/S: después de cualquier guardado ya encolado
+    AnalysisCache *cache = m_analysisCache;
+    runOnIoThread([cache, deviceId]() { cache->invalidate(deviceId); });
+}
+
+/**
+ * Encola un trabajo de disco en el hilo de E/S
+ */
+void DataAnalyzer::runOnIoThread(std::function<void()> work)
+{
+    QMetaObject::invokeMethod(m_ioContext, work, Qt::QueuedConnection);
+}
+
+/**
+ * Activa o desactiva el análisis en segundo plano al conectar dispositivos
+ */
+void DataAnalyzer::setBackgroundAnalysisEnabled(bool enabled)
+{
+    m_backgroundEnabled = enabled;
+}
+
+/**
+ * Lanza un análisis rápido de prioridad baja si el dispositivo no tiene resultados
+ */
+void DataAnalyzer::startBackgroundAnalysis(const QString &deviceId)
+{
+    if (!m_backgroundEnabled) return;
+
+    // Fuera de la señal de conexión, cuando DeviceManager ya ha actualizado su lista
+    QTimer::singleShot(0, this, [this, deviceId]() {
+        DeviceInfo device = m_deviceManager->getDeviceInfo(deviceId);
+        if (device.id.isEmpty() || !device.authorized || device.type == "archive") return;
+        if (m_pendingTasksPerDevice.contains(deviceId)) return; // Ya se está analizando
+        if (m_bridgeWaits.contains(deviceId)) return;            // Ya espera a Bridge Client
+
+        QMutexLocker locker(&m_dataSetMutex);
+        bool analyzed = m_dataSets.contains(deviceId) && !m_dataSets[deviceId].isEmpty();
+        locker.unlock();
+        if (analyzed) return;
+
+        qDebug() << "Análisis en segundo plano de" << deviceId;
+        startDeviceAnalysis(deviceId, true, true);
+    });
+}
+
+/**
+ * Descarta las tareas en cola del análisis en segundo plano
+ */
+void DataAnalyzer::cancelBackgroundAnalysis(const QString &deviceId)
+{
+    if (!m_backgroundDevices.contains(deviceId)) return;
+
+    int dropped = 0;
+    for (int i = m_analysisQueue.size() - 1; i >= 0; --i) {
+        if (m_analysisQueue.at(i).deviceId == deviceId) {
+            m_typesInAnalysis.remove(deviceId + "/" + m_analysisQueue.at(i).dataType);
+            m_analysisQueue.removeAt(i);
+            ++dropped;
+        }
+    }
+
+    int pending = m_pendingTasksPerDevice.value(deviceId) - dropped;
+    qDebug() << "Análisis en segundo plano de" << deviceId << "cancelado:" << dropped
+             << "tareas descartadas," << qMax(0, pending) << "en curso";
+    if (pending > 0) {
+        m_pendingTasksPerDevice[deviceId] = pending;
         return;
     }
+    m_pendingTasksPerDevice.remove(deviceId);
+    finishBackgroundAnalysis(deviceId);
+}
+
+/**
+ * Cierra el análisis en segundo plano y lanza el del usuario que esperaba
+ */
+void DataAnalyzer::finishBackgroundAnalysis(const QString &deviceId)
+{
+    m_backgroundDevices.remove(deviceId);
+    emit backgroundAnalysisFinished(deviceId);
+
+    if (m_deferredAnalyses.contains(deviceId)) {
+        bool quickScan = m_deferredAnalyses.take(deviceId);
+        QMetaObject::invokeMethod(this, [this, deviceId, quickScan]() {
+            analyzeDevice(deviceId, quickScan);
+        }, Qt::QueuedConnection);
+    }
+}
+
+/**
+ * Un análisis completo aplazado tras el de segundo plano también cuenta como en curso
+ */
+bool DataAnalyzer::isAnalyzing(const QString &deviceId, const QString &dataType) const
+{
+    if (m_typesInAnalysis.contains(deviceId + "/" + dataType)) return true;
+    if (m_bridgeWaits.contains(deviceId) && !m_bridgeWaits.value(deviceId).quickScan) return true;
+    return m_deferredAnalyses.contains(deviceId) && !m_deferredAnalyses.value(deviceId);
+}
+
+/**
+ * Abre una cola para un tipo en análisis, con los elementos ya descubiertos
+ */
+QSharedPointer<ItemFeed> DataAnalyzer::openItemFeed(const QString &deviceId, const QString &dataType)
+{
+    if (!isAnalyzing(deviceId, dataType)) return QSharedPointer<ItemFeed>();
+
+    // El consumidor vive en otro hilo: la cola se destruye en el suyo
+    QSharedPointer<ItemFeed> feed(new ItemFeed, &QObject::deleteLater);
+
+    FeedSubscription subscription;
+    subscription.feed = feed;
+    subscription.offset = 0;
+    subscription.generation = 0;
+    m_feeds[deviceId + "/" + dataType].append(subscription);
+
+    feedSubscribers(deviceId, dataType);
+    return feed;
+}
+
+/**
+ * Entrega a cada cola los elementos publicados desde su última entrega
+ */
+void DataAnalyzer::feedSubscribers(const QString &deviceId, const QString &dataType)
+{
+    auto it = m_feeds.find(deviceId + "/" + dataType);
+    if (it == m_feeds.end()) return;
+    if (m_backgroundDevices.contains(deviceId)) return; // Solo recuentos: nada que transferir
+
+    QMutexLocker locker(&m_dataSetMutex);
+    DataSet dataSet = m_dataSets.value(deviceId).value(dataType); // Copia compartida
+    locker.unlock();
+    const DataItemStore &items = dataSet.items;
+
+    QList<FeedSubscription> &subscriptions = it.value();
+    for (int i = subscriptions.size() - 1; i >= 0; --i) {
+        QSharedPointer<ItemFeed> feed = subscriptions[i].feed.toStrongRef();
+        if (!feed) {
+            subscriptions.removeAt(i); // La transferencia ya terminó
+            continue;
+        }
+
+        // DataSet reemplazado (p. ej. análisis completo tras detectar borrados) o más corto:
+        // se recorre desde el principio y se saltan los elementos que la cola ya recibió
+        FeedSubscription &subscription = subscriptions[i];
+        if (subscription.generation != dataSet.generation || items.size() < subscription.offset) {
+            subscription.offset = 0;
+            subscription.generation = dataSet.generation;
+        }
+
+        int offset = subscription.offset;
+        if (items.size() <= offset) continue;
+
+        QList<DataItem> batch;
+        batch.reserve(items.size() - offset);
+        for (int index = offset; index < items.size(); ++index) {
+            DataItem item = items.at(index);
+            if (subscription.delivered.contains(item.id)) continue;
+            subscription.delivered.insert(item.id);
+            batch.append(item);
+        }
+        subscription.offset = items.size();
+        if (!batch.isEmpty()) feed->push(batch);
+    }
+    if (subscriptions.isEmpty()) m_feeds.erase(it);
+}
+
+/**
+ * Cierra las colas de un tipo (o de todo el dispositivo)
+ */
+void DataAnalyzer::closeItemFeeds(const QString &deviceId, const QString &dataType, const QString &errorMessage)
+{
+    QStringList keys;
+    if (dataType.isEmpty()) {
+        for (auto it = m_feeds.constBegin(); it != m_feeds.constEnd(); ++it) {
+            if (it.key().startsWith(deviceId + "/")) keys.append(it.key());
+        }
+    } else {
+        keys.append(deviceId + "/" + dataType);
+    }
 
-    // Comprobar si el proceso de análisis está libre
-    if (m_analysisProcess->state() != QProcess::NotRunning) {
-        // El proceso está ocupado, esperar a que termine
-        qDebug() << "Proceso de análisis ocupado, esperando...";
-        return; // La señal finished disparará la siguiente llamada
+    for (const QString &key : qAsConst(keys)) {
+        const QList<FeedSubscription> subscriptions = m_feeds.take(key);
+        for (const FeedSubscription &subscription : subscriptions) {
+            if (QSharedPointer<ItemFeed> feed = subscription.feed.toStrongRef()) {
+                feed->close(errorMessage);
+            }
+        }
     }
+}
+
+bool DataAnalyzer::isBackgroundAnalysis(const QString &deviceId) const
+{
+    return m_backgroundDevices.contains(deviceId);
+}
 
-    m_currentAnalysisTask = m_analysisQueue.dequeue();
-    qDebug() << "Procesando tarea de análisis para dispositivo:"
-             << m_currentAnalysisTask.deviceId
-             << "Tipo:" << m_currentAnalysisTask.dataType
-             << "Usando Bridge Client:" << m_currentAnalysisTask.useBridgeClient;
+bool DataAnalyzer::hasAnalysisResults(const QString &deviceId)
+{
+    if (m_pendingTasksPerDevice.contains(deviceId)) return false;
 
-    startAnalysisTask(m_currentAnalysisTask);
+    QMutexLocker locker(&m_dataSetMutex);
+    return m_dataSets.contains(deviceId) && !m_dataSets[deviceId].isEmpty();
+}
 
-    // Si la cola está vacía después de dequeue, marcar como inactivo
-    if (m_analysisQueue.isEmpty()) {
-        m_isAnalyzing = false;
+/**
+ * Con una transferencia en curso, el análisis en segundo plano va de tarea en tarea
+ */
+void DataAnalyzer::setTransferActive(bool active)
+{
+    m_transferActive = active;
+    if (!active) {
+        QMetaObject::invokeMethod(this, "processNextAnalysisTask", Qt::QueuedConnection);
     }
 }
 
+/**
+ * Activa o desactiva el análisis ligero de mensajes y contactos
+ */
+void DataAnalyzer::setLazyRecordFields(bool enabled)
+{
+    m_lazyRecordFields = enabled;
+}
+
+/**
+ * Establece los filtros que se envían con cada escaneo de Bridge Client
+ */
+void DataAnalyzer::setBridgeScanFilter(const ScanFilter &filter)
+{
+    m_bridgeScanFilter = filter;
+    m_bridgeScanFilter.types.clear(); // El tipo lo pone cada tarea
+}
+
+/**
+ * Activa o desactiva la detección de duplicados exactos
+ */
+void DataAnalyzer::setDuplicateDetectionEnabled(bool enabled)
+{
+    m_duplicateDetection = enabled;
+}
+
 /**
  * Inicia una tarea de análisis específica
  */
@@ -173,20 +595,210 @@ void DataAnalyzer::startAnalysisTask(const AnalysisTask& task)
 
     emit analysisProgress(task.deviceId, task.dataType, 0); // Indicar inicio de tarea
 
-    if (device.type == "android") {
+    // Con caché, primero se comprueba si los datos cambiaron desde el último análisis
+    if (m_cacheEnabled && startCacheCheck(task, device.type)) {
+        return;
+    }
+
+    dispatchAnalysisTask(task, device.type);
+}
+
+/**
+ * Lanza el análisis de una tarea según el tipo de dispositivo
+ */
+void DataAnalyzer::dispatchAnalysisTask(const AnalysisTask& task, const QString &deviceType)
+{
+    if (deviceType == "android") {
         startAndroidAnalysis(task);
-    } else if (device.type == "ios") {
+    } else if (deviceType == "ios") {
         startIOSAnalysis(task);
+    } else if (deviceType == "local") {
+        startLocalAnalysis(task);
+    } else if (deviceType == "archive") {
+        startArchiveAnalysis(task);
     } else {
         finalizeAnalysis(task.deviceId, task.dataType, false, "Tipo de dispositivo no soportado.");
     }
 }
 
+/**
+ * Comprueba el testigo de cambios de una tarea (local: en el momento; Android: con un proceso)
+ */
+bool DataAnalyzer::startCacheCheck(const AnalysisTask& task, const QString &deviceType)
+{
+    if (deviceType == "local") {
+        QString rootPath = m_deviceManager->getLocalDevicePath(task.deviceId);
+        runOnIoThread([this, task, deviceType, rootPath]() {
+            QString token = localCacheToken(rootPath);
+            QMetaObject::invokeMethod(this, [this, task, deviceType, token]() {
+                onCacheTokenReady(task, deviceType, token);
+            }, Qt::QueuedConnection);
+        });
+        return true;
+    }
+    if (deviceType != "android") return false; // Respaldos ya tienen índice; iOS es simulado
+
+    QString command = androidCacheTokenCommand(task.dataType);
+    if (command.isEmpty()) return false;
+
+    // Los tipos de archivo comparten testigo: una sola comprobación por dispositivo
+    bool isFileType = task.dataType == "photos" || task.dataType == "videos" ||
+                      task.dataType == "music" || task.dataType == "documents";
+    QString key = task.deviceId + "/" + (isFileType ? QString("files") : task.dataType);
+    auto running = m_tokenChecks.find(key);
+    if (running != m_tokenChecks.end()) {
+        running->waiting << task;
+        return true;
+    }
+
+    QString adbPath = m_deviceManager->getAdbPath();
+    if (adbPath.isEmpty()) return false;
+
+    // Lo que cambie la forma de obtener los datos también invalida la caché
+    QString variant = task.useBridgeClient ? "bridge" : "adb";
+    if (isFileType) variant += "|" + m_androidMediaRoots.join('|');
+    if (task.useBridgeClient && !m_bridgeScanFilter.isEmpty()) {
+        variant += "|" + QString::fromUtf8(QJsonDocument(m_bridgeScanFilter.toJson()).toJson(QJsonDocument::Compact));
+    }
+
+    QProcess *process = new QProcess(this);
+    TokenCheck &check = m_tokenChecks[key];
+    check.process = process;
+    check.deviceType = deviceType;
+    check.variant = variant;
+    check.waiting << task;
+
+    auto finish = [this, key, process](bool ok) {
+        TokenCheck done = m_tokenChecks.take(key);
+        process->deleteLater();
+
+        QByteArray output = ok ? process->readAllStandardOutput().trimmed() : QByteArray();
+        QString token;
+        if (!output.isEmpty()) {
+            QCryptographicHash hash(QCryptographicHash::Md5);
+            hash.addData(done.variant.toUtf8());
+            hash.addData(output);
+            token = QString::fromLatin1(hash.result().toHex());
+        }
+        for (const AnalysisTask &waiting : qAsConst(done.waiting)) {
+            onCacheTokenReady(waiting, done.deviceType, token);
+        }
+    };
+    connect(process, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+            this, [finish](int exitCode, QProcess::ExitStatus exitStatus) {
+        finish(exitCode == 0 && exitStatus == QProcess::NormalExit);
+    });
+    connect(process, &QProcess::errorOccurred, this, [finish](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) finish(false);
+    });
+
+    process->start(adbPath, QStringList() << "-s" << task.deviceId << "exec-out" << command);
+    return true;
+}
+
+/**
+ * Publica el DataSet guardado si el testigo coincide; si no, analiza y recuerda el testigo
+ */
+void DataAnalyzer::onCacheTokenReady(const AnalysisTask& task, const QString &deviceType, const QString &token)
+{
+    DataSet cached;
+    if (m_analysisCache->load(task.deviceId, task.dataType, token, cached)) {
+        m_lastRowCounts[task.deviceId][task.dataType] = cached.items.size();
+
+        QMutexLocker locker(&m_dataSetMutex);
+        m_dataSets[task.deviceId][task.dataType] = cached;
+        locker.unlock();
+
+        emit dataSetUpdated(task.deviceId, task.dataType);
+        finalizeAnalysis(task.deviceId, task.dataType, true);
+        return;
+    }
+
+    // Un análisis rápido solo cuenta: no hay nada que guardar ni sobre lo que mezclar cambios
+    if (token.isEmpty() || task.quickScan) {
+        dispatchAnalysisTask(task, deviceType);
+        return;
+    }
+    m_pendingCacheTokens[task.deviceId + "/" + task.dataType] = token;
+
+    // Los datos cambiaron: por ADB se piden solo los cambios sobre lo guardado
+    AnalysisTask analysisTask = task;
+    if (deviceType == "android" && !task.useBridgeClient && task.dataType != "contacts") {
+        analysisTask.data["deltaScan"] = true;
+    }
+    dispatchAnalysisTask(analysisTask, deviceType);
+}
+
+/**
+ * Comandos de testigo en Android: resumen MD5 de lo que cambia cuando cambian los datos
+ *
+ * Para archivos se usan las fechas de los directorios (cambian al crear, borrar o renombrar
+ * archivos en ellos), el número de archivos y la fecha del más reciente (cambia al
+ * modificar uno en su sitio); para registros, los identificadores y la columna que
+ * cambia con cada edición, sin los textos.
+ */
+QString DataAnalyzer::androidCacheTokenCommand(const QString &dataType) const
+{
+    if (dataType == "photos" || dataType == "videos" || dataType == "music" || dataType == "documents") {
+        return QString(
+            "{ if find /sdcard -maxdepth 0 -printf '' >/dev/null 2>&1; then "
+            "find %1 -type d -printf '%T@ %p\\n'; T=$(find %1 -type f -printf '%T@\\n' | sort -n); "
+            "else find %1 -type d -exec stat -c '%Y %n' {} +; T=$(find %1 -type f -exec stat -c '%Y' {} + | sort -n); fi; "
+            "echo \"$T\" | wc -l; echo \"$T\" | tail -n 1; } 2>/dev/null | md5sum")
+            .arg(m_androidMediaRoots.join(' '));
+    }
+    if (dataType == "contacts") {
+        return "content query --uri content://com.android.contacts/raw_contacts --projection _id,version | md5sum";
+    }
+    if (dataType == "messages") {
+        return "content query --uri content://sms --projection _id,date,read | md5sum";
+    }
+    if (dataType == "calls") {
+        return "content query --uri content://call_log/calls --projection _id,date,duration | md5sum";
+    }
+    return QString();
+}
+
+/**
+ * Testigo de un dispositivo local: rutas y fechas de sus directorios, número de archivos
+ * y fecha del más reciente (una modificación en el sitio no cambia la del directorio)
+ */
+QString DataAnalyzer::localCacheToken(const QString &rootPath)
+{
+    if (rootPath.isEmpty() || !QDir(rootPath).exists()) return QString();
+
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(QByteArray::number(QFileInfo(rootPath).lastModified().toMSecsSinceEpoch()));
+
+    qint64 fileCount = 0;
+    qint64 newestFile = 0;
+    QDirIterator it(rootPath, QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        qint64 modified = it.fileInfo().lastModified().toMSecsSinceEpoch();
+        if (it.fileInfo().isDir()) {
+            hash.addData(it.filePath().toUtf8());
+            hash.addData(QByteArray::number(modified));
+        } else {
+            fileCount++;
+            newestFile = qMax(newestFile, modified);
+        }
+    }
+    hash.addData(QByteArray::number(fileCount));
+    hash.addData(QByteArray::number(newestFile));
+    return QString::fromLatin1(hash.result().toHex());
+}
+
 /**
  * Inicia análisis para un dispositivo Android
  */
 void DataAnalyzer::startAndroidAnalysis(const AnalysisTask& task)
 {
+    // Análisis rápido: solo recuentos (también con Bridge Client, que no tiene orden de recuento)
+    if (task.quickScan && startAndroidQuickCount(task)) {
+        return;
+    }
+
     // Comprobar si debemos usar Bridge Client para esta tarea
     if (task.useBridgeClient) {
         // Verificar que el cliente de Bridge está disponible
@@ -201,12 +813,16 @@ void DataAnalyzer::startAndroidAnalysis(const AnalysisTask& task)
     }
 
     // Usar métodos directos de ADB si no se usa Bridge Client o no está disponible
-    if (task.dataType == "photos") {
-        analyzeAndroidPhotosReal(task.deviceId);
+    if (task.dataType == "photos" || task.dataType == "videos" ||
+        task.dataType == "music" || task.dataType == "documents") {
+        analyzeAndroidMedia(task);
     }
     else if (task.dataType == "contacts") {
         analyzeAndroidContacts(task.deviceId);
     }
+    else if (task.data.value("deltaScan").toBool() && analyzeAndroidRecordsDelta(task)) {
+        return; // Mensajes o llamadas nuevos sobre lo guardado en caché
+    }
     else if (task.dataType == "messages") {
         analyzeAndroidMessages(task.deviceId);
     }
@@ -246,34 +862,380 @@ void DataAnalyzer::startIOSAnalysis(const AnalysisTask& task)
 }
 
 /**
- * Obtiene un conjunto de datos previamente analizado
+ * Analiza un dispositivo local recorriendo el directorio raíz.
+ * Las rutas se guardan relativas a la raíz ("/DCIM/foto.jpg"), igual que en un dispositivo real.
  */
-DataSet DataAnalyzer::getDataSet(const QString &deviceId, const QString &dataType)
+void DataAnalyzer::startLocalAnalysis(const AnalysisTask& task)
 {
-    // Devolver dataset existente o uno vacío/no soportado
-    QMutexLocker locker(&m_dataSetMutex);
-    if (m_dataSets.contains(deviceId) && m_dataSets[deviceId].contains(dataType)) {
-        return m_dataSets[deviceId][dataType];
+    QString rootPath = m_deviceManager->getLocalDevicePath(task.deviceId);
+    if (rootPath.isEmpty() || !QDir(rootPath).exists()) {
+        finalizeAnalysis(task.deviceId, task.dataType, false, "Directorio del dispositivo local no disponible.");
+        return;
     }
 
-    DataSet emptySet;
-    emptySet.type = dataType;
-    emptySet.totalSize = 0;
-    emptySet.isSupported = false; // Por defecto no soportado si no se encuentra
-    return emptySet;
+    DataSet dataSet;
+    dataSet.type = task.dataType;
+    dataSet.isSupported = true;
+    dataSet.totalSize = 0;
+
+    QDirIterator it(rootPath, QDir::Files | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        const QFileInfo info = it.fileInfo();
+        if (inferDataTypeFromPath(info.fileName()) != task.dataType) continue;
+
+        DataItem item;
+        item.filePath = "/" + QDir(rootPath).relativeFilePath(info.absoluteFilePath());
+        item.id = item.filePath;
+        item.displayName = info.fileName();
+        item.size = info.size();
+        item.dateTime = info.lastModified();
+        dataSet.items.append(item);
+        dataSet.totalSize += item.size;
+    }
+
+    qDebug() << "Análisis local" << task.dataType << ":" << dataSet.items.size() << "elementos," << dataSet.totalSize << "bytes";
+
+    QMutexLocker locker(&m_dataSetMutex);
+    m_dataSets[task.deviceId][task.dataType] = dataSet;
+    locker.unlock();
+
+    emit dataSetUpdated(task.deviceId, task.dataType);
+    finalizeAnalysis(task.deviceId, task.dataType, true);
 }
 
 /**
- * Obtiene los tipos de datos soportados para transferencia entre dos dispositivos
+ * Reconstruye el DataSet de un tipo desde el índice del respaldo (sin leer los datos)
  */
-QStringList DataAnalyzer::getSupportedDataTypes(const QString &sourceId, const QString &destId)
+void DataAnalyzer::startArchiveAnalysis(const AnalysisTask& task)
 {
-    // Determinar compatibilidad entre dispositivos
-    DeviceInfo sourceDevice = m_deviceManager->getDeviceInfo(sourceId);
-    DeviceInfo destDevice = m_deviceManager->getDeviceInfo(destId);
-
-    if(sourceDevice.id.isEmpty() || destDevice.id.isEmpty()) {
-        return QStringList(); // No se puede determinar si los dispositivos son desconocidos
+    BackupArchiveReader reader;
+    QString error;
+    if (!reader.open(m_deviceManager->getLocalDevicePath(task.deviceId), &error)) {
+        finalizeAnalysis(task.deviceId, task.dataType, false, "No se pudo abrir el archivo de respaldo: " + error);
+        return;
+    }
+
+    DataSet dataSet = reader.dataSet(task.dataType);
+
+    QMutexLocker locker(&m_dataSetMutex);
+    m_dataSets[task.deviceId][task.dataType] = dataSet;
+    locker.unlock();
+
+    emit dataSetUpdated(task.deviceId, task.dataType);
+    finalizeAnalysis(task.deviceId, task.dataType, true);
+}
+
+/**
+ * Carga de forma síncrona todos los DataSets de un archivo de respaldo
+ */
+bool DataAnalyzer::loadArchive(const QString &deviceId)
+{
+    BackupArchiveReader reader;
+    QString error;
+    if (!reader.open(m_deviceManager->getLocalDevicePath(deviceId), &error)) {
+        qWarning() << "No se pudo abrir el archivo de respaldo" << deviceId << error;
+        return false;
+    }
+
+    const QStringList types = reader.dataTypes();
+    QMap<QString, DataSet> dataSets;
+    for (const QString &type : types) {
+        dataSets[type] = reader.dataSet(type);
+    }
+
+    QMutexLocker locker(&m_dataSetMutex);
+    m_dataSets[deviceId] = dataSets;
+    locker.unlock();
+
+    for (const QString &type : types) {
+        emit dataSetUpdated(deviceId, type);
+    }
+    return true;
+}
+
+/**
+ * Infiere el tipo de datos de un archivo por su extensión
+ */
+QString DataAnalyzer::inferDataTypeFromPath(const QString &filePath)
+{
+    static const QStringList photoSuffixes = {"jpg", "jpeg", "png", "gif", "heic", "webp", "bmp", "dng"};
+    static const QStringList videoSuffixes = {"mp4", "3gp", "mkv", "avi", "mov", "webm"};
+    static const QStringList musicSuffixes = {"mp3", "m4a", "ogg", "flac", "wav", "aac", "opus"};
+    static const QStringList documentSuffixes = {"pdf", "doc", "docx", "xls", "xlsx", "ppt", "pptx", "txt", "odt", "csv"};
+
+    QString suffix = QFileInfo(filePath).suffix().toLower();
+    if (photoSuffixes.contains(suffix)) return "photos";
+    if (videoSuffixes.contains(suffix)) return "videos";
+    if (musicSuffixes.contains(suffix)) return "music";
+    if (documentSuffixes.contains(suffix)) return "documents";
+    return QString();
+}
+
+/**
+ * Obtiene un conjunto de datos previamente analizado
+ */
+DataSet DataAnalyzer::getDataSet(const QString &deviceId, const QString &dataType)
+{
+    // Devolver dataset existente o uno vacío/no soportado
+    QMutexLocker locker(&m_dataSetMutex);
+    if (m_dataSets.contains(deviceId) && m_dataSets[deviceId].contains(dataType)) {
+        return m_dataSets[deviceId][dataType];
+    }
+
+    DataSet emptySet;
+    emptySet.type = dataType;
+    emptySet.totalSize = 0;
+    emptySet.isSupported = false; // Por defecto no soportado si no se encuentra
+    return emptySet;
+}
+
+/**
+ * Evalúa una consulta sobre los índices del DataSet, construyéndolos si hace falta
+ */
+ItemSelection DataAnalyzer::selectItems(const QString &deviceId, const QString &dataType, const ItemQuery &query)
+{
+    QMutexLocker locker(&m_dataSetMutex);
+    DataSet dataSet = m_dataSets.value(deviceId).value(dataType); // Copia compartida
+    locker.unlock();
+    const DataItemStore &items = dataSet.items;
+
+    QString key = deviceId + "/" + dataType;
+    ItemIndex &index = m_itemIndexes[key];
+    if (index.size() != items.size()) {
+        QElapsedTimer timer;
+        timer.start();
+        index.build(items);
+        qDebug() << "Índices de" << key << ":" << items.size() << "elementos en" << timer.elapsed() << "ms";
+    }
+
+    ItemSelection selection = index.select(query);
+    selection.deviceId = deviceId;
+    selection.dataType = dataType;
+    selection.generation = dataSet.generation;
+    return selection;
+}
+
+/**
+ * Inventaría un destino fuera de la cola de tareas, en paralelo con el análisis del origen
+ */
+void DataAnalyzer::analyzeDestination(const QString &deviceId)
+{
+    if (m_inventoryScans.contains(deviceId) || m_localInventories.contains(deviceId)) return; // Ya hay uno en curso
+
+    DeviceInfo device = m_deviceManager->getDeviceInfo(deviceId);
+    if (device.id.isEmpty() || !device.authorized) return;
+
+    if (device.type == "android") {
+        startAndroidInventory(deviceId);
+        return;
+    }
+
+    if (device.type == "local" || device.type == "archive") {
+        // Recorrer los directorios de destino puede tardar: en el hilo de E/S
+        QString path = m_deviceManager->getLocalDevicePath(deviceId);
+        m_localInventories.insert(deviceId);
+        runOnIoThread([this, device, path]() {
+            DestinationInventory inventory = localInventory(device, path);
+            QMetaObject::invokeMethod(this, [this, deviceId = device.id, inventory]() {
+                m_localInventories.remove(deviceId);
+                publishInventory(deviceId, inventory);
+            }, Qt::QueuedConnection);
+        });
+        return;
+    }
+
+    DestinationInventory inventory;
+    inventory.errorMessage = "Inventario no disponible para dispositivos " + device.type;
+    // Igual que el de Android, el resultado llega después de volver
+    QTimer::singleShot(0, this, [this, deviceId, inventory]() {
+        publishInventory(deviceId, inventory);
+    });
+}
+
+/**
+ * Espacio libre, archivos en los directorios de destino y recuentos de registros, en un solo adb
+ */
+void DataAnalyzer::startAndroidInventory(const QString &deviceId)
+{
+    QString adbPath = m_deviceManager->getAdbPath();
+    if (adbPath.isEmpty()) {
+        DestinationInventory inventory;
+        inventory.errorMessage = "Ruta de ADB no configurada";
+        publishInventory(deviceId, inventory);
+        return;
+    }
+
+    QStringList directories;
+    for (const QString &type : {QString("photos"), QString("videos"), QString("music"), QString("documents")}) {
+        QString directory = DataTransferManager::destinationDirectoryFor(type);
+        directory.chop(1); // Sin la '/' final, como las rutas que imprime find
+        if (!directories.contains(directory)) directories << directory;
+    }
+
+    // Cada sección empieza con una línea '#nombre'; grep -c imprime 0 aunque salga con 1
+    QString remoteCommand = QString(
+        "for v in /sdcard /data; do echo \"#df $v\"; df -k $v 2>/dev/null | tail -n 1; done; "
+        "echo '#files'; "
+        "if find /sdcard -maxdepth 0 -printf '' >/dev/null 2>&1; then "
+        "find %1 -type f -printf '%s\\t%T@\\t%p\\n'; "
+        "else find %1 -type f -exec stat -c '%s\t%Y\t%n' {} +; fi 2>/dev/null; "
+        "echo '#contacts'; content query --uri %2 --projection _id | grep -c '^Row'; "
+        "echo '#messages'; content query --uri %3 --projection _id | grep -c '^Row'")
+        .arg(directories.join(' '), androidRecordUri("contacts"), androidRecordUri("messages"));
+
+    InventoryScan &scan = m_inventoryScans[deviceId];
+    scan.process = new QProcess(this);
+    QProcess *process = scan.process;
+
+    auto consume = [this, deviceId](bool flush) {
+        auto it = m_inventoryScans.find(deviceId);
+        if (it == m_inventoryScans.end()) return;
+
+        it->framer.append(it->process->readAllStandardOutput());
+        if (flush) it->framer.finish();
+
+        QByteArray line;
+        while (it->framer.nextLine(line)) {
+            if (line.startsWith('#')) {
+                it->section = QString::fromUtf8(line.mid(1));
+                continue;
+            }
+
+            DestinationInventory &inventory = it->inventory;
+            if (it->section.startsWith("df ")) {
+                // Filesystem 1K-blocks Used Available Use% Mounted on
+                const QList<QByteArray> fields = line.simplified().split(' ');
+                bool ok = false;
+                qint64 available = fields.size() >= 4 ? fields.at(3).toLongLong(&ok) : 0;
+                if (ok) inventory.freeSpace[it->section.mid(3)] = available * 1024;
+            } else if (it->section == "files") {
+                // tamaño \t fecha (segundos, con decimales si viene de -printf %T@) \t ruta
+                int tab = line.indexOf('\t');
+                int secondTab = tab > 0 ? line.indexOf('\t', tab + 1) : -1;
+                if (secondTab < 0) continue;
+                DestinationFile file;
+                file.size = line.left(tab).toLongLong();
+                bool ok = false;
+                double modified = line.mid(tab + 1, secondTab - tab - 1).toDouble(&ok);
+                if (ok) file.modified = static_cast<qint64>(modified);
+                inventory.existingFiles.insert(QString::fromUtf8(line.constData() + secondTab + 1, line.size() - secondTab - 1),
+                                               file);
+            } else if (it->section == "contacts") {
+                inventory.contactsCount = line.trimmed().toInt();
+            } else if (it->section == "messages") {
+                inventory.messagesCount = line.trimmed().toInt();
+            }
+        }
+    };
+    auto finish = [this, deviceId, consume](bool started, const QString &errorMessage) {
+        if (started) consume(true);
+        InventoryScan done = m_inventoryScans.take(deviceId);
+        done.process->deleteLater();
+
+        // Sin espacio libre la salida no sirve para planificar; lo demás puede faltar
+        done.inventory.complete = started && !done.inventory.freeSpace.isEmpty();
+        if (!done.inventory.complete) {
+            done.inventory.errorMessage = errorMessage.isEmpty() ? QString("No se pudo leer el espacio libre del destino")
+                                                                 : errorMessage;
+        }
+        publishInventory(deviceId, done.inventory);
+    };
+    connect(process, &QProcess::readyReadStandardOutput, this, [consume]() { consume(false); });
+    connect(process, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+            this, [finish](int, QProcess::ExitStatus exitStatus) {
+        finish(exitStatus == QProcess::NormalExit, QString());
+    });
+    connect(process, &QProcess::errorOccurred, this, [finish, process](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) finish(false, "No se pudo iniciar adb: " + process->errorString());
+    });
+
+    process->start(adbPath, QStringList() << "-s" << deviceId << "exec-out" << remoteCommand);
+}
+
+/**
+ * Inventario de un directorio del PC (o del directorio de un archivo de respaldo)
+ */
+DestinationInventory DataAnalyzer::localInventory(const DeviceInfo &device, const QString &path)
+{
+    DestinationInventory inventory;
+    QString root = device.type == "archive" ? QFileInfo(path).absolutePath() : path;
+
+    QStorageInfo storage(root);
+    if (!storage.isValid()) {
+        inventory.errorMessage = "No se pudo leer el espacio libre de " + root;
+        return inventory;
+    }
+    inventory.freeSpace["/"] = storage.bytesAvailable(); // Todas las rutas del dispositivo están en la raíz
+
+    if (device.type == "archive") {
+        // Un respaldo solo crece: no hay archivos que deduplicar, sí registros ya guardados.
+        // Se cuentan en el índice, sin decodificar cada registro
+        BackupArchiveReader reader;
+        bool exists = reader.open(path);
+        inventory.contactsCount = exists ? reader.entryCount("contacts") : 0;
+        inventory.messagesCount = exists ? reader.entryCount("messages") : 0;
+    } else {
+        QStringList directories;
+        for (const QString &type : {QString("photos"), QString("videos"), QString("music"), QString("documents")}) {
+            QString directory = DataTransferManager::destinationDirectoryFor(type);
+            directory.chop(1);
+            if (!directories.contains(directory)) directories << directory;
+        }
+        for (const QString &directory : qAsConst(directories)) {
+            QString hostDirectory = QDir::cleanPath(root + "/" + directory);
+            QDirIterator it(hostDirectory, QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+            while (it.hasNext()) {
+                it.next();
+                DestinationFile file;
+                file.size = it.fileInfo().size();
+                file.modified = it.fileInfo().lastModified().toSecsSinceEpoch();
+                inventory.existingFiles.insert(directory + it.filePath().mid(hostDirectory.size()), file);
+            }
+        }
+    }
+
+    inventory.complete = true;
+    return inventory;
+}
+
+/**
+ * Guarda el inventario para el motor de transferencia y avisa a la interfaz
+ */
+void DataAnalyzer::publishInventory(const QString &deviceId, const DestinationInventory &inventory)
+{
+    QMutexLocker locker(&m_inventoryMutex);
+    m_inventories[deviceId] = inventory;
+    m_inventories[deviceId].takenAt = QDateTime::currentDateTimeUtc();
+    locker.unlock();
+
+    if (inventory.complete) {
+        qDebug() << "Inventario del destino" << deviceId << ": libre" << inventory.freeSpace
+                 << "archivos" << inventory.existingFiles.size() << "contactos" << inventory.contactsCount
+                 << "mensajes" << inventory.messagesCount;
+    } else {
+        qWarning() << "Inventario del destino" << deviceId << "no disponible:" << inventory.errorMessage;
+    }
+    emit destinationInventoryReady(deviceId);
+}
+
+DestinationInventory DataAnalyzer::getDestinationInventory(const QString &deviceId) const
+{
+    QMutexLocker locker(&m_inventoryMutex);
+    return m_inventories.value(deviceId);
+}
+
+/**
+ * Obtiene los tipos de datos soportados para transferencia entre dos dispositivos
+ */
+QStringList DataAnalyzer::getSupportedDataTypes(const QString &sourceId, const QString &destId)
+{
+    // Determinar compatibilidad entre dispositivos
+    DeviceInfo sourceDevice = m_deviceManager->getDeviceInfo(sourceId);
+    DeviceInfo destDevice = m_deviceManager->getDeviceInfo(destId);
+
+    if(sourceDevice.id.isEmpty() || destDevice.id.isEmpty()) {
+        return QStringList(); // No se puede determinar si los dispositivos son desconocidos
     }
 
     // Lista base de tipos potencialmente transferibles
@@ -404,9 +1366,12 @@ void DataAnalyzer::startAndroidAnalysisViaBridge(const AnalysisTask& task)
     connect(bridgeClient, &AdbSocketClient::messagesDataReceived, this,
             &DataAnalyzer::onBridgeClientMessagesData);
 
-    // Iniciar el escaneo
+    // Iniciar el escaneo: solo el tipo de la tarea y lo que pase los filtros viajan por USB
+    ScanFilter filter = m_bridgeScanFilter;
+    filter.types << task.dataType;
+    m_bridgeTasks[task.deviceId] = task;
     m_bridgeScanComplete[task.deviceId][task.dataType] = false;
-    bridgeClient->startScan();
+    bridgeClient->startScan(filter);
 
     // Emitir evento de progreso inicial
     emit analysisProgress(task.deviceId, task.dataType, 0);
@@ -439,21 +1404,37 @@ void DataAnalyzer::updateBridgeScanProgress(const QString &deviceId, const QStri
 }
 
 /**
- * Maneja la finalización del proceso de análisis externo
+ * Maneja la finalización del proceso de análisis externo de una tarea
  */
-void DataAnalyzer::onAnalysisProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
+void DataAnalyzer::onAnalysisProcessFinished(QProcess *process, const AnalysisTask &task,
+                                             int exitCode, QProcess::ExitStatus exitStatus)
 {
-    if (m_currentAnalysisTask.deviceId.isEmpty()) {
-        qWarning() << "Proceso finalizado sin tarea de análisis activa";
+    QString deviceId = task.deviceId;
+    QString dataType = task.data["type"].toString();
+
+    // La consulta incremental detectó borrados: se descarta la base y se analiza completo
+    if (m_queryStreams.value(process).fullRescan) {
+        m_queryStreams.remove(process);
+        process->deleteLater();
+        qDebug() << "Filas borradas en" << dataType << "de" << deviceId << ": análisis completo";
+
+        QMutexLocker locker(&m_dataSetMutex);
+        m_dataSets[deviceId].remove(dataType);
+        locker.unlock();
+
+        if (dataType == "messages") {
+            analyzeAndroidMessages(deviceId);
+        } else {
+            analyzeAndroidCalls(deviceId);
+        }
         return;
     }
 
-    QString stdOut = m_analysisProcess->readAllStandardOutput();
-    QString stdErr = m_analysisProcess->readAllStandardError();
-    QString deviceId = m_currentAnalysisTask.deviceId;
-    QString dataType = m_currentAnalysisTask.data["type"].toString();
-
     if (exitCode != 0 || exitStatus != QProcess::NormalExit) {
+        QString stdErr = process->readAllStandardError();
+        m_queryStreams.remove(process);
+        process->deleteLater();
+
         QString errorMsg = QString("Error en análisis de %1 (Código: %2): %3")
                                .arg(dataType)
                                .arg(exitCode)
@@ -465,43 +1446,178 @@ void DataAnalyzer::onAnalysisProcessFinished(int exitCode, QProcess::ExitStatus
         return;
     }
 
-    DataSet dataSet;
-    dataSet.type = dataType;
-    dataSet.isSupported = true;
+    // Procesar lo que quede de la salida y publicar las últimas filas
+    parseQueryOutput(process, task, true);
+    QueryStream stream = m_queryStreams.take(process);
+    process->deleteLater();
 
-    if (dataType == "photos") {
-        QString basePath = m_currentAnalysisTask.data["basePath"].toString();
-        dataSet.items = parseAndroidPhotoList(stdOut, basePath);
-    }
-    else if (dataType == "contacts") {
-        dataSet.items = parseAndroidContacts(stdOut);
-    }
-    else if (dataType == "messages") {
-        dataSet.items = parseAndroidMessages(stdOut);
-    }
-    else if (dataType == "calls") {
-        dataSet.items = parseAndroidCalls(stdOut);
-    }
-    else {
-        // Manejar otros tipos de datos...
+    qDebug() << "Filas de" << dataType << "en" << deviceId << ":" << stream.rows
+             << (stream.baseRows > 0 ? QString("nuevas sobre %1 en caché").arg(stream.baseRows) : QString());
+    m_lastRowCounts[deviceId][dataType] = stream.baseRows + stream.rows;
+
+    // Para el siguiente análisis incremental: lo que hay en el dispositivo, no lo que se pudo convertir
+    QJsonObject scanInfo;
+    scanInfo["deviceRows"] = stream.baseRows + stream.deviceRows;
+    scanInfo["maxId"] = QString::number(stream.maxRowId);
+    m_pendingScanInfo[deviceId + "/" + dataType] = scanInfo;
+
+    emit analysisProgress(deviceId, dataType, 100);
+
+    // Finalizar tarea
+    finalizeAnalysis(deviceId, dataType, true);
+}
+
+namespace {
+
+/**
+ * _id de una línea "Row: N _id=..., ..." (las proyecciones empiezan por _id), o -1
+ */
+qint64 rowId(const QByteArray &line)
+{
+    int start = line.indexOf(" _id=");
+    if (start < 0) return -1;
+    start += 5;
+    int end = start;
+    while (end < line.size() && line.at(end) >= '0' && line.at(end) <= '9') end++;
+    return end > start ? line.mid(start, end - start).toLongLong() : -1;
+}
+
+} // namespace
+
+/**
+ * Convierte en DataItems las filas completas recibidas de una consulta y las publica por bloques
+ */
+void DataAnalyzer::parseQueryOutput(QProcess *process, const AnalysisTask &task, bool finished)
+{
+    auto it = m_queryStreams.find(process);
+    if (it == m_queryStreams.end()) return;
+
+    QueryStream &stream = *it;
+    if (stream.fullRescan) return; // Proceso ya terminado a la fuerza
+    QString dataType = task.data["type"].toString();
+
+    stream.framer.append(process->readAllStandardOutput());
+    if (finished) stream.framer.finish();
+
+    QByteArray line;
+    DataItem item;
+
+    // Consulta incremental: la primera línea es el recuento de filas que siguen en el dispositivo
+    if (stream.expectedBaseRows >= 0 && stream.framer.nextLine(line)) {
+        if (line.trimmed().toInt() != stream.expectedBaseRows) {
+            stream.fullRescan = true;
+            process->kill();
+            return;
+        }
+        stream.expectedBaseRows = -1;
     }
 
-    // Calcular tamaño total
-    dataSet.totalSize = 0;
-    for (const DataItem &item : dataSet.items) {
-        dataSet.totalSize += item.size;
+    while (stream.framer.nextLine(line)) {
+        if (line.startsWith("Row: ")) {
+            stream.deviceRows++;
+            stream.maxRowId = qMax(stream.maxRowId, rowId(line));
+        }
+        if (parseAndroidRow(dataType, line, item)) {
+            if (m_lazyRecordFields) stripHeavyFields(dataType, item);
+            stream.chunk.append(item);
+            stream.rows++;
+        }
     }
 
-    // Almacenar resultados
+    // Publicar por bloques: la interfaz ve datos parciales sin una señal por fila
+    if (!finished && stream.chunk.size() < ROW_CHUNK) return;
+
+    QString deviceId = task.deviceId;
     QMutexLocker locker(&m_dataSetMutex);
-    m_dataSets[deviceId][dataType] = dataSet;
+    QMap<QString, DataSet> &deviceSets = m_dataSets[deviceId];
+    if (!deviceSets.contains(dataType)) {
+        DataSet dataSet;
+        dataSet.type = dataType;
+        dataSet.isSupported = true;
+        dataSet.totalSize = 0;
+        deviceSets[dataType] = dataSet;
+    }
+    DataSet &dataSet = deviceSets[dataType];
+    for (const DataItem &row : qAsConst(stream.chunk)) {
+        dataSet.totalSize += row.size;
+    }
+    dataSet.items.append(stream.chunk);
     locker.unlock();
+    stream.chunk.clear();
 
     emit dataSetUpdated(deviceId, dataType);
-    emit analysisProgress(deviceId, dataType, 100);
 
-    // Finalizar tarea
-    finalizeAnalysis(deviceId, dataType, true);
+    if (finished) return; // El 100% lo emite quien finaliza la tarea
+
+    // Sin total conocido, se estima con el recuento del análisis anterior o una curva que tiende a 99
+    int expected = m_lastRowCounts.value(deviceId).value(dataType) - stream.baseRows;
+    int progress = expected > 0 ? static_cast<int>(qint64(stream.rows) * 100 / expected)
+                                : static_cast<int>(qint64(stream.rows) * 100 / (stream.rows + 10 * ROW_CHUNK));
+    progress = qBound(1, progress, 99);
+    if (progress != stream.lastProgress) {
+        stream.lastProgress = progress;
+        emit analysisProgress(deviceId, dataType, progress);
+    }
+}
+
+/**
+ * Procesa una fila de la salida de una consulta según el tipo de datos
+ */
+bool DataAnalyzer::parseAndroidRow(const QString &dataType, const QByteArray &line, DataItem &item)
+{
+    if (dataType == "contacts") return parseAndroidContactRow(line, item);
+    if (dataType == "messages") return parseAndroidMessageRow(line, item);
+    if (dataType == "calls") return parseAndroidCallRow(line, item);
+    return false;
+}
+
+/**
+ * Proveedor de contenido de cada tipo de registro
+ */
+QString DataAnalyzer::androidRecordUri(const QString &dataType)
+{
+    if (dataType == "contacts") return "content://com.android.contacts/data";
+    if (dataType == "messages") return "content://sms";
+    if (dataType == "calls") return "content://call_log/calls";
+    return QString();
+}
+
+/**
+ * Consulta de cada tipo de registro; parseAndroidRow() depende de estas proyecciones
+ */
+QString DataAnalyzer::androidRecordQuery(const QString &dataType)
+{
+    QString projection;
+    if (dataType == "contacts") projection = "_id,display_name,times_contacted,last_time_contacted";
+    else if (dataType == "messages") projection = "_id,address,body,date";
+    else if (dataType == "calls") projection = "_id,number,date,duration,type";
+    else return QString();
+
+    return QString("content query --uri %1 --projection %2").arg(androidRecordUri(dataType), projection);
+}
+
+/**
+ * Deja en un registro solo lo que necesita la interfaz antes de transferir
+ */
+void DataAnalyzer::stripHeavyFields(const QString &dataType, DataItem &item)
+{
+    static const QStringList messageFields = {"body", "isRead", "type"}; // La dirección se queda: sirve para seleccionar
+    static const QStringList contactFields = {"phones", "emails", "photoUri"};
+
+    const QStringList *fields = nullptr;
+    if (dataType == "messages") fields = &messageFields;
+    else if (dataType == "contacts") fields = &contactFields;
+    else return; // Las llamadas no tienen campos pesados
+
+    for (const QString &field : *fields) {
+        item.data.remove(field);
+    }
+    item.data["partial"] = true;
+}
+
+bool DataAnalyzer::isPartialRecord(const DataItem &item)
+{
+    return item.data.value("partial").toBool();
 }
 
 /**
@@ -518,6 +1634,9 @@ void DataAnalyzer::finalizeAnalysis(const QString& deviceId, const QString& data
     }
 
     qDebug() << "Finalizando análisis para dispositivo:" << deviceId << "Tipo:" << dataType << "Éxito:" << success;
+    m_runningTasks.remove(deviceId + "/" + dataType); // Libera su hueco para la siguiente tarea
+    QString cacheToken = m_pendingCacheTokens.take(deviceId + "/" + dataType);
+    QJsonObject scanInfo = m_pendingScanInfo.take(deviceId + "/" + dataType);
 
     // Asegurar que exista un dataset incluso si el análisis falló, marcarlo como no soportado/error
     QMutexLocker locker(&m_dataSetMutex);
@@ -537,9 +1656,38 @@ void DataAnalyzer::finalizeAnalysis(const QString& deviceId, const QString& data
         locker.unlock();
         emit dataSetUpdated(deviceId, dataType); // Notificar a la UI sobre el estado de error
     } else {
+        DataSet &dataSet = m_dataSets[deviceId][dataType];
+        if (!dataSet.items.isEmpty()) {
+            qDebug() << "Memoria de" << dataType << ":" << dataSet.memoryUsage() / dataSet.items.size()
+                     << "bytes por elemento," << dataSet.items.size() << "elementos";
+        }
+
+        // El índice de rutas solo sirve para mezclar lotes: mergeItems() lo rehace si vuelve a hacer falta
+        dataSet.pathIndex = QHash<QString, int>();
+        dataSet.pathIndexed = 0;
         locker.unlock();
     }
 
+    // Las transferencias que consumen este tipo reciben lo último y el cierre
+    m_typesInAnalysis.remove(deviceId + "/" + dataType);
+    if (!m_backgroundDevices.contains(deviceId)) {
+        feedSubscribers(deviceId, dataType);
+        closeItemFeeds(deviceId, dataType, success ? QString()
+                                                   : (errorMsg.isEmpty() ? QString("Análisis falló") : errorMsg));
+    }
+
+    // Guardar el resultado con el testigo calculado antes del análisis
+    if (success && !cacheToken.isEmpty()) {
+        DataSet analyzed = getDataSet(deviceId, dataType);
+        if (analyzed.isSupported && analyzed.errorMessage.isEmpty()) {
+            // Codificar y escribir todos los registros no debe frenar la interfaz
+            AnalysisCache *cache = m_analysisCache;
+            runOnIoThread([cache, deviceId, dataType, cacheToken, analyzed, scanInfo]() {
+                cache->store(deviceId, dataType, cacheToken, analyzed, scanInfo);
+            });
+        }
+    }
+
     if (success) {
         emit analysisProgress(deviceId, dataType, 100); // Tarea completada exitosamente
     } else {
@@ -551,8 +1699,12 @@ void DataAnalyzer::finalizeAnalysis(const QString& deviceId, const QString& data
         m_pendingTasksPerDevice[deviceId]--;
         if (m_pendingTasksPerDevice[deviceId] <= 0) {
             qDebug() << "Todas las tareas de análisis completadas para dispositivo:" << deviceId;
-            emit analysisComplete(deviceId); // Todas las tareas para este dispositivo terminaron
             m_pendingTasksPerDevice.remove(deviceId); // Limpiar
+            if (m_backgroundDevices.contains(deviceId)) {
+                finishBackgroundAnalysis(deviceId);
+            } else {
+                emit analysisComplete(deviceId); // Todas las tareas para este dispositivo terminaron
+            }
         }
     } else {
         qWarning() << "Contador de tareas pendientes no encontrado para dispositivo:" << deviceId << "al finalizar" << dataType;
@@ -574,19 +1726,17 @@ void DataAnalyzer::onBridgeClientDeviceInfo(const QJsonObject &deviceInfo)
 /**
  * Maneja la recepción de datos multimedia desde Bridge Client
  */
-void DataAnalyzer::onBridgeClientMediaData(int index, int count, const QJsonArray &mediaData)
+void DataAnalyzer::onBridgeClientMediaData(int index, int count, const QList<DataItem> &items)
 {
     qDebug() << "Received media data from Bridge Client chunk" << (index + 1) << "of" << count;
 
-    QString deviceId = m_currentAnalysisTask.deviceId;
+    AnalysisTask task = bridgeTaskForSender();
+    QString deviceId = task.deviceId;
     if (deviceId.isEmpty()) {
         qWarning() << "Received media data but no active task";
         return;
     }
 
-    // Procesar datos multimedia (fotos, videos, música)
-    QList<DataItem> items = parseJsonMediaData(mediaData);
-
     // Agrupar elementos por tipo
     QMap<QString, QList<DataItem>> itemsByType;
     for (const DataItem &item : items) {
@@ -610,80 +1760,32 @@ void DataAnalyzer::onBridgeClientMediaData(int index, int count, const QJsonArra
             }
         }
 
+        // Un Bridge Client que no entienda los filtros envía todo: se descarta aquí
+        if (type != task.dataType || !matchesBridgeScanFilter(item)) continue;
         itemsByType[type].append(item);
     }
 
-    // Actualizar conjuntos de datos por tipo
-    QMutexLocker locker(&m_dataSetMutex);
-    for (auto it = itemsByType.begin(); it != itemsByType.end(); ++it) {
-        QString type = it.key();
-        QList<DataItem> typeItems = it.value();
-
-        if (!m_dataSets.contains(deviceId)) {
-            m_dataSets[deviceId] = QMap<QString, DataSet>();
-        }
-
-        if (!m_dataSets[deviceId].contains(type)) {
-            // Crear nuevo dataset
-            DataSet newDataSet;
-            newDataSet.type = type;
-            newDataSet.isSupported = true;
-            newDataSet.items = typeItems;
-            newDataSet.totalSize = 0;
-
-            for (const DataItem &item : typeItems) {
-                newDataSet.totalSize += item.size;
-            }
-
-            m_dataSets[deviceId][type] = newDataSet;
-        } else {
-            // Actualizar dataset existente
-            QList<DataItem> &existingItems = m_dataSets[deviceId][type].items;
-            qint64 &totalSize = m_dataSets[deviceId][type].totalSize;
-
-            // Verificar duplicados basados en id/filePath
-            QSet<QString> existingPaths;
-            for (const DataItem &item : existingItems) {
-                existingPaths.insert(item.filePath);
-            }
-
-            for (const DataItem &item : typeItems) {
-                if (!existingPaths.contains(item.filePath)) {
-                    existingItems.append(item);
-                    totalSize += item.size;
-                }
-            }
-        }
-    }
-    locker.unlock();
-
-    // Emitir actualizaciones para cada tipo
-    for (auto it = itemsByType.begin(); it != itemsByType.end(); ++it) {
-        QString type = it.key();
-        emit dataSetUpdated(deviceId, type);
-    }
+    mergeBridgeItems(deviceId, itemsByType);
 
     // Actualizar progreso total aproximado
     int progress = (((index + 1) * 100) / count);
-    updateBridgeScanProgress(deviceId, m_currentAnalysisTask.dataType, progress);
+    updateBridgeScanProgress(deviceId, task.dataType, progress);
 }
 
 /**
  * Maneja la recepción de datos de archivos desde Bridge Client
  */
-void DataAnalyzer::onBridgeClientFilesData(int index, int count, const QJsonArray &filesData)
+void DataAnalyzer::onBridgeClientFilesData(int index, int count, const QList<DataItem> &items)
 {
     qDebug() << "Received files data from Bridge Client chunk" << (index + 1) << "of" << count;
 
-    QString deviceId = m_currentAnalysisTask.deviceId;
+    AnalysisTask task = bridgeTaskForSender();
+    QString deviceId = task.deviceId;
     if (deviceId.isEmpty()) {
         qWarning() << "Received files data but no active task";
         return;
     }
 
-    // Procesar datos de archivos (documentos, APKs, etc.)
-    QList<DataItem> items = parseJsonFilesData(filesData);
-
     // Agrupar por tipo
     QMap<QString, QList<DataItem>> itemsByType;
     for (const DataItem &item : items) {
@@ -703,222 +1805,1076 @@ void DataAnalyzer::onBridgeClientFilesData(int index, int count, const QJsonArra
             }
         }
 
+        if (type != task.dataType || !matchesBridgeScanFilter(item)) continue;
         itemsByType[type].append(item);
     }
 
-    // Actualizar conjuntos de datos por tipo (similar a onBridgeClientMediaData)
-    QMutexLocker locker(&m_dataSetMutex);
-    for (auto it = itemsByType.begin(); it != itemsByType.end(); ++it) {
-        QString type = it.key();
-        QList<DataItem> typeItems = it.value();
+    mergeBridgeItems(deviceId, itemsByType);
 
-        if (!m_dataSets.contains(deviceId)) {
-            m_dataSets[deviceId] = QMap<QString, DataSet>();
-        }
+    // Actualizar progreso
+    int progress = (((index + 1) * 100) / count);
+    updateBridgeScanProgress(deviceId, task.dataType, progress);
+}
 
-        if (!m_dataSets[deviceId].contains(type)) {
-            // Crear nuevo dataset
+/**
+ * Incorpora un lote de Bridge Client a los DataSets del dispositivo y notifica los tipos tocados
+ */
+void DataAnalyzer::mergeBridgeItems(const QString &deviceId, const QMap<QString, QList<DataItem>> &itemsByType)
+{
+    QMutexLocker locker(&m_dataSetMutex);
+    QMap<QString, DataSet> &deviceSets = m_dataSets[deviceId];
+    for (auto it = itemsByType.begin(); it != itemsByType.end(); ++it) {
+        if (!deviceSets.contains(it.key())) {
             DataSet newDataSet;
-            newDataSet.type = type;
+            newDataSet.type = it.key();
             newDataSet.isSupported = true;
-            newDataSet.items = typeItems;
             newDataSet.totalSize = 0;
-
-            for (const DataItem &item : typeItems) {
-                newDataSet.totalSize += item.size;
-            }
-
-            m_dataSets[deviceId][type] = newDataSet;
-        } else {
-            // Actualizar dataset existente
-            QList<DataItem> &existingItems = m_dataSets[deviceId][type].items;
-            qint64 &totalSize = m_dataSets[deviceId][type].totalSize;
-
-            // Verificar duplicados
-            QSet<QString> existingPaths;
-            for (const DataItem &item : existingItems) {
-                existingPaths.insert(item.filePath);
-            }
-
-            for (const DataItem &item : typeItems) {
-                if (!existingPaths.contains(item.filePath)) {
-                    existingItems.append(item);
-                    totalSize += item.size;
-                }
-            }
+            deviceSets[it.key()] = newDataSet;
         }
+        mergeItems(deviceSets[it.key()], it.value());
     }
     locker.unlock();
 
     // Emitir actualizaciones para cada tipo
     for (auto it = itemsByType.begin(); it != itemsByType.end(); ++it) {
-        QString type = it.key();
+        emit dataSetUpdated(deviceId, it.key());
+    }
+}
+
+/**
+ * Comprueba un elemento recibido contra los filtros de escaneo (raíces y tamaño solo en archivos)
+ */
+bool DataAnalyzer::matchesBridgeScanFilter(const DataItem &item) const
+{
+    const ScanFilter &filter = m_bridgeScanFilter;
+    if (item.dateTime.isValid()) {
+        if (filter.from.isValid() && item.dateTime < filter.from) return false;
+        if (filter.to.isValid() && item.dateTime > filter.to) return false;
+    }
+    if (item.filePath.isEmpty()) return true;
+
+    if (filter.minSize >= 0 && item.size < filter.minSize) return false;
+    if (filter.rootFolders.isEmpty()) return true;
+    for (const QString &root : filter.rootFolders) {
+        if (item.filePath.startsWith(root.endsWith('/') ? root : root + "/")) return true;
+    }
+    return false;
+}
+
+/**
+ * Añade los elementos con ruta nueva usando el índice ruta -> posición del DataSet
+ */
+int DataAnalyzer::mergeItems(DataSet &dataSet, const QList<DataItem> &items)
+{
+    // Validez explícita (con rutas repetidas el índice tiene menos entradas que items):
+    // se reconstruye si items se reemplazó por algo más corto y solo se completa con
+    // los elementos que se añadieron por otra vía
+    if (dataSet.pathIndexed > dataSet.items.size()) {
+        dataSet.pathIndex.clear();
+        dataSet.pathIndexed = 0;
+    }
+    if (dataSet.pathIndexed < dataSet.items.size()) {
+        dataSet.pathIndex.reserve(dataSet.items.size() + items.size());
+        for (int i = dataSet.pathIndexed; i < dataSet.items.size(); ++i) {
+            dataSet.pathIndex.insert(dataSet.items.filePath(i), i);
+        }
+        dataSet.pathIndexed = dataSet.items.size();
+    }
+
+    int added = 0;
+    for (const DataItem &item : items) {
+        // Verificar duplicados basados en filePath
+        if (dataSet.pathIndex.contains(item.filePath)) continue;
+
+        dataSet.pathIndex.insert(item.filePath, dataSet.items.size());
+        dataSet.items.append(item);
+        dataSet.pathIndexed++;
+        dataSet.totalSize += item.size;
+        ++added;
+    }
+    return added;
+}
+
+/**
+ * Maneja la recepción de datos de contactos desde Bridge Client
+ */
+void DataAnalyzer::onBridgeClientContactsData(const QList<DataItem> &contactsData)
+{
+    qDebug() << "Received contacts data from Bridge Client";
+
+    AnalysisTask task = bridgeTaskForSender();
+    QString deviceId = task.deviceId;
+    if (deviceId.isEmpty()) {
+        qWarning() << "Received contacts data but no active task";
+        return;
+    }
+    if (task.dataType != "contacts") return; // Escaneo de otro tipo (cliente sin filtros)
+
+    // Los contactos llegan ya convertidos desde el hilo de E/S
+    QList<DataItem> contacts = contactsData;
+    if (m_lazyRecordFields) {
+        for (DataItem &contact : contacts) {
+            stripHeavyFields("contacts", contact);
+        }
+    }
+
+    // Actualizar dataset de contactos
+    QMutexLocker locker(&m_dataSetMutex);
+    if (!m_dataSets.contains(deviceId)) {
+        m_dataSets[deviceId] = QMap<QString, DataSet>();
+    }
+
+    DataSet contactsSet;
+    contactsSet.type = "contacts";
+    contactsSet.isSupported = true;
+    contactsSet.items = contacts;
+    contactsSet.totalSize = 0;
+
+    // Calcular tamaño total
+    for (const DataItem &contact : contacts) {
+        contactsSet.totalSize += contact.size;
+    }
+
+    m_dataSets[deviceId]["contacts"] = contactsSet;
+    locker.unlock();
+
+    emit dataSetUpdated(deviceId, "contacts");
+    updateBridgeScanProgress(deviceId, "contacts", 100);
+}
+
+/**
+ * Maneja la recepción de datos de mensajes desde Bridge Client
+ */
+void DataAnalyzer::onBridgeClientMessagesData(const QList<DataItem> &messagesData)
+{
+    qDebug() << "Received messages data from Bridge Client";
+
+    AnalysisTask task = bridgeTaskForSender();
+    QString deviceId = task.deviceId;
+    if (deviceId.isEmpty()) {
+        qWarning() << "Received messages data but no active task";
+        return;
+    }
+    if (task.dataType != "messages") return;
+
+    // Los mensajes llegan ya convertidos desde el hilo de E/S
+    QList<DataItem> messages = messagesData;
+    messages.erase(std::remove_if(messages.begin(), messages.end(), [this](const DataItem &message) {
+        return !matchesBridgeScanFilter(message);
+    }), messages.end());
+    if (m_lazyRecordFields) {
+        for (DataItem &message : messages) {
+            stripHeavyFields("messages", message);
+        }
+    }
+
+    // Actualizar dataset de mensajes
+    QMutexLocker locker(&m_dataSetMutex);
+    if (!m_dataSets.contains(deviceId)) {
+        m_dataSets[deviceId] = QMap<QString, DataSet>();
+    }
+
+    DataSet messagesSet;
+    messagesSet.type = "messages";
+    messagesSet.isSupported = true;
+    messagesSet.items = messages;
+    messagesSet.totalSize = 0;
+
+    // Calcular tamaño total
+    for (const DataItem &message : messages) {
+        messagesSet.totalSize += message.size;
+    }
+
+    m_dataSets[deviceId]["messages"] = messagesSet;
+    locker.unlock();
+
+    emit dataSetUpdated(deviceId, "messages");
+    updateBridgeScanProgress(deviceId, "messages", 100);
+}
+
+/**
+ * Maneja la actualización de progreso desde Bridge Client
+ */
+void DataAnalyzer::onBridgeClientScanProgress(int progress)
+{
+    AnalysisTask task = bridgeTaskForSender();
+    if (task.deviceId.isEmpty() || task.dataType.isEmpty()) {
+        return;
+    }
+
+    // Reportar progreso del escaneo
+    updateBridgeScanProgress(task.deviceId, task.dataType, progress);
+}
+
+/**
+ * Maneja la finalización del escaneo desde Bridge Client
+ */
+void DataAnalyzer::onBridgeClientScanCompleted()
+{
+    AnalysisTask task = bridgeTaskForSender();
+    QString deviceId = task.deviceId;
+    QString dataType = task.dataType;
+
+    qDebug() << "Bridge Client scan completed for device:" << deviceId << "type:" << dataType;
+
+    // Desconectar señales de Bridge Client
+    disconnectBridgeClientSignals(deviceId);
+    m_bridgeTasks.remove(deviceId);
+
+    // Marcar como completado
+    if (!deviceId.isEmpty() && !dataType.isEmpty()) {
+        m_bridgeScanComplete[deviceId][dataType] = true;
+        finalizeAnalysis(deviceId, dataType, true);
+    }
+}
+
+/**
+ * Maneja errores de escaneo desde Bridge Client
+ */
+void DataAnalyzer::onBridgeClientScanError(const QString &errorMessage)
+{
+    AnalysisTask task = bridgeTaskForSender();
+    QString deviceId = task.deviceId;
+    QString dataType = task.dataType;
+
+    qDebug() << "Bridge Client scan error for device:" << deviceId << "type:" << dataType << "error:" << errorMessage;
+
+    // Desconectar señales
+    disconnectBridgeClientSignals(deviceId);
+    m_bridgeTasks.remove(deviceId);
+
+    if (!deviceId.isEmpty() && !dataType.isEmpty()) {
+        finalizeAnalysis(deviceId, dataType, false, errorMessage);
+    }
+}
+
+/**
+ * Tarea de Bridge Client del cliente que emitió la señal en curso
+ */
+AnalysisTask DataAnalyzer::bridgeTaskForSender() const
+{
+    QObject *client = sender();
+    for (auto it = m_bridgeTasks.constBegin(); it != m_bridgeTasks.constEnd(); ++it) {
+        if (client && m_deviceManager->getBridgeClient(it.key()) == client) {
+            return it.value();
+        }
+    }
+    return AnalysisTask();
+}
+
+/**
+ * Lanza el proceso externo de una tarea de análisis (un proceso por tarea)
+ */
+void DataAnalyzer::startAnalysisProcess(const AnalysisTask &task, const QString &fullAdbCommand)
+{
+    // Dividir el comando para ejecutarlo con QProcess
+    QStringList arguments = fullAdbCommand.split(' ');
+    QString program = arguments.takeFirst(); // El path a adb
+
+    startAnalysisProcess(task, program, arguments);
+}
+
+/**
+ * Lanza el proceso externo de una tarea con los argumentos ya separados
+ */
+void DataAnalyzer::startAnalysisProcess(const AnalysisTask &task, const QString &program, const QStringList &arguments)
+{
+    QProcess *process = new QProcess(this);
+    QueryStream &stream = m_queryStreams[process];
+    stream.rows = 0;
+    stream.lastProgress = 0;
+    stream.deviceRows = 0;
+    stream.maxRowId = task.data.value("deltaMaxId", 0).toLongLong();
+    stream.expectedBaseRows = task.data.value("deltaBaseRows", -1).toInt();
+    stream.baseRows = qMax(0, stream.expectedBaseRows);
+    stream.fullRescan = false;
+
+    // La salida se procesa a medida que llega, sin acumularla entera
+    connect(process, &QProcess::readyReadStandardOutput, this, [this, process, task]() {
+        parseQueryOutput(process, task, false);
+    });
+    connect(process, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+            this, [this, process, task](int exitCode, QProcess::ExitStatus exitStatus) {
+        onAnalysisProcessFinished(process, task, exitCode, exitStatus);
+    });
+    connect(process, &QProcess::errorOccurred, this, [this, process, task](QProcess::ProcessError error) {
+        if (error != QProcess::FailedToStart) return; // Los demás errores terminan en finished
+        m_queryStreams.remove(process);
+        process->deleteLater();
+        finalizeAnalysis(task.deviceId, task.dataType, false,
+                         "No se pudo iniciar el proceso de análisis: " + process->errorString());
+    });
+
+    process->start(program, arguments);
+}
+
+/**
+ * Raíces de medios por defecto en dispositivos Android
+ */
+QStringList DataAnalyzer::defaultAndroidMediaRoots()
+{
+    return {
+        "/sdcard/DCIM",            // Cámara y capturas de pantalla
+        "/sdcard/Pictures",
+        "/sdcard/Movies",
+        "/sdcard/Music",
+        "/sdcard/Download",
+        "/sdcard/Documents",
+        "/sdcard/WhatsApp/Media",
+        "/sdcard/Android/media/com.whatsapp/WhatsApp/Media",
+        "/storage/*/DCIM"          // Tarjetas SD (el comodín lo expande el shell del dispositivo)
+    };
+}
+
+/**
+ * Establece las raíces que recorre el análisis de medios por ADB
+ */
+void DataAnalyzer::setAndroidMediaRoots(const QStringList &roots)
+{
+    m_androidMediaRoots = roots;
+}
+
+/**
+ * Recorre todas las raíces de medios de un dispositivo Android con una sola orden find
+ */
+void DataAnalyzer::analyzeAndroidMedia(const AnalysisTask &task)
+{
+    // Fotos, vídeos, música y documentos salen del mismo recorrido: las demás tareas se suman a él
+    auto running = m_mediaScans.find(task.deviceId);
+    if (running != m_mediaScans.end()) {
+        running->waitingTypes << task.dataType;
+        m_runningTasks.remove(task.deviceId + "/" + task.dataType); // No ocupa hueco mientras espera
+        return;
+    }
+
+    QString adbPath = m_deviceManager->getAdbPath();
+    if (adbPath.isEmpty()) {
+        finalizeAnalysis(task.deviceId, task.dataType, false, "No se pudo construir el comando ADB (path no encontrado).");
+        return;
+    }
+
+    const QStringList fileTypes = {"photos", "videos", "music", "documents"};
+
+    // Recorrido incremental si la caché tiene los cuatro tipos del análisis anterior
+    QMap<QString, DataSet> baseSets;
+    if (task.data.value("deltaScan").toBool()) {
+        for (const QString &type : fileTypes) {
+            DataSet base;
+            if (!m_analysisCache->loadLatest(task.deviceId, type, base)) {
+                baseSets.clear();
+                break;
+            }
+            baseSets[type] = base;
+        }
+    }
+
+    // toybox find admite -printf desde Android 10; en versiones anteriores se usa stat por lotes
+    QString roots = m_androidMediaRoots.join(' ');
+    QString remoteCommand;
+    if (baseSets.isEmpty()) {
+        remoteCommand = QString(
+            "echo \"T $(date +%s)\"; "
+            "if find /sdcard -maxdepth 0 -printf '' >/dev/null 2>&1; then "
+            "find %1 -type f -printf '%s\\t%T@\\t%p\\n'; "
+            "else find %1 -type f -exec stat -c '%s\t%Y\t%n' {} +; fi 2>/dev/null").arg(roots);
+    } else {
+        // Desde el archivo más reciente guardado (reloj del dispositivo): todos los directorios
+        // (D), los que cambiaron con sus archivos (C/F) y los archivos modificados (F).
+        // Sin -printf se sale con 3 y se hace el recorrido completo.
+        qint64 newest = 0;
+        for (const DataSet &base : qAsConst(baseSets)) {
+            for (const DataItem &item : base.items) {
+                newest = qMax(newest, item.dateTime.toSecsSinceEpoch());
+            }
+        }
+
+        // Un archivo con fecha futura no debe estrechar la ventana: como mucho, desde el
+        // recorrido anterior (hora del dispositivo, o la de guardado en cachés antiguas)
+        qint64 lastScan = 0;
+        for (const QString &type : fileTypes) {
+            qint64 scanTime = m_analysisCache->scanInfo(task.deviceId, type).value("deviceTime").toString().toLongLong();
+            if (scanTime <= 0) scanTime = m_analysisCache->savedAt(task.deviceId, type).toSecsSinceEpoch();
+            if (scanTime > 0) lastScan = lastScan > 0 ? qMin(lastScan, scanTime) : scanTime;
+        }
+        if (lastScan > 0) newest = qMin(newest, lastScan);
+
+        remoteCommand = QString(
+            "echo \"T $(date +%s)\"; "
+            "if find /sdcard -maxdepth 0 -printf '' >/dev/null 2>&1; then "
+            "N=$(( ($(date +%s) - %2) / 60 + 2 )); [ $N -lt 2 ] && N=2; "
+            "find %1 -type d -printf 'D\\t%p\\n'; "
+            "find %1 -type d -mmin -$N -printf 'C\\t%p\\n' "
+            "-exec find {} -maxdepth 1 -type f -printf 'F\\t%s\\t%T@\\t%p\\n' \\; ; "
+            "find %1 -type f -mmin -$N -printf 'F\\t%s\\t%T@\\t%p\\n'; "
+            "else exit 3; fi 2>/dev/null").arg(roots, QString::number(newest));
+    }
+
+    QProcess *process = new QProcess(this);
+    MediaScan &scan = m_mediaScans[task.deviceId];
+    scan.process = process;
+    scan.waitingTypes << task.dataType;
+    scan.fileCount = 0;
+    scan.deviceTime = 0;
+    scan.unpublishedRows = 0;
+    scan.lastProgress = 0;
+    scan.delta = !baseSets.isEmpty();
+    scan.baseSets = baseSets;
+    for (const QString &type : fileTypes) {
+        DataSet &dataSet = scan.dataSets[type];
+        dataSet.type = type;
+        dataSet.isSupported = true;
+        dataSet.totalSize = 0;
+    }
+
+    QString deviceId = task.deviceId;
+    connect(process, &QProcess::readyReadStandardOutput, this, [this, deviceId]() {
+        parseMediaScanOutput(deviceId, false);
+    });
+    connect(process, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+            this, [this, deviceId](int exitCode, QProcess::ExitStatus exitStatus) {
+        onMediaScanFinished(deviceId, exitStatus == QProcess::NormalExit, exitCode);
+    });
+    connect(process, &QProcess::errorOccurred, this, [this, deviceId](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) onMediaScanFinished(deviceId, false, -1);
+    });
+
+    qDebug() << (scan.delta ? "Recorrido incremental de medios para" : "Recorrido de medios para")
+             << deviceId << "en" << roots;
+
+    // exec-out: salida binaria sin PTY ni conversión de fin de línea
+    process->start(adbPath, QStringList() << "-s" << deviceId << "exec-out" << remoteCommand);
+}
+
+/**
+ * Procesa las líneas completas ("tamaño\tfecha\truta") recibidas del recorrido de medios
+ */
+void DataAnalyzer::parseMediaScanOutput(const QString &deviceId, bool flush)
+{
+    auto it = m_mediaScans.find(deviceId);
+    if (it == m_mediaScans.end()) return;
+
+    MediaScan &scan = *it;
+    scan.framer.append(scan.process->readAllStandardOutput());
+    if (flush) scan.framer.finish();
+
+    QByteArray line;
+    while (scan.framer.nextLine(line)) {
+        // Primera línea: hora del dispositivo al empezar ("T segundos")
+        if (line.startsWith("T ")) {
+            scan.deviceTime = line.mid(2).trimmed().toLongLong();
+            continue;
+        }
+
+        if (scan.delta) {
+            // Líneas con prefijo: "D\tdir", "C\tdir" o "F\t<línea de archivo>"
+            if (line.size() < 2 || line.at(1) != '\t') continue;
+            char kind = line.at(0);
+            QByteArray rest = line.mid(2);
+            if (kind == 'D') {
+                scan.existingDirs.insert(QString::fromUtf8(rest));
+                continue;
+            }
+            if (kind == 'C') {
+                scan.changedDirs.insert(QString::fromUtf8(rest));
+                continue;
+            }
+            if (kind != 'F') continue;
+            line = rest;
+        }
+
+        int sizeEnd = line.indexOf('\t');
+        int timeEnd = sizeEnd >= 0 ? line.indexOf('\t', sizeEnd + 1) : -1;
+        if (timeEnd < 0) continue; // Línea mal formada
+
+        QString path = QString::fromUtf8(line.constData() + timeEnd + 1, line.size() - timeEnd - 1);
+
+        // Saltar archivos y carpetas ocultos (miniaturas, papelera, .nomedia...)
+        if (path.contains("/.")) continue;
+
+        QString type = inferDataTypeFromPath(path);
+        if (type.isEmpty()) continue;
+
+        QByteArray seconds = line.mid(sizeEnd + 1, timeEnd - sizeEnd - 1);
+        int dot = seconds.indexOf('.');
+        if (dot >= 0) seconds.truncate(dot); // %T@ incluye fracciones de segundo
+
+        DataItem item;
+        item.filePath = path;
+        item.id = path;
+        item.displayName = path.mid(path.lastIndexOf('/') + 1);
+        item.size = line.left(sizeEnd).toLongLong();
+        item.dateTime = QDateTime::fromSecsSinceEpoch(seconds.toLongLong());
+
+        DataSet &dataSet = scan.dataSets[type];
+        dataSet.items.append(item);
+        dataSet.totalSize += item.size;
+        scan.fileCount++;
+        scan.unpublishedRows++;
+    }
+
+    // El recorrido incremental solo tiene sentido completo, tras mezclarlo con la caché
+    if (!flush && !scan.delta && scan.unpublishedRows >= ROW_CHUNK) {
+        publishMediaChunk(deviceId);
+    }
+}
+
+/**
+ * Publica los archivos listados desde el último bloque en los tipos que esperan el recorrido
+ */
+void DataAnalyzer::publishMediaChunk(const QString &deviceId)
+{
+    auto it = m_mediaScans.find(deviceId);
+    if (it == m_mediaScans.end()) return;
+
+    MediaScan &scan = *it;
+    const QStringList types = scan.waitingTypes;
+
+    QMutexLocker locker(&m_dataSetMutex);
+    QMap<QString, DataSet> &deviceSets = m_dataSets[deviceId];
+    for (const QString &type : types) {
+        const DataSet &scanned = scan.dataSets[type];
+        if (!scan.publishedRows.contains(type)) {
+            DataSet dataSet;
+            dataSet.type = type;
+            dataSet.isSupported = true;
+            dataSet.totalSize = 0;
+            deviceSets[type] = dataSet;
+            scan.publishedRows[type] = 0;
+        }
+
+        DataSet &dataSet = deviceSets[type];
+        for (int i = scan.publishedRows.value(type); i < scanned.items.size(); ++i) {
+            DataItem item = scanned.items.at(i);
+            dataSet.totalSize += item.size;
+            dataSet.items.append(item);
+        }
+        scan.publishedRows[type] = scanned.items.size();
+    }
+    locker.unlock();
+    scan.unpublishedRows = 0;
+
+    // Sin total conocido: una curva que tiende a 99 con los archivos listados
+    int progress = qBound(1, static_cast<int>(qint64(scan.fileCount) * 100 / (scan.fileCount + 10 * ROW_CHUNK)), 99);
+    bool progressChanged = progress != scan.lastProgress;
+    scan.lastProgress = progress;
+
+    for (const QString &type : types) {
         emit dataSetUpdated(deviceId, type);
+        if (progressChanged) emit analysisProgress(deviceId, type, progress);
+    }
+}
+
+/**
+ * Reparte el resultado del recorrido de medios entre los tipos que lo esperaban
+ */
+void DataAnalyzer::onMediaScanFinished(const QString &deviceId, bool normalExit, int exitCode)
+{
+    auto it = m_mediaScans.find(deviceId);
+    if (it == m_mediaScans.end()) return;
+
+    parseMediaScanOutput(deviceId, true);
+    MediaScan scan = m_mediaScans.take(deviceId);
+    QString stdErr = scan.process->readAllStandardError();
+    scan.process->deleteLater();
+
+    // Sin recorrido incremental posible (find sin -printf, fallo...): se repite completo
+    if (scan.delta && (!normalExit || exitCode == 3 || scan.existingDirs.isEmpty())) {
+        qDebug() << "Recorrido incremental no disponible en" << deviceId << ": recorrido completo";
+        AnalysisTask full;
+        full.deviceId = deviceId;
+        full.dataType = scan.waitingTypes.first();
+        full.quickScan = false;
+        full.useBridgeClient = false;
+        analyzeAndroidMedia(full);
+
+        auto restarted = m_mediaScans.find(deviceId);
+        for (const QString &type : scan.waitingTypes.mid(1)) {
+            if (restarted != m_mediaScans.end()) {
+                restarted->waitingTypes << type;
+            } else {
+                finalizeAnalysis(deviceId, type, false, "No se pudo repetir el recorrido de medios.");
+            }
+        }
+        return;
+    }
+
+    // find termina con error si alguna raíz no existe: solo es fallo si no se obtuvo nada
+    if (!scan.delta && (!normalExit || (exitCode != 0 && scan.fileCount == 0))) {
+        QString errorMsg = QString("Error en el recorrido de medios (Código: %1): %2")
+                               .arg(exitCode)
+                               .arg(stdErr.isEmpty() ? scan.process->errorString() : stdErr);
+        qWarning() << errorMsg;
+        for (const QString &type : scan.waitingTypes) {
+            finalizeAnalysis(deviceId, type, false, errorMsg);
+        }
+        return;
+    }
+
+    // La hora del dispositivo acota la ventana del siguiente recorrido incremental
+    if (scan.deviceTime > 0) {
+        QJsonObject scanInfo;
+        scanInfo["deviceTime"] = QString::number(scan.deviceTime);
+        for (const QString &type : qAsConst(scan.waitingTypes)) {
+            m_pendingScanInfo[deviceId + "/" + type] = scanInfo;
+        }
+    }
+
+    if (scan.delta) {
+        int listed = scan.fileCount;
+        mergeMediaDelta(scan);
+        qDebug() << "Recorrido incremental de" << deviceId << ":" << scan.changedDirs.size()
+                 << "directorios cambiados," << listed << "archivos listados," << scan.fileCount << "en total";
+    } else {
+        qDebug() << "Recorrido de medios de" << deviceId << ":" << scan.fileCount << "archivos";
+    }
+
+    // Los archivos que comparten tamaño con otro se comparan por huella antes de publicar
+    QStringList candidates = m_duplicateDetection ? duplicateCandidates(scan.dataSets) : QStringList();
+    if (!candidates.isEmpty()) {
+        startDuplicateHashing(deviceId, scan.waitingTypes, scan.dataSets, candidates);
+        return;
+    }
+    publishMediaScan(deviceId, scan.waitingTypes, scan.dataSets, QHash<QString, QString>());
+}
+
+/**
+ * Publica los DataSets del recorrido (con los duplicados marcados) y finaliza sus tareas
+ */
+void DataAnalyzer::publishMediaScan(const QString &deviceId, const QStringList &waitingTypes,
+                                    QMap<QString, DataSet> dataSets, const QHash<QString, QString> &hashes)
+{
+    if (m_duplicateDetection) {
+        for (const QString &type : waitingTypes) {
+            DataSet &dataSet = dataSets[type];
+            markDuplicates(dataSet, hashes);
+            if (dataSet.duplicateCount > 0) {
+                qDebug() << "Duplicados en" << deviceId << type << ":" << dataSet.duplicateCount
+                         << "archivos," << dataSet.duplicateSize << "bytes";
+            }
+        }
+    }
+
+    QMutexLocker locker(&m_dataSetMutex);
+    for (const QString &type : waitingTypes) {
+        m_dataSets[deviceId][type] = dataSets.value(type);
+    }
+    locker.unlock();
+
+    for (const QString &type : waitingTypes) {
+        emit dataSetUpdated(deviceId, type);
+        finalizeAnalysis(deviceId, type, true);
+    }
+}
+
+/**
+ * Solo los archivos con el tamaño de otro pueden ser duplicados; los que ya tienen huella no se repiten
+ */
+QStringList DataAnalyzer::duplicateCandidates(const QMap<QString, DataSet> &dataSets)
+{
+    QStringList candidates;
+    for (const DataSet &dataSet : dataSets) {
+        QHash<qint64, QVector<int>> bySize;
+        for (int i = 0; i < dataSet.items.size(); ++i) {
+            qint64 size = dataSet.items.itemSize(i);
+            if (size > 0) bySize[size].append(i);
+        }
+        for (const QVector<int> &group : qAsConst(bySize)) {
+            if (group.size() < 2) continue;
+            for (int index : group) {
+                DataItem item = dataSet.items.at(index);
+                if (!item.filePath.isEmpty() && !item.data.contains("contentHash")) {
+                    candidates << item.filePath;
+                }
+            }
+        }
     }
+    return candidates;
+}
 
-    // Actualizar progreso
-    int progress = (((index + 1) * 100) / count);
-    updateBridgeScanProgress(deviceId, m_currentAnalysisTask.dataType, progress);
+/**
+ * Guarda el recorrido pendiente de publicar y lanza el primer lote de huellas
+ */
+void DataAnalyzer::startDuplicateHashing(const QString &deviceId, const QStringList &waitingTypes,
+                                         const QMap<QString, DataSet> &dataSets, const QStringList &candidates)
+{
+    HashScan &hashScan = m_hashScans[deviceId];
+    hashScan.process = nullptr;
+    hashScan.dataSets = dataSets;
+    hashScan.waitingTypes = waitingTypes;
+    hashScan.pending = candidates;
+    hashScan.batchEnd = 0;
+
+    qDebug() << "Calculando huellas de" << candidates.size() << "posibles duplicados en" << deviceId;
+    runNextHashBatch(deviceId);
 }
 
 /**
- * Maneja la recepción de datos de contactos desde Bridge Client
+ * Un lote es una orden md5sum con tantas rutas como quepan en HASH_BATCH_CHARS
  */
-void DataAnalyzer::onBridgeClientContactsData(const QJsonArray &contactsData)
+void DataAnalyzer::runNextHashBatch(const QString &deviceId)
 {
-    qDebug() << "Received contacts data from Bridge Client";
+    auto it = m_hashScans.find(deviceId);
+    if (it == m_hashScans.end()) return;
 
-    QString deviceId = m_currentAnalysisTask.deviceId;
-    if (deviceId.isEmpty()) {
-        qWarning() << "Received contacts data but no active task";
+    HashScan &hashScan = *it;
+    QString adbPath = m_deviceManager->getAdbPath();
+    int batchStart = hashScan.batchEnd;
+    if (batchStart >= hashScan.pending.size() || adbPath.isEmpty()) {
+        // Sin huellas no se marca nada: el recorrido se publica igualmente
+        HashScan done = m_hashScans.take(deviceId);
+        publishMediaScan(deviceId, done.waitingTypes, done.dataSets, done.hashes);
         return;
     }
 
-    // Procesar datos de contactos
-    QList<DataItem> contacts = parseJsonContactsData(contactsData);
-
-    // Actualizar dataset de contactos
-    QMutexLocker locker(&m_dataSetMutex);
-    if (!m_dataSets.contains(deviceId)) {
-        m_dataSets[deviceId] = QMap<QString, DataSet>();
-    }
-
-    DataSet contactsSet;
-    contactsSet.type = "contacts";
-    contactsSet.isSupported = true;
-    contactsSet.items = contacts;
-    contactsSet.totalSize = 0;
-
-    // Calcular tamaño total
-    for (const DataItem &contact : contacts) {
-        contactsSet.totalSize += contact.size;
+    QString command = "md5sum";
+    while (hashScan.batchEnd < hashScan.pending.size()) {
+        QString quoted = AdbProcessTransport::shellQuote(hashScan.pending.at(hashScan.batchEnd));
+        if (hashScan.batchEnd > batchStart && command.size() + quoted.size() + 1 > HASH_BATCH_CHARS) break;
+        command += ' ' + quoted;
+        hashScan.batchEnd++;
     }
+    command += " 2>/dev/null";
 
-    m_dataSets[deviceId]["contacts"] = contactsSet;
-    locker.unlock();
+    QProcess *process = new QProcess(this);
+    hashScan.process = process;
+    hashScan.framer.clear();
 
-    emit dataSetUpdated(deviceId, "contacts");
-    updateBridgeScanProgress(deviceId, "contacts", 100);
+    connect(process, &QProcess::readyReadStandardOutput, this, [this, deviceId, process]() {
+        auto running = m_hashScans.find(deviceId);
+        if (running != m_hashScans.end() && running->process == process) {
+            running->framer.append(process->readAllStandardOutput());
+        }
+    });
+    // md5sum sale con error si algún archivo desapareció: se aprovecha lo que sí se leyó
+    connect(process, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+            this, [this, deviceId]() {
+        onHashBatchFinished(deviceId);
+    });
+    connect(process, &QProcess::errorOccurred, this, [this, deviceId](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) onHashBatchFinished(deviceId);
+    });
+
+    process->start(adbPath, QStringList() << "-s" << deviceId << "exec-out" << command);
 }
 
 /**
- * Maneja la recepción de datos de mensajes desde Bridge Client
+ * Guarda las huellas del lote y sigue con el siguiente
  */
-void DataAnalyzer::onBridgeClientMessagesData(const QJsonArray &messagesData)
+void DataAnalyzer::onHashBatchFinished(const QString &deviceId)
 {
-    qDebug() << "Received messages data from Bridge Client";
+    auto it = m_hashScans.find(deviceId);
+    if (it == m_hashScans.end() || !it->process) return;
 
-    QString deviceId = m_currentAnalysisTask.deviceId;
-    if (deviceId.isEmpty()) {
-        qWarning() << "Received messages data but no active task";
-        return;
+    HashScan &hashScan = *it;
+    hashScan.framer.append(hashScan.process->readAllStandardOutput());
+    hashScan.framer.finish();
+    hashScan.process->deleteLater();
+    hashScan.process = nullptr;
+
+    QByteArray line;
+    while (hashScan.framer.nextLine(line)) {
+        // "<32 hex>  <ruta>" (la ruta puede contener espacios)
+        if (line.size() < 35 || line.at(32) != ' ') continue;
+        QString path = QString::fromUtf8(line.constData() + 34, line.size() - 34);
+        hashScan.hashes.insert(path, QString::fromLatin1(line.left(32)));
     }
 
-    // Procesar datos de mensajes
-    QList<DataItem> messages = parseJsonMessagesData(messagesData);
+    runNextHashBatch(deviceId);
+}
 
-    // Actualizar dataset de mensajes
-    QMutexLocker locker(&m_dataSetMutex);
-    if (!m_dataSets.contains(deviceId)) {
-        m_dataSets[deviceId] = QMap<QString, DataSet>();
+/**
+ * Agrupa por (tamaño, huella); en cada grupo se conserva el más antiguo (el original,
+ * no la copia de WhatsApp o la exportación) y los demás apuntan a él
+ */
+void DataAnalyzer::markDuplicates(DataSet &dataSet, const QHash<QString, QString> &hashes)
+{
+    dataSet.duplicateCount = 0;
+    dataSet.duplicateSize = 0;
+
+    QList<DataItem> items = dataSet.items.toList();
+    bool changed = false;
+
+    QHash<QString, int> kept; // "tamaño/huella" -> posición que se conserva
+    for (int i = 0; i < items.size(); ++i) {
+        DataItem &item = items[i];
+        QString hash = hashes.value(item.filePath);
+        if (!hash.isEmpty() && item.data.value("contentHash").toString() != hash) {
+            item.data["contentHash"] = hash;
+            changed = true;
+        } else {
+            hash = item.data.value("contentHash").toString();
+        }
+        if (hash.isEmpty() || item.size <= 0) continue;
+
+        QString key = QString::number(item.size) + "/" + hash;
+        auto first = kept.find(key);
+        if (first == kept.end()) {
+            kept.insert(key, i);
+        } else if (item.dateTime.isValid() && item.dateTime < items.at(first.value()).dateTime) {
+            first.value() = i;
+        }
     }
 
-    DataSet messagesSet;
-    messagesSet.type = "messages";
-    messagesSet.isSupported = true;
-    messagesSet.items = messages;
-    messagesSet.totalSize = 0;
+    for (int i = 0; i < items.size(); ++i) {
+        DataItem &item = items[i];
+        QString hash = item.data.value("contentHash").toString();
+        int original = hash.isEmpty() || item.size <= 0
+                           ? i : kept.value(QString::number(item.size) + "/" + hash, i);
 
-    // Calcular tamaño total
-    for (const DataItem &message : messages) {
-        messagesSet.totalSize += message.size;
+        // Las marcas de la caché se recalculan: el original pudo desaparecer
+        QString duplicateOf = original != i ? items.at(original).filePath : QString();
+        if (item.data.value("duplicateOf").toString() != duplicateOf) {
+            if (duplicateOf.isEmpty()) {
+                item.data.remove("duplicateOf");
+            } else {
+                item.data["duplicateOf"] = duplicateOf;
+            }
+            changed = true;
+        }
+        if (!duplicateOf.isEmpty()) {
+            dataSet.duplicateCount++;
+            dataSet.duplicateSize += item.size;
+        }
     }
 
-    m_dataSets[deviceId]["messages"] = messagesSet;
-    locker.unlock();
-
-    emit dataSetUpdated(deviceId, "messages");
-    updateBridgeScanProgress(deviceId, "messages", 100);
+    if (changed) {
+        dataSet.items = items;
+        dataSet.pathIndex.clear();
+        dataSet.pathIndexed = 0;
+    }
 }
 
 /**
- * Maneja la actualización de progreso desde Bridge Client
+ * Aplica un recorrido incremental sobre los DataSets guardados
  */
-void DataAnalyzer::onBridgeClientScanProgress(int progress)
+void DataAnalyzer::mergeMediaDelta(MediaScan &scan)
 {
-    if (m_currentAnalysisTask.deviceId.isEmpty() || m_currentAnalysisTask.dataType.isEmpty()) {
-        return;
+    // Archivos que se volvieron a listar (nuevos, modificados o de directorios cambiados)
+    QSet<QString> listed;
+    for (const DataSet &changes : qAsConst(scan.dataSets)) {
+        for (int i = 0; i < changes.items.size(); ++i) {
+            listed.insert(changes.items.filePath(i));
+        }
     }
 
-    // Reportar progreso del escaneo
-    updateBridgeScanProgress(m_currentAnalysisTask.deviceId, m_currentAnalysisTask.dataType, progress);
+    scan.fileCount = 0;
+    for (auto it = scan.dataSets.begin(); it != scan.dataSets.end(); ++it) {
+        DataSet merged;
+        merged.type = it.key();
+        merged.isSupported = true;
+        merged.totalSize = 0;
+
+        const DataSet base = scan.baseSets.value(it.key());
+        for (const DataItem &item : base.items) {
+            QString dir = item.filePath.left(item.filePath.lastIndexOf('/'));
+            if (!scan.existingDirs.contains(dir) || scan.changedDirs.contains(dir) || listed.contains(item.filePath)) {
+                continue; // Borrado, o su versión actual viene en el recorrido
+            }
+            merged.items.append(item);
+            merged.totalSize += item.size;
+        }
+
+        // Un archivo reciente de un directorio cambiado aparece dos veces
+        QSet<QString> seen;
+        for (const DataItem &item : it.value().items) {
+            if (seen.contains(item.filePath)) continue;
+            seen.insert(item.filePath);
+            merged.items.append(item);
+            merged.totalSize += item.size;
+        }
+
+        scan.fileCount += merged.items.size();
+        it.value() = merged;
+    }
 }
 
 /**
- * Maneja la finalización del escaneo desde Bridge Client
+ * Cuenta filas (registros) o archivos y bytes por tipo (medios) sin crear DataItems
  */
-void DataAnalyzer::onBridgeClientScanCompleted()
+bool DataAnalyzer::startAndroidQuickCount(const AnalysisTask &task)
 {
-    QString deviceId = m_currentAnalysisTask.deviceId;
-    QString dataType = m_currentAnalysisTask.dataType;
+    bool isFileType = task.dataType == "photos" || task.dataType == "videos" ||
+                      task.dataType == "music" || task.dataType == "documents";
+    QString uri = androidRecordUri(task.dataType);
+    if (!isFileType && uri.isEmpty()) return false;
 
-    qDebug() << "Bridge Client scan completed for device:" << deviceId << "type:" << dataType;
+    QString adbPath = m_deviceManager->getAdbPath();
+    if (adbPath.isEmpty()) return false;
+
+    QString deviceId = task.deviceId;
+    QString dataType = task.dataType;
+    QProcess *process = new QProcess(this);
+
+    if (!isFileType) {
+        // grep -c sale con 1 si no hay filas; el recuento (0) ya está impreso
+        QString remoteCommand = QString("content query --uri %1 --projection _id | grep -c '^Row' || true").arg(uri);
+        connect(process, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+                this, [this, process, deviceId, dataType](int exitCode, QProcess::ExitStatus exitStatus) {
+            process->deleteLater();
+            bool ok = false;
+            int count = process->readAllStandardOutput().trimmed().toInt(&ok);
+            if (exitCode != 0 || exitStatus != QProcess::NormalExit || !ok) {
+                finalizeAnalysis(deviceId, dataType, false, "No se pudieron contar los registros: " +
+                                 QString::fromUtf8(process->readAllStandardError()).trimmed());
+                return;
+            }
+            m_lastRowCounts[deviceId][dataType] = count; // Estimación de progreso del análisis completo
+            publishSummary(deviceId, dataType, count, 0);
+        });
+        connect(process, &QProcess::errorOccurred, this, [this, process, deviceId, dataType](QProcess::ProcessError error) {
+            if (error != QProcess::FailedToStart) return;
+            process->deleteLater();
+            finalizeAnalysis(deviceId, dataType, false, "No se pudo iniciar adb: " + process->errorString());
+        });
+        process->start(adbPath, QStringList() << "-s" << deviceId << "exec-out" << remoteCommand);
+        return true;
+    }
+
+    // Los cuatro tipos de archivo comparten un solo recuento por dispositivo
+    auto running = m_quickCounts.find(deviceId);
+    if (running != m_quickCounts.end()) {
+        delete process;
+        running->waitingTypes << dataType;
+        m_runningTasks.remove(deviceId + "/" + dataType); // No ocupa hueco mientras espera
+        return true;
+    }
+
+    QuickCount &quick = m_quickCounts[deviceId];
+    quick.process = process;
+    quick.waitingTypes << dataType;
+
+    // Solo tamaño y nombre de archivo; el tipo se deduce de la extensión al sumar.
+    // toybox no trae awk, así que la suma por tipo se hace aquí y no en el dispositivo.
+    // Se excluyen las rutas ocultas igual que en el escaneo completo, para que ambos cuadren.
+    QString roots = m_androidMediaRoots.join(' ');
+    QString remoteCommand = QString(
+        "if find /sdcard -maxdepth 0 -printf '' >/dev/null 2>&1; then "
+        "find %1 -type f -not -path '*/.*' -printf '%s\\t%f\\n'; "
+        "else find %1 -type f -not -path '*/.*' -exec stat -c '%s\t%n' {} +; fi 2>/dev/null").arg(roots);
+
+    auto consume = [this, deviceId](bool flush) {
+        auto it = m_quickCounts.find(deviceId);
+        if (it == m_quickCounts.end()) return;
+
+        it->framer.append(it->process->readAllStandardOutput());
+        if (flush) it->framer.finish();
+
+        QByteArray line;
+        while (it->framer.nextLine(line)) {
+            int tab = line.indexOf('\t');
+            if (tab <= 0) continue;
+            QString type = inferDataTypeFromPath(QString::fromUtf8(line.constData() + tab + 1, line.size() - tab - 1));
+            if (type.isEmpty()) continue;
+            it->counts[type]++;
+            it->sizes[type] += line.left(tab).toLongLong();
+        }
+    };
+    auto finish = [this, deviceId, consume](bool ok) {
+        consume(true);
+        QuickCount done = m_quickCounts.take(deviceId);
+        done.process->deleteLater();
+
+        // find termina con error si alguna raíz no existe: solo es fallo si no se contó nada
+        if (!ok && done.counts.isEmpty()) {
+            for (const QString &type : qAsConst(done.waitingTypes)) {
+                finalizeAnalysis(deviceId, type, false, "No se pudieron contar los archivos del dispositivo.");
+            }
+            return;
+        }
 
-    // Marcar como completado
-    if (!deviceId.isEmpty() && !dataType.isEmpty()) {
-        m_bridgeScanComplete[deviceId][dataType] = true;
-        finalizeAnalysis(deviceId, dataType, true);
-    }
+        int files = 0;
+        for (int count : qAsConst(done.counts)) files += count;
+        qDebug() << "Recuento rápido de medios de" << deviceId << ":" << files << "archivos";
 
-    // Desconectar señales de Bridge Client
-    disconnectBridgeClientSignals(deviceId);
+        for (const QString &type : qAsConst(done.waitingTypes)) {
+            publishSummary(deviceId, type, done.counts.value(type), done.sizes.value(type));
+        }
+    };
+    connect(process, &QProcess::readyReadStandardOutput, this, [consume]() { consume(false); });
+    connect(process, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+            this, [finish](int exitCode, QProcess::ExitStatus exitStatus) {
+        finish(exitCode == 0 && exitStatus == QProcess::NormalExit);
+    });
+    connect(process, &QProcess::errorOccurred, this, [finish](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) finish(false);
+    });
+
+    process->start(adbPath, QStringList() << "-s" << deviceId << "exec-out" << remoteCommand);
+    return true;
 }
 
 /**
- * Maneja errores de escaneo desde Bridge Client
+ * Publica el resultado de un análisis rápido
  */
-void DataAnalyzer::onBridgeClientScanError(const QString &errorMessage)
+void DataAnalyzer::publishSummary(const QString &deviceId, const QString &dataType, int count, qint64 totalSize)
 {
-    QString deviceId = m_currentAnalysisTask.deviceId;
-    QString dataType = m_currentAnalysisTask.dataType;
-
-    qDebug() << "Bridge Client scan error for device:" << deviceId << "type:" << dataType << "error:" << errorMessage;
+    DataSet summary;
+    summary.type = dataType;
+    summary.isSupported = true;
+    summary.totalSize = totalSize;
+    summary.summaryOnly = true;
+    summary.summaryCount = count;
 
-    if (!deviceId.isEmpty() && !dataType.isEmpty()) {
-        finalizeAnalysis(deviceId, dataType, false, errorMessage);
-    }
+    QMutexLocker locker(&m_dataSetMutex);
+    m_dataSets[deviceId][dataType] = summary;
+    locker.unlock();
 
-    // Desconectar señales
-    disconnectBridgeClientSignals(deviceId);
+    emit dataSetUpdated(deviceId, dataType);
+    finalizeAnalysis(deviceId, dataType, true);
 }
 
 /**
- * Analiza fotos en dispositivos Android usando método directo
+ * Consulta los mensajes o llamadas nuevos y comprueba con un recuento que no se borró ninguno
  */
-void DataAnalyzer::analyzeAndroidPhotosReal(const QString &deviceId)
+bool DataAnalyzer::analyzeAndroidRecordsDelta(const AnalysisTask &task)
 {
-    // Usar adb para listar archivos en directorios comunes
-    QString photoPath = "/sdcard/DCIM/Camera/"; // Ruta inicial a comprobar
-    QString command = QString("shell ls -l %1").arg(photoPath);
-    QString fullAdbCommand = getAdbCommand(deviceId, command);
+    QString uri;
+    QString projection;
+    if (task.dataType == "messages") {
+        uri = "content://sms";
+        projection = "_id,address,body,date";
+    } else if (task.dataType == "calls") {
+        uri = "content://call_log/calls";
+        projection = "_id,number,date,duration,type";
+    } else {
+        return false;
+    }
 
-    if (fullAdbCommand.isEmpty()) {
-        finalizeAnalysis(deviceId, "photos", false, "No se pudo construir el comando ADB (path no encontrado).");
-        return;
+    // Hacen falta las filas que contó el dispositivo en el análisis anterior: las que no se
+    // pudieron convertir no están en el DataSet guardado
+    QJsonObject scanInfo = m_analysisCache->scanInfo(task.deviceId, task.dataType);
+    if (!scanInfo.contains("deviceRows") || !scanInfo.contains("maxId")) return false;
+
+    DataSet base;
+    QString adbPath = m_deviceManager->getAdbPath();
+    if (adbPath.isEmpty() || !m_analysisCache->loadLatest(task.deviceId, task.dataType, base)) {
+        return false;
     }
 
-    qDebug() << "Ejecutando comando para fotos:" << fullAdbCommand;
+    // Los _id de estos proveedores solo crecen: lo nuevo es lo que supera al mayor visto
+    qint64 maxId = scanInfo.value("maxId").toString().toLongLong();
 
-    // Añadir la ruta base a los datos de la tarea para que el slot finished la use
-    m_currentAnalysisTask.data["basePath"] = photoPath;
-    m_currentAnalysisTask.data["type"] = "photos";
+    QString remoteCommand = QString(
+        "content query --uri %1 --projection _id --where \"_id<=%2\" | grep -c '^Row'; "
+        "content query --uri %1 --projection %3 --where \"_id>%2\"")
+        .arg(uri, QString::number(maxId), projection);
 
-    // Preparar argumentos para QProcess::start
-    QStringList arguments = fullAdbCommand.split(' ');
-    QString program = arguments.takeFirst(); // El path a adb
+    // La base se publica ya; las filas nuevas se añaden a ella a medida que llegan
+    QMutexLocker locker(&m_dataSetMutex);
+    m_dataSets[task.deviceId][task.dataType] = base;
+    locker.unlock();
+    emit dataSetUpdated(task.deviceId, task.dataType);
 
-    // Iniciar el proceso
-    m_analysisProcess->start(program, arguments);
+    AnalysisTask deltaTask;
+    deltaTask.deviceId = task.deviceId;
+    deltaTask.dataType = task.dataType;
+    deltaTask.data["type"] = task.dataType;
+    deltaTask.data["deltaBaseRows"] = scanInfo.value("deviceRows").toInt();
+    deltaTask.data["deltaMaxId"] = maxId;
+
+    qDebug() << "Consulta incremental de" << task.dataType << "en" << task.deviceId << "desde _id" << maxId;
+    startAnalysisProcess(deltaTask, adbPath, QStringList() << "-s" << task.deviceId << "exec-out" << remoteCommand);
+    return true;
 }
 
 /**
@@ -927,7 +2883,7 @@ void DataAnalyzer::analyzeAndroidPhotosReal(const QString &deviceId)
 void DataAnalyzer::analyzeAndroidContacts(const QString &deviceId)
 {
     // Comando ADB para obtener todos los contactos
-    QString command = "shell content query --uri content://com.android.contacts/data --projection _id,display_name,times_contacted,last_time_contacted";
+    QString command = "shell " + androidRecordQuery("contacts");
     QString fullAdbCommand = getAdbCommand(deviceId, command);
 
     if (fullAdbCommand.isEmpty()) {
@@ -936,14 +2892,13 @@ void DataAnalyzer::analyzeAndroidContacts(const QString &deviceId)
     }
 
     // Preparar los datos para el análisis
-    m_currentAnalysisTask.data["type"] = "contacts";
-
-    // Dividir el comando para ejecutarlo con QProcess
-    QStringList arguments = fullAdbCommand.split(' ');
-    QString program = arguments.takeFirst();
+    AnalysisTask task;
+    task.deviceId = deviceId;
+    task.dataType = "contacts";
+    task.data["type"] = "contacts";
 
     // Iniciar el proceso
-    m_analysisProcess->start(program, arguments);
+    startAnalysisProcess(task, fullAdbCommand);
 }
 
 /**
@@ -952,7 +2907,7 @@ void DataAnalyzer::analyzeAndroidContacts(const QString &deviceId)
 void DataAnalyzer::analyzeAndroidMessages(const QString &deviceId)
 {
     // Comandos para obtener mensajes SMS
-    QString command = "shell content query --uri content://sms --projection _id,address,body,date";
+    QString command = "shell " + androidRecordQuery("messages");
     QString fullAdbCommand = getAdbCommand(deviceId, command);
 
     if (fullAdbCommand.isEmpty()) {
@@ -960,12 +2915,12 @@ void DataAnalyzer::analyzeAndroidMessages(const QString &deviceId)
         return;
     }
 
-    m_currentAnalysisTask.data["type"] = "messages";
+    AnalysisTask task;
+    task.deviceId = deviceId;
+    task.dataType = "messages";
+    task.data["type"] = "messages";
 
-    QStringList arguments = fullAdbCommand.split(' ');
-    QString program = arguments.takeFirst();
-
-    m_analysisProcess->start(program, arguments);
+    startAnalysisProcess(task, fullAdbCommand);
 }
 
 /**
@@ -974,7 +2929,7 @@ void DataAnalyzer::analyzeAndroidMessages(const QString &deviceId)
 void DataAnalyzer::analyzeAndroidCalls(const QString &deviceId)
 {
     // Comando para obtener el registro de llamadas
-    QString command = "shell content query --uri content://call_log/calls --projection _id,number,date,duration,type";
+    QString command = "shell " + androidRecordQuery("calls");
     QString fullAdbCommand = getAdbCommand(deviceId, command);
 
     if (fullAdbCommand.isEmpty()) {
@@ -982,12 +2937,12 @@ void DataAnalyzer::analyzeAndroidCalls(const QString &deviceId)
         return;
     }
 
-    m_currentAnalysisTask.data["type"] = "calls";
-
-    QStringList arguments = fullAdbCommand.split(' ');
-    QString program = arguments.takeFirst();
+    AnalysisTask task;
+    task.deviceId = deviceId;
+    task.dataType = "calls";
+    task.data["type"] = "calls";
 
-    m_analysisProcess->start(program, arguments);
+    startAnalysisProcess(task, fullAdbCommand);
 }
 
 /**
@@ -1177,429 +3132,81 @@ QString DataAnalyzer::getIdeviceCommand(const QString &deviceId, const QString &
     return toolPath + " " + fullArgs.join(" "); // Para logs
 }
 
-/**
- * Procesa datos JSON de archivos multimedia
- */
-QList<DataItem> DataAnalyzer::parseJsonMediaData(const QJsonArray &jsonArray)
-{
-    QList<DataItem> items;
-
-    for (int i = 0; i < jsonArray.size(); ++i) {
-        QJsonObject obj = jsonArray[i].toObject();
-
-        // Extraer datos básicos
-        QString path = obj["path"].toString();
-        QString name = obj["name"].toString();
-        qint64 size = obj["size"].toVariant().toLongLong();
-        QString type = obj["type"].toString();
-        qint64 dateModified = obj["dateModified"].toVariant().toLongLong();
-        QString mimeType = obj["mimeType"].toString();
-
-        if (path.isEmpty() || name.isEmpty()) {
-            continue; // Saltar elementos sin información esencial
-        }
-
-        // Crear objeto DataItem
-        DataItem item;
-        item.id = path; // Usar ruta como ID único
-        item.displayName = name;
-        item.filePath = path;
-        item.size = size;
-        item.dateTime = QDateTime::fromMSecsSinceEpoch(dateModified);
-
-        // Mapear tipos de archivo a categorías
-        if (type == "IMAGE") {
-            item.data["mediaType"] = "photos";
-        } else if (type == "VIDEO") {
-            item.data["mediaType"] = "videos";
-        } else if (type == "AUDIO") {
-            item.data["mediaType"] = "music";
-        } else {
-            item.data["mediaType"] = "other";
-        }
-
-        item.data["mimeType"] = mimeType;
-
-        // Procesar metadatos adicionales si existen
-        if (obj.contains("metadata")) {
-            QJsonObject metaObj = obj["metadata"].toObject();
-            for (auto it = metaObj.begin(); it != metaObj.end(); ++it) {
-                item.data[it.key()] = it.value().toVariant();
-            }
-        }
-
-        items.append(item);
-    }
-
-    return items;
-}
-
-/**
- * Procesa datos JSON de archivos generales
- */
-QList<DataItem> DataAnalyzer::parseJsonFilesData(const QJsonArray &jsonArray)
-{
-    QList<DataItem> items;
-
-    for (int i = 0; i < jsonArray.size(); ++i) {
-        QJsonObject obj = jsonArray[i].toObject();
-
-        // Extraer datos básicos
-        QString path = obj["path"].toString();
-        QString name = obj["name"].toString();
-        qint64 size = obj["size"].toVariant().toLongLong();
-        QString type = obj["type"].toString();
-        qint64 dateModified = obj["dateModified"].toVariant().toLongLong();
-        QString mimeType = obj["mimeType"].toString();
-
-        if (path.isEmpty() || name.isEmpty()) {
-            continue; // Saltar elementos sin información esencial
-        }
-
-        // Crear objeto DataItem
-        DataItem item;
-        item.id = path; // Usar ruta como ID único
-        item.displayName = name;
-        item.filePath = path;
-        item.size = size;
-        item.dateTime = QDateTime::fromMSecsSinceEpoch(dateModified);
-
-        // Mapear tipos de archivo a categorías
-        if (type == "DOCUMENT") {
-            item.data["fileType"] = "documents";
-        } else if (type == "APK") {
-            item.data["fileType"] = "applications";
-        } else if (type == "ARCHIVE") {
-            item.data["fileType"] = "archives";
-        } else {
-            item.data["fileType"] = "other";
-        }
-
-        item.data["mimeType"] = mimeType;
-
-        items.append(item);
-    }
-
-    return items;
-}
-
-/**
- * Procesa datos JSON de contactos
- */
-QList<DataItem> DataAnalyzer::parseJsonContactsData(const QJsonArray &jsonArray)
-{
-    QList<DataItem> contacts;
-
-    for (int i = 0; i < jsonArray.size(); ++i) {
-        QJsonObject obj = jsonArray[i].toObject();
-
-        // Extraer datos básicos
-        QString id = obj["id"].toString();
-        QString displayName = obj["displayName"].toString();
-
-        if (id.isEmpty() || displayName.isEmpty()) {
-            continue; // Saltar contactos sin información esencial
-        }
-
-        // Crear objeto DataItem
-        DataItem contact;
-        contact.id = id;
-        contact.displayName = displayName;
-        contact.size = 1024; // Tamaño estimado para contactos
-
-        // Almacenar números de teléfono
-        if (obj.contains("phoneNumbers")) {
-            QJsonArray phones = obj["phoneNumbers"].toArray();
-            QStringList phoneList;
-            for (int j = 0; j < phones.size(); ++j) {
-                phoneList.append(phones[j].toString());
-            }
-            contact.data["phones"] = phoneList;
-        }
-
-        // Almacenar correos electrónicos
-        if (obj.contains("emails")) {
-            QJsonArray emails = obj["emails"].toArray();
-            QStringList emailList;
-            for (int j = 0; j < emails.size(); ++j) {
-                emailList.append(emails[j].toString());
-            }
-            contact.data["emails"] = emailList;
-        }
-
-        // Almacenar URI de foto si existe
-        if (obj.contains("photoUri")) {
-            contact.data["photoUri"] = obj["photoUri"].toString();
-        }
-
-        contacts.append(contact);
-    }
-
-    return contacts;
-}
-
-/**
- * Procesa datos JSON de mensajes
- */
-QList<DataItem> DataAnalyzer::parseJsonMessagesData(const QJsonArray &jsonArray)
-{
-    QList<DataItem> messages;
-
-    for (int i = 0; i < jsonArray.size(); ++i) {
-        QJsonObject obj = jsonArray[i].toObject();
-
-        // Extraer datos básicos
-        QString id = obj["id"].toString();
-        QString threadId = obj["threadId"].toString();
-        QString address = obj["address"].toString();
-        qint64 date = obj["date"].toVariant().toLongLong();
-        QString body = obj["body"].toString();
-        bool isRead = obj["isRead"].toBool();
-        int type = obj["type"].toInt();
-
-        if (id.isEmpty() || body.isEmpty()) {
-            continue; // Saltar mensajes sin información esencial
-        }
-
-        // Crear objeto DataItem
-        DataItem message;
-        message.id = id;
-        message.displayName = QString("Mensaje de %1").arg(address);
-        message.size = body.length() + address.length(); // Tamaño aproximado
-        message.dateTime = QDateTime::fromMSecsSinceEpoch(date);
-
-        // Almacenar datos adicionales
-        message.data["threadId"] = threadId;
-        message.data["address"] = address;
-        message.data["body"] = body;
-        message.data["isRead"] = isRead;
-        message.data["type"] = type;
-
-        messages.append(message);
-    }
-
-    return messages;
-}
-
-/**
- * Procesa listas de fotos de Android
- */
-QList<DataItem> DataAnalyzer::parseAndroidPhotoList(const QString &output, const QString& basePath)
-{
-    QList<DataItem> photos;
-    QStringList lines = output.split('\n', Qt::SkipEmptyParts);
-
-    // Formato típico de salida de `ls -l`:
-    // -rw-rw---- 1 u0_a171 media_rw 3133747 2024-03-29 10:00 IMG_20240329_100000.jpg
-    QRegularExpression re(
-        "^([-d])"              // 1: Tipo (d para directorio, - para archivo)
-        "([rwx-]{9})"          // 2: Permisos (ignorados)
-        "\\s+\\d+\\s+"         //    Contador de enlaces (ignorado)
-        "([^\\s]+)\\s+"        // 3: Propietario (ignorado)
-        "([^\\s]+)\\s+"        // 4: Grupo (ignorado)
-        "(\\d+)"               // 5: Tamaño
-        "\\s+(\\d{4}-\\d{2}-\\d{2})" // 6: Fecha (YYYY-MM-DD)
-        "\\s+(\\d{2}:\\d{2})"  // 7: Hora (HH:MM)
-        "\\s+(.+)$"            // 8: Nombre de archivo
-        );
-
-    // Año actual para archivos sin año
-    int currentYear = QDate::currentDate().year();
-
-    for (const QString &line : lines) {
-        QString trimmedLine = line.trimmed();
-        if (trimmedLine.isEmpty()) continue;
-
-        QRegularExpressionMatch match = re.match(trimmedLine);
-        if (match.hasMatch()) {
-            QString type = match.captured(1);
-            // Saltar directorios
-            if (type == "d") {
-                continue;
-            }
-
-            QString filename = match.captured(8);
-            // Saltar archivos ocultos
-            if (filename.startsWith('.')) {
-                continue;
-            }
-
-            // Comprobar extensiones de imagen
-            if (!filename.endsWith(".jpg", Qt::CaseInsensitive) &&
-                !filename.endsWith(".jpeg", Qt::CaseInsensitive) &&
-                !filename.endsWith(".png", Qt::CaseInsensitive) &&
-                !filename.endsWith(".gif", Qt::CaseInsensitive) &&
-                !filename.endsWith(".bmp", Qt::CaseInsensitive) &&
-                !filename.endsWith(".webp", Qt::CaseInsensitive) &&
-                !filename.endsWith(".heic", Qt::CaseInsensitive) &&
-                !filename.endsWith(".heif", Qt::CaseInsensitive)) {
-                continue;
-            }
-
-            DataItem photo;
-            photo.size = match.captured(5).toLongLong();
-            photo.displayName = filename;
-
-            // Construir ruta completa
-            QString currentBasePath = basePath;
-            if (!currentBasePath.endsWith('/')) {
-                currentBasePath += '/';
-            }
-            photo.filePath = currentBasePath + filename;
-            photo.id = photo.filePath;
-
-            // Parsear fecha/hora
-            QString dateStr = match.captured(6);
-            QString timeStr = match.captured(7);
-            QDateTime dt = QDateTime::fromString(dateStr + " " + timeStr, "yyyy-MM-dd HH:mm");
-            if(dt.isValid()) {
-                // Manejar fechas antiguas
-                if(dt.date().year() < 1980) {
-                    QDate potentialDate(currentYear, dt.date().month(), dt.date().day());
-                    if (potentialDate.isValid() && potentialDate <= QDate::currentDate()) {
-                        dt.setDate(potentialDate);
-                    } else {
-                        potentialDate.setDate(currentYear - 1, dt.date().month(), dt.date().day());
-                        if (potentialDate.isValid()) {
-                            dt.setDate(potentialDate);
-                        }
-                    }
-                }
-                photo.dateTime = dt;
-            } else {
-                photo.dateTime = QDateTime();
-            }
-
-            photos.append(photo);
-        } else {
-            qWarning() << "No se pudo parsear línea:" << trimmedLine;
-        }
-    }
-
-    qDebug() << "Parseados" << photos.count() << "ítems de foto desde" << basePath;
-    return photos;
-}
 
 /**
- * Procesa datos de contactos Android
+ * Procesa una fila de contactos Android (columnas de analyzeAndroidContacts)
  */
-QList<DataItem> DataAnalyzer::parseAndroidContacts(const QString &output)
+bool DataAnalyzer::parseAndroidContactRow(const QByteArray &line, DataItem &contact)
 {
-    QList<DataItem> contacts;
-    QStringList lines = output.split('\n', Qt::SkipEmptyParts);
-
-    // Expresión regular para parsear la salida de ADB
-    QRegularExpression contactRegex(
-        "Row:\\s\\d+\\s_id=(\\d+),.*"
-        "display_name=([^,]+),.*"
-        "times_contacted=(\\d+),.*"
-        "last_time_contacted=(\\d+)"
-        );
-
-    for (const QString &line : lines) {
-        QRegularExpressionMatch match = contactRegex.match(line);
-        if (match.hasMatch()) {
-            DataItem contact;
-            contact.id = match.captured(1);
-            contact.displayName = match.captured(2).trimmed();
+    enum { Id, DisplayName, TimesContacted, LastTimeContacted };
+    static thread_local ContentQueryParser parser({"_id", "display_name", "times_contacted", "last_time_contacted"},
+                                                  DisplayName);
+    if (!parser.parseRow(line)) return false;
 
-            // Convertir timestamp a QDateTime
-            qint64 lastContact = match.captured(4).toLongLong();
-            contact.dateTime = QDateTime::fromMSecsSinceEpoch(lastContact * 1000);
+    contact = DataItem();
+    contact.id = QString::fromLatin1(parser.value(Id));
+    contact.displayName = parser.text(DisplayName);
 
-            // Tamaño estimado basado en campos
-            contact.size = 1024 + (contact.displayName.size() * 2);
+    // Convertir timestamp a QDateTime (UTC: evita resolver la zona horaria fila a fila)
+    qint64 lastContact = parser.integer(LastTimeContacted);
+    contact.dateTime = QDateTime::fromMSecsSinceEpoch(lastContact * 1000, Qt::UTC);
 
-            contacts.append(contact);
-        }
-    }
-
-    qDebug() << "Contactos encontrados:" << contacts.size();
-    return contacts;
+    // Tamaño estimado basado en campos
+    contact.size = 1024 + (contact.displayName.size() * 2);
+    return true;
 }
 
 /**
- * Procesa datos de mensajes Android
+ * Procesa una fila de mensajes Android (columnas de analyzeAndroidMessages)
  */
-QList<DataItem> DataAnalyzer::parseAndroidMessages(const QString &output)
+bool DataAnalyzer::parseAndroidMessageRow(const QByteArray &line, DataItem &message)
 {
-    QList<DataItem> messages;
-    QStringList lines = output.split('\n', Qt::SkipEmptyParts);
+    enum { Id, Address, Body, Date };
+    static thread_local ContentQueryParser parser({"_id", "address", "body", "date"}, Body);
+    if (!parser.parseRow(line)) return false;
 
-    QRegularExpression messageRegex(
-        "Row:\\s\\d+\\s_id=(\\d+),\\s*"
-        "address=([^,]+),\\s*"
-        "body=([^,]+),\\s*"
-        "date=(\\d+)"
-        );
+    message = DataItem();
+    message.id = QString::fromLatin1(parser.value(Id));
+    QString address = parser.text(Address);
+    QString body = parser.text(Body);
 
-    for (const QString &line : lines) {
-        QRegularExpressionMatch match = messageRegex.match(line);
-        if (match.hasMatch()) {
-            DataItem message;
-            message.id = match.captured(1);
-            QString address = match.captured(2).trimmed();
-            QString body = match.captured(3).trimmed();
+    message.displayName = QString("Mensaje de %1").arg(address);
+    message.data["address"] = address;
+    message.data["body"] = body;
 
-            message.displayName = QString("Mensaje de %1").arg(address);
-            message.data["body"] = body;
-
-            qint64 timestamp = match.captured(4).toLongLong();
-            message.dateTime = QDateTime::fromMSecsSinceEpoch(timestamp);
-
-            // Tamaño basado en longitud del mensaje
-            message.size = body.size() + address.size();
-
-            messages.append(message);
-        }
-    }
+    message.dateTime = QDateTime::fromMSecsSinceEpoch(parser.integer(Date), Qt::UTC);
 
-    qDebug() << "Mensajes encontrados:" << messages.size();
-    return messages;
+    // Tamaño basado en longitud del mensaje
+    message.size = body.size() + address.size();
+    return true;
 }
 
 /**
- * Procesa datos de llamadas Android
+ * Procesa una fila de llamadas Android (columnas de analyzeAndroidCalls)
  */
-QList<DataItem> DataAnalyzer::parseAndroidCalls(const QString &output)
+bool DataAnalyzer::parseAndroidCallRow(const QByteArray &line, DataItem &call)
 {
-    QList<DataItem> calls;
-    QStringList lines = output.split('\n', Qt::SkipEmptyParts);
-
-    QRegularExpression callRegex(
-        "Row:\\s\\d+\\s_id=(\\d+),\\s*"
-        "number=([^,]+),\\s*"
-        "date=(\\d+),\\s*"
-        "duration=(\\d+),\\s*"
-        "type=(\\d+)"
-        );
-
-    for (const QString &line : lines) {
-        QRegularExpressionMatch match = callRegex.match(line);
-        if (match.hasMatch()) {
-            DataItem call;
-            call.id = match.captured(1);
-            QString number = match.captured(2).trimmed();
+    enum { Id, Number, Date, Duration, Type };
+    static thread_local ContentQueryParser parser({"_id", "number", "date", "duration", "type"});
+    if (!parser.parseRow(line)) return false;
 
-            // Determinar tipo de llamada
-            int callType = match.captured(5).toInt();
-            QString typeStr;
-            if (callType == 1) typeStr = "Entrante";
-            else if (callType == 2) typeStr = "Saliente";
-            else typeStr = "Perdida";
+    call = DataItem();
+    call.id = QString::fromLatin1(parser.value(Id));
+    QString number = parser.text(Number);
 
-            call.displayName = QString("Llamada %1 - %2").arg(typeStr, number);
+    // Determinar tipo de llamada
+    qint64 callType = parser.integer(Type);
+    QString typeStr;
+    if (callType == 1) typeStr = "Entrante";
+    else if (callType == 2) typeStr = "Saliente";
+    else typeStr = "Perdida";
 
-            qint64 timestamp = match.captured(3).toLongLong();
-            call.dateTime = QDateTime::fromMSecsSinceEpoch(timestamp);
+    call.displayName = QString("Llamada %1 - %2").arg(typeStr, number);
+    call.data["number"] = number;
 
-            // Tamaño basado en duración
-            call.size = match.captured(4).toInt() * 10; // Factor aproximado
+    call.dateTime = QDateTime::fromMSecsSinceEpoch(parser.integer(Date), Qt::UTC);
 
-            calls.append(call);
-        }
-    }
-
-    qDebug() << "Llamadas encontradas:" << calls.size();
-    return calls;
+    // Tamaño basado en duración
+    call.size = parser.integer(Duration) * 10; // Factor aproximado
+    return true;
 }
@@ -11,25 +11,74 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QMutex>
+#include <QSet>
+#include <QHash>
+#include <QSharedPointer>
+#include <QWeakPointer>
+#include <functional>
 #include "devicemanager.h"
+#include "lineframer.h"
+#include "dataitemstore.h"
+#include "itemfeed.h"
+#include "itemquery.h"
 
-// Estructura para representar un elemento de datos individual
-struct DataItem {
-    QString id;           // Identificador único del elemento (ej. ruta de archivo para fotos)
-    QString displayName;  // Nombre para mostrar en la UI
-    QVariantMap data;     // Datos específicos del elemento (campos de contacto, contenido de mensaje, etc.)
-    QString filePath;     // Ruta del archivo si es un elemento multimedia
-    qint64 size;          // Tamaño en bytes (para multimedia)
-    QDateTime dateTime;   // Fecha/hora asociada al elemento
-};
+class AnalysisCache;
+class QThread;
 
 // Estructura para representar un conjunto de datos
 struct DataSet {
     QString type;         // Tipo de datos ("contacts", "messages", "photos", etc.)
-    QList<DataItem> items; // Elementos en este conjunto
+    DataItemStore items;  // Elementos en este conjunto (almacenamiento compacto)
     qint64 totalSize;     // Tamaño total en bytes
     bool isSupported;     // Si este tipo de datos es compatible con la transferencia actual
     QString errorMessage; // Mensaje de error si ocurrió alguno durante el análisis
+    QHash<QString, int> pathIndex; // filePath -> posición en items; lo mantiene DataAnalyzer::mergeItems()
+                                   // mientras llegan lotes y se libera al terminar el análisis
+    int pathIndexed = 0;           // Elementos de items ya incluidos en pathIndex; quien reemplace
+                                   // items lo pone a 0 junto con pathIndex.clear()
+    bool summaryOnly = false;      // Análisis rápido: solo recuento y tamaño, items está vacío
+    int summaryCount = 0;          // Número de elementos contados si summaryOnly
+    int duplicateCount = 0;        // Copias exactas de otro elemento (data["duplicateOf"])
+    qint64 duplicateSize = 0;      // Bytes que no hace falta transferir por esas copias
+    quint64 generation = nextGeneration(); // Única por DataSet construido (las copias la conservan):
+                                           // cambia cuando el análisis reemplaza el conjunto entero
+
+    // Número de elementos, enumerados o solo contados
+    int itemCount() const { return summaryOnly ? summaryCount : items.size(); }
+
+    // Memoria aproximada de los elementos más la de pathIndex (una ruta completa por entrada)
+    qint64 memoryUsage() const;
+
+    // Siguiente valor de generation, seguro entre hilos
+    static quint64 nextGeneration();
+};
+
+// Archivo ya presente en un destino
+struct DestinationFile {
+    qint64 size = 0;
+    qint64 modified = -1;  // Segundos desde epoch; -1 si no se pudo leer
+};
+
+// Inventario ligero de un dispositivo de destino (ver DataAnalyzer::analyzeDestination())
+struct DestinationInventory {
+    QMap<QString, qint64> freeSpace;      // Volumen (ruta del dispositivo) -> bytes libres
+    QHash<QString, DestinationFile> existingFiles; // Ruta en los directorios de destino -> tamaño y fecha
+    int contactsCount = -1;               // -1 si no se pudo contar o el destino no guarda registros
+    int messagesCount = -1;
+    bool complete = false;                // false mientras se inventaría o si falló
+    QString errorMessage;
+    QDateTime takenAt;                    // Cuándo se publicó (UTC): el destino puede cambiar después
+
+    // Volumen que contiene una ruta (el de prefijo más largo), o vacío si no hay ninguno
+    QString volumeFor(const QString &path) const {
+        QString best;
+        for (auto it = freeSpace.constBegin(); it != freeSpace.constEnd(); ++it) {
+            const QString &volume = it.key();
+            bool contains = volume == "/" || path == volume || path.startsWith(volume + "/");
+            if (contains && volume.size() > best.size()) best = volume;
+        }
+        return best;
+    }
 };
 
 // Estructura para una tarea de análisis
@@ -48,6 +97,10 @@ struct AnalysisTask {
  * Esta clase se encarga de escanear dispositivos para encontrar datos transferibles,
  * usando métodos directos (ADB, libimobiledevice) o a través de Bridge Client cuando
  * está disponible. Maneja el análisis de fotos, videos, contactos, mensajes, etc.
+ *
+ * Las tareas (dispositivo + tipo de datos) se ejecutan en paralelo hasta un límite,
+ * cada una con su propio proceso, de modo que analizar un dispositivo tarda lo que
+ * su consulta más lenta y el destino no espera detrás del origen.
  */
 class DataAnalyzer : public QObject
 {
@@ -68,11 +121,70 @@ public:
     /**
      * @brief Analiza un dispositivo para encontrar datos transferibles
      * @param deviceId Identificador del dispositivo
-     * @param quickScan Si es verdadero, realiza un análisis más rápido pero menos completo
+     * @param quickScan Si es verdadero, solo se cuentan elementos y tamaños (DataSet::summaryOnly)
      * @return true si el análisis se inició correctamente
+     *
+     * En Android, el análisis rápido cuenta filas de cada consulta y suma los tamaños de
+     * las raíces de medios sin crear DataItems; lo que ya esté en la caché se publica
+     * completo. Los demás tipos de dispositivo, baratos de enumerar, se analizan enteros.
+     * Los elementos se enumeran al pedir un análisis completo antes de transferir.
      */
     bool analyzeDevice(const QString &deviceId, bool quickScan = false);
 
+    /**
+     * @brief Activa o desactiva el análisis en segundo plano al conectar dispositivos (activo por defecto)
+     *
+     * Cuando DeviceManager anuncia un dispositivo autorizado (al conectarse o al
+     * autorizarse), se prepara Bridge Client y se lanza un análisis rápido con
+     * caché (ver analyzeDevice()) de prioridad baja: sus tareas solo arrancan si no hay
+     * tareas pedidas por el usuario en cola y, con una transferencia en curso, de una en
+     * una. No emite analysisStarted() ni analysisComplete() (sí dataSetUpdated()) y
+     * termina con backgroundAnalysisFinished().
+     */
+    void setBackgroundAnalysisEnabled(bool enabled);
+
+    /**
+     * @brief Lanza el análisis en segundo plano de un dispositivo si aún no tiene resultados
+     */
+    void startBackgroundAnalysis(const QString &deviceId);
+
+    /**
+     * @brief Descarta las tareas en cola del análisis en segundo plano de un dispositivo
+     *
+     * Las que ya están en curso terminan (son recuentos o lecturas de caché).
+     */
+    void cancelBackgroundAnalysis(const QString &deviceId);
+
+    /**
+     * @brief Indica si el análisis en curso de un dispositivo es el de segundo plano
+     */
+    bool isBackgroundAnalysis(const QString &deviceId) const;
+
+    /**
+     * @brief Indica si un dispositivo tiene resultados y ningún análisis en curso
+     */
+    bool hasAnalysisResults(const QString &deviceId);
+
+    /**
+     * @brief Informa de si hay una transferencia en curso (limita el trabajo en segundo plano)
+     */
+    void setTransferActive(bool active);
+
+    /**
+     * @brief Indica si un tipo de un dispositivo está en análisis (o a la espera de empezarlo)
+     */
+    bool isAnalyzing(const QString &deviceId, const QString &dataType) const;
+
+    /**
+     * @brief Abre una cola con los elementos de un tipo que aún se está analizando
+     *
+     * La cola empieza con los elementos ya descubiertos, recibe cada bloque que se
+     * publica después y se cierra cuando termina el análisis del tipo. Debe llamarse
+     * desde el hilo del analizador; la cola puede consumirse desde cualquier otro.
+     * @return Cola, o nula si el tipo no se está analizando (su DataSet ya está completo)
+     */
+    QSharedPointer<ItemFeed> openItemFeed(const QString &deviceId, const QString &dataType);
+
     /**
      * @brief Obtiene un conjunto de datos previamente analizado
      * @param deviceId Identificador del dispositivo
@@ -81,6 +193,36 @@ public:
      */
     DataSet getDataSet(const QString &deviceId, const QString &dataType);
 
+    /**
+     * @brief Selecciona elementos de un tipo analizado según unos filtros
+     *
+     * Usa los índices del DataSet (fecha, tamaño, directorio, tipo MIME y contacto),
+     * que se construyen en la primera consulta y se descartan cuando el DataSet cambia.
+     * Tras un análisis rápido (summaryOnly) no hay elementos que seleccionar: hace
+     * falta el análisis completo.
+     * @param deviceId Identificador del dispositivo
+     * @param dataType Tipo de datos
+     * @param query Filtros
+     * @return Selección para DataTransferManager::startTransfer()
+     */
+    ItemSelection selectItems(const QString &deviceId, const QString &dataType, const ItemQuery &query);
+
+    /**
+     * @brief Inventaría el destino: espacio libre, archivos ya presentes y registros
+     *
+     * Se ejecuta con su propio proceso, fuera de la cola de tareas, así que corre a la
+     * vez que el análisis del origen. Emite destinationInventoryReady() al terminar;
+     * si ya hay un inventario en curso para el dispositivo no hace nada.
+     * @param deviceId ID del dispositivo de destino
+     */
+    void analyzeDestination(const QString &deviceId);
+
+    /**
+     * @brief Último inventario del destino (se puede llamar desde cualquier hilo)
+     * @return Inventario, con complete == false si aún no hay uno válido
+     */
+    DestinationInventory getDestinationInventory(const QString &deviceId) const;
+
     /**
      * @brief Obtiene los tipos de datos soportados para transferencia entre dos dispositivos
      * @param sourceId ID del dispositivo origen
@@ -99,7 +241,7 @@ public:
 
     /**
      * @brief Verifica si un tipo de datos es soportado entre dispositivos
-     * @param sourceType Tipo de dispositivo origen ("android", "ios")
+     * @param sourceType Tipo de dispositivo origen ("android", "ios", "local")
      * @param destType Tipo de dispositivo destino
      * @param dataType Tipo de datos a verificar
      * @return true si es soportado
@@ -115,6 +257,121 @@ public:
      */
     QString getIncompatibilityReason(const QString &sourceType, const QString &destType, const QString &dataType);
 
+    /**
+     * @brief Carga de forma síncrona todos los DataSets de un archivo de respaldo
+     * @param deviceId ID del dispositivo de tipo "archive"
+     * @return true si el índice se pudo leer
+     */
+    bool loadArchive(const QString &deviceId);
+
+    /**
+     * @brief Establece cuántas tareas de análisis pueden ejecutarse a la vez
+     *
+     * Cada tarea usa su propio proceso; las tareas de Bridge Client de un mismo
+     * dispositivo se siguen ejecutando de una en una.
+     * @param maxTasks Número máximo de tareas simultáneas (mínimo 1)
+     */
+    void setMaxConcurrentTasks(int maxTasks);
+
+    /**
+     * @brief Establece los directorios que recorre el análisis de archivos por ADB
+     * @param roots Rutas del dispositivo (se admiten comodines del shell del dispositivo)
+     */
+    void setAndroidMediaRoots(const QStringList &roots);
+
+    /**
+     * @brief Activa o desactiva la caché en disco de los análisis (activa por defecto)
+     *
+     * Con la caché activa, cada tarea calcula antes un testigo barato de los datos del
+     * dispositivo (huella de directorios o de los identificadores de una consulta); si
+     * coincide con el guardado, el DataSet se carga de disco sin repetir el análisis.
+     * Si no coincide, por ADB se piden solo los cambios (directorios modificados, _id
+     * nuevos de mensajes y llamadas) y se mezclan con lo guardado.
+     */
+    void setAnalysisCacheEnabled(bool enabled);
+
+    /**
+     * @brief Descarta lo guardado en caché para un dispositivo
+     */
+    void invalidateAnalysisCache(const QString &deviceId);
+
+    /**
+     * @brief Activa o desactiva el análisis ligero de mensajes y contactos (activo por defecto)
+     *
+     * En modo ligero el análisis solo conserva id, hilo, tamaño y fecha de cada registro
+     * (el tamaño se calcula antes de descartar el cuerpo, teléfonos o correos) y lo marca
+     * como parcial; DataTransferManager pide los registros completos por páginas al
+     * transferirlos (DeviceTransport::fetchRecords()).
+     */
+    void setLazyRecordFields(bool enabled);
+
+    /**
+     * @brief Establece los filtros de los escaneos de Bridge Client
+     *
+     * Cada escaneo pide además solo el tipo de su tarea. Bridge Client aplica los filtros
+     * en el dispositivo; si una versión antigua los ignora, se aplican al recibir los datos.
+     * Sin efecto en el análisis directo por ADB.
+     * @param filter Directorios raíz, rango de fechas y tamaño mínimo (los tipos se ignoran)
+     */
+    void setBridgeScanFilter(const ScanFilter &filter);
+
+    /**
+     * @brief Activa o desactiva la detección de duplicados exactos (activa por defecto)
+     *
+     * Tras el recorrido de medios por ADB se calcula en el dispositivo el MD5 de los
+     * archivos cuyo tamaño coincide con el de otro (md5sum por lotes, muchos archivos por
+     * orden). De cada grupo con la misma huella se conserva el más antiguo; los demás
+     * guardan su ruta en data["duplicateOf"], cuentan en DataSet::duplicateCount y
+     * DataTransferManager no los envía. Las huellas se guardan en data["contentHash"] y
+     * viajan con la caché, así que un análisis incremental solo calcula las nuevas.
+     */
+    void setDuplicateDetectionEnabled(bool enabled);
+
+    /**
+     * @brief Directorios de medios por defecto (cámara, capturas, descargas, WhatsApp, tarjeta SD...)
+     */
+    static QStringList defaultAndroidMediaRoots();
+
+    /**
+     * @brief Convierte una fila de "adb shell content query" en un DataItem
+     * @param dataType "contacts", "messages" o "calls" (con la proyección que usa el análisis)
+     * @param line Línea de la salida, sin salto de línea
+     * @param item Elemento de salida
+     * @return false si la línea no es una fila válida
+     */
+    static bool parseAndroidRow(const QString &dataType, const QByteArray &line, DataItem &item);
+
+    /**
+     * @brief Consulta "content query" (URI y proyección) que usa el análisis de un tipo
+     * @param dataType "contacts", "messages" o "calls"
+     * @return Comando del dispositivo, o vacío si el tipo no es un registro
+     */
+    static QString androidRecordQuery(const QString &dataType);
+
+    /**
+     * @brief Descarta los campos pesados de un registro y lo marca como parcial
+     *
+     * Mensajes: cuerpo, leído y tipo; contactos: teléfonos, correos y foto. Se conservan
+     * id, displayName, dirección, threadId, tamaño y fecha, y data["partial"] = true.
+     */
+    static void stripHeavyFields(const QString &dataType, DataItem &item);
+
+    /**
+     * @brief Indica si un registro se analizó en modo ligero y falta pedirlo completo
+     */
+    static bool isPartialRecord(const DataItem &item);
+
+    /**
+     * @brief Añade a un DataSet los elementos cuya ruta aún no contiene
+     *
+     * Usa y actualiza DataSet::pathIndex, de modo que el coste es proporcional al
+     * número de elementos añadidos y no al tamaño del DataSet.
+     * @param dataSet DataSet de destino
+     * @param items Elementos nuevos (p. ej. un lote de Bridge Client)
+     * @return Número de elementos añadidos
+     */
+    static int mergeItems(DataSet &dataSet, const QList<DataItem> &items);
+
 signals:
     /**
      * @brief Señal emitida cuando se inicia el análisis de un dispositivo
@@ -136,6 +393,12 @@ signals:
      */
     void analysisComplete(const QString &deviceId);
 
+    /**
+     * @brief Señal emitida cuando termina (o se cancela) el análisis en segundo plano de un dispositivo
+     * @param deviceId Identificador del dispositivo
+     */
+    void backgroundAnalysisFinished(const QString &deviceId);
+
     /**
      * @brief Señal emitida cuando ocurre un error durante el análisis
      * @param deviceId Identificador del dispositivo
@@ -151,6 +414,12 @@ signals:
      */
     void dataSetUpdated(const QString &deviceId, const QString &dataType);
 
+    /**
+     * @brief Señal emitida cuando termina el inventario de un destino
+     * @param deviceId Identificador del dispositivo
+     */
+    void destinationInventoryReady(const QString &deviceId);
+
     /**
      * @brief Señal interna para procesar la cola de tareas
      * @param deviceId Identificador del dispositivo que finalizó una tarea
@@ -164,11 +433,19 @@ private slots:
     void processNextAnalysisTask();
 
     /**
-     * @brief Maneja la finalización del proceso de análisis externo
+     * @brief Pasa a las colas abiertas los elementos nuevos de un DataSet
+     */
+    void feedSubscribers(const QString &deviceId, const QString &dataType);
+
+    /**
+     * @brief Maneja la finalización del proceso de análisis externo de una tarea
+     * @param process Proceso que terminó
+     * @param task Tarea a la que pertenece
      * @param exitCode Código de salida del proceso
      * @param exitStatus Estado de salida
      */
-    void onAnalysisProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void onAnalysisProcessFinished(QProcess *process, const AnalysisTask &task,
+                                   int exitCode, QProcess::ExitStatus exitStatus);
 
     /**
      * @brief Maneja eventos cuando Bridge Client recibe información del dispositivo
@@ -180,17 +457,17 @@ private slots:
      * @brief Maneja datos multimedia recibidos de Bridge Client
      * @param index Índice del lote actual
      * @param count Total de lotes
-     * @param mediaData Array JSON con datos multimedia
+     * @param items Elementos del lote, ya convertidos en el hilo de E/S
      */
-    void onBridgeClientMediaData(int index, int count, const QJsonArray &mediaData);
+    void onBridgeClientMediaData(int index, int count, const QList<DataItem> &items);
 
     /**
      * @brief Maneja datos de archivos recibidos de Bridge Client
      * @param index Índice del lote actual
      * @param count Total de lotes
-     * @param filesData Array JSON con datos de archivos
+     * @param items Elementos del lote, ya convertidos en el hilo de E/S
      */
-    void onBridgeClientFilesData(int index, int count, const QJsonArray &filesData);
+    void onBridgeClientFilesData(int index, int count, const QList<DataItem> &items);
 
     /**
      * @brief Maneja evento de escaneo completado en Bridge Client
@@ -211,23 +488,197 @@ private slots:
 
     /**
      * @brief Maneja datos de contactos recibidos de Bridge Client
-     * @param contactsData Array JSON con datos de contactos
+     * @param contactsData Contactos ya convertidos en el hilo de E/S
      */
-    void onBridgeClientContactsData(const QJsonArray &contactsData);
+    void onBridgeClientContactsData(const QList<DataItem> &contactsData);
 
     /**
      * @brief Maneja datos de mensajes recibidos de Bridge Client
-     * @param messagesData Array JSON con datos de mensajes
+     * @param messagesData Mensajes ya convertidos en el hilo de E/S
      */
-    void onBridgeClientMessagesData(const QJsonArray &messagesData);
+    void onBridgeClientMessagesData(const QList<DataItem> &messagesData);
 
 private:
+    // Recorrido de medios en curso de un dispositivo Android
+    struct MediaScan {
+        QProcess *process;
+        LineFramer framer;               // Salida aún sin procesar
+        QMap<QString, DataSet> dataSets; // Resultados por tipo de datos
+        QStringList waitingTypes;        // Tipos cuyas tareas esperan este recorrido
+        int fileCount;
+        qint64 deviceTime;               // Hora del dispositivo al empezar (0 si no se recibió)
+        int unpublishedRows;             // Archivos listados desde la última publicación parcial
+        int lastProgress;
+        QMap<QString, int> publishedRows; // Tipo -> elementos ya publicados (recorrido completo)
+
+        // Recorrido incremental: solo se listan los directorios y archivos que cambiaron
+        bool delta;
+        QMap<QString, DataSet> baseSets; // DataSets de la caché sobre los que se aplica
+        QSet<QString> existingDirs;      // Todos los directorios actuales
+        QSet<QString> changedDirs;       // Directorios que se volvieron a listar
+    };
+    QMap<QString, MediaScan> m_mediaScans; // [deviceId] -> recorrido en curso
+
+    // Cálculo de huellas de posibles duplicados tras un recorrido de medios
+    struct HashScan {
+        QProcess *process;
+        LineFramer framer;
+        QMap<QString, DataSet> dataSets; // Resultado del recorrido, aún sin publicar
+        QStringList waitingTypes;
+        QStringList pending;             // Rutas sin huella que comparten tamaño con otra
+        int batchEnd;                    // Fin (en pending) del lote en curso
+        QHash<QString, QString> hashes;  // Ruta -> MD5
+    };
+    QMap<QString, HashScan> m_hashScans; // [deviceId] -> huellas en curso
+    static const int HASH_BATCH_CHARS = 3500; // Longitud máxima de una orden md5sum (adb antiguos: 4 KB)
+
+    // Recuento rápido de archivos en curso de un dispositivo Android
+    struct QuickCount {
+        QProcess *process;
+        LineFramer framer;
+        QStringList waitingTypes;        // Tipos cuyas tareas esperan este recuento
+        QMap<QString, int> counts;       // Archivos por tipo de datos
+        QMap<QString, qint64> sizes;     // Bytes por tipo de datos
+    };
+    QMap<QString, QuickCount> m_quickCounts; // [deviceId] -> recuento en curso
+
+    // Inventario de un destino Android en curso
+    struct InventoryScan {
+        QProcess *process;
+        LineFramer framer;
+        QString section;                 // Sección de la salida que se está leyendo
+        DestinationInventory inventory;
+    };
+    QMap<QString, InventoryScan> m_inventoryScans; // [deviceId] -> inventario en curso
+    QSet<QString> m_localInventories;              // Inventarios locales en curso en el hilo de E/S
+
+    /**
+     * @brief Inventario de un destino Android con un único proceso adb
+     */
+    void startAndroidInventory(const QString &deviceId);
+
+    /**
+     * @brief Inventario de un directorio local o de un archivo de respaldo
+     *
+     * Recorre el disco: se llama en el hilo de E/S y no toca miembros.
+     * @param path Ruta local del dispositivo (DeviceManager::getLocalDevicePath())
+     */
+    static DestinationInventory localInventory(const DeviceInfo &device, const QString &path);
+
+    /**
+     * @brief Guarda un inventario y emite destinationInventoryReady()
+     */
+    void publishInventory(const QString &deviceId, const DestinationInventory &inventory);
+
+    /**
+     * @brief Pone en cola el análisis de un dispositivo
+     * @param deviceId ID del dispositivo
+     * @param quickScan Solo recuentos (ver analyzeDevice())
+     * @param background true para el análisis en segundo plano (prioridad baja, sin diálogos)
+     * @param waitForBridge false para no esperar a Bridge Client (tras bridgeClientSetupFinished)
+     * @return true si el análisis se puso en cola (o quedó aplazado tras el de segundo plano
+     *         o a la espera de Bridge Client)
+     */
+    bool startDeviceAnalysis(const QString &deviceId, bool quickScan, bool background, bool waitForBridge = true);
+
+    /**
+     * @brief Da por terminado el análisis en segundo plano y lanza el que esperaba, si hay
+     */
+    void finishBackgroundAnalysis(const QString &deviceId);
+
+    /**
+     * @brief Cierra las colas de elementos de un tipo
+     * @param deviceId ID del dispositivo
+     * @param dataType Tipo de datos (vacío para todos los del dispositivo)
+     * @param errorMessage Error del análisis (vacío si terminó bien)
+     */
+    void closeItemFeeds(const QString &deviceId, const QString &dataType, const QString &errorMessage = QString());
+
     /**
      * @brief Inicia una tarea de análisis específica
      * @param task Tarea a ejecutar
      */
     void startAnalysisTask(const AnalysisTask& task);
 
+    /**
+     * @brief Lanza el análisis de una tarea según el tipo de dispositivo
+     * @param task Tarea de análisis
+     * @param deviceType Tipo de dispositivo ("android", "ios", "local", "archive")
+     */
+    void dispatchAnalysisTask(const AnalysisTask& task, const QString &deviceType);
+
+    /**
+     * @brief Calcula el testigo de cambios de una tarea antes de analizarla
+     *
+     * Las tareas que comparten testigo (los tipos de archivo de un dispositivo) esperan
+     * a la misma comprobación.
+     * @param task Tarea de análisis
+     * @param deviceType Tipo de dispositivo
+     * @return false si el tipo no admite caché (la tarea debe lanzarse directamente)
+     */
+    bool startCacheCheck(const AnalysisTask& task, const QString &deviceType);
+
+    /**
+     * @brief Carga la tarea desde la caché si el testigo coincide; si no, la analiza
+     * @param task Tarea de análisis
+     * @param deviceType Tipo de dispositivo
+     * @param token Testigo actual (vacío si no se pudo calcular)
+     */
+    void onCacheTokenReady(const AnalysisTask& task, const QString &deviceType, const QString &token);
+
+    /**
+     * @brief Comando del dispositivo Android cuya salida (un MD5) resume los datos de un tipo
+     * @return Comando, o vacío si el tipo no tiene testigo
+     */
+    QString androidCacheTokenCommand(const QString &dataType) const;
+
+    /**
+     * @brief Testigo de un dispositivo local: fechas de sus directorios, número de archivos
+     *        y fecha del archivo más reciente
+     *
+     * Recorre todo el árbol: se llama desde el hilo de E/S (ver runOnIoThread()).
+     * @param rootPath Carpeta raíz del dispositivo
+     */
+    static QString localCacheToken(const QString &rootPath);
+
+    /**
+     * @brief Ejecuta trabajo de disco (recorridos, caché) en el hilo de E/S del analizador
+     *
+     * Los trabajos se ejecutan en orden; el resultado se devuelve a este objeto con
+     * QMetaObject::invokeMethod(this, ..., Qt::QueuedConnection).
+     */
+    void runOnIoThread(std::function<void()> work);
+
+    /**
+     * @brief Lanza el proceso externo de una tarea de análisis
+     * @param task Tarea (con los datos que necesitará el parser)
+     * @param fullAdbCommand Comando completo (programa y argumentos separados por espacios)
+     */
+    void startAnalysisProcess(const AnalysisTask &task, const QString &fullAdbCommand);
+
+    /**
+     * @brief Lanza el proceso externo de una tarea con los argumentos ya separados
+     *
+     * Si task.data contiene "deltaBaseRows", la primera línea de la salida debe ser el
+     * número de filas que el dispositivo conserva de la base; si no coincide, la
+     * consulta incremental se abandona y el tipo se analiza completo.
+     */
+    void startAnalysisProcess(const AnalysisTask &task, const QString &program, const QStringList &arguments);
+
+    /**
+     * @brief Procesa la salida recibida de una consulta y publica las filas por bloques
+     * @param process Proceso de la consulta
+     * @param task Tarea a la que pertenece
+     * @param finished true si el proceso terminó (se procesa y publica todo lo pendiente)
+     */
+    void parseQueryOutput(QProcess *process, const AnalysisTask &task, bool finished);
+
+    /**
+     * @brief Tarea de Bridge Client del cliente que emitió la señal en curso
+     * @return Tarea activa, o una tarea vacía si el emisor no tiene ninguna
+     */
+    AnalysisTask bridgeTaskForSender() const;
+
     /**
      * @brief Inicia análisis para un dispositivo Android
      * @param task Tarea de análisis
@@ -246,8 +697,124 @@ private:
      */
     void startAndroidAnalysisViaBridge(const AnalysisTask& task);
 
+    /**
+     * @brief Analiza un dispositivo local (directorio del PC) recorriendo su árbol
+     * @param task Tarea de análisis
+     */
+    void startLocalAnalysis(const AnalysisTask& task);
+
+    /**
+     * @brief Reconstruye un DataSet desde el índice mapeado de un archivo de respaldo
+     * @param task Tarea de análisis
+     */
+    void startArchiveAnalysis(const AnalysisTask& task);
+
+    /**
+     * @brief Infiere el tipo de datos de un archivo por su extensión
+     * @param filePath Ruta o nombre del archivo
+     * @return "photos", "videos", "music", "documents" o cadena vacía si no se reconoce
+     */
+    static QString inferDataTypeFromPath(const QString &filePath);
+
     // Métodos de análisis específicos para Android usando métodos directos
-    void analyzeAndroidPhotosReal(const QString &deviceId);
+    /**
+     * @brief Enumera fotos, vídeos, música y documentos con un solo find por exec-out
+     *
+     * Otras tareas de archivos del mismo dispositivo que lleguen mientras tanto se suman
+     * al recorrido en curso en lugar de lanzar el suyo.
+     * @param task Tarea de análisis
+     */
+    void analyzeAndroidMedia(const AnalysisTask &task);
+
+    /**
+     * @brief Convierte en DataItems las líneas completas recibidas del recorrido de medios
+     * @param deviceId ID del dispositivo
+     * @param flush true para procesar también una última línea sin salto de línea
+     */
+    void parseMediaScanOutput(const QString &deviceId, bool flush);
+
+    /**
+     * @brief Publica en bloques de ROW_CHUNK los archivos nuevos de un recorrido completo
+     *
+     * El primer bloque de cada tipo sustituye al resultado anterior; el definitivo (con
+     * los duplicados marcados) lo publica publishMediaScan() al terminar.
+     * @param deviceId ID del dispositivo
+     */
+    void publishMediaChunk(const QString &deviceId);
+
+    /**
+     * @brief Guarda el resultado del recorrido de medios y finaliza las tareas que lo esperaban
+     * @param deviceId ID del dispositivo
+     * @param normalExit false si el proceso no pudo iniciarse o terminó de forma anómala
+     * @param exitCode Código de salida
+     */
+    void onMediaScanFinished(const QString &deviceId, bool normalExit, int exitCode);
+
+    /**
+     * @brief Mezcla el resultado de un recorrido incremental con los DataSets de la caché
+     *
+     * Se descartan los elementos de directorios que ya no existen o que cambiaron (estos
+     * se vuelven a listar enteros) y los archivos que se volvieron a listar.
+     */
+    void mergeMediaDelta(MediaScan &scan);
+
+    /**
+     * @brief Guarda los DataSets de un recorrido de medios y finaliza las tareas que lo esperaban
+     * @param hashes Huellas calculadas (ruta -> MD5) para marcar duplicados
+     */
+    void publishMediaScan(const QString &deviceId, const QStringList &waitingTypes,
+                          QMap<QString, DataSet> dataSets, const QHash<QString, QString> &hashes);
+
+    /**
+     * @brief Rutas sin huella cuyo tamaño coincide con el de otro elemento del mismo tipo
+     */
+    static QStringList duplicateCandidates(const QMap<QString, DataSet> &dataSets);
+
+    /**
+     * @brief Calcula por lotes las huellas de los candidatos y después publica el recorrido
+     */
+    void startDuplicateHashing(const QString &deviceId, const QStringList &waitingTypes,
+                               const QMap<QString, DataSet> &dataSets, const QStringList &candidates);
+
+    /**
+     * @brief Lanza el siguiente lote de md5sum o, si no quedan, publica el recorrido
+     */
+    void runNextHashBatch(const QString &deviceId);
+
+    /**
+     * @brief Recoge las huellas de un lote ("md5  ruta" por línea)
+     */
+    void onHashBatchFinished(const QString &deviceId);
+
+    /**
+     * @brief Marca los duplicados exactos (mismo tamaño y huella) y actualiza sus totales
+     */
+    static void markDuplicates(DataSet &dataSet, const QHash<QString, QString> &hashes);
+
+    /**
+     * @brief Análisis rápido de Android: recuento de filas o de archivos y bytes por tipo
+     * @param task Tarea de análisis (quickScan)
+     * @return false si el tipo no se puede contar (se analiza completo)
+     */
+    bool startAndroidQuickCount(const AnalysisTask &task);
+
+    /**
+     * @brief Publica un DataSet con solo recuento y tamaño y finaliza su tarea
+     */
+    void publishSummary(const QString &deviceId, const QString &dataType, int count, qint64 totalSize);
+
+    /**
+     * @brief URI del proveedor de contenido de un tipo de registro
+     */
+    static QString androidRecordUri(const QString &dataType);
+
+    /**
+     * @brief Consulta solo los mensajes o llamadas con _id mayor que el último guardado
+     * @param task Tarea de análisis
+     * @return false si no hay base en la caché (hay que analizar el tipo completo)
+     */
+    bool analyzeAndroidRecordsDelta(const AnalysisTask &task);
+
     void analyzeAndroidContacts(const QString &deviceId);
     void analyzeAndroidMessages(const QString &deviceId);
     void analyzeAndroidCalls(const QString &deviceId);
@@ -259,14 +826,9 @@ private:
     void analyzeIOSCalls(const QString &deviceId);
 
     // Métodos parser para diferentes formatos de datos
-    QList<DataItem> parseAndroidContacts(const QString &output);
-    QList<DataItem> parseAndroidMessages(const QString &output);
-    QList<DataItem> parseAndroidCalls(const QString &output);
-    QList<DataItem> parseAndroidPhotoList(const QString &output, const QString& basePath);
-    QList<DataItem> parseJsonMediaData(const QJsonArray &jsonArray);
-    QList<DataItem> parseJsonFilesData(const QJsonArray &jsonArray);
-    QList<DataItem> parseJsonContactsData(const QJsonArray &jsonArray);
-    QList<DataItem> parseJsonMessagesData(const QJsonArray &jsonArray);
+    static bool parseAndroidContactRow(const QByteArray &line, DataItem &contact);
+    static bool parseAndroidMessageRow(const QByteArray &line, DataItem &message);
+    static bool parseAndroidCallRow(const QByteArray &line, DataItem &call);
 
     // Métodos auxiliares
     QString getAdbCommand(const QString &deviceId, const QString &command);
@@ -275,20 +837,88 @@ private:
     void createBasicDataSet(const QString &deviceId, const QString &dataType);
     void disconnectBridgeClientSignals(const QString &deviceId);
     void updateBridgeScanProgress(const QString &deviceId, const QString &dataType, int progress);
+    void mergeBridgeItems(const QString &deviceId, const QMap<QString, QList<DataItem>> &itemsByType);
+    bool matchesBridgeScanFilter(const DataItem &item) const;
 
     // Variables miembro
     DeviceManager *m_deviceManager;
-    QProcess *m_analysisProcess;
     QMap<QString, QMap<QString, DataSet>> m_dataSets; // Mapa de [deviceId][dataType] -> DataSet
 
     QQueue<AnalysisTask> m_analysisQueue; // Cola para tareas de análisis pendientes
-    AnalysisTask m_currentAnalysisTask;   // Tarea que se está procesando actualmente
-    bool m_isAnalyzing; // Flag que indica si el procesador de la cola está activo
+    QSet<QString> m_runningTasks;         // Tareas en ejecución ("deviceId/dataType")
+    int m_maxConcurrentTasks;             // Límite de tareas simultáneas
+    QMap<QString, AnalysisTask> m_bridgeTasks; // Tarea de Bridge Client activa por dispositivo
+
+    QStringList m_androidMediaRoots;
+    ScanFilter m_bridgeScanFilter;        // Filtros de los escaneos de Bridge Client
+
+    // Salida de una consulta de análisis en curso
+    struct QueryStream {
+        LineFramer framer;
+        QList<DataItem> chunk;           // Filas aún no publicadas en m_dataSets
+        int rows;
+        int lastProgress;
+        int deviceRows;                  // Filas "Row:" recibidas, se puedan convertir o no
+        qint64 maxRowId;                 // Mayor _id visto (incluido el de la consulta anterior)
+        int baseRows;                    // Filas del dispositivo sobre las que se añaden las nuevas
+        int expectedBaseRows;            // Recuento pendiente de comprobar (-1 si no hay)
+        bool fullRescan;                 // La base ya no es válida: repetir el análisis completo
+    };
+    QHash<QProcess *, QueryStream> m_queryStreams;
+    QMap<QString, QMap<QString, int>> m_lastRowCounts; // [deviceId][dataType] -> filas del último análisis
+
+    static constexpr int ROW_CHUNK = 2000; // Filas por publicación parcial
+    // Caché de análisis en disco
+    struct TokenCheck {
+        QProcess *process;
+        QString deviceType;
+        QString variant;                 // Se mezcla con la salida para formar el testigo
+        QList<AnalysisTask> waiting;     // Tareas que esperan este testigo
+    };
+    AnalysisCache *m_analysisCache;
+    QThread *m_ioThread;               // Hilo de E/S de disco: testigos locales y escritura de la caché
+    QObject *m_ioContext;              // Objeto de m_ioThread al que se encolan los trabajos
+    bool m_cacheEnabled;
+    bool m_lazyRecordFields;           // Análisis ligero de mensajes y contactos
+    bool m_duplicateDetection;         // Huellas de archivos de igual tamaño tras el recorrido
+    QMap<QString, TokenCheck> m_tokenChecks;       // ["deviceId/testigo"] -> comprobación en curso
+    QMap<QString, QString> m_pendingCacheTokens;   // ["deviceId/dataType"] -> testigo a guardar al terminar
+    QMap<QString, QJsonObject> m_pendingScanInfo;  // ["deviceId/dataType"] -> datos del recorrido a guardar con él
+
     QMap<QString, int> m_pendingTasksPerDevice; // Rastrea tareas pendientes para señal analysisComplete
 
     // Mapas para el seguimiento de tareas de Bridge Client
     QMap<QString, QMap<QString, bool>> m_bridgeScanComplete; // [deviceId][dataType] -> completado
     QMutex m_dataSetMutex; // Mutex para proteger acceso a m_dataSets
+
+    // Análisis en segundo plano
+    bool m_backgroundEnabled;
+    bool m_transferActive;
+    QSet<QString> m_backgroundDevices;       // Dispositivos cuyo análisis en curso es de segundo plano
+    QMap<QString, bool> m_deferredAnalyses;  // Análisis del usuario aplazados tras el de segundo plano (quickScan)
+
+    // Análisis a la espera de que termine la configuración de Bridge Client
+    struct BridgeWait {
+        bool quickScan;
+        bool background;
+    };
+    QMap<QString, BridgeWait> m_bridgeWaits;
+
+    // Colas de elementos para transferencias que empiezan antes de terminar el análisis
+    struct FeedSubscription {
+        QWeakPointer<ItemFeed> feed;
+        int offset;                          // Elementos del DataSet ya entregados
+        quint64 generation;                  // DataSet::generation al que se refiere offset
+        QSet<QString> delivered;             // Ids entregados, para no repetirlos si el DataSet se reemplaza
+    };
+    QSet<QString> m_typesInAnalysis;                          // ["deviceId/dataType"] en cola o en curso
+    QHash<QString, QList<FeedSubscription>> m_feeds;         // ["deviceId/dataType"] -> colas abiertas
+
+    QHash<QString, ItemIndex> m_itemIndexes; // ["deviceId/dataType"] -> índices para selectItems()
+
+    // Inventarios de destino; los lee el motor de transferencia desde su hilo
+    QMap<QString, DestinationInventory> m_inventories;
+    mutable QMutex m_inventoryMutex;
 };
 
 #endif // DATAANALYZER_H
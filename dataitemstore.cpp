@@ -0,0 +1,345 @@
+#include "dataitemstore.h"
+#include <QStringList>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+// Indicadores al inicio de cada registro
+enum ItemFlag : quint8 {
+    IdIsPath = 0x01,       // id == filePath
+    IdEmpty = 0x02,
+    NameIsFile = 0x04,     // displayName == nombre de archivo
+    NameEmpty = 0x08,
+    HasData = 0x10
+};
+
+// Codificación de los valores de data
+enum ValueKind : quint8 {
+    KindInterned,          // Índice en la tabla de valores repetitivos
+    KindText,
+    KindInteger,
+    KindBool,
+    KindStringList,
+    KindDouble,            // 8 bytes (números que llegan de JSON)
+    KindVariant            // Índice en m_variants
+};
+
+const qint64 INVALID_TIME = std::numeric_limits<qint64>::min();
+
+// Claves cuyos valores se repiten entre muchos elementos
+bool isRepetitiveKey(const QString &key)
+{
+    return key == QLatin1String("mimeType") || key == QLatin1String("mediaType")
+           || key == QLatin1String("fileType") || key == QLatin1String("type");
+}
+
+void putVarint(QByteArray &out, quint64 value)
+{
+    while (value >= 0x80) {
+        out.append(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out.append(static_cast<char>(value));
+}
+
+quint64 getVarint(const uchar *&p)
+{
+    quint64 value = 0;
+    int shift = 0;
+    for (;;) {
+        uchar byte = *p++;
+        value |= quint64(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) break;
+        shift += 7;
+    }
+    return value;
+}
+
+void putText(QByteArray &out, const QString &text)
+{
+    QByteArray utf8 = text.toUtf8();
+    putVarint(out, static_cast<quint64>(utf8.size()));
+    out.append(utf8);
+}
+
+QString getText(const uchar *&p)
+{
+    int length = static_cast<int>(getVarint(p));
+    QString text = QString::fromUtf8(reinterpret_cast<const char *>(p), length);
+    p += length;
+    return text;
+}
+
+} // namespace
+
+DataItemStore::DataItemStore()
+{
+    m_dirTable.append(QString()); // Índice 0 reservado: ruta sin directorio
+}
+
+DataItemStore &DataItemStore::operator=(const QList<DataItem> &items)
+{
+    clear();
+    append(items);
+    return *this;
+}
+
+int DataItemStore::size() const
+{
+    return m_sizes.size();
+}
+
+int DataItemStore::count() const
+{
+    return m_sizes.size();
+}
+
+bool DataItemStore::isEmpty() const
+{
+    return m_sizes.isEmpty();
+}
+
+quint32 DataItemStore::intern(QVector<QString> &table, QHash<QString, quint32> &index, const QString &value)
+{
+    auto it = index.constFind(value);
+    if (it != index.constEnd()) return it.value();
+
+    quint32 id = static_cast<quint32>(table.size());
+    table.append(value);
+    index.insert(value, id);
+    return id;
+}
+
+/**
+ * Añade un elemento: columnas fijas + registro (nombre, id, nombre para mostrar, data)
+ */
+void DataItemStore::append(const DataItem &item)
+{
+    m_sizes.append(item.size);
+    m_times.append(item.dateTime.isValid() ? item.dateTime.toMSecsSinceEpoch() : INVALID_TIME);
+    m_offsets.append(static_cast<quint32>(m_records.size()));
+
+    // La ruta se parte en directorio (internado) y nombre de archivo
+    int slash = item.filePath.lastIndexOf('/');
+    QString name = slash >= 0 ? item.filePath.mid(slash + 1) : item.filePath;
+    m_dirs.append(slash >= 0 ? intern(m_dirTable, m_dirIndex, item.filePath.left(slash)) : 0);
+
+    quint8 flags = 0;
+    if (item.id == item.filePath) flags |= IdIsPath;
+    else if (item.id.isEmpty()) flags |= IdEmpty;
+    if (item.displayName == name) flags |= NameIsFile;
+    else if (item.displayName.isEmpty()) flags |= NameEmpty;
+    if (!item.data.isEmpty()) flags |= HasData;
+
+    m_records.append(static_cast<char>(flags));
+    putText(m_records, name);
+    if (!(flags & (IdIsPath | IdEmpty))) putText(m_records, item.id);
+    if (!(flags & (NameIsFile | NameEmpty))) putText(m_records, item.displayName);
+    if (flags & HasData) encodeData(item.data);
+}
+
+void DataItemStore::append(const QList<DataItem> &items)
+{
+    reserve(size() + items.size());
+    for (const DataItem &item : items) {
+        append(item);
+    }
+}
+
+/**
+ * Codifica los campos de data con el tipo de cada valor
+ */
+void DataItemStore::encodeData(const QVariantMap &data)
+{
+    putVarint(m_records, static_cast<quint64>(data.size()));
+    for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
+        putVarint(m_records, intern(m_keyTable, m_keyIndex, it.key()));
+
+        const QVariant &value = it.value();
+        switch (value.userType()) {
+        case QMetaType::QString:
+            if (isRepetitiveKey(it.key())) {
+                m_records.append(static_cast<char>(KindInterned));
+                putVarint(m_records, intern(m_valueTable, m_valueIndex, value.toString()));
+            } else {
+                m_records.append(static_cast<char>(KindText));
+                putText(m_records, value.toString());
+            }
+            break;
+        case QMetaType::Int:
+        case QMetaType::UInt:
+        case QMetaType::LongLong:
+        case QMetaType::ULongLong: {
+            qint64 number = value.toLongLong();
+            m_records.append(static_cast<char>(KindInteger));
+            putVarint(m_records, (static_cast<quint64>(number) << 1) ^ static_cast<quint64>(number >> 63));
+            break;
+        }
+        case QMetaType::Bool:
+            m_records.append(static_cast<char>(KindBool));
+            m_records.append(static_cast<char>(value.toBool() ? 1 : 0));
+            break;
+        case QMetaType::Double: {
+            double number = value.toDouble();
+            m_records.append(static_cast<char>(KindDouble));
+            m_records.append(reinterpret_cast<const char *>(&number), sizeof(number));
+            break;
+        }
+        case QMetaType::QStringList: {
+            const QStringList list = value.toStringList();
+            m_records.append(static_cast<char>(KindStringList));
+            putVarint(m_records, static_cast<quint64>(list.size()));
+            for (const QString &entry : list) {
+                putText(m_records, entry);
+            }
+            break;
+        }
+        default:
+            m_records.append(static_cast<char>(KindVariant));
+            putVarint(m_records, static_cast<quint64>(m_variants.size()));
+            m_variants.append(value);
+            break;
+        }
+    }
+}
+
+QString DataItemStore::filePath(int index) const
+{
+    const uchar *record = reinterpret_cast<const uchar *>(m_records.constData()) + m_offsets.at(index) + 1;
+    QString name = getText(record);
+    quint32 dir = m_dirs.at(index);
+    return dir == 0 ? name : m_dirTable.at(dir) + QLatin1Char('/') + name;
+}
+
+qint64 DataItemStore::itemSize(int index) const
+{
+    return m_sizes.at(index);
+}
+
+/**
+ * Reconstruye el elemento i a partir de sus columnas y su registro
+ */
+DataItem DataItemStore::at(int index) const
+{
+    DataItem item;
+    item.size = m_sizes.at(index);
+    qint64 time = m_times.at(index);
+    if (time != INVALID_TIME) {
+        item.dateTime = QDateTime::fromMSecsSinceEpoch(time, Qt::UTC);
+    }
+
+    const uchar *record = reinterpret_cast<const uchar *>(m_records.constData()) + m_offsets.at(index);
+    quint8 flags = *record++;
+    QString name = getText(record);
+    quint32 dir = m_dirs.at(index);
+    item.filePath = dir == 0 ? name : m_dirTable.at(dir) + QLatin1Char('/') + name;
+
+    if (flags & IdIsPath) item.id = item.filePath;
+    else if (!(flags & IdEmpty)) item.id = getText(record);
+
+    if (flags & NameIsFile) item.displayName = name;
+    else if (!(flags & NameEmpty)) item.displayName = getText(record);
+
+    if (flags & HasData) {
+        int fields = static_cast<int>(getVarint(record));
+        for (int i = 0; i < fields; ++i) {
+            const QString &key = m_keyTable.at(static_cast<int>(getVarint(record)));
+            quint8 kind = *record++;
+            switch (kind) {
+            case KindInterned:
+                item.data.insert(key, m_valueTable.at(static_cast<int>(getVarint(record))));
+                break;
+            case KindText:
+                item.data.insert(key, getText(record));
+                break;
+            case KindInteger: {
+                quint64 zigzag = getVarint(record);
+                qint64 number = static_cast<qint64>(zigzag >> 1) ^ -static_cast<qint64>(zigzag & 1);
+                if (number >= std::numeric_limits<int>::min() && number <= std::numeric_limits<int>::max()) {
+                    item.data.insert(key, static_cast<int>(number));
+                } else {
+                    item.data.insert(key, number);
+                }
+                break;
+            }
+            case KindBool:
+                item.data.insert(key, *record++ != 0);
+                break;
+            case KindDouble: {
+                double number;
+                memcpy(&number, record, sizeof(number));
+                record += sizeof(number);
+                item.data.insert(key, number);
+                break;
+            }
+            case KindStringList: {
+                int entries = static_cast<int>(getVarint(record));
+                QStringList list;
+                list.reserve(entries);
+                for (int e = 0; e < entries; ++e) {
+                    list.append(getText(record));
+                }
+                item.data.insert(key, list);
+                break;
+            }
+            default:
+                item.data.insert(key, m_variants.at(static_cast<int>(getVarint(record))));
+                break;
+            }
+        }
+    }
+    return item;
+}
+
+DataItem DataItemStore::operator[](int index) const
+{
+    return at(index);
+}
+
+void DataItemStore::reserve(int count)
+{
+    m_sizes.reserve(count);
+    m_times.reserve(count);
+    m_dirs.reserve(count);
+    m_offsets.reserve(count);
+}
+
+void DataItemStore::clear()
+{
+    *this = DataItemStore();
+}
+
+QList<DataItem> DataItemStore::toList() const
+{
+    QList<DataItem> items;
+    items.reserve(size());
+    for (int i = 0; i < size(); ++i) {
+        items.append(at(i));
+    }
+    return items;
+}
+
+/**
+ * Memoria aproximada: capacidad de columnas y búfer más las tablas internadas
+ */
+qint64 DataItemStore::memoryUsage() const
+{
+    auto stringBytes = [](const QVector<QString> &table) {
+        qint64 bytes = 0;
+        for (const QString &value : table) {
+            bytes += 32 + value.capacity() * 2; // Cabecera de QString + UTF-16
+        }
+        return bytes;
+    };
+
+    qint64 bytes = static_cast<qint64>(m_sizes.capacity()) * sizeof(qint64)
+                   + static_cast<qint64>(m_times.capacity()) * sizeof(qint64)
+                   + static_cast<qint64>(m_dirs.capacity()) * sizeof(quint32)
+                   + static_cast<qint64>(m_offsets.capacity()) * sizeof(quint32)
+                   + m_records.capacity();
+    bytes += stringBytes(m_dirTable) + stringBytes(m_keyTable) + stringBytes(m_valueTable);
+    bytes += static_cast<qint64>(m_dirIndex.size() + m_keyIndex.size() + m_valueIndex.size()) * 32; // Nodos de hash
+    bytes += static_cast<qint64>(m_variants.size()) * sizeof(QVariant);
+    return bytes;
+}
@@ -0,0 +1,124 @@
+#ifndef DATAITEMSTORE_H
+#define DATAITEMSTORE_H
+
+#include <QString>
+#include <QList>
+#include <QVector>
+#include <QHash>
+#include <QByteArray>
+#include <QVariant>
+#include <QVariantMap>
+#include <QDateTime>
+#include <QMetaType>
+
+// Estructura para representar un elemento de datos individual
+struct DataItem {
+    QString id;           // Identificador único del elemento (ej. ruta de archivo para fotos)
+    QString displayName;  // Nombre para mostrar en la UI
+    QVariantMap data;     // Datos específicos del elemento (campos de contacto, contenido de mensaje, etc.)
+    QString filePath;     // Ruta del archivo si es un elemento multimedia
+    qint64 size;          // Tamaño en bytes (para multimedia)
+    QDateTime dateTime;   // Fecha/hora asociada al elemento
+};
+
+Q_DECLARE_METATYPE(DataItem)
+
+/**
+ * @class DataItemStore
+ * @brief Almacén compacto de DataItems con la interfaz de lectura de QList<DataItem>
+ *
+ * Tamaños y fechas (milisegundos desde epoch, 64 bits) se guardan en columnas; el
+ * resto de cada elemento es un registro binario en un único búfer: nombre de archivo,
+ * id y nombre para mostrar solo cuando difieren de la ruta o del nombre de archivo,
+ * y los campos de data tipados (enteros, booleanos, textos, listas). Los directorios,
+ * las claves de data y los valores repetitivos (mimeType, mediaType...) se internan.
+ *
+ * at() y la iteración devuelven DataItems reconstruidos por valor; filePath() e
+ * itemSize() leen un campo sin reconstruir el elemento. Todas las columnas son
+ * contenedores Qt compartidos implícitamente, así que copiar un DataSet sigue siendo barato.
+ */
+class DataItemStore
+{
+public:
+    DataItemStore();
+
+    /**
+     * @brief Reemplaza el contenido por una lista de elementos
+     */
+    DataItemStore &operator=(const QList<DataItem> &items);
+
+    int size() const;
+    int count() const;
+    bool isEmpty() const;
+
+    /**
+     * @brief Reconstruye el elemento i
+     */
+    DataItem at(int index) const;
+    DataItem operator[](int index) const;
+
+    /**
+     * @brief Ruta del elemento i sin reconstruir el resto
+     */
+    QString filePath(int index) const;
+
+    /**
+     * @brief Tamaño del elemento i
+     */
+    qint64 itemSize(int index) const;
+
+    void append(const DataItem &item);
+    void append(const QList<DataItem> &items);
+    void reserve(int count);
+    void clear();
+
+    /**
+     * @brief Copia todos los elementos a una lista
+     */
+    QList<DataItem> toList() const;
+
+    /**
+     * @brief Memoria ocupada (aproximada) por el almacén, en bytes
+     */
+    qint64 memoryUsage() const;
+
+    class const_iterator
+    {
+    public:
+        const_iterator(const DataItemStore *store, int index) : m_store(store), m_index(index) {}
+        DataItem operator*() const { return m_store->at(m_index); }
+        const_iterator &operator++() { ++m_index; return *this; }
+        bool operator==(const const_iterator &other) const { return m_index == other.m_index; }
+        bool operator!=(const const_iterator &other) const { return m_index != other.m_index; }
+
+    private:
+        const DataItemStore *m_store;
+        int m_index;
+    };
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+
+private:
+    quint32 intern(QVector<QString> &table, QHash<QString, quint32> &index, const QString &value);
+    void encodeData(const QVariantMap &data);
+
+    // Columnas por elemento
+    QVector<qint64> m_sizes;
+    QVector<qint64> m_times;       // Milisegundos desde epoch (mínimo de qint64 si no hay fecha)
+    QVector<quint32> m_dirs;       // Directorio internado (0 = ruta sin '/')
+    QVector<quint32> m_offsets;    // Inicio del registro en m_records
+
+    QByteArray m_records;          // Registros binarios de los elementos
+
+    // Tablas de cadenas internadas
+    QVector<QString> m_dirTable;
+    QHash<QString, quint32> m_dirIndex;
+    QVector<QString> m_keyTable;
+    QHash<QString, quint32> m_keyIndex;
+    QVector<QString> m_valueTable;
+    QHash<QString, quint32> m_valueIndex;
+    QVector<QVariant> m_variants;  // Valores de data sin codificación propia
+};
+
+#endif // DATAITEMSTORE_H
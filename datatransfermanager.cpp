@@ -1,4 +1,6 @@
 #include "datatransfermanager.h"
+#include "rangedtransfer.h"
+#include "deltasync.h"
 #include <QDir>
 #include <QTemporaryDir>
 #include <QDebug>
@@ -10,6 +12,8 @@
 #include <QMutexLocker>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QThread>
+#include <algorithm>
 
 /**
  * Constructor de la clase DataTransferManager
@@ -19,22 +23,19 @@ DataTransferManager::DataTransferManager(DeviceManager *deviceManager, DataAnaly
     , m_deviceManager(deviceManager)
     , m_dataAnalyzer(dataAnalyzer)
     , m_isTransferring(false)
+    , m_sourceTransport(nullptr)
+    , m_destTransport(nullptr)
+    , m_maxItemsInFlight(0)
+    , m_itemLimit(1)
+    , m_itemsInFlight(0)
+    , m_waitingForItems(false)
     , m_totalTransferSize(0)
     , m_totalTransferredSizePreviousTasks(0)
+    , m_rangedTransferThreshold(RangedTransferJob::DEFAULT_THRESHOLD)
+    , m_rangeSize(RangedTransferJob::DEFAULT_RANGE_SIZE)
+    , m_deltaSyncEnabled(true)
 {
-    // Conectar señales de procesos
-    connect(&m_pullProcess, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
-            this, &DataTransferManager::onPullProcessFinished);
-    connect(&m_pushProcess, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
-            this, &DataTransferManager::onPushProcessFinished);
-
-    // Manejar stderr para mejores mensajes de error
-    connect(&m_pullProcess, &QProcess::readyReadStandardError, this, [this](){
-        qWarning() << "Pull Process Error Output:" << m_pullProcess.readAllStandardError();
-    });
-    connect(&m_pushProcess, &QProcess::readyReadStandardError, this, [this](){
-        qWarning() << "Push Process Error Output:" << m_pushProcess.readAllStandardError();
-    });
+    m_latencyClock.start();
 }
 
 /**
@@ -53,6 +54,40 @@ DataTransferManager::~DataTransferManager()
  */
 bool DataTransferManager::startTransfer(const QString &sourceId, const QString &destId,
                                         const QStringList &dataTypes, bool clearDestination)
+{
+    return beginTransfer(sourceId, destId, dataTypes, clearDestination, QMap<QString, ItemSelection>());
+}
+
+/**
+ * Inicia una transferencia de elementos seleccionados
+ */
+bool DataTransferManager::startTransfer(const QString &destId, const QList<ItemSelection> &selections,
+                                        bool clearDestination)
+{
+    if (selections.isEmpty()) {
+        emit transferFailed("No hay elementos seleccionados para transferir");
+        return false;
+    }
+
+    QString sourceId = selections.first().deviceId;
+    QStringList dataTypes;
+    QMap<QString, ItemSelection> byType;
+    for (const ItemSelection &selection : selections) {
+        if (selection.deviceId != sourceId) {
+            emit transferFailed("Las selecciones deben ser de un mismo dispositivo origen");
+            return false;
+        }
+        dataTypes << selection.dataType;
+        byType[selection.dataType] = selection;
+    }
+    return beginTransfer(sourceId, destId, dataTypes, clearDestination, byType);
+}
+
+/**
+ * Prepara las tareas (tipos completos o seleccionados) y arranca la primera
+ */
+bool DataTransferManager::beginTransfer(const QString &sourceId, const QString &destId, const QStringList &dataTypes,
+                                        bool clearDestination, const QMap<QString, ItemSelection> &selections)
 {
     QMutexLocker locker(&m_transferMutex);
 
@@ -89,7 +124,9 @@ bool DataTransferManager::startTransfer(const QString &sourceId, const QString &
     m_totalTransferSize = 0;
     m_totalTransferredSizePreviousTasks = 0;
     m_currentTask = TransferTask();
+    m_waitingForItems = false;
     m_transferTimer.start();
+    m_stepLatenciesUs.clear();
 
     // Verificar capacidades de Bridge Client
     bool sourceBridgeAvailable = sourceDevice.type == "android" &&
@@ -98,30 +135,76 @@ bool DataTransferManager::startTransfer(const QString &sourceId, const QString &
                                m_deviceManager->isBridgeClientConnected(destId);
 
     // Popular cola y calcular tamaño total
+    QStringList discoveringTypes; // Tipos aún en análisis: van detrás de los ya analizados
     for (const QString &dataType : dataTypes) {
+        if (!m_dataAnalyzer->isTypeSupported(sourceDevice.type, destDevice.type, dataType)) {
+            qWarning() << "Saltando tipo de dato debido a incompatibilidad de plataforma:" << dataType;
+            continue;
+        }
+
+        // Si el tipo aún se está analizando, la tarea consume sus elementos a medida que aparecen
+        // (una selección, en cambio, se refiere a los elementos que había al hacerla)
+        auto selection = selections.constFind(dataType);
+        bool selected = selection != selections.constEnd();
+        QSharedPointer<ItemFeed> feed = selected ? QSharedPointer<ItemFeed>()
+                                                 : m_dataAnalyzer->openItemFeed(sourceId, dataType);
         DataSet dataSet = m_dataAnalyzer->getDataSet(sourceId, dataType);
-        if (dataSet.items.isEmpty() || !dataSet.isSupported || !dataSet.errorMessage.isEmpty()) {
+        if (!feed && (dataSet.items.isEmpty() || !dataSet.isSupported || !dataSet.errorMessage.isEmpty())) {
             qWarning() << "Saltando tipo de dato:" << dataType << "Items:" << dataSet.items.count()
             << "Soportado:" << dataSet.isSupported << "Error:" << dataSet.errorMessage;
             continue;
         }
-
-        if (!m_dataAnalyzer->isTypeSupported(sourceDevice.type, destDevice.type, dataType)) {
-            qWarning() << "Saltando tipo de dato debido a incompatibilidad de plataforma:" << dataType;
+        // Un DataSet reemplazado con el mismo número de elementos tiene otra generación;
+        // uno que solo creció conserva la generación pero no el recuento
+        if (selected && (selection->generation != dataSet.generation || selection->itemCount != dataSet.items.size()
+                         || selection->indexes.isEmpty())) {
+            qWarning() << "Saltando selección de" << dataType << ": vacía o de un análisis anterior"
+                       << selection->itemCount << "/" << dataSet.items.size();
             continue;
         }
 
-        m_dataTypeQueue.enqueue(dataType);
         TransferTask taskInfo;
         taskInfo.sourceId = sourceId;
         taskInfo.destId = destId;
         taskInfo.dataType = dataType;
         taskInfo.clearDestination = clearDestination;
-        taskInfo.itemsToTransfer = dataSet.items;
-        taskInfo.totalItems = dataSet.items.size();
-        taskInfo.totalSize = dataSet.totalSize > 0 ? dataSet.totalSize : (dataSet.items.size() * 1024); // Estimación
+        if (feed) {
+            taskInfo.feed = feed;
+            taskInfo.totalItems = 0;
+            taskInfo.totalSize = 0;
+            takeDiscoveredItems(taskInfo);
+            connect(feed.data(), &ItemFeed::itemsAvailable, this, [this, dataType]() {
+                onItemsDiscovered(dataType);
+            });
+            discoveringTypes.append(dataType);
+        } else if (selected) {
+            taskInfo.itemsToTransfer.reserve(selection->indexes.size());
+            QSet<QString> selectedPaths;
+            for (int index : selection->indexes) {
+                taskInfo.itemsToTransfer.append(dataSet.items.at(index));
+                selectedPaths.insert(dataSet.items.filePath(index));
+            }
+            // Una copia cuyo original no se eligió se transfiere como un archivo más
+            for (DataItem &item : taskInfo.itemsToTransfer) {
+                if (item.data.contains("duplicateOf") && !selectedPaths.contains(item.data.value("duplicateOf").toString())) {
+                    item.data.remove("duplicateOf");
+                }
+            }
+            taskInfo.totalItems = taskInfo.itemsToTransfer.size();
+            taskInfo.totalSize = selection->totalSize > 0 ? selection->totalSize
+                                                          : (taskInfo.totalItems * 1024); // Estimación
+            m_dataTypeQueue.enqueue(dataType);
+        } else {
+            taskInfo.itemsToTransfer = dataSet.items.toList();
+            taskInfo.totalItems = dataSet.items.size();
+            taskInfo.totalSize = dataSet.totalSize > 0 ? dataSet.totalSize : (dataSet.items.size() * 1024); // Estimación
+            m_dataTypeQueue.enqueue(dataType);
+        }
         taskInfo.processedItems = 0;
         taskInfo.processedSize = 0;
+        taskInfo.skippedExisting = 0;
+        taskInfo.skippedDuplicates = 0;
+        taskInfo.skippedMissing = 0;
         taskInfo.currentItemIndex = -1;
         taskInfo.status = "waiting";
 
@@ -135,6 +218,9 @@ bool DataTransferManager::startTransfer(const QString &sourceId, const QString &
         m_taskStates[dataType] = taskInfo;
         m_totalTransferSize += taskInfo.totalSize;
     }
+    for (const QString &dataType : qAsConst(discoveringTypes)) {
+        m_dataTypeQueue.enqueue(dataType);
+    }
 
     if (m_dataTypeQueue.isEmpty()) {
         QString errorMsg = "No hay tipos de datos válidos seleccionados o compatibles para transferir";
@@ -143,6 +229,34 @@ bool DataTransferManager::startTransfer(const QString &sourceId, const QString &
         return false;
     }
 
+    // Inventario del destino, analizado en paralelo con el origen: planificar antes del primer envío
+    m_destInventory = m_dataAnalyzer->getDestinationInventory(destId);
+
+    // Si es viejo pueden faltar archivos que lista como presentes: no se usa y se pide otro
+    qint64 inventoryAge = m_destInventory.takenAt.isValid()
+                              ? m_destInventory.takenAt.msecsTo(QDateTime::currentDateTimeUtc()) : -1;
+    if (m_destInventory.complete && (inventoryAge < 0 || inventoryAge > INVENTORY_MAX_AGE_MS)) {
+        qDebug() << "Inventario del destino de hace" << inventoryAge / 1000 << "s: se descarta y se pide otro";
+        m_destInventory = DestinationInventory();
+        DataAnalyzer *analyzer = m_dataAnalyzer;
+        QMetaObject::invokeMethod(analyzer, [analyzer, destId]() {
+            analyzer->analyzeDestination(destId);
+        }, Qt::QueuedConnection);
+    }
+    QString capacityError;
+    if (!checkDestinationCapacity(&capacityError)) {
+        qWarning() << capacityError;
+        emit transferFailed(capacityError);
+        cleanupTempDirectory();
+        return false;
+    }
+    if (!m_destInventory.complete) {
+        qDebug() << "Sin inventario del destino: no se comprueba el espacio ni se omiten archivos existentes";
+    }
+
+    // Crear los transportes una sola vez para toda la transferencia
+    createTransports(sourceId, destId, sourceBridgeAvailable && destBridgeAvailable);
+
     qDebug() << "Iniciando transferencia. Tareas:" << m_dataTypeQueue << "Tamaño Total:" << m_totalTransferSize;
     m_isTransferring = true; // MARCAR COMO ACTIVA *ANTES* DE EMITIR SEÑALES
 
@@ -151,16 +265,50 @@ bool DataTransferManager::startTransfer(const QString &sourceId, const QString &
     emit transferStarted(m_totalTransferSize);
     emit transferProgress(0);
 
-    startNextTransferTask(); // Iniciar la primera tarea
+    scheduleStep(&DataTransferManager::startNextTransferTask); // La primera tarea arranca en el hilo del motor
 
     return true;
 }
 
+/**
+ * Respalda datos de un dispositivo en un archivo del PC
+ */
+bool DataTransferManager::startBackupToArchive(const QString &sourceId, const QString &archivePath,
+                                               const QStringList &dataTypes)
+{
+    QString archiveId = m_deviceManager->addArchiveDevice(archivePath);
+    if (archiveId.isEmpty()) {
+        emit transferFailed("Ruta de archivo de respaldo no válida: " + archivePath);
+        return false;
+    }
+    return startTransfer(sourceId, archiveId, dataTypes);
+}
+
+/**
+ * Restaura datos de un archivo de respaldo en un dispositivo
+ */
+bool DataTransferManager::startRestoreFromArchive(const QString &archivePath, const QString &destId,
+                                                  const QStringList &dataTypes)
+{
+    QString archiveId = m_deviceManager->addArchiveDevice(archivePath);
+    if (archiveId.isEmpty() || !m_dataAnalyzer->loadArchive(archiveId)) {
+        emit transferFailed("No se pudo abrir el archivo de respaldo: " + archivePath);
+        return false;
+    }
+    return startTransfer(archiveId, destId, dataTypes);
+}
+
 /**
  * Cancela la transferencia en curso
  */
 void DataTransferManager::cancelTransfer()
 {
+    // Los transportes y sus procesos pertenecen al hilo del motor: cancelar allí
+    if (QThread::currentThread() != thread()) {
+        QMetaObject::invokeMethod(this, [this]() { cancelTransfer(); }, Qt::QueuedConnection);
+        return;
+    }
+
     QMutexLocker locker(&m_transferMutex);
 
     if (!m_isTransferring) return;
@@ -169,29 +317,8 @@ void DataTransferManager::cancelTransfer()
     bool wasActive = m_isTransferring;
     m_isTransferring = false; // Prevenir inicio de nuevos pasos/tareas
 
-    // Terminar procesos en curso
-    if (m_pullProcess.state() != QProcess::NotRunning) {
-        m_pullProcess.blockSignals(true); // Evitar que finished() se procese después de cancelar
-        m_pullProcess.terminate();
-        m_pullProcess.waitForFinished(500);
-        m_pullProcess.blockSignals(false);
-    }
-
-    if (m_pushProcess.state() != QProcess::NotRunning) {
-        m_pushProcess.blockSignals(true);
-        m_pushProcess.terminate();
-        m_pushProcess.waitForFinished(500);
-        m_pushProcess.blockSignals(false);
-    }
-
-    // Desconectar Bridge Client de ambos dispositivos si estaban en uso
-    if (!m_currentTask.sourceId.isEmpty()) {
-        disconnectBridgeClientSignals(m_currentTask.sourceId);
-    }
-
-    if (!m_currentTask.destId.isEmpty()) {
-        disconnectBridgeClientSignals(m_currentTask.destId);
-    }
+    // Abortar la operación en curso y liberar transportes
+    releaseTransports();
 
     // Limpiar estado
     m_dataTypeQueue.clear();
@@ -199,6 +326,7 @@ void DataTransferManager::cancelTransfer()
     m_currentTask = TransferTask();
 
     cleanupTempDirectory();
+    logSchedulingLatency();
 
     locker.unlock(); // Desbloquear antes de emitir señales
 
@@ -263,6 +391,48 @@ QList<TransferTask> DataTransferManager::getActiveTasksInfo() const
     return infoList;
 }
 
+/**
+ * Establece el umbral de transferencia por rangos
+ */
+void DataTransferManager::setRangedTransferThreshold(qint64 bytes)
+{
+    QMutexLocker locker(&m_transferMutex);
+    m_rangedTransferThreshold = qMax<qint64>(0, bytes);
+}
+
+qint64 DataTransferManager::rangedTransferThreshold() const
+{
+    QMutexLocker locker(&m_transferMutex);
+    return m_rangedTransferThreshold;
+}
+
+/**
+ * Establece el tamaño de rango
+ */
+void DataTransferManager::setRangeSize(qint64 bytes)
+{
+    QMutexLocker locker(&m_transferMutex);
+    m_rangeSize = bytes;
+}
+
+/**
+ * Activa o desactiva la sincronización por deltas
+ */
+void DataTransferManager::setDeltaSyncEnabled(bool enabled)
+{
+    QMutexLocker locker(&m_transferMutex);
+    m_deltaSyncEnabled = enabled;
+}
+
+/**
+ * Establece el límite de archivos en vuelo
+ */
+void DataTransferManager::setMaxItemsInFlight(int maxItems)
+{
+    QMutexLocker locker(&m_transferMutex);
+    m_maxItemsInFlight = qMax(0, maxItems);
+}
+
 /**
  * Inicia la siguiente tarea de transferencia
  */
@@ -276,7 +446,9 @@ void DataTransferManager::startNextTransferTask()
             bool wasActive = m_isTransferring;
             m_isTransferring = false; // Marcar como inactivo *antes* de emitir
 
+            releaseTransports();
             cleanupTempDirectory();
+            logSchedulingLatency();
 
             locker.unlock(); // Desbloquear antes de emitir señales
 
@@ -295,7 +467,7 @@ void DataTransferManager::startNextTransferTask()
     if (!m_taskStates.contains(nextDataType)) {
         qWarning() << "Estado de tarea no encontrado para:" << nextDataType << ". Saltando.";
         locker.unlock();
-        QTimer::singleShot(0, this, &DataTransferManager::startNextTransferTask);
+        scheduleStep(&DataTransferManager::startNextTransferTask);
         return;
     }
 
@@ -304,6 +476,8 @@ void DataTransferManager::startNextTransferTask()
     m_currentTask.currentItemIndex = -1;
     m_currentTask.processedItems = 0;
     m_currentTask.processedSize = 0;
+    m_waitingForItems = false;
+    m_totalTransferSize += takeDiscoveredItems(m_currentTask);
 
     qDebug() << "Iniciando tarea:" << m_currentTask.dataType << "Items:" << m_currentTask.totalItems
              << "Tamaño:" << m_currentTask.totalSize << "Usando Bridge Client:" << m_currentTask.useBridgeClient;
@@ -313,36 +487,32 @@ void DataTransferManager::startNextTransferTask()
     emit transferTaskStarted(m_currentTask.dataType, m_currentTask.totalItems);
     emitTaskProgress(); // Emitir progreso inicial (0%)
 
-    DeviceInfo sourceDevice = m_deviceManager->getDeviceInfo(m_currentTask.sourceId);
-    DeviceInfo destDevice = m_deviceManager->getDeviceInfo(m_currentTask.destId);
-    bool taskStarted = false;
-
-    if (sourceDevice.type == "android" && destDevice.type == "android") {
-        taskStarted = transferAndroidToAndroid(m_currentTask);
-    } else if (sourceDevice.type == "android" && destDevice.type == "ios") {
-        taskStarted = transferAndroidToIOS(m_currentTask);
-    } else if (sourceDevice.type == "ios" && destDevice.type == "android") {
-        taskStarted = transferIOSToAndroid(m_currentTask);
-    } else if (sourceDevice.type == "ios" && destDevice.type == "ios") {
-        taskStarted = transferIOSToIOS(m_currentTask);
-    } else {
-        m_currentTask.errorMessage = "Combinación de tipos de dispositivo no soportada.";
-        taskStarted = false;
-    }
+    bool taskStarted = prepareDestination(m_currentTask);
 
     if (!taskStarted) {
         // Si la preparación de la tarea falló, la finalizamos inmediatamente
         finalizeCurrentTask(false, m_currentTask.errorMessage.isEmpty() ?
                                        "No se pudo iniciar la tarea específica de la plataforma." :
                                        m_currentTask.errorMessage);
+    } else if (isFileType(m_currentTask.dataType)) {
+        // Archivos: varios en vuelo, hasta lo que admitan ambos transportes
+        locker.relock();
+        m_itemsInFlight = 0;
+        m_inFlightNames.clear();
+        // El límite configurado solo puede reducirlo: un archivo de respaldo admite una
+        // entrada abierta y Bridge Client no asocia FILE_READY/FILE_SAVED a su petición
+        m_itemLimit = qMax(1, qMin(m_sourceTransport->maxConcurrentJobs(), m_destTransport->maxConcurrentJobs()));
+        if (m_maxItemsInFlight > 0) m_itemLimit = qMin(m_itemLimit, m_maxItemsInFlight);
+        locker.unlock();
+        fillFilePipeline();
     } else {
-        // Tarea iniciada, procesar el primer paso/ítem
+        // Registros: se procesan uno a uno
         processNextTransferStep();
     }
 }
 
 /**
- * Procesa el siguiente paso de transferencia
+ * Procesa el siguiente registro de la tarea actual
  */
 void DataTransferManager::processNextTransferStep()
 {
@@ -351,10 +521,23 @@ void DataTransferManager::processNextTransferStep()
     if (!m_isTransferring) return;
 
     m_currentTask.currentItemIndex++;
+    m_totalTransferSize += takeDiscoveredItems(m_currentTask);
 
     if (m_currentTask.currentItemIndex >= m_currentTask.totalItems) {
-        qDebug() << "Tarea completada (todos los ítems procesados):" << m_currentTask.dataType;
+        // El análisis aún puede aportar registros: se sigue con el siguiente bloque
+        if (isDiscovering(m_currentTask)) {
+            m_currentTask.currentItemIndex--;
+            m_waitingForItems = true;
+            return;
+        }
+
+        QString analysisError = m_currentTask.feed ? m_currentTask.feed->errorMessage() : QString();
         locker.unlock();
+        if (!analysisError.isEmpty()) {
+            finalizeCurrentTask(false, "El análisis del origen falló: " + analysisError);
+            return;
+        }
+        qDebug() << "Tarea completada (todos los ítems procesados):" << m_currentTask.dataType;
         finalizeCurrentTask(true); // Finalizar la tarea actual como exitosa
         return;
     }
@@ -372,24 +555,111 @@ void DataTransferManager::processNextTransferStep()
     const DataItem& currentItem = m_currentTask.itemsToTransfer[m_currentTask.currentItemIndex];
     m_currentTask.currentItemName = currentItem.displayName;
 
+    bool missing = m_currentTask.missingRecords.contains(currentItem.id);
+    bool partial = DataAnalyzer::isPartialRecord(currentItem);
+
     locker.unlock(); // Desbloquear antes de continuar
 
-    // Decidir cómo transferir según el tipo de datos
-    if (m_currentTask.dataType == "photos" || m_currentTask.dataType == "videos" ||
-        m_currentTask.dataType == "music" || m_currentTask.dataType == "documents") {
-
-        if (m_currentTask.useBridgeClient) {
-            // Transferir usando Bridge Client
-            if (!startPhotoPullViaBridge(currentItem)) {
-                // Si falla, usar método tradicional como fallback
-                startPhotoPull();
+    if (missing) {
+        skipMissingRecord();
+        return;
+    }
+
+    // Análisis ligero: el registro aún no tiene sus campos completos
+    if (partial) {
+        fetchRecordPage();
+        return;
+    }
+
+    startRecordStep();
+}
+
+/**
+ * Lee del origen una página de registros completos y reanuda la tarea
+ */
+void DataTransferManager::fetchRecordPage()
+{
+    QMutexLocker locker(&m_transferMutex);
+
+    int first = m_currentTask.currentItemIndex;
+    int last = qMin(first + RECORD_PAGE, m_currentTask.itemsToTransfer.size());
+    QStringList ids;
+    for (int i = first; i < last; ++i) {
+        const DataItem &item = m_currentTask.itemsToTransfer[i];
+        if (DataAnalyzer::isPartialRecord(item) && !m_currentTask.missingRecords.contains(item.id)) ids.append(item.id);
+    }
+    QString dataType = m_currentTask.dataType;
+    locker.unlock();
+
+    qDebug() << "Pidiendo" << ids.size() << "registros completos de" << dataType << "desde" << first;
+
+    RecordFetchJob *job = m_sourceTransport->fetchRecords(dataType, ids);
+    trackJob(job, [this, job, first, last](bool success, const QString &errorMessage) {
+        if (!success) {
+            finalizeCurrentTask(false, "No se pudieron leer los registros completos: " + errorMessage);
+            return;
+        }
+
+        QHash<QString, DataItem> records;
+        for (const DataItem &record : job->records()) {
+            records.insert(record.id, record);
+        }
+
+        QMutexLocker locker(&m_transferMutex);
+        if (!m_isTransferring) return;
+
+        int missing = 0;
+        for (int i = first; i < last && i < m_currentTask.itemsToTransfer.size(); ++i) {
+            DataItem &item = m_currentTask.itemsToTransfer[i];
+            if (!DataAnalyzer::isPartialRecord(item)) continue;
+
+            auto it = records.constFind(item.id);
+            if (it != records.constEnd()) {
+                item = it.value();
+            } else {
+                // Borrado en el dispositivo después del análisis: se salta, nunca se escribe a medias
+                m_currentTask.missingRecords.insert(item.id);
+                ++missing;
             }
-        } else {
-            // Método tradicional con ADB pull/push
-            startPhotoPull();
         }
-    }
-    else if (m_currentTask.dataType == "contacts") {
+        if (missing > 0) {
+            qWarning() << missing << "registros de" << m_currentTask.dataType << "ya no están en el origen y se omiten";
+        }
+        bool currentMissing = m_currentTask.missingRecords.contains(m_currentTask.itemsToTransfer.value(first).id);
+        locker.unlock();
+
+        if (currentMissing) {
+            skipMissingRecord();
+            return;
+        }
+        startRecordStep();
+    });
+}
+
+/**
+ * Cuenta el registro actual como omitido (borrado en el origen) y pasa al siguiente
+ */
+void DataTransferManager::skipMissingRecord()
+{
+    QMutexLocker locker(&m_transferMutex);
+    if (!m_isTransferring) return;
+
+    m_currentTask.processedItems++;
+    m_currentTask.skippedMissing++;
+    locker.unlock();
+
+    emitTaskProgress();
+    emitOverallProgress();
+    scheduleStep(&DataTransferManager::processNextTransferStep);
+}
+
+/**
+ * Procesa el registro actual según el tipo de la tarea
+ */
+void DataTransferManager::startRecordStep()
+{
+    // Decidir cómo transferir según el tipo de datos
+    if (m_currentTask.dataType == "contacts") {
         startContactsTransfer(m_currentTask);
     }
     else if (m_currentTask.dataType == "messages") {
@@ -401,331 +671,447 @@ void DataTransferManager::processNextTransferStep()
 }
 
 /**
- * Implementa transferencia entre dispositivos Android
+ * Prepara el destino para una tarea
  */
-bool DataTransferManager::transferAndroidToAndroid(TransferTask &task)
+bool DataTransferManager::prepareDestination(TransferTask &task)
 {
+    if (!m_sourceTransport || !m_destTransport) {
+        QMutexLocker locker(&m_transferMutex);
+        task.errorMessage = m_unsupportedRouteMessage;
+        return false;
+    }
+
     // Crear directorio en destino si es necesario (para archivos)
-    if (task.dataType == "photos" || task.dataType == "videos" ||
-        task.dataType == "music" || task.dataType == "documents") {
-
-        // Determinar directorio de destino
-        QString destBaseDir;
-        if (task.dataType == "photos" || task.dataType == "videos") {
-            destBaseDir = "/sdcard/MobileDataBridge/Media/";
-        } else if (task.dataType == "music") {
-            destBaseDir = "/sdcard/MobileDataBridge/Music/";
-        } else if (task.dataType == "documents") {
-            destBaseDir = "/sdcard/MobileDataBridge/Documents/";
-        } else {
-            destBaseDir = "/sdcard/MobileDataBridge/";
+    if (isFileType(task.dataType)) {
+
+        QString destBaseDir = destinationDirectoryFor(task.dataType);
+        QString error;
+        if (!m_destTransport->makeDirectory(destBaseDir, &error)) {
+            qWarning() << "Error creando directorio:" << destBaseDir << error;
+            task.errorMessage = "Fallo al crear directorio destino.";
+            return false;
         }
 
-        // Si usamos Bridge Client, podemos hacerlo directamente a través de él
-        if (task.useBridgeClient) {
-            // Bridge Client se encargará de crear directorios según sea necesario
-            return true;
-        } else {
-            // Método tradicional: usar ADB para crear directorio
-            QString adbPath = m_deviceManager->getAdbPath();
-            if (adbPath.isEmpty()) {
-                task.errorMessage = "Ruta ADB no encontrada.";
-                return false;
-            }
-
-            // Comando para crear directorio
-            QProcess mkdirProcess;
-            QStringList args;
-            args << "-s" << task.destId << "shell" << "mkdir" << "-p" << destBaseDir;
-
-            qDebug() << "Ejecutando mkdir:" << adbPath << args.join(" ");
-            mkdirProcess.start(adbPath, args);
-
-            if (!mkdirProcess.waitForFinished(3000)) {
-                qWarning() << "Timeout creando directorio:" << mkdirProcess.errorString();
-                task.errorMessage = "Timeout al crear directorio destino.";
-                return false;
-            }
-
-            if(mkdirProcess.exitCode() != 0) {
-                qWarning() << "Error creando directorio:" << mkdirProcess.readAllStandardError();
-                task.errorMessage = "Fallo al crear directorio destino.";
-                return false;
-            }
-
-            qDebug() << "Directorio destino asegurado:" << destBaseDir;
-            return true;
-        }
+        qDebug() << "Directorio destino asegurado:" << destBaseDir << "via" << m_destTransport->kind();
+        return true;
     } else if (task.dataType == "contacts" || task.dataType == "messages" || task.dataType == "calls") {
         // Estos tipos de datos no requieren directorio de destino previo
         return true;
     }
 
-    task.errorMessage = "Tipo '" + task.dataType + "' no implementado para Android->Android.";
+    task.errorMessage = "Tipo '" + task.dataType + "' no implementado para transferencia.";
     return false;
 }
 
 /**
- * Implementa transferencia de Android a iOS
+ * Crea los transportes de origen y destino
  */
-bool DataTransferManager::transferAndroidToIOS(TransferTask &task)
+void DataTransferManager::createTransports(const QString &sourceId, const QString &destId, bool preferBridge)
 {
-    task.errorMessage = "Transferencia Android->iOS aún no implementada completamente.";
-    return false;
+    releaseTransports();
+
+    // Se crean en el hilo de DeviceManager (sin padre) y se entregan al hilo del motor
+    m_sourceTransport = DeviceTransport::create(m_deviceManager, sourceId, preferBridge);
+    m_destTransport = DeviceTransport::create(m_deviceManager, destId, preferBridge);
+    if (m_sourceTransport) m_sourceTransport->moveToThread(thread());
+    if (m_destTransport) m_destTransport->moveToThread(thread());
+
+    auto platformName = [this](const QString &deviceId) {
+        QString type = m_deviceManager->getDeviceInfo(deviceId).type;
+        if (type == "android") return QString("Android");
+        if (type == "ios") return QString("iOS");
+        if (type == "local") return QString("Local");
+        return type;
+    };
+    m_unsupportedRouteMessage = QString("Transferencia %1->%2 aún no implementada completamente.")
+                                    .arg(platformName(sourceId), platformName(destId));
+
+    qDebug() << "Transportes:" << (m_sourceTransport ? m_sourceTransport->kind() : QString("ninguno"))
+             << "->" << (m_destTransport ? m_destTransport->kind() : QString("ninguno"));
 }
 
 /**
- * Implementa transferencia de iOS a Android
+ * Aborta la operación en curso y libera los transportes
  */
-bool DataTransferManager::transferIOSToAndroid(TransferTask &task)
+void DataTransferManager::releaseTransports()
 {
-    task.errorMessage = "Transferencia iOS->Android aún no implementada completamente.";
-    return false;
+    const QList<QPointer<TransportJob>> jobs = m_activeJobs;
+    m_activeJobs.clear();
+    for (const QPointer<TransportJob> &job : jobs) {
+        if (!job) continue;
+        disconnect(job, nullptr, this, nullptr); // Evitar reentrar en las continuaciones al abortar
+        job->abort();
+    }
+
+    QString error;
+    if (m_sourceTransport) {
+        m_sourceTransport->finalize(&error);
+        m_sourceTransport->deleteLater();
+        m_sourceTransport = nullptr;
+    }
+    if (m_destTransport) {
+        if (!m_destTransport->finalize(&error)) {
+            qWarning() << "Error al cerrar el destino" << m_destTransport->kind() << ":" << error;
+        }
+        m_destTransport->deleteLater();
+        m_destTransport = nullptr;
+    }
 }
 
 /**
- * Implementa transferencia entre dispositivos iOS
+ * Indica si un tipo de datos se transfiere como archivos
  */
-bool DataTransferManager::transferIOSToIOS(TransferTask &task)
+bool DataTransferManager::isFileType(const QString &dataType)
 {
-    task.errorMessage = "Transferencia iOS->iOS aún no implementada completamente.";
-    return false;
+    return dataType == "photos" || dataType == "videos" || dataType == "music" || dataType == "documents";
 }
 
 /**
- * Inicia la descarga de archivo usando ADB directo
+ * Directorio de destino según el tipo de datos
  */
-void DataTransferManager::startPhotoPull()
+QString DataTransferManager::destinationDirectoryFor(const QString &dataType)
+{
+    if (dataType == "photos" || dataType == "videos") {
+        return "/sdcard/MobileDataBridge/Media/";
+    } else if (dataType == "music") {
+        return "/sdcard/MobileDataBridge/Music/";
+    } else if (dataType == "documents") {
+        return "/sdcard/MobileDataBridge/Documents/";
+    }
+    return "/sdcard/MobileDataBridge/";
+}
+
+/**
+ * Lanza archivos de la tarea actual hasta llenar la tubería
+ */
+void DataTransferManager::fillFilePipeline()
 {
     QMutexLocker locker(&m_transferMutex);
 
     if (!m_isTransferring) return;
 
-    if (m_currentTask.currentItemIndex >= m_currentTask.itemsToTransfer.size()) {
-        locker.unlock();
-        finalizeCurrentTask(false, "Error interno: Índice fuera de límites (pull).");
-        return;
-    }
+    m_totalTransferSize += takeDiscoveredItems(m_currentTask);
 
-    const DataItem& currentItem = m_currentTask.itemsToTransfer[m_currentTask.currentItemIndex];
-    m_currentTask.currentItemName = currentItem.displayName;
+    QList<int> toStart;
+    bool skipped = false;
+    while (m_itemsInFlight + toStart.size() < m_itemLimit &&
+           m_currentTask.currentItemIndex + 1 < m_currentTask.itemsToTransfer.size()) {
+        const DataItem &item = m_currentTask.itemsToTransfer[m_currentTask.currentItemIndex + 1];
+        if (item.filePath.isEmpty()) {
+            // Saltar ítem sin ruta
+            m_currentTask.currentItemIndex++;
+            m_currentTask.processedItems++;
+            skipped = true;
+            continue;
+        }
+        // Dos elementos con el mismo nombre escriben la misma ruta de destino: conservar el orden
+        if (m_inFlightNames.contains(item.displayName)) break;
 
-    QString sourcePath = currentItem.filePath;
-    if (sourcePath.isEmpty()) {
-        // Saltar ítem sin ruta
-        m_currentTask.processedItems++;
-        emitTaskProgress();
-        locker.unlock();
-        QTimer::singleShot(0, this, &DataTransferManager::processNextTransferStep);
-        return;
-    }
+        // El destino ya lo tiene: cuenta como transferido sin enviarlo
+        if (existsAtDestination(m_currentTask, item)) {
+            m_currentTask.currentItemIndex++;
+            m_currentTask.processedItems++;
+            m_currentTask.processedSize += item.size;
+            m_currentTask.skippedExisting++;
+            skipped = true;
+            continue;
+        }
 
-    m_currentTask.tempFilePath = getTempPathForItem(currentItem.displayName);
+        // Copia exacta de otro archivo de la tarea: basta con enviar el original
+        if (item.data.contains("duplicateOf")) {
+            m_currentTask.currentItemIndex++;
+            m_currentTask.processedItems++;
+            m_currentTask.processedSize += item.size;
+            m_currentTask.skippedDuplicates++;
+            skipped = true;
+            continue;
+        }
 
-    QString adbPath = m_deviceManager->getAdbPath();
-    if (adbPath.isEmpty()) {
-        locker.unlock();
-        finalizeCurrentTask(false, "Error: Ruta ADB no encontrada (pull).");
-        return;
+        m_currentTask.currentItemIndex++;
+        m_inFlightNames.insert(item.displayName);
+        toStart.append(m_currentTask.currentItemIndex);
     }
+    m_itemsInFlight += toStart.size();
 
-    QStringList args;
-    args << "-s" << m_currentTask.sourceId << "pull" << sourcePath << m_currentTask.tempFilePath;
-
-    qDebug() << "Copiando archivo:" << sourcePath << "a" << m_currentTask.tempFilePath;
-    m_currentTask.status = "pulling";
+    bool exhausted = m_currentTask.currentItemIndex + 1 >= m_currentTask.itemsToTransfer.size();
+    bool discovering = exhausted && isDiscovering(m_currentTask);
+    if (discovering) m_waitingForItems = true; // Se reanuda con el siguiente bloque del análisis
+    bool taskDone = m_itemsInFlight == 0 && exhausted && !discovering;
+    QString analysisError = taskDone && m_currentTask.feed ? m_currentTask.feed->errorMessage() : QString();
 
     locker.unlock(); // Desbloquear antes de emitir señales
 
-    emitTaskProgress(); // Emitir progreso antes de iniciar
+    if (skipped) emitTaskProgress();
 
-    m_pullProcess.start(adbPath, args);
+    if (taskDone && !analysisError.isEmpty()) {
+        finalizeCurrentTask(false, "El análisis del origen falló: " + analysisError);
+        return;
+    }
+    if (taskDone) {
+        qDebug() << "Tarea completada (todos los ítems procesados):" << m_currentTask.dataType;
+        finalizeCurrentTask(true);
+        return;
+    }
+
+    // Ningún job termina dentro de su creación, así que lanzarlos aquí no reentra
+    for (int index : toStart) {
+        startItemPull(index);
+    }
 }
 
 /**
- * Maneja la finalización del proceso de pull
+ * Inicia la lectura de un archivo hacia el directorio temporal
  */
-void DataTransferManager::onPullProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
+void DataTransferManager::startItemPull(int index)
 {
     QMutexLocker locker(&m_transferMutex);
 
     if (!m_isTransferring) return;
 
-    if (exitCode != 0 || exitStatus != QProcess::NormalExit) {
-        QString errorMsg = QString("Fallo al copiar archivo (pull) '%1': %2 (%3)")
-        .arg(m_currentTask.currentItemName)
-            .arg(m_pullProcess.errorString())
-            .arg(QString(m_pullProcess.readAllStandardError()).trimmed());
+    const DataItem item = m_currentTask.itemsToTransfer[index];
+    m_currentTask.currentItemName = item.displayName;
+    m_currentTask.status = "pulling";
 
-        qWarning() << errorMsg;
-        m_currentTask.processedItems++;
-        emitTaskProgress();
+    // El índice evita que dos elementos en vuelo compartan archivo temporal
+    QString tempPath = getTempPathForItem(QString::number(index) + "_" + item.displayName);
+
+    bool ranged = m_rangedTransferThreshold > 0 && item.size >= m_rangedTransferThreshold
+                  && m_sourceTransport->supportsRangedReads();
+    qint64 rangeSize = m_rangeSize;
+
+    locker.unlock(); // Desbloquear antes de emitir señales
 
-        locker.unlock(); // Desbloquear antes de continuar
-        QTimer::singleShot(0, this, &DataTransferManager::processNextTransferStep); // Intentar siguiente ítem
+    qDebug() << "Copiando archivo:" << item.filePath << "a" << tempPath;
+    emitTaskProgress(); // Emitir progreso antes de iniciar
+
+    TransportJob *job = nullptr;
+    if (ranged) {
+        RangedTransferJob *rangedJob = new RangedTransferJob(m_sourceTransport, RangedTransferJob::Read,
+                                                             item.filePath, tempPath, rangeSize, this);
+        rangedJob->start();
+        job = rangedJob;
     } else {
-        qDebug() << "Pull exitoso para:" << m_currentTask.currentItemName;
-        locker.unlock();
-        startPhotoPush(); // Iniciar push
+        job = m_sourceTransport->readToFile(item.filePath, tempPath);
     }
+    trackJob(job, [this, index, tempPath](bool success, const QString &errorMessage) {
+        onItemPulled(index, tempPath, success, errorMessage);
+    });
 }
 
 /**
- * Inicia la subida de archivo usando ADB
+ * Continúa un archivo tras su lectura desde el origen
  */
-void DataTransferManager::startPhotoPush()
+void DataTransferManager::onItemPulled(int index, const QString &tempPath, bool success, const QString &errorMessage)
 {
-    QMutexLocker locker(&m_transferMutex);
-
-    if (!m_isTransferring) return;
-
-    if (m_currentTask.currentItemIndex >= m_currentTask.itemsToTransfer.size()) {
-        locker.unlock();
-        finalizeCurrentTask(false, "Error interno: Índice fuera de límites (push).");
+    if (!success) {
+        qWarning() << QString("Fallo al copiar archivo (pull) '%1': %2")
+                      .arg(m_currentTask.itemsToTransfer.value(index).displayName, errorMessage);
+        finishItem(index, false, tempPath);
         return;
     }
 
-    const DataItem& currentItem = m_currentTask.itemsToTransfer[m_currentTask.currentItemIndex];
-
-    if (m_currentTask.tempFilePath.isEmpty() || !QFile::exists(m_currentTask.tempFilePath)) {
-        qWarning() << "Archivo temporal no encontrado o vacío para push:"
-                   << m_currentTask.currentItemName << m_currentTask.tempFilePath;
-
-        m_currentTask.processedItems++;
-        emitTaskProgress();
+    startItemPush(index, tempPath); // Directamente, sin pasar por la cola de eventos
+}
 
-        locker.unlock();
-        QTimer::singleShot(0, this, &DataTransferManager::processNextTransferStep); // Saltar e intentar siguiente
-        return;
-    }
+/**
+ * Inicia la escritura del archivo temporal en el destino
+ */
+void DataTransferManager::startItemPush(int index, const QString &tempPath)
+{
+    QMutexLocker locker(&m_transferMutex);
 
-    // Determinar directorio de destino según tipo
-    QString destBaseDir;
-    if (m_currentTask.dataType == "photos" || m_currentTask.dataType == "videos") {
-        destBaseDir = "/sdcard/MobileDataBridge/Media/";
-    } else if (m_currentTask.dataType == "music") {
-        destBaseDir = "/sdcard/MobileDataBridge/Music/";
-    } else if (m_currentTask.dataType == "documents") {
-        destBaseDir = "/sdcard/MobileDataBridge/Documents/";
-    } else {
-        destBaseDir = "/sdcard/MobileDataBridge/";
-    }
+    if (!m_isTransferring) return;
 
-    QString destPath = destBaseDir + currentItem.displayName;
+    const DataItem item = m_currentTask.itemsToTransfer[index];
 
-    QString adbPath = m_deviceManager->getAdbPath();
-    if (adbPath.isEmpty()) {
-        if (!m_currentTask.tempFilePath.isEmpty()) {
-            QFile::remove(m_currentTask.tempFilePath);
-        }
+    if (tempPath.isEmpty() || !QFile::exists(tempPath)) {
+        qWarning() << "Archivo temporal no encontrado o vacío para push:" << item.displayName << tempPath;
         locker.unlock();
-        finalizeCurrentTask(false, "Error: Ruta ADB no encontrada (push).");
+        finishItem(index, false, QString());
         return;
     }
 
-    QStringList args;
-    args << "-s" << m_currentTask.destId << "push" << m_currentTask.tempFilePath << destPath;
-
-    qDebug() << "Pegando archivo:" << m_currentTask.tempFilePath << "a" << destPath;
+    QString destPath = destinationDirectoryFor(m_currentTask.dataType) + item.displayName;
     m_currentTask.status = "pushing";
+    bool tryDelta = m_deltaSyncEnabled && m_destTransport->supportsDelta();
+
+    locker.unlock(); // Desbloquear antes de iniciar la operación
 
-    locker.unlock(); // Desbloquear antes de iniciar proceso
+    qDebug() << "Pegando archivo:" << tempPath << "a" << destPath;
 
-    m_pushProcess.start(adbPath, args);
+    // Si el destino ya tiene una versión del archivo, enviar solo las diferencias
+    if (tryDelta && startDeltaPush(index, item, tempPath, destPath)) return;
+    startFullPush(index, tempPath, destPath);
 }
 
 /**
- * Maneja la finalización del proceso de push
+ * Escribe el archivo temporal completo en el destino (por rangos si es grande)
  */
-void DataTransferManager::onPushProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
+void DataTransferManager::startFullPush(int index, const QString &tempPath, const QString &destPath)
 {
     QMutexLocker locker(&m_transferMutex);
 
     if (!m_isTransferring) return;
 
-    QString tempFileToDelete = m_currentTask.tempFilePath; // Guardar para eliminar después
+    const DataItem item = m_currentTask.itemsToTransfer[index];
+    QString dataType = m_currentTask.dataType;
+    bool ranged = m_rangedTransferThreshold > 0 && item.size >= m_rangedTransferThreshold
+                  && m_destTransport->supportsRangedWrites();
+    qint64 rangeSize = m_rangeSize;
 
-    if (!tempFileToDelete.isEmpty()) {
-        QFile::remove(tempFileToDelete);
+    locker.unlock();
+
+    TransportJob *job = nullptr;
+    if (ranged) {
+        RangedTransferJob *rangedJob = new RangedTransferJob(m_destTransport, RangedTransferJob::Write,
+                                                             destPath, tempPath, rangeSize, this);
+        rangedJob->start();
+        job = rangedJob;
+    } else {
+        job = m_destTransport->writeItem(dataType, item, tempPath, destPath);
     }
+    trackPushJob(job, index, tempPath, item.displayName);
+}
 
-    if (m_currentTask.currentItemIndex >= m_currentTask.itemsToTransfer.size()) {
-        qWarning() << "Índice inválido en onPushProcessFinished.";
-        locker.unlock();
-        QTimer::singleShot(0, this, &DataTransferManager::processNextTransferStep);
-        return;
+/**
+ * Registra la escritura de un archivo y cierra el elemento al terminar
+ */
+void DataTransferManager::trackPushJob(TransportJob *job, int index, const QString &tempPath, const QString &displayName)
+{
+    trackJob(job, [this, index, tempPath, displayName](bool success, const QString &errorMessage) {
+        if (!success) {
+            qWarning() << QString("Fallo al pegar archivo (push) '%1': %2").arg(displayName, errorMessage);
+        }
+        finishItem(index, success, tempPath);
+    });
+}
+
+/**
+ * Intenta actualizar un archivo existente en el destino enviando solo un delta
+ *
+ * La firma del archivo del destino se pide de forma asíncrona (en el dispositivo
+ * implica leerlo entero) y queda registrada para poder cancelarla.
+ */
+bool DataTransferManager::startDeltaPush(int index, const DataItem &item, const QString &tempPath, const QString &destPath)
+{
+    qint64 localSize = QFileInfo(tempPath).size();
+    if (localSize < DELTA_MIN_SIZE) return false;
+
+    // Solo archivos que ya existen con la misma ruta pero distinto tamaño o fecha;
+    // con inventario, los que no estaban no necesitan consultar al destino
+    if (m_destInventory.complete && !m_destInventory.existingFiles.contains(destPath)) return false;
+    TransportEntry existing;
+    if (!m_destTransport->statPath(destPath, existing) || existing.isDirectory) return false;
+    // adb stat da segundos enteros y el origen milisegundos: se comparan al segundo
+    if (existing.size == localSize && existing.modified.isValid() && item.dateTime.isValid()
+        && existing.modified.toSecsSinceEpoch() == item.dateTime.toSecsSinceEpoch()) {
+        return false;
     }
 
-    const DataItem& currentItem = m_currentTask.itemsToTransfer[m_currentTask.currentItemIndex];
+    DeltaSignatureJob *signatureJob = m_destTransport->blockSignature(destPath, DeltaSync::blockSizeFor(qMax(localSize, existing.size)));
+    trackJob(signatureJob, [this, signatureJob, index, tempPath, destPath, localSize](bool success, const QString &errorMessage) {
+        onDeltaSignature(index, tempPath, destPath, localSize, signatureJob->signature(), success, errorMessage);
+    });
+    return true;
+}
 
-    if (exitCode != 0 || exitStatus != QProcess::NormalExit) {
-        QString errorMsg = QString("Fallo al pegar archivo (push) '%1': %2 (%3)")
-        .arg(m_currentTask.currentItemName)
-            .arg(m_pushProcess.errorString())
-            .arg(QString(m_pushProcess.readAllStandardError()).trimmed());
+/**
+ * Calcula el delta con la firma del destino y lo aplica, o recurre a la copia completa
+ */
+void DataTransferManager::onDeltaSignature(int index, const QString &tempPath, const QString &destPath, qint64 localSize,
+                                           const DeltaSignature &signature, bool success, const QString &errorMessage)
+{
+    QString displayName;
+    {
+        QMutexLocker locker(&m_transferMutex);
+        if (!m_isTransferring) return;
+        displayName = m_currentTask.itemsToTransfer[index].displayName;
+    }
 
-        qWarning() << errorMsg;
-    } else {
-        qDebug() << "Push exitoso para:" << m_currentTask.currentItemName;
-        m_currentTask.processedSize += currentItem.size;
+    if (!success) {
+        qWarning() << "Delta no disponible para" << destPath << ":" << errorMessage;
+        startFullPush(index, tempPath, destPath);
+        return;
     }
 
-    m_currentTask.processedItems++;
+    // La suma rodante recorre todo el archivo: fuera del hilo del motor, que sigue
+    // atendiendo los demás archivos en vuelo y la cancelación
+    DeltaComputeJob *deltaJob = new DeltaComputeJob(tempPath, signature, this);
+    trackJob(deltaJob, [this, deltaJob, index, tempPath, destPath, localSize, displayName](bool ok, const QString &error) {
+        onDeltaComputed(index, tempPath, destPath, localSize, displayName, deltaJob->ops(), ok, error);
+    });
+}
 
-    emitTaskProgress(); // Emitir progreso DESPUÉS del intento
-    emitOverallProgress();
+/**
+ * Aplica el delta calculado si compensa, o recurre a la copia completa
+ */
+void DataTransferManager::onDeltaComputed(int index, const QString &tempPath, const QString &destPath, qint64 localSize,
+                                          const QString &displayName, const QList<DeltaOp> &ops,
+                                          bool success, const QString &errorMessage)
+{
+    {
+        QMutexLocker locker(&m_transferMutex);
+        if (!m_isTransferring) return;
+    }
 
-    locker.unlock(); // Desbloquear antes de continuar
+    if (!success) {
+        qWarning() << "Delta no disponible para" << destPath << ":" << errorMessage;
+        startFullPush(index, tempPath, destPath);
+        return;
+    }
 
-    QTimer::singleShot(0, this, &DataTransferManager::processNextTransferStep);
+    qint64 literal = DeltaSync::literalBytes(ops);
+    if (literal > localSize * 3 / 4) {
+        qDebug() << "Delta poco útil para" << destPath << "(" << literal << "de" << localSize << "bytes), copia completa";
+        startFullPush(index, tempPath, destPath);
+        return;
+    }
+
+    qDebug() << "Delta para" << destPath << ":" << literal << "de" << localSize << "bytes a enviar en"
+             << ops.size() << "operaciones";
+    trackPushJob(m_destTransport->applyDelta(tempPath, destPath, ops), index, tempPath, displayName);
 }
 
 /**
- * Inicia la transferencia de un archivo usando Bridge Client
+ * Cierra un archivo en vuelo y lanza los siguientes
  */
-bool DataTransferManager::startPhotoPullViaBridge(const DataItem &item)
+void DataTransferManager::finishItem(int index, bool transferred, const QString &tempPath)
 {
     QMutexLocker locker(&m_transferMutex);
 
-    if (!m_isTransferring) return false;
-
-    // Verificar que Bridge Client está disponible en origen y destino
-    AdbSocketClient* sourceBridge = m_deviceManager->getBridgeClient(m_currentTask.sourceId);
-    AdbSocketClient* destBridge = m_deviceManager->getBridgeClient(m_currentTask.destId);
-
-    if (!sourceBridge || !sourceBridge->isConnected() || !destBridge || !destBridge->isConnected()) {
-        qWarning() << "Bridge Client no disponible en origen o destino para:" << item.displayName;
-        return false;
-    }
+    if (!m_isTransferring) return;
 
-    // Configurar Bridge Clients para la transferencia
-    if (!connectToBridgeClient(m_currentTask.sourceId, "source") ||
-        !connectToBridgeClient(m_currentTask.destId, "destination")) {
-        return false;
+    if (!tempPath.isEmpty()) {
+        QFile::remove(tempPath);
     }
 
-    // Preparar la información de archivo a transferir
-    QString fileInfo = QString("{\"path\":\"%1\",\"name\":\"%2\",\"size\":%3}")
-                           .arg(item.filePath)
-                           .arg(item.displayName)
-                           .arg(item.size);
-
-    // Solicitar el archivo del origen
-    bool success = sourceBridge->requestFile(item.filePath);
-    if (!success) {
-        qWarning() << "Error al solicitar archivo via Bridge Client:" << item.filePath;
-        disconnectBridgeClientSignals(m_currentTask.sourceId);
-        disconnectBridgeClientSignals(m_currentTask.destId);
-        return false;
+    const DataItem &item = m_currentTask.itemsToTransfer[index];
+    if (transferred) {
+        m_currentTask.processedSize += item.size;
     }
+    m_currentTask.processedItems++;
+    m_itemsInFlight--;
+    m_inFlightNames.remove(item.displayName);
 
-    m_currentTask.status = "transferring_via_bridge";
+    locker.unlock(); // Desbloquear antes de emitir y continuar
 
-    locker.unlock(); // Desbloquear antes de emitir señales
+    emitTaskProgress(); // Emitir progreso DESPUÉS del intento
+    emitOverallProgress();
 
-    emitTaskProgress();
+    fillFilePipeline();
+}
 
-    return true;
+/**
+ * Registra una operación en vuelo y su continuación
+ */
+void DataTransferManager::trackJob(TransportJob *job, std::function<void(bool, const QString &)> onFinished)
+{
+    m_activeJobs.append(job);
+    connect(job, &TransportJob::finished, job, &QObject::deleteLater);
+    connect(job, &TransportJob::finished, this, [this, job, onFinished](bool success, const QString &errorMessage) {
+        m_activeJobs.removeOne(job);
+        onFinished(success, errorMessage);
+    });
 }
 
 /**
@@ -754,7 +1140,10 @@ bool DataTransferManager::startContactsTransfer(TransferTask &task)
         if (m_currentTask.currentItemIndex < m_currentTask.itemsToTransfer.size()) {
             const DataItem& currentItem = m_currentTask.itemsToTransfer[m_currentTask.currentItemIndex];
 
-            // Procesar contacto (simulado)
+            // Procesar contacto (simulado salvo en destinos que guardan registros, como un respaldo)
+            if (m_destTransport && m_destTransport->supportsRecords()) {
+                m_destTransport->storeRecord(m_currentTask.dataType, currentItem);
+            }
             m_currentTask.processedItems++;
             m_currentTask.processedSize += currentItem.size;
 
@@ -764,7 +1153,7 @@ bool DataTransferManager::startContactsTransfer(TransferTask &task)
             emitOverallProgress();
 
             // Procesar el siguiente contacto
-            QTimer::singleShot(0, this, &DataTransferManager::processNextTransferStep);
+            scheduleStep(&DataTransferManager::processNextTransferStep);
         }
     });
 
@@ -796,7 +1185,10 @@ bool DataTransferManager::startMessagesTransfer(TransferTask &task)
         if (m_currentTask.currentItemIndex < m_currentTask.itemsToTransfer.size()) {
             const DataItem& currentItem = m_currentTask.itemsToTransfer[m_currentTask.currentItemIndex];
 
-            // Procesar mensaje (simulado)
+            // Procesar mensaje (simulado salvo en destinos que guardan registros, como un respaldo)
+            if (m_destTransport && m_destTransport->supportsRecords()) {
+                m_destTransport->storeRecord(m_currentTask.dataType, currentItem);
+            }
             m_currentTask.processedItems++;
             m_currentTask.processedSize += currentItem.size;
 
@@ -806,13 +1198,119 @@ bool DataTransferManager::startMessagesTransfer(TransferTask &task)
             emitOverallProgress();
 
             // Procesar el siguiente mensaje
-            QTimer::singleShot(0, this, &DataTransferManager::processNextTransferStep);
+            scheduleStep(&DataTransferManager::processNextTransferStep);
         }
     });
 
     return true;
 }
 
+/**
+ * Suma por volumen lo que falta por escribir y lo compara con el espacio libre del inventario
+ */
+bool DataTransferManager::checkDestinationCapacity(QString *errorMessage) const
+{
+    if (!m_destInventory.complete) return true; // Sin inventario no hay con qué comparar
+
+    QMap<QString, qint64> needed; // Volumen -> bytes a escribir
+    for (auto it = m_taskStates.constBegin(); it != m_taskStates.constEnd(); ++it) {
+        const TransferTask &task = it.value();
+        if (!isFileType(task.dataType)) continue;
+
+        QString volume = m_destInventory.volumeFor(destinationDirectoryFor(task.dataType));
+        if (volume.isEmpty()) continue;
+        for (const DataItem &item : task.itemsToTransfer) {
+            if (!existsAtDestination(task, item) && !item.data.contains("duplicateOf")) needed[volume] += item.size;
+        }
+    }
+
+    for (auto it = needed.constBegin(); it != needed.constEnd(); ++it) {
+        qint64 available = m_destInventory.freeSpace.value(it.key());
+        if (it.value() > available) {
+            if (errorMessage) {
+                *errorMessage = QString("Espacio insuficiente en el destino (%1): se necesitan %2 MB y hay %3 MB libres")
+                                    .arg(it.key())
+                                    .arg(it.value() / (1024 * 1024))
+                                    .arg(available / (1024 * 1024));
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Mismo destino, tamaño y fecha que un archivo del inventario
+ */
+bool DataTransferManager::existsAtDestination(const TransferTask &task, const DataItem &item) const
+{
+    if (task.clearDestination || !m_destInventory.complete || item.filePath.isEmpty()) return false;
+
+    // Solo tamaño y fecha exactos (al segundo): un archivo editado sin cambiar de tamaño, u
+    // otro distinto con el mismo nombre, sigue el camino normal (delta o copia completa)
+    auto it = m_destInventory.existingFiles.constFind(destinationDirectoryFor(task.dataType) + item.displayName);
+    return it != m_destInventory.existingFiles.constEnd() && it->size == item.size
+           && it->modified >= 0 && item.dateTime.isValid() && it->modified == item.dateTime.toSecsSinceEpoch();
+}
+
+/**
+ * Incorpora los elementos recién descubiertos y reanuda la tarea si los esperaba
+ */
+void DataTransferManager::onItemsDiscovered(const QString &dataType)
+{
+    QMutexLocker locker(&m_transferMutex);
+
+    if (!m_isTransferring) return;
+
+    bool current = m_currentTask.dataType == dataType;
+    if (!current && !m_taskStates.contains(dataType)) return;
+
+    // Las tareas en espera también acumulan, para que los totales crezcan desde el principio
+    TransferTask &task = current ? m_currentTask : m_taskStates[dataType];
+    qint64 added = takeDiscoveredItems(task);
+    m_totalTransferSize += added;
+
+    bool resume = current && m_waitingForItems;
+    if (resume) m_waitingForItems = false;
+    bool fileType = isFileType(dataType);
+
+    locker.unlock(); // Desbloquear antes de emitir señales y continuar
+
+    if (!resume) {
+        if (current && added > 0) emitTaskProgress();
+        return;
+    }
+
+    if (fileType) {
+        fillFilePipeline();
+    } else {
+        processNextTransferStep();
+    }
+}
+
+/**
+ * Pasa a la tarea los elementos que el análisis ha dejado en su cola
+ */
+qint64 DataTransferManager::takeDiscoveredItems(TransferTask &task)
+{
+    if (!task.feed) return 0;
+
+    const QList<DataItem> items = task.feed->takeAll();
+    qint64 added = 0;
+    for (const DataItem &item : items) {
+        added += item.size > 0 ? item.size : 1024; // Misma estimación que para los DataSets sin tamaño
+    }
+    task.itemsToTransfer.append(items);
+    task.totalItems += items.size();
+    task.totalSize += added;
+    return added;
+}
+
+bool DataTransferManager::isDiscovering(const TransferTask &task)
+{
+    return task.feed && !task.feed->isFinished();
+}
+
 /**
  * Finaliza la tarea actual
  */
@@ -824,11 +1322,20 @@ void DataTransferManager::finalizeCurrentTask(bool success, const QString& error
 
     if (m_currentTask.dataType.isEmpty()) {
         locker.unlock();
-        QTimer::singleShot(0, this, &DataTransferManager::startNextTransferTask);
+        scheduleStep(&DataTransferManager::startNextTransferTask);
         return;
     }
 
     qDebug() << "Finalizando tarea:" << m_currentTask.dataType << "Éxito:" << success;
+    if (m_currentTask.skippedExisting > 0) {
+        qDebug() << m_currentTask.skippedExisting << "archivos ya estaban en el destino y no se enviaron";
+    }
+    if (m_currentTask.skippedDuplicates > 0) {
+        qDebug() << m_currentTask.skippedDuplicates << "copias exactas de otros archivos no se enviaron";
+    }
+    if (m_currentTask.skippedMissing > 0) {
+        qWarning() << m_currentTask.skippedMissing << "registros se omitieron por haberse borrado en el origen";
+    }
 
     m_currentTask.status = success ? "completed" : "failed";
     m_currentTask.errorMessage = errorMsg;
@@ -837,28 +1344,87 @@ void DataTransferManager::finalizeCurrentTask(bool success, const QString& error
         m_taskStates[m_currentTask.dataType] = m_currentTask; // Actualizar estado almacenado
     }
 
-    // Desconectar Bridge Client si se usó
-    if (m_currentTask.useBridgeClient) {
-        disconnectBridgeClientSignals(m_currentTask.sourceId);
-        disconnectBridgeClientSignals(m_currentTask.destId);
-    }
-
+    TransferTask finishedTask = m_currentTask;
     if (success) {
-        emit transferTaskProgress(m_currentTask.dataType, 100,
-                                  m_currentTask.totalItems, m_currentTask.totalItems,
-                                  m_currentTask.totalSize, m_currentTask.totalSize, "");
-        emit transferTaskCompleted(m_currentTask.dataType, m_currentTask.processedItems);
         m_totalTransferredSizePreviousTasks += m_currentTask.totalSize; // Acumular tamaño total de la tarea exitosa
     } else {
-        emit transferTaskFailed(m_currentTask.dataType, errorMsg);
         m_totalTransferredSizePreviousTasks += m_currentTask.processedSize; // Acumular solo lo procesado de la tarea fallida
     }
 
+    locker.unlock(); // Desbloquear antes de emitir señales (getOverallProgress también bloquea)
+
+    if (success) {
+        emit transferTaskProgress(finishedTask.dataType, 100,
+                                  finishedTask.totalItems, finishedTask.totalItems,
+                                  finishedTask.totalSize, finishedTask.totalSize, "");
+        emit transferTaskCompleted(finishedTask.dataType, finishedTask.processedItems);
+    } else {
+        emit transferTaskFailed(finishedTask.dataType, errorMsg);
+    }
+
     emitOverallProgress();
 
-    locker.unlock(); // Desbloquear antes de continuar
+    scheduleStep(&DataTransferManager::startNextTransferTask); // Iniciar la siguiente tarea
+}
+
+/**
+ * Programa un paso del motor en su bucle de eventos y mide cuánto tarda en ejecutarse
+ */
+void DataTransferManager::scheduleStep(void (DataTransferManager::*step)())
+{
+    qint64 scheduledAt = m_latencyClock.nsecsElapsed();
+    QMetaObject::invokeMethod(this, [this, step, scheduledAt]() {
+        qint64 latencyUs = (m_latencyClock.nsecsElapsed() - scheduledAt) / 1000;
+        {
+            QMutexLocker locker(&m_transferMutex);
+            m_stepLatenciesUs.append(latencyUs);
+        }
+        (this->*step)();
+    }, Qt::QueuedConnection);
+}
 
-    QTimer::singleShot(0, this, &DataTransferManager::startNextTransferTask); // Iniciar la siguiente tarea
+/**
+ * Resume una lista de latencias en microsegundos
+ */
+DataTransferManager::SchedulingLatencyStats DataTransferManager::summarizeLatencies(const QVector<qint64> &latenciesUs)
+{
+    SchedulingLatencyStats stats;
+    stats.samples = latenciesUs.size();
+    stats.meanUs = 0;
+    stats.p95Us = 0;
+    stats.maxUs = 0;
+    if (latenciesUs.isEmpty()) return stats;
+
+    QVector<qint64> sorted = latenciesUs;
+    std::sort(sorted.begin(), sorted.end());
+    qint64 total = 0;
+    for (qint64 latency : sorted) total += latency;
+
+    stats.meanUs = total / sorted.size();
+    stats.p95Us = sorted[qMin(sorted.size() - 1, sorted.size() * 95 / 100)];
+    stats.maxUs = sorted.last();
+    return stats;
+}
+
+/**
+ * Obtiene estadísticas de latencia de planificación de la última transferencia
+ */
+DataTransferManager::SchedulingLatencyStats DataTransferManager::schedulingLatencyStats() const
+{
+    QMutexLocker locker(&m_transferMutex);
+    return summarizeLatencies(m_stepLatenciesUs);
+}
+
+/**
+ * Registra en el log la latencia de planificación (llamar con el mutex bloqueado)
+ */
+void DataTransferManager::logSchedulingLatency()
+{
+    SchedulingLatencyStats stats = summarizeLatencies(m_stepLatenciesUs);
+    if (stats.samples == 0) return;
+
+    qDebug() << "Latencia de planificación por paso (µs): pasos" << stats.samples
+             << "media" << stats.meanUs << "p95" << stats.p95Us << "máx" << stats.maxUs;
 }
 
 /**
@@ -954,178 +1520,3 @@ QString DataTransferManager::getTempPathForItem(const QString& itemName) const
 
     return m_tempDirOwner + QDir::separator() + safeName;
 }
-
-/**
- * Verifica si Bridge Client está disponible para transferencia
- */
-bool DataTransferManager::isBridgeClientAvailable(const QString &deviceId) const
-{
-    return m_deviceManager->isBridgeClientConnected(deviceId);
-}
-
-/**
- * Conecta con Bridge Client para transferencia
- */
-bool DataTransferManager::connectToBridgeClient(const QString &deviceId, const QString &role)
-{
-    AdbSocketClient* bridgeClient = m_deviceManager->getBridgeClient(deviceId);
-    if (!bridgeClient || !bridgeClient->isConnected()) {
-        return false;
-    }
-
-    // Configurar rol
-    if (!bridgeClient->setRole(role)) {
-        qWarning() << "Error al configurar rol" << role << "para Bridge Client en dispositivo" << deviceId;
-        return false;
-    }
-
-    // Conectar señales para transferencia
-    if (role == "source") {
-        // Para dispositivo origen
-        connect(bridgeClient, &AdbSocketClient::fileReady, this, &DataTransferManager::onBridgeClientFileReady);
-        connect(bridgeClient, &AdbSocketClient::fileTransferProgress, this, &DataTransferManager::onBridgeClientFileProgress);
-        connect(bridgeClient, &AdbSocketClient::errorOccurred, this, &DataTransferManager::onBridgeClientError);
-    } else if (role == "destination") {
-        // Para dispositivo destino
-        connect(bridgeClient, &AdbSocketClient::fileSaved, this, &DataTransferManager::onBridgeClientFileSaved);
-        connect(bridgeClient, &AdbSocketClient::errorOccurred, this, &DataTransferManager::onBridgeClientError);
-    }
-
-    return true;
-}
-
-/**
- * Desconecta señales de Bridge Client
- */
-void DataTransferManager::disconnectBridgeClientSignals(const QString &deviceId)
-{
-    AdbSocketClient* bridgeClient = m_deviceManager->getBridgeClient(deviceId);
-    if (bridgeClient) {
-        disconnect(bridgeClient, &AdbSocketClient::fileReady, this, &DataTransferManager::onBridgeClientFileReady);
-        disconnect(bridgeClient, &AdbSocketClient::fileSaved, this, &DataTransferManager::onBridgeClientFileSaved);
-        disconnect(bridgeClient, &AdbSocketClient::fileTransferProgress, this, &DataTransferManager::onBridgeClientFileProgress);
-        disconnect(bridgeClient, &AdbSocketClient::errorOccurred, this, &DataTransferManager::onBridgeClientError);
-    }
-}
-
-/**
- * Maneja eventos cuando un archivo está listo para transferir desde Bridge Client
- */
-void DataTransferManager::onBridgeClientFileReady(const QString &filePath)
-{
-    QMutexLocker locker(&m_transferMutex);
-
-    if (!m_isTransferring) return;
-
-    qDebug() << "Archivo listo desde Bridge Client:" << filePath;
-
-    // Verificar que Bridge Client destino está disponible
-    AdbSocketClient* destBridge = m_deviceManager->getBridgeClient(m_currentTask.destId);
-    if (!destBridge || !destBridge->isConnected()) {
-        qWarning() << "Bridge Client destino no disponible para guardar:" << filePath;
-
-        // Continuar con el siguiente ítem
-        m_currentTask.processedItems++;
-        locker.unlock();
-        emitTaskProgress();
-        QTimer::singleShot(0, this, &DataTransferManager::processNextTransferStep);
-        return;
-    }
-
-    // Calcular tamaño estimado del archivo para progreso
-    qint64 itemSize = 0;
-    if (m_currentTask.currentItemIndex < m_currentTask.itemsToTransfer.size()) {
-        itemSize = m_currentTask.itemsToTransfer[m_currentTask.currentItemIndex].size;
-    }
-
-    // Construir información del archivo a guardar
-    QString fileInfo = QString("{\"path\":\"%1\",\"name\":\"%2\",\"size\":%3}")
-                           .arg(filePath)
-                           .arg(m_currentTask.currentItemName)
-                           .arg(itemSize);
-
-    // Enviar comando para guardar en destino
-    destBridge->saveFile(fileInfo);
-}
-
-/**
- * Maneja eventos cuando un archivo ha sido guardado por Bridge Client
- */
-void DataTransferManager::onBridgeClientFileSaved(const QString &result)
-{
-    QMutexLocker locker(&m_transferMutex);
-
-    if (!m_isTransferring) return;
-
-    qDebug() << "Archivo guardado por Bridge Client, resultado:" << result;
-
-    // Actualizar progreso
-    if (m_currentTask.currentItemIndex < m_currentTask.itemsToTransfer.size()) {
-        if (result.startsWith("OK")) {
-            m_currentTask.processedSize += m_currentTask.itemsToTransfer[m_currentTask.currentItemIndex].size;
-        }
-        m_currentTask.processedItems++;
-    }
-
-    locker.unlock();
-
-    emitTaskProgress();
-    emitOverallProgress();
-
-    // Continuar con el siguiente ítem
-    QTimer::singleShot(0, this, &DataTransferManager::processNextTransferStep);
-}
-
-/**
- * Maneja eventos de progreso de transferencia desde Bridge Client
- */
-void DataTransferManager::onBridgeClientFileProgress(const QString &filePath, qint64 bytesReceived, qint64 totalBytes)
-{
-    QMutexLocker locker(&m_transferMutex);
-
-    if (!m_isTransferring) return;
-
-    qDebug() << "Progreso de transferencia Bridge Client:" << filePath
-             << bytesReceived << "/" << totalBytes;
-
-    // Actualizar progreso parcial para el ítem actual
-    if (m_currentTask.currentItemIndex < m_currentTask.itemsToTransfer.size()) {
-        // Calcular progreso proporcional para este ítem
-        double progress = totalBytes > 0 ? static_cast<double>(bytesReceived) / totalBytes : 0;
-        qint64 fullItemSize = m_currentTask.itemsToTransfer[m_currentTask.currentItemIndex].size;
-        qint64 currentProcessedSize = progress * fullItemSize;
-
-        // Solo actualizar tarea, no el contador de ítems todavía
-        m_currentTask.processedSize = currentProcessedSize;
-    }
-
-    locker.unlock();
-
-    // Reportar progreso
-    emitTaskProgress();
-    emitOverallProgress();
-}
-
-/**
- * Maneja errores de Bridge Client
- */
-void DataTransferManager::onBridgeClientError(const QString &errorMessage)
-{
-    QMutexLocker locker(&m_transferMutex);
-
-    if (!m_isTransferring) return;
-
-    qWarning() << "Error en Bridge Client durante transferencia:" << errorMessage;
-
-    // Actualizar contador e intentar siguiente ítem
-    if (m_currentTask.currentItemIndex < m_currentTask.itemsToTransfer.size()) {
-        m_currentTask.processedItems++;
-    }
-
-    locker.unlock();
-
-    emitTaskProgress();
-
-    // Continuar con el siguiente ítem
-    QTimer::singleShot(0, this, &DataTransferManager::processNextTransferStep);
-}
@@ -7,8 +7,18 @@
 #include <QQueue>
 #include <QMutex>
 #include <QElapsedTimer>
+#include <QPointer>
+#include <QVector>
+#include <QSet>
+#include <QSharedPointer>
+#include <functional>
 #include "devicemanager.h"
 #include "dataanalyzer.h"
+#include "devicetransport.h"
+#include "itemfeed.h"
+
+struct DeltaSignature;
+struct DeltaOp;
 
 // Estructura para seguimiento de tareas de transferencia
 struct TransferTask {
@@ -24,9 +34,13 @@ struct TransferTask {
     int currentItemIndex;
     QString currentItemName;
     QString status;
-    QString tempFilePath;
     QString errorMessage;
     bool useBridgeClient;  // Indica si debe usarse Bridge Client para esta tarea
+    QSharedPointer<ItemFeed> feed; // Elementos que el análisis aún descubre (nula si el DataSet estaba completo)
+    int skippedExisting;   // Archivos que el destino ya tenía (misma ruta y tamaño)
+    int skippedDuplicates; // Copias exactas de otro archivo (DataItem::data["duplicateOf"])
+    int skippedMissing;    // Registros borrados en el origen tras el análisis: no se escriben
+    QSet<QString> missingRecords; // IDs de esos registros
 };
 
 /**
@@ -34,8 +48,28 @@ struct TransferTask {
  * @brief Clase responsable de transferir datos entre dispositivos
  *
  * Esta clase maneja el proceso de transferencia de datos entre dispositivos,
- * gestionando diferentes tipos de datos (fotos, contactos, etc.) y adaptándose
- * a las capacidades disponibles (ADB directo o Bridge Client).
+ * gestionando diferentes tipos de datos (fotos, contactos, etc.). El movimiento de
+ * archivos se delega en un DeviceTransport por dispositivo (ADB directo, Bridge
+ * Client o directorio local), elegido al iniciar la transferencia.
+ *
+ * El objeto está pensado para vivir en un hilo propio (moveToThread): los pasos de la
+ * transferencia, los procesos y los callbacks de Bridge Client se atienden en ese bucle
+ * de eventos y las señales llegan encoladas a la interfaz. startTransfer() y sus
+ * variantes se llaman desde el hilo de DeviceManager/DataAnalyzer (el de la interfaz),
+ * ya que leen su estado; cancelTransfer() puede llamarse desde cualquier hilo.
+ *
+ * Los archivos de una tarea avanzan como una tubería: varios elementos están en vuelo a
+ * la vez (hasta maxConcurrentJobs() de los transportes) y la finalización de cada paso
+ * lanza directamente el siguiente, sin volver a pasar por la cola de eventos.
+ *
+ * Un tipo cuyo análisis sigue en curso no hace esperar a la transferencia: su tarea
+ * consume los elementos de una ItemFeed a medida que el analizador los publica, los
+ * totales crecen con cada bloque y la tarea solo termina cuando la cola está cerrada
+ * y vacía. Estas tareas se ponen al final, detrás de los tipos ya analizados.
+ *
+ * Antes del primer envío se consulta el inventario del destino (DataAnalyzer::
+ * analyzeDestination()): la transferencia no empieza si los archivos conocidos no
+ * caben en su volumen, y los que ya están en el destino con el mismo tamaño se omiten.
  */
 class DataTransferManager : public QObject
 {
@@ -57,6 +91,9 @@ public:
 
     /**
      * @brief Inicia una transferencia de datos entre dispositivos
+     *
+     * Los tipos que DataAnalyzer aún está analizando se aceptan aunque no tengan
+     * elementos todavía: se transfieren a medida que aparecen.
      * @param sourceId ID del dispositivo origen
      * @param destId ID del dispositivo destino
      * @param dataTypes Lista de tipos de datos a transferir
@@ -65,6 +102,37 @@ public:
      */
     bool startTransfer(const QString &sourceId, const QString &destId, const QStringList &dataTypes, bool clearDestination = false);
 
+    /**
+     * @brief Inicia una transferencia de los elementos seleccionados (ver DataAnalyzer::selectItems())
+     *
+     * Una selección se descarta si el DataSet cambió de tamaño desde que se hizo.
+     * @param destId ID del dispositivo destino
+     * @param selections Una selección por tipo de datos, todas del mismo dispositivo origen
+     * @param clearDestination Si es true, se borrarán datos existentes en destino
+     * @return true si la transferencia se inició correctamente
+     */
+    bool startTransfer(const QString &destId, const QList<ItemSelection> &selections, bool clearDestination = false);
+
+    /**
+     * @brief Respalda datos de un dispositivo en un archivo del PC
+     *
+     * Si el archivo ya es un respaldo válido, los elementos se añaden al final.
+     * @param sourceId ID del dispositivo origen
+     * @param archivePath Ruta del archivo de respaldo
+     * @param dataTypes Tipos de datos a respaldar
+     * @return true si la transferencia se inició correctamente
+     */
+    bool startBackupToArchive(const QString &sourceId, const QString &archivePath, const QStringList &dataTypes);
+
+    /**
+     * @brief Restaura datos de un archivo de respaldo en un dispositivo
+     * @param archivePath Ruta del archivo de respaldo
+     * @param destId ID del dispositivo destino
+     * @param dataTypes Tipos de datos a restaurar
+     * @return true si la transferencia se inició correctamente
+     */
+    bool startRestoreFromArchive(const QString &archivePath, const QString &destId, const QStringList &dataTypes);
+
     /**
      * @brief Cancela la transferencia en curso
      */
@@ -88,6 +156,62 @@ public:
      */
     QList<TransferTask> getActiveTasksInfo() const;
 
+    /**
+     * @brief Establece el tamaño a partir del cual un archivo se transfiere por rangos paralelos
+     * @param bytes Umbral en bytes (0 desactiva la transferencia por rangos)
+     */
+    void setRangedTransferThreshold(qint64 bytes);
+
+    /**
+     * @brief Obtiene el umbral de transferencia por rangos
+     */
+    qint64 rangedTransferThreshold() const;
+
+    /**
+     * @brief Establece el tamaño de cada rango en la transferencia por rangos
+     * @param bytes Tamaño del rango en bytes
+     */
+    void setRangeSize(qint64 bytes);
+
+    /**
+     * @brief Activa o desactiva la sincronización por deltas
+     *
+     * Si está activa y el destino ya tiene un archivo con la misma ruta pero distinto
+     * tamaño o fecha, solo se envían los bloques que cambiaron.
+     * @param enabled true para activar (valor por defecto)
+     */
+    void setDeltaSyncEnabled(bool enabled);
+
+    /**
+     * @brief Establece cuántos archivos pueden estar en vuelo a la vez
+     * @param maxItems Límite de elementos simultáneos (0 usa el de los transportes, que
+     *                 también acota cualquier otro valor)
+     */
+    void setMaxItemsInFlight(int maxItems);
+
+    // Estadísticas de latencia entre que un paso se programa y se ejecuta
+    struct SchedulingLatencyStats {
+        int samples;
+        qint64 meanUs;
+        qint64 p95Us;
+        qint64 maxUs;
+    };
+
+    /**
+     * @brief Latencia de planificación de los pasos de la última transferencia
+     *
+     * Mide el tiempo que cada paso espera en el bucle de eventos del motor; sirve para
+     * comprobar que diálogos o repintados de la interfaz no retrasan la transferencia.
+     */
+    SchedulingLatencyStats schedulingLatencyStats() const;
+
+    /**
+     * @brief Directorio de destino en el dispositivo para un tipo de datos
+     * @param dataType Tipo de datos
+     * @return Ruta del directorio (terminada en '/')
+     */
+    static QString destinationDirectoryFor(const QString &dataType);
+
 signals:
     /**
      * @brief Señal emitida cuando se inicia una transferencia
@@ -160,57 +284,60 @@ signals:
      */
     void transferFinished(bool success, const QString& message);
 
-private slots:
+private:
     /**
-     * @brief Maneja la finalización del proceso de pull (copia desde origen)
-     * @param exitCode Código de salida
-     * @param exitStatus Estado de salida
+     * @brief Prepara las tareas y arranca la transferencia
+     * @param selections Selecciones por tipo de datos; los tipos sin selección se transfieren enteros
      */
-    void onPullProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    bool beginTransfer(const QString &sourceId, const QString &destId, const QStringList &dataTypes,
+                       bool clearDestination, const QMap<QString, ItemSelection> &selections);
 
     /**
-     * @brief Maneja la finalización del proceso de push (copia a destino)
-     * @param exitCode Código de salida
-     * @param exitStatus Estado de salida
+     * @brief Inicia la siguiente tarea de transferencia
      */
-    void onPushProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void startNextTransferTask();
 
     /**
-     * @brief Maneja eventos cuando un archivo está listo para transferir desde Bridge Client
-     * @param filePath Ruta del archivo
+     * @brief Procesa el siguiente registro (contactos, mensajes) de la tarea actual
      */
-    void onBridgeClientFileReady(const QString &filePath);
+    void processNextTransferStep();
 
     /**
-     * @brief Maneja eventos cuando un archivo ha sido guardado por Bridge Client
-     * @param result Resultado de la operación
+     * @brief Lanza archivos de la tarea actual hasta llenar los huecos libres de la tubería
+     *
+     * Finaliza la tarea cuando no quedan archivos pendientes ni en vuelo.
      */
-    void onBridgeClientFileSaved(const QString &result);
+    void fillFilePipeline();
 
     /**
-     * @brief Maneja eventos de progreso de transferencia desde Bridge Client
-     * @param filePath Ruta del archivo
-     * @param bytesReceived Bytes recibidos
-     * @param totalBytes Bytes totales
+     * @brief Comprueba con el inventario del destino que los archivos conocidos caben
+     * @param errorMessage Mensaje de error de salida
+     * @return false si algún volumen no tiene espacio suficiente
      */
-    void onBridgeClientFileProgress(const QString &filePath, qint64 bytesReceived, qint64 totalBytes);
+    bool checkDestinationCapacity(QString *errorMessage) const;
 
     /**
-     * @brief Maneja errores de Bridge Client
-     * @param errorMessage Mensaje de error
+     * @brief Indica si el destino ya tiene un archivo idéntico (según el inventario)
      */
-    void onBridgeClientError(const QString &errorMessage);
+    bool existsAtDestination(const TransferTask &task, const DataItem &item) const;
 
-private:
     /**
-     * @brief Inicia la siguiente tarea de transferencia
+     * @brief Incorpora los elementos que el análisis ha publicado para un tipo
+     *
+     * Si la tarea actual esperaba elementos nuevos, la reanuda.
      */
-    void startNextTransferTask();
+    void onItemsDiscovered(const QString &dataType);
 
     /**
-     * @brief Procesa el siguiente paso de transferencia
+     * @brief Pasa a la tarea los elementos pendientes de su cola (con el mutex bloqueado)
+     * @return Bytes añadidos al total estimado
      */
-    void processNextTransferStep();
+    qint64 takeDiscoveredItems(TransferTask &task);
+
+    /**
+     * @brief Indica si el análisis de la tarea puede aportar aún más elementos
+     */
+    static bool isDiscovering(const TransferTask &task);
 
     /**
      * @brief Finaliza la tarea actual
@@ -230,49 +357,138 @@ private:
     void emitTaskProgress();
 
     /**
-     * @brief Implementa transferencia entre dispositivos Android
+     * @brief Prepara el destino para una tarea (transportes disponibles y directorio creado)
      * @param task Tarea de transferencia
-     * @return true si se inició correctamente
+     * @return true si la tarea puede comenzar
      */
-    bool transferAndroidToAndroid(TransferTask &task);
+    bool prepareDestination(TransferTask &task);
 
     /**
-     * @brief Implementa transferencia de Android a iOS
-     * @param task Tarea de transferencia
-     * @return true si se inició correctamente
+     * @brief Crea los transportes de origen y destino
+     * @param sourceId ID del dispositivo origen
+     * @param destId ID del dispositivo destino
+     * @param preferBridge Si se debe usar Bridge Client cuando esté conectado
      */
-    bool transferAndroidToIOS(TransferTask &task);
+    void createTransports(const QString &sourceId, const QString &destId, bool preferBridge);
 
     /**
-     * @brief Implementa transferencia de iOS a Android
-     * @param task Tarea de transferencia
-     * @return true si se inició correctamente
+     * @brief Aborta la operación en curso y libera los transportes
      */
-    bool transferIOSToAndroid(TransferTask &task);
+    void releaseTransports();
 
     /**
-     * @brief Implementa transferencia entre dispositivos iOS
-     * @param task Tarea de transferencia
-     * @return true si se inició correctamente
+     * @brief Indica si un tipo de datos se transfiere como archivos (fotos, vídeos, música, documentos)
      */
-    bool transferIOSToIOS(TransferTask &task);
+    static bool isFileType(const QString &dataType);
 
     /**
-     * @brief Inicia la descarga de foto usando ADB directo
+     * @brief Inicia la lectura de un archivo desde el transporte de origen
+     * @param index Índice del elemento en la tarea actual
      */
-    void startPhotoPull();
+    void startItemPull(int index);
 
     /**
-     * @brief Inicia la subida de foto usando ADB directo
+     * @brief Continúa un archivo tras su lectura: lo escribe en el destino o lo da por fallido
+     * @param index Índice del elemento
+     * @param tempPath Archivo temporal
+     * @param success true si la lectura fue exitosa
+     * @param errorMessage Mensaje de error de la lectura
      */
-    void startPhotoPush();
+    void onItemPulled(int index, const QString &tempPath, bool success, const QString &errorMessage);
 
     /**
-     * @brief Inicia la transferencia de una foto usando Bridge Client
-     * @param item Elemento a transferir
-     * @return true si se inició correctamente
+     * @brief Inicia la escritura de un archivo ya leído en el transporte de destino
+     * @param index Índice del elemento
+     * @param tempPath Archivo temporal con su contenido
+     */
+    void startItemPush(int index, const QString &tempPath);
+
+    /**
+     * @brief Cuenta el registro actual como omitido por haberse borrado en el origen
+     */
+    void skipMissingRecord();
+
+    /**
+     * @brief Cierra un archivo en vuelo, actualiza el progreso y lanza los siguientes
+     * @param index Índice del elemento
+     * @param transferred true si el archivo llegó al destino
+     * @param tempPath Archivo temporal a eliminar (puede estar vacío)
      */
-    bool startPhotoPullViaBridge(const DataItem &item);
+    void finishItem(int index, bool transferred, const QString &tempPath);
+
+    /**
+     * @brief Registra una operación en vuelo para poder abortarla al cancelar
+     * @param job Operación
+     * @param onFinished Continuación a ejecutar cuando termine
+     */
+    void trackJob(TransportJob *job, std::function<void(bool, const QString &)> onFinished);
+
+    /**
+     * @brief Escribe el archivo temporal completo en el destino
+     * @param index Índice del elemento
+     * @param tempPath Archivo temporal con su contenido
+     * @param destPath Ruta de destino
+     */
+    void startFullPush(int index, const QString &tempPath, const QString &destPath);
+
+    /**
+     * @brief Registra la escritura de un archivo; al terminar cierra el elemento
+     * @param job Operación de escritura
+     * @param index Índice del elemento
+     * @param tempPath Archivo temporal a eliminar
+     * @param displayName Nombre del elemento para los mensajes
+     */
+    void trackPushJob(TransportJob *job, int index, const QString &tempPath, const QString &displayName);
+
+    /**
+     * @brief Intenta escribir el archivo actual como delta sobre la versión del destino
+     * @param index Índice del elemento
+     * @param item Elemento a escribir
+     * @param tempPath Archivo temporal con el contenido nuevo
+     * @param destPath Ruta de destino
+     * @return true si se pidió la firma del destino (el resto sigue en onDeltaSignature()),
+     *         false si se debe hacer una copia completa
+     */
+    bool startDeltaPush(int index, const DataItem &item, const QString &tempPath, const QString &destPath);
+
+    /**
+     * @brief Continúa un delta cuando llega la firma del destino
+     * @param index Índice del elemento
+     * @param tempPath Archivo temporal con el contenido nuevo
+     * @param destPath Ruta de destino
+     * @param localSize Tamaño del archivo nuevo
+     * @param signature Firma del archivo del destino
+     * @param success true si se obtuvo la firma
+     * @param errorMessage Mensaje de error de la firma
+     */
+    void onDeltaSignature(int index, const QString &tempPath, const QString &destPath, qint64 localSize,
+                          const DeltaSignature &signature, bool success, const QString &errorMessage);
+
+    /**
+     * @brief Continúa un delta cuando DeltaComputeJob termina de calcular las operaciones
+     * @param ops Operaciones calculadas
+     * @param success true si se pudo leer el archivo nuevo
+     * @param errorMessage Mensaje de error del cálculo
+     */
+    void onDeltaComputed(int index, const QString &tempPath, const QString &destPath, qint64 localSize,
+                         const QString &displayName, const QList<DeltaOp> &ops,
+                         bool success, const QString &errorMessage);
+
+    /**
+     * @brief Programa un paso en el bucle de eventos del motor registrando su latencia
+     * @param step Paso a ejecutar
+     */
+    void scheduleStep(void (DataTransferManager::*step)());
+
+    /**
+     * @brief Resume una lista de latencias
+     */
+    static SchedulingLatencyStats summarizeLatencies(const QVector<qint64> &latenciesUs);
+
+    /**
+     * @brief Escribe en el log el resumen de latencias (con el mutex bloqueado)
+     */
+    void logSchedulingLatency();
 
     /**
      * @brief Implementa transferencia de contactos
@@ -288,6 +504,19 @@ private:
      */
     bool startMessagesTransfer(TransferTask &task);
 
+    /**
+     * @brief Procesa el registro actual según el tipo de la tarea
+     */
+    void startRecordStep();
+
+    /**
+     * @brief Pide al origen los registros completos de la página que empieza en el actual
+     *
+     * Sustituye en itemsToTransfer los registros parciales del análisis ligero (hasta
+     * RECORD_PAGE) y continúa con startRecordStep().
+     */
+    void fetchRecordPage();
+
     /**
      * @brief Prepara un directorio temporal para la transferencia
      * @return true si se creó correctamente
@@ -307,27 +536,6 @@ private:
      */
     QString getTempPathForItem(const QString& itemName) const;
 
-    /**
-     * @brief Verifica si Bridge Client está disponible para transferencia
-     * @param deviceId ID del dispositivo
-     * @return true si está disponible
-     */
-    bool isBridgeClientAvailable(const QString &deviceId) const;
-
-    /**
-     * @brief Conecta con Bridge Client para transferencia
-     * @param deviceId ID del dispositivo
-     * @param role Rol ("source" o "destination")
-     * @return true si se conectó correctamente
-     */
-    bool connectToBridgeClient(const QString &deviceId, const QString &role);
-
-    /**
-     * @brief Desconecta señales de Bridge Client
-     * @param deviceId ID del dispositivo
-     */
-    void disconnectBridgeClientSignals(const QString &deviceId);
-
     // Variables miembro
     DeviceManager *m_deviceManager;
     DataAnalyzer *m_dataAnalyzer;
@@ -335,13 +543,30 @@ private:
     QQueue<QString> m_dataTypeQueue;
     QMap<QString, TransferTask> m_taskStates;
     TransferTask m_currentTask;
-    QProcess m_pullProcess;
-    QProcess m_pushProcess;
+    DeviceTransport *m_sourceTransport;
+    DeviceTransport *m_destTransport;
+    QList<QPointer<TransportJob>> m_activeJobs;
+    int m_maxItemsInFlight;
+    int m_itemLimit;
+    int m_itemsInFlight;
+    bool m_waitingForItems;               // La tarea actual agotó sus elementos y espera al análisis
+    QSet<QString> m_inFlightNames;
     QString m_tempDirOwner;
     qint64 m_totalTransferSize;
     qint64 m_totalTransferredSizePreviousTasks;
-    QMutex m_transferMutex;
+    mutable QMutex m_transferMutex;
     QElapsedTimer m_transferTimer;
+    qint64 m_rangedTransferThreshold;
+    qint64 m_rangeSize;
+    bool m_deltaSyncEnabled;
+    QString m_unsupportedRouteMessage;
+    DestinationInventory m_destInventory;  // Inventario del destino al iniciar la transferencia
+    QElapsedTimer m_latencyClock;
+    QVector<qint64> m_stepLatenciesUs;
+
+    static constexpr qint64 DELTA_MIN_SIZE = 1024 * 1024; // Por debajo, la copia completa es más barata
+    static constexpr int RECORD_PAGE = 500;               // Registros completos por petición al origen
+    static constexpr qint64 INVENTORY_MAX_AGE_MS = 2 * 60 * 1000; // Más viejo, el inventario no decide qué se omite
 };
 
 #endif // DATATRANSFERMANAGER_H
@@ -0,0 +1,448 @@
+#include "deltasync.h"
+#include <QDebug>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThreadPool>
+#include <QTimer>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MDB_HAVE_SSE2 1
+#endif
+
+/**
+ * Suma débil estilo rsync: a = suma de bytes, b = suma de (n - i) * x_i (ambas mod 2^16)
+ */
+quint32 DeltaSync::weakChecksum(const uchar *data, qint64 length)
+{
+    quint32 a = 0;
+    quint32 b = 0;
+    qint64 i = 0;
+
+#ifdef MDB_HAVE_SSE2
+    // 16 bytes por iteración: _mm_sad_epu8 da la suma de bytes y _mm_madd_epi16 la suma
+    // ponderada (16 - j) * x_j del trozo; el resto de peso es (n - i - 16) * suma
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i weightsLo = _mm_setr_epi16(16, 15, 14, 13, 12, 11, 10, 9);
+    const __m128i weightsHi = _mm_setr_epi16(8, 7, 6, 5, 4, 3, 2, 1);
+    for (; i + 16 <= length; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+
+        __m128i sad = _mm_sad_epu8(bytes, zero);
+        quint32 sum = static_cast<quint32>(_mm_cvtsi128_si32(sad) + _mm_cvtsi128_si32(_mm_srli_si128(sad, 8)));
+
+        __m128i weighted = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi8(bytes, zero), weightsLo),
+                                         _mm_madd_epi16(_mm_unpackhi_epi8(bytes, zero), weightsHi));
+        weighted = _mm_add_epi32(weighted, _mm_srli_si128(weighted, 8));
+        weighted = _mm_add_epi32(weighted, _mm_srli_si128(weighted, 4));
+
+        a += sum;
+        b += static_cast<quint32>(length - i - 16) * sum + static_cast<quint32>(_mm_cvtsi128_si32(weighted));
+    }
+#endif
+
+    for (; i < length; ++i) {
+        a += data[i];
+        b += static_cast<quint32>(length - i) * data[i];
+    }
+    return (a & 0xffff) | ((b & 0xffff) << 16);
+}
+
+quint32 DeltaSync::rollWeakChecksum(quint32 checksum, uchar outByte, uchar inByte, qint64 blockSize)
+{
+    quint32 a = checksum & 0xffff;
+    quint32 b = checksum >> 16;
+    a = (a - outByte + inByte) & 0xffff;
+    b = (b - static_cast<quint32>(blockSize) * outByte + a) & 0xffff;
+    return a | (b << 16);
+}
+
+qint64 DeltaSync::blockSizeFor(qint64 fileSize)
+{
+    // Como máximo ~2048 bloques: la firma calculada en el dispositivo lanza un dd por bloque
+    qint64 blockSize = 16 * 1024;
+    while (blockSize < 8 * 1024 * 1024 && fileSize / blockSize > 2048) {
+        blockSize *= 2;
+    }
+    return blockSize;
+}
+
+/**
+ * Firma completa de un archivo local
+ */
+bool DeltaSync::computeSignature(const QString &filePath, qint64 blockSize,
+                                 DeltaSignature &signature, QString *errorMessage)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorMessage) *errorMessage = QString("No se pudo abrir %1: %2").arg(filePath, file.errorString());
+        return false;
+    }
+
+    signature.blockSize = blockSize;
+    signature.fileSize = file.size();
+    signature.hasWeak = true;
+    signature.blocks.clear();
+    signature.blocks.reserve(static_cast<int>((signature.fileSize + blockSize - 1) / blockSize));
+
+    while (!file.atEnd()) {
+        QByteArray block = file.read(blockSize);
+        if (block.isEmpty()) break;
+
+        DeltaBlockSignature blockSignature;
+        blockSignature.weak = weakChecksum(reinterpret_cast<const uchar *>(block.constData()), block.size());
+        blockSignature.strong = QCryptographicHash::hash(block, QCryptographicHash::Md5);
+        signature.blocks.append(blockSignature);
+    }
+    return true;
+}
+
+namespace {
+
+/**
+ * Añade una operación, fusionándola con la anterior si es contigua
+ */
+void appendOp(QList<DeltaOp> &ops, DeltaOp::Type type, qint64 offset, qint64 length, qint64 basisOffset = 0)
+{
+    if (length <= 0) return;
+
+    if (!ops.isEmpty()) {
+        DeltaOp &last = ops.last();
+        bool contiguous = last.type == type && last.offset + last.length == offset
+                          && (type == DeltaOp::Literal || last.basisOffset + last.length == basisOffset);
+        if (contiguous) {
+            last.length += length;
+            return;
+        }
+    }
+
+    DeltaOp op;
+    op.type = type;
+    op.offset = offset;
+    op.length = length;
+    op.basisOffset = basisOffset;
+    ops.append(op);
+}
+
+QByteArray strongChecksum(const uchar *data, qint64 length)
+{
+    return QCryptographicHash::hash(QByteArray::fromRawData(reinterpret_cast<const char *>(data), static_cast<int>(length)),
+                                    QCryptographicHash::Md5);
+}
+
+} // namespace
+
+/**
+ * Recorre el archivo nuevo buscando bloques del base
+ */
+bool DeltaSync::computeDelta(const QString &filePath, const DeltaSignature &signature,
+                             QList<DeltaOp> &ops, QString *errorMessage)
+{
+    ops.clear();
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorMessage) *errorMessage = QString("No se pudo abrir %1: %2").arg(filePath, file.errorString());
+        return false;
+    }
+
+    const qint64 size = file.size();
+    const qint64 blockSize = signature.blockSize;
+    if (size == 0) return true;
+    if (blockSize <= 0) {
+        appendOp(ops, DeltaOp::Literal, 0, size);
+        return true;
+    }
+
+    const uchar *data = file.map(0, size);
+    if (!data) {
+        if (errorMessage) *errorMessage = QString("No se pudo mapear %1: %2").arg(filePath, file.errorString());
+        return false;
+    }
+
+    if (!signature.hasWeak) {
+        // Solo MD5 por bloque: comparar bloque a bloque en la misma posición
+        for (qint64 offset = 0, index = 0; offset < size; offset += blockSize, ++index) {
+            qint64 length = qMin(blockSize, size - offset);
+            qint64 basisLength = index < signature.blocks.size() ? qMin(blockSize, signature.fileSize - offset) : -1;
+            if (basisLength == length && strongChecksum(data + offset, length) == signature.blocks[index].strong) {
+                appendOp(ops, DeltaOp::CopyBlock, offset, length, offset);
+            } else {
+                appendOp(ops, DeltaOp::Literal, offset, length);
+            }
+        }
+        file.unmap(const_cast<uchar *>(data));
+        return true;
+    }
+
+    // Índice de bloques completos por suma débil, con tabla de 16 bits para descartar rápido
+    QHash<quint32, QVector<int>> blocksByWeak;
+    QByteArray tagTable(65536, 0);
+    for (int i = 0; i < signature.blocks.size(); ++i) {
+        if (qMin(blockSize, signature.fileSize - i * blockSize) != blockSize) continue;
+        quint32 weak = signature.blocks[i].weak;
+        blocksByWeak[weak].append(i);
+        tagTable[static_cast<int>((weak ^ (weak >> 16)) & 0xffff)] = 1;
+    }
+
+    qint64 offset = 0;
+    qint64 literalStart = 0;
+    bool haveWeak = false;
+    quint32 weak = 0;
+
+    while (offset + blockSize <= size) {
+        if (!haveWeak) {
+            weak = weakChecksum(data + offset, blockSize);
+            haveWeak = true;
+        }
+
+        int matched = -1;
+        if (tagTable.at(static_cast<int>((weak ^ (weak >> 16)) & 0xffff))) {
+            auto it = blocksByWeak.constFind(weak);
+            if (it != blocksByWeak.constEnd()) {
+                QByteArray strong = strongChecksum(data + offset, blockSize);
+                for (int index : it.value()) {
+                    if (signature.blocks[index].strong != strong) continue;
+                    // Preferir el bloque que ya está en la misma posición
+                    if (matched < 0 || index * blockSize == offset) matched = index;
+                    if (index * blockSize == offset) break;
+                }
+            }
+        }
+
+        if (matched >= 0) {
+            appendOp(ops, DeltaOp::Literal, literalStart, offset - literalStart);
+            appendOp(ops, DeltaOp::CopyBlock, offset, blockSize, matched * blockSize);
+            offset += blockSize;
+            literalStart = offset;
+            haveWeak = false;
+        } else {
+            if (offset + blockSize < size) {
+                weak = rollWeakChecksum(weak, data[offset], data[offset + blockSize], blockSize);
+            }
+            offset++;
+        }
+    }
+
+    // El último bloque del base puede ser más corto: comprobar si coincide con el final
+    qint64 tailLength = signature.fileSize % blockSize;
+    if (tailLength > 0 && size - literalStart >= tailLength
+        && strongChecksum(data + size - tailLength, tailLength) == signature.blocks.last().strong) {
+        appendOp(ops, DeltaOp::Literal, literalStart, size - tailLength - literalStart);
+        appendOp(ops, DeltaOp::CopyBlock, size - tailLength, tailLength, signature.fileSize - tailLength);
+    } else {
+        appendOp(ops, DeltaOp::Literal, literalStart, size - literalStart);
+    }
+
+    file.unmap(const_cast<uchar *>(data));
+    return true;
+}
+
+qint64 DeltaSync::literalBytes(const QList<DeltaOp> &ops)
+{
+    qint64 total = 0;
+    for (const DeltaOp &op : ops) {
+        if (op.type == DeltaOp::Literal) total += op.length;
+    }
+    return total;
+}
+
+/**
+ * Constructor de DeltaSignatureJob
+ */
+DeltaSignatureJob::DeltaSignatureJob(QObject *parent)
+    : TransportJob(parent)
+{
+    m_signature.blockSize = 0;
+    m_signature.fileSize = 0;
+    m_signature.hasWeak = false;
+}
+
+DeltaSignature DeltaSignatureJob::signature() const
+{
+    return m_signature;
+}
+
+void DeltaSignatureJob::setSignature(const DeltaSignature &signature)
+{
+    m_signature = signature;
+}
+
+// El job se destruye en su hilo; el cálculo solo lo usa con mutex y si sigue vivo
+struct DeltaComputeJob::Link {
+    QMutex mutex;
+    DeltaComputeJob *job = nullptr;
+};
+
+/**
+ * Constructor de DeltaComputeJob
+ */
+DeltaComputeJob::DeltaComputeJob(const QString &filePath, const DeltaSignature &signature, QObject *parent)
+    : TransportJob(parent)
+    , m_link(new Link)
+{
+    m_link->job = this;
+    QSharedPointer<Link> link = m_link;
+    QThreadPool::globalInstance()->start([link, filePath, signature]() {
+        QList<DeltaOp> ops;
+        QString error;
+        bool ok = DeltaSync::computeDelta(filePath, signature, ops, &error);
+
+        // Con el mutex tomado el job no puede destruirse antes de encolar el resultado;
+        // si se destruye después, Qt descarta el evento pendiente
+        QMutexLocker locker(&link->mutex);
+        DeltaComputeJob *job = link->job;
+        if (!job) return;
+        QMetaObject::invokeMethod(job, [job, ok, ops, error]() {
+            if (job->isFinished()) return; // Abortado mientras se calculaba
+            job->m_ops = ops;
+            job->complete(ok, error);
+        }, Qt::QueuedConnection);
+    });
+}
+
+DeltaComputeJob::~DeltaComputeJob()
+{
+    QMutexLocker locker(&m_link->mutex);
+    m_link->job = nullptr;
+}
+
+QList<DeltaOp> DeltaComputeJob::ops() const
+{
+    return m_ops;
+}
+
+/**
+ * Constructor de DeltaApplyJob
+ */
+DeltaApplyJob::DeltaApplyJob(const QString &basisPath, const QString &sourcePath,
+                             const QList<DeltaOp> &ops, QObject *parent)
+    : TransportJob(parent)
+    , m_basis(basisPath)
+    , m_source(sourcePath)
+    , m_output(basisPath + ".mdbpart")
+    , m_destPath(basisPath)
+    , m_ops(ops)
+    , m_opIndex(0)
+    , m_opDone(0)
+    , m_written(0)
+    , m_total(0)
+    , m_verified(0)
+    , m_outputHash(QCryptographicHash::Md5)
+    , m_sourceHash(QCryptographicHash::Md5)
+{
+    for (const DeltaOp &op : ops) {
+        m_total += op.length;
+    }
+}
+
+void DeltaApplyJob::start()
+{
+    if (!m_basis.open(QIODevice::ReadOnly) || !m_source.open(QIODevice::ReadOnly)
+        || !m_output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        QString error = QString("No se pudo preparar el delta de %1").arg(m_destPath);
+        QTimer::singleShot(0, this, [this, error]() { fail(error); });
+        return;
+    }
+    QTimer::singleShot(0, this, &DeltaApplyJob::processNextBlock);
+}
+
+void DeltaApplyJob::abort()
+{
+    fail("Operación cancelada");
+}
+
+/**
+ * Descarta el archivo parcial; el destino original queda intacto
+ */
+void DeltaApplyJob::fail(const QString &errorMessage)
+{
+    if (isFinished()) return;
+
+    m_basis.close();
+    m_source.close();
+    if (m_output.isOpen()) m_output.close();
+    m_output.remove();
+    complete(false, errorMessage);
+}
+
+/**
+ * Escribe hasta BLOCK_SIZE bytes del archivo reconstruido
+ */
+void DeltaApplyJob::processNextBlock()
+{
+    if (isFinished()) return;
+
+    qint64 budget = BLOCK_SIZE;
+    while (budget > 0 && m_opIndex < m_ops.size()) {
+        const DeltaOp &op = m_ops[m_opIndex];
+        QFile &input = op.type == DeltaOp::CopyBlock ? m_basis : m_source;
+        qint64 inputOffset = (op.type == DeltaOp::CopyBlock ? op.basisOffset : op.offset) + m_opDone;
+        qint64 length = qMin(budget, op.length - m_opDone);
+
+        QByteArray block;
+        if (input.seek(inputOffset)) block = input.read(length);
+        if (block.size() != length || m_output.write(block) != length) {
+            fail(QString("Error reconstruyendo %1 en el offset %2").arg(m_destPath).arg(op.offset + m_opDone));
+            return;
+        }
+
+        m_outputHash.addData(block);
+        m_written += length;
+        m_opDone += length;
+        budget -= length;
+        if (m_opDone == op.length) {
+            m_opIndex++;
+            m_opDone = 0;
+        }
+    }
+
+    emit progress(m_written, m_total);
+
+    if (m_opIndex < m_ops.size()) {
+        QTimer::singleShot(0, this, &DeltaApplyJob::processNextBlock);
+        return;
+    }
+
+    m_basis.close();
+    if (!m_output.flush()) {
+        fail(QString("Error escribiendo %1: %2").arg(m_output.fileName(), m_output.errorString()));
+        return;
+    }
+    m_output.close();
+    m_source.seek(0);
+    QTimer::singleShot(0, this, &DeltaApplyJob::verifyNextBlock);
+}
+
+/**
+ * Calcula el MD5 del archivo nuevo y, si coincide, reemplaza el destino
+ */
+void DeltaApplyJob::verifyNextBlock()
+{
+    if (isFinished()) return;
+
+    QByteArray block = m_source.read(BLOCK_SIZE);
+    m_sourceHash.addData(block);
+    m_verified += block.size();
+
+    if (!block.isEmpty() && !m_source.atEnd()) {
+        QTimer::singleShot(0, this, &DeltaApplyJob::verifyNextBlock);
+        return;
+    }
+
+    m_source.close();
+    if (m_verified != m_total || m_sourceHash.result() != m_outputHash.result()) {
+        fail(QString("Verificación MD5 fallida al aplicar el delta de %1").arg(m_destPath));
+        return;
+    }
+
+    QFile::remove(m_destPath);
+    if (!m_output.rename(m_destPath)) {
+        // Conservar el .mdbpart: ya es el único ejemplar del contenido verificado
+        complete(false, QString("No se pudo reemplazar %1: %2").arg(m_destPath, m_output.errorString()));
+        return;
+    }
+    complete(true);
+}
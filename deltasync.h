@@ -0,0 +1,207 @@
+#ifndef DELTASYNC_H
+#define DELTASYNC_H
+
+#include <QObject>
+#include <QFile>
+#include <QList>
+#include <QVector>
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QSharedPointer>
+#include "devicetransport.h"
+
+// Firma de un bloque del archivo base (el que ya existe en el destino)
+struct DeltaBlockSignature {
+    quint32 weak;         // Suma rodante (estilo rsync); 0 si la firma no tiene sumas débiles
+    QByteArray strong;    // MD5 del bloque
+};
+
+// Firma por bloques de un archivo base
+struct DeltaSignature {
+    qint64 blockSize;     // Tamaño de bloque (el último bloque puede ser menor)
+    qint64 fileSize;      // Tamaño del archivo base
+    bool hasWeak;         // false si solo hay MD5 (p. ej. calculada en el dispositivo): solo se
+                          // aprovechan bloques que no cambiaron de posición
+    QVector<DeltaBlockSignature> blocks;
+};
+
+// Operación para reconstruir el archivo nuevo a partir del base
+struct DeltaOp {
+    enum Type {
+        CopyBlock,        // Copiar length bytes del base desde basisOffset
+        Literal           // Enviar length bytes del archivo nuevo
+    };
+    Type type;
+    qint64 offset;        // Posición en el archivo nuevo
+    qint64 length;
+    qint64 basisOffset;   // Solo para CopyBlock
+};
+
+/**
+ * @class DeltaSync
+ * @brief Cálculo de deltas estilo rsync entre un archivo nuevo y uno base
+ *
+ * El destino aporta la firma por bloques del archivo que ya tiene; el archivo nuevo
+ * se recorre con una suma rodante y solo los bloques cuya suma débil coincide se
+ * confirman con MD5. La suma débil de un bloque completo usa SSE2 cuando está disponible.
+ */
+class DeltaSync
+{
+public:
+    /**
+     * @brief Suma débil (a + b << 16) de un bloque
+     */
+    static quint32 weakChecksum(const uchar *data, qint64 length);
+
+    /**
+     * @brief Desplaza la suma débil un byte
+     * @param checksum Suma del bloque actual
+     * @param outByte Byte que sale por la izquierda
+     * @param inByte Byte que entra por la derecha
+     * @param blockSize Tamaño del bloque
+     */
+    static quint32 rollWeakChecksum(quint32 checksum, uchar outByte, uchar inByte, qint64 blockSize);
+
+    /**
+     * @brief Tamaño de bloque recomendado para un archivo
+     *
+     * Se limita el número de bloques para que la firma siga siendo barata cuando se
+     * calcula en el dispositivo.
+     */
+    static qint64 blockSizeFor(qint64 fileSize);
+
+    /**
+     * @brief Calcula la firma completa (suma débil + MD5) de un archivo local
+     * @param filePath Archivo base
+     * @param blockSize Tamaño de bloque
+     * @param signature Firma de salida
+     * @param errorMessage Mensaje de error de salida (opcional)
+     * @return true si se pudo leer el archivo
+     */
+    static bool computeSignature(const QString &filePath, qint64 blockSize,
+                                 DeltaSignature &signature, QString *errorMessage = nullptr);
+
+    /**
+     * @brief Calcula las operaciones que transforman el archivo base en el nuevo
+     * @param filePath Archivo nuevo (local)
+     * @param signature Firma del archivo base
+     * @param ops Operaciones de salida, ordenadas por posición y contiguas
+     * @param errorMessage Mensaje de error de salida (opcional)
+     * @return true si se pudo leer el archivo nuevo
+     */
+    static bool computeDelta(const QString &filePath, const DeltaSignature &signature,
+                             QList<DeltaOp> &ops, QString *errorMessage = nullptr);
+
+    /**
+     * @brief Bytes que hay que enviar para aplicar un delta
+     */
+    static qint64 literalBytes(const QList<DeltaOp> &ops);
+};
+
+/**
+ * @class DeltaSignatureJob
+ * @brief Cálculo asíncrono de la firma de un archivo del destino (ver DeviceTransport::blockSignature())
+ */
+class DeltaSignatureJob : public TransportJob
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief Constructor
+     * @param parent Objeto padre (opcional)
+     */
+    explicit DeltaSignatureJob(QObject *parent = nullptr);
+
+    /**
+     * @brief Firma calculada (válida tras finished() con éxito)
+     */
+    DeltaSignature signature() const;
+
+protected:
+    void setSignature(const DeltaSignature &signature);
+
+private:
+    DeltaSignature m_signature;
+};
+
+/**
+ * @class DeltaComputeJob
+ * @brief Ejecuta DeltaSync::computeDelta() en el grupo de hilos global
+ *
+ * Recorrer un archivo de varios GB con la suma rodante tarda segundos: así el hilo
+ * que lo pide sigue atendiendo otras operaciones y la cancelación. El resultado
+ * vuelve al hilo del job; abortar no detiene el cálculo, solo descarta su resultado.
+ */
+class DeltaComputeJob : public TransportJob
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief Constructor; el cálculo empieza enseguida
+     * @param filePath Archivo nuevo (local)
+     * @param signature Firma del archivo base
+     * @param parent Objeto padre (opcional)
+     */
+    DeltaComputeJob(const QString &filePath, const DeltaSignature &signature, QObject *parent = nullptr);
+    ~DeltaComputeJob();
+
+    /**
+     * @brief Operaciones calculadas (válidas tras finished() con éxito)
+     */
+    QList<DeltaOp> ops() const;
+
+private:
+    struct Link;                  // Compartido con el cálculo, que puede terminar después del job
+    QSharedPointer<Link> m_link;
+    QList<DeltaOp> m_ops;
+};
+
+/**
+ * @class DeltaApplyJob
+ * @brief Reconstruye un archivo del PC a partir del base y del archivo nuevo
+ *
+ * Escribe el resultado junto al destino (.mdbpart), verifica su MD5 contra el
+ * archivo nuevo y lo renombra sobre el destino. Tanto la reconstrucción como la
+ * verificación procesan un bloque grande por iteración del bucle de eventos.
+ */
+class DeltaApplyJob : public TransportJob
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief Constructor
+     * @param basisPath Archivo base (destino actual)
+     * @param sourcePath Archivo nuevo
+     * @param ops Operaciones calculadas con DeltaSync::computeDelta()
+     * @param parent Objeto padre (opcional)
+     */
+    DeltaApplyJob(const QString &basisPath, const QString &sourcePath,
+                  const QList<DeltaOp> &ops, QObject *parent = nullptr);
+
+    void start();
+    void abort() override;
+
+private slots:
+    void processNextBlock();
+    void verifyNextBlock();
+
+private:
+    void fail(const QString &errorMessage);
+
+    QFile m_basis;
+    QFile m_source;
+    QFile m_output;
+    QString m_destPath;
+    QList<DeltaOp> m_ops;
+    int m_opIndex;
+    qint64 m_opDone;
+    qint64 m_written;
+    qint64 m_total;
+    qint64 m_verified;
+    QCryptographicHash m_outputHash;
+    QCryptographicHash m_sourceHash;
+
+    static constexpr qint64 BLOCK_SIZE = 4 * 1024 * 1024; // 4 MB por iteración
+};
+
+#endif // DELTASYNC_H
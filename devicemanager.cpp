@@ -5,6 +5,7 @@
 #include <QDebug>
 #include <QRegularExpression>
 #include <QCoreApplication>
+#include <QProcessEnvironment>
 
 DeviceManager::DeviceManager(QObject *parent) : QObject(parent),
     adbProcess(nullptr),
@@ -45,6 +46,58 @@ bool DeviceManager::setupBridgeClient(const QString &deviceId)
         return false;
     }
 
+    if (m_bridgeSetups.contains(deviceId)) {
+        qWarning() << "Bridge Client setup already in progress for device:" << deviceId;
+        return false;
+    }
+
+    // Configurar y conectar
+    return bridgeClientFor(deviceId)->setupBridgeClient(deviceId, adbPath);
+}
+
+bool DeviceManager::isBridgeClientConnected(const QString &deviceId) const
+{
+    return m_bridgeClients.contains(deviceId) && m_bridgeClients[deviceId]->isConnected();
+}
+
+AdbSocketClient* DeviceManager::getBridgeClient(const QString &deviceId)
+{
+    if (m_bridgeClients.contains(deviceId)) {
+        return m_bridgeClients[deviceId];
+    }
+    return nullptr;
+}
+
+bool DeviceManager::startBridgeClientSetup(const QString &deviceId)
+{
+    if (m_bridgeSetups.contains(deviceId)) {
+        return true; // Ya hay una configuración en curso
+    }
+
+    if (!connectedDevices.contains(deviceId) ||
+        connectedDevices[deviceId].type != "android" ||
+        !connectedDevices[deviceId].authorized) {
+        return false;
+    }
+
+    AdbSocketClient *client = bridgeClientFor(deviceId);
+    if (client->isConnected()) {
+        return false;
+    }
+
+    // Las órdenes adb y la conexión corren en el hilo de E/S del cliente
+    m_bridgeSetups.insert(deviceId);
+    client->setupBridgeClientAsync(deviceId, adbPath);
+    return true;
+}
+
+bool DeviceManager::isBridgeClientSettingUp(const QString &deviceId) const
+{
+    return m_bridgeSetups.contains(deviceId);
+}
+
+AdbSocketClient* DeviceManager::bridgeClientFor(const QString &deviceId)
+{
     // Crear cliente si no existe
     if (!m_bridgeClients.contains(deviceId)) {
         m_bridgeClients[deviceId] = new AdbSocketClient(this);
@@ -64,23 +117,13 @@ bool DeviceManager::setupBridgeClient(const QString &deviceId)
             qDebug() << "Bridge Client error for device:" << deviceId << "-" << errorMessage;
             emit bridgeClientError(deviceId, errorMessage);
         });
-    }
-
-    // Configurar y conectar
-    return m_bridgeClients[deviceId]->setupBridgeClient(deviceId, adbPath);
-}
-
-bool DeviceManager::isBridgeClientConnected(const QString &deviceId) const
-{
-    return m_bridgeClients.contains(deviceId) && m_bridgeClients[deviceId]->isConnected();
-}
 
-AdbSocketClient* DeviceManager::getBridgeClient(const QString &deviceId)
-{
-    if (m_bridgeClients.contains(deviceId)) {
-        return m_bridgeClients[deviceId];
+        connect(m_bridgeClients[deviceId], &AdbSocketClient::setupFinished, this, [this, deviceId](bool success) {
+            m_bridgeSetups.remove(deviceId);
+            emit bridgeClientSetupFinished(deviceId, success);
+        });
     }
-    return nullptr;
+    return m_bridgeClients[deviceId];
 }
 
 DeviceManager::~DeviceManager()
@@ -107,6 +150,9 @@ bool DeviceManager::startDeviceDetection()
     if (isScanning)
         return true; // Ya está escaneando
 
+    // Registrar directorios locales configurados (MDB_LOCAL_DEVICES)
+    registerLocalDevicesFromEnvironment();
+
     // Verificar si tenemos ADB disponible
     if (!isAdbAvailable()) {
         emit error("ADB no encontrado. La detección de dispositivos Android no estará disponible.");
@@ -122,7 +168,7 @@ bool DeviceManager::startDeviceDetection()
     // Si no tenemos ninguna herramienta disponible, fallamos
     if (!isAdbAvailable() && !isLibimobiledeviceAvailable()) {
         emit error("No se encontraron herramientas para detectar dispositivos. Por favor, instale ADB y/o libimobiledevice.");
-        return false;
+        return !m_localDevicePaths.isEmpty(); // Los dispositivos locales siguen disponibles
     }
 
     // Comenzar el escaneo periódico
@@ -571,29 +617,13 @@ bool DeviceManager::setupBridgeClient(const QString &deviceId)
         return false;
     }
 
-    // Crear cliente si no existe
-    if (!m_bridgeClients.contains(deviceId)) {
-        m_bridgeClients[deviceId] = new AdbSocketClient(this);
-
-        // Conectar señales
-        connect(m_bridgeClients[deviceId], &AdbSocketClient::connected, this, [this, deviceId]() {
-            qDebug() << "Bridge Client connected for device:" << deviceId;
-            emit bridgeClientConnected(deviceId);
-        });
-
-        connect(m_bridgeClients[deviceId], &AdbSocketClient::disconnected, this, [this, deviceId]() {
-            qDebug() << "Bridge Client disconnected for device:" << deviceId;
-            emit bridgeClientDisconnected(deviceId);
-        });
-
-        connect(m_bridgeClients[deviceId], &AdbSocketClient::errorOccurred, this, [this, deviceId](const QString &errorMessage) {
-            qDebug() << "Bridge Client error for device:" << deviceId << "-" << errorMessage;
-            emit bridgeClientError(deviceId, errorMessage);
-        });
+    if (m_bridgeSetups.contains(deviceId)) {
+        qWarning() << "Bridge Client setup already in progress for device:" << deviceId;
+        return false;
     }
 
     // Configurar y conectar
-    return m_bridgeClients[deviceId]->setupBridgeClient(deviceId, adbPath);
+    return bridgeClientFor(deviceId)->setupBridgeClient(deviceId, adbPath);
 }
 
 bool DeviceManager::isBridgeClientConnected(const QString &deviceId) const
@@ -608,3 +638,111 @@ AdbSocketClient* DeviceManager::getBridgeClient(const QString &deviceId)
     }
     return nullptr;
 }
+
+/**
+ * Registra un directorio del PC como dispositivo local
+ * @return ID del dispositivo ("local:<ruta>") o cadena vacía si el directorio no existe
+ */
+QString DeviceManager::addLocalDevice(const QString &rootPath, const QString &name)
+{
+    QFileInfo rootInfo(rootPath);
+    if (!rootInfo.isDir()) {
+        qWarning() << "Directorio de dispositivo local no válido:" << rootPath;
+        return QString();
+    }
+
+    QString absolutePath = QDir::cleanPath(rootInfo.absoluteFilePath());
+    QString deviceId = "local:" + absolutePath;
+    if (connectedDevices.contains(deviceId)) {
+        return deviceId;
+    }
+
+    DeviceInfo device;
+    device.id = deviceId;
+    device.type = "local";
+    device.model = "Directorio local";
+    device.name = name.isEmpty() ? rootInfo.fileName() : name;
+    device.authorized = true;
+    device.osVersion = QString();
+
+    connectedDevices[deviceId] = device;
+    m_localDevicePaths[deviceId] = absolutePath;
+
+    qDebug() << "Dispositivo local registrado:" << deviceId;
+    emit deviceConnected(device);
+    emit deviceListUpdated();
+    return deviceId;
+}
+
+/**
+ * Registra un archivo de respaldo como dispositivo (puede no existir todavía)
+ * @return ID del dispositivo ("archive:<ruta>") o cadena vacía si el directorio padre no existe
+ */
+QString DeviceManager::addArchiveDevice(const QString &archivePath, const QString &name)
+{
+    QFileInfo archiveInfo(archivePath);
+    if (!archiveInfo.absoluteDir().exists()) {
+        qWarning() << "Directorio del archivo de respaldo no válido:" << archivePath;
+        return QString();
+    }
+
+    QString absolutePath = QDir::cleanPath(archiveInfo.absoluteFilePath());
+    QString deviceId = "archive:" + absolutePath;
+    if (connectedDevices.contains(deviceId)) {
+        return deviceId;
+    }
+
+    DeviceInfo device;
+    device.id = deviceId;
+    device.type = "archive";
+    device.model = "Archivo de respaldo";
+    device.name = name.isEmpty() ? archiveInfo.completeBaseName() : name;
+    device.authorized = true;
+    device.osVersion = QString();
+
+    connectedDevices[deviceId] = device;
+    m_localDevicePaths[deviceId] = absolutePath;
+
+    qDebug() << "Archivo de respaldo registrado:" << deviceId;
+    emit deviceConnected(device);
+    emit deviceListUpdated();
+    return deviceId;
+}
+
+/**
+ * Elimina un dispositivo local o archivo de respaldo registrado
+ */
+bool DeviceManager::removeLocalDevice(const QString &deviceId)
+{
+    if (!m_localDevicePaths.contains(deviceId)) {
+        return false;
+    }
+
+    m_localDevicePaths.remove(deviceId);
+    connectedDevices.remove(deviceId);
+    emit deviceDisconnected(deviceId);
+    emit deviceListUpdated();
+    return true;
+}
+
+/**
+ * Obtiene la ruta en el PC de un dispositivo local o archivo de respaldo
+ */
+QString DeviceManager::getLocalDevicePath(const QString &deviceId) const
+{
+    return m_localDevicePaths.value(deviceId);
+}
+
+/**
+ * Registra los directorios listados en MDB_LOCAL_DEVICES (separados por el separador de rutas del sistema)
+ */
+void DeviceManager::registerLocalDevicesFromEnvironment()
+{
+    QString configured = QProcessEnvironment::systemEnvironment().value("MDB_LOCAL_DEVICES");
+    if (configured.isEmpty()) return;
+
+    const QStringList paths = configured.split(QDir::listSeparator(), Qt::SkipEmptyParts);
+    for (const QString &path : paths) {
+        addLocalDevice(path.trimmed());
+    }
+}
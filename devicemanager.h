@@ -5,12 +5,13 @@
 #include <QProcess>
 #include <QTimer>
 #include <QMap>
+#include <QSet>
 #include "adbsocketclient.h"
 
 // Estructura para almacenar información de un dispositivo
 struct DeviceInfo {
     QString id;          // Identificador único (serial, UDID)
-    QString type;        // "android" o "ios"
+    QString type;        // "android", "ios", "local" (directorio del PC) o "archive" (respaldo)
     QString model;       // Modelo del dispositivo
     QString name;        // Nombre asignado al dispositivo
     bool authorized;     // Si el dispositivo está autorizado/confiado
@@ -45,6 +46,16 @@ public:
     bool setupBridgeClient(const QString &deviceId);
     bool isBridgeClientConnected(const QString &deviceId) const;
     AdbSocketClient* getBridgeClient(const QString &deviceId);
+    // Configuración sin bloquear; true si queda en curso (avisa con bridgeClientSetupFinished)
+    bool startBridgeClientSetup(const QString &deviceId);
+    bool isBridgeClientSettingUp(const QString &deviceId) const;
+
+    // Dispositivos locales: un directorio del PC que actúa como dispositivo
+    // (útil para pruebas y benchmarks sin teléfonos conectados)
+    QString addLocalDevice(const QString &rootPath, const QString &name = QString());
+    QString addArchiveDevice(const QString &archivePath, const QString &name = QString());
+    bool removeLocalDevice(const QString &deviceId);
+    QString getLocalDevicePath(const QString &deviceId) const;
 
 signals:
     // Señales para comunicar cambios a la interfaz
@@ -59,6 +70,7 @@ signals:
     void bridgeClientConnected(const QString &deviceId);
     void bridgeClientDisconnected(const QString &deviceId);
     void bridgeClientError(const QString &deviceId, const QString &errorMessage);
+    void bridgeClientSetupFinished(const QString &deviceId, bool success);
 
 public slots:
     // Acciones que se pueden invocar desde la interfaz
@@ -81,6 +93,8 @@ private:
     bool parseIOSDeviceList(const QString &output);
     QString findAdbPath();
     QString findLibimobiledevicePath();
+    void registerLocalDevicesFromEnvironment();
+    AdbSocketClient* bridgeClientFor(const QString &deviceId);
 
     // Variables internas
     QProcess *adbProcess;
@@ -94,6 +108,10 @@ private:
 
     // Bridge Client
     QMap<QString, AdbSocketClient*> m_bridgeClients;
+    QSet<QString> m_bridgeSetups; // Dispositivos con configuración asíncrona en curso
+
+    // Dispositivos locales y archivos de respaldo (ID -> ruta en el PC)
+    QMap<QString, QString> m_localDevicePaths;
 };
 
 #endif // DEVICEMANAGER_H
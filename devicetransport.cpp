@@ -0,0 +1,1737 @@
+#include "devicetransport.h"
+#include "devicemanager.h"
+#include "adbsocketclient.h"
+#include "backuparchive.h"
+#include "rangedtransfer.h"
+#include "deltasync.h"
+#include "dataanalyzer.h"
+#include "lineframer.h"
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <functional>
+
+/**
+ * Constructor de TransportJob
+ */
+TransportJob::TransportJob(QObject *parent)
+    : QObject(parent)
+    , m_finished(false)
+    , m_success(false)
+{
+}
+
+bool TransportJob::isFinished() const
+{
+    return m_finished;
+}
+
+bool TransportJob::succeeded() const
+{
+    return m_success;
+}
+
+QString TransportJob::errorMessage() const
+{
+    return m_errorMessage;
+}
+
+/**
+ * Aborta la operación (implementación por defecto)
+ */
+void TransportJob::abort()
+{
+    complete(false, "Operación cancelada");
+}
+
+/**
+ * Marca la operación como terminada y emite finished() una sola vez
+ */
+void TransportJob::complete(bool success, const QString &errorMessage)
+{
+    if (m_finished) return;
+
+    m_finished = true;
+    m_success = success;
+    m_errorMessage = errorMessage;
+    emit finished(success, errorMessage);
+}
+
+/**
+ * Constructor de RecordFetchJob
+ */
+RecordFetchJob::RecordFetchJob(QObject *parent)
+    : TransportJob(parent)
+{
+}
+
+QList<DataItem> RecordFetchJob::records() const
+{
+    return m_records;
+}
+
+void RecordFetchJob::setRecords(const QList<DataItem> &records)
+{
+    m_records = records;
+}
+
+/**
+ * Constructor de ProcessTransportJob
+ */
+ProcessTransportJob::ProcessTransportJob(const QString &program, const QStringList &arguments,
+                                         const QString &description, QObject *parent)
+    : TransportJob(parent)
+    , m_program(program)
+    , m_arguments(arguments)
+    , m_description(description)
+{
+    connect(&m_process, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+            this, &ProcessTransportJob::onProcessFinished);
+    connect(&m_process, &QProcess::errorOccurred, this, &ProcessTransportJob::onProcessError);
+}
+
+/**
+ * Lanza el proceso
+ */
+void ProcessTransportJob::start()
+{
+    qDebug() << "Ejecutando:" << m_program << m_arguments.join(" ");
+    m_process.start(m_program, m_arguments);
+}
+
+/**
+ * Aborta el proceso en curso
+ */
+void ProcessTransportJob::abort()
+{
+    if (m_process.state() != QProcess::NotRunning) {
+        m_process.blockSignals(true);
+        m_process.kill();
+        m_process.waitForFinished(500);
+        m_process.blockSignals(false);
+    }
+    complete(false, "Operación cancelada");
+}
+
+void ProcessTransportJob::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    if (exitCode != 0 || exitStatus != QProcess::NormalExit) {
+        QString stdErr = QString::fromUtf8(m_process.readAllStandardError()).trimmed();
+        complete(false, QString("%1 falló: %2").arg(m_description, stdErr.isEmpty() ? m_process.errorString() : stdErr));
+        return;
+    }
+    complete(true);
+}
+
+void ProcessTransportJob::onProcessError(QProcess::ProcessError error)
+{
+    // Los fallos en tiempo de ejecución llegan también por finished()
+    // FailedToStart puede emitirse dentro de start(): diferir para no completar de forma síncrona
+    if (error == QProcess::FailedToStart) {
+        QString message = QString("%1 no pudo iniciarse: %2").arg(m_description, m_process.errorString());
+        QTimer::singleShot(0, this, [this, message]() { complete(false, message); });
+    }
+}
+
+namespace {
+
+/**
+ * Job que termina con error en la siguiente iteración del bucle de eventos
+ */
+class FailedTransportJob : public TransportJob
+{
+public:
+    FailedTransportJob(const QString &message, QObject *parent)
+        : TransportJob(parent)
+    {
+        QTimer::singleShot(0, this, [this, message]() { complete(false, message); });
+    }
+};
+
+/**
+ * Lectura de registros que termina con error en la siguiente iteración del bucle de eventos
+ */
+class FailedRecordFetchJob : public RecordFetchJob
+{
+public:
+    FailedRecordFetchJob(const QString &message, QObject *parent)
+        : RecordFetchJob(parent)
+    {
+        QTimer::singleShot(0, this, [this, message]() { complete(false, message); });
+    }
+};
+
+/**
+ * Firma que termina con error en la siguiente iteración del bucle de eventos
+ */
+class FailedDeltaSignatureJob : public DeltaSignatureJob
+{
+public:
+    FailedDeltaSignatureJob(const QString &message, QObject *parent)
+        : DeltaSignatureJob(parent)
+    {
+        QTimer::singleShot(0, this, [this, message]() { complete(false, message); });
+    }
+};
+
+/**
+ * Firma de un archivo del PC, calculada en la siguiente iteración del bucle de eventos
+ */
+class LocalDeltaSignatureJob : public DeltaSignatureJob
+{
+public:
+    LocalDeltaSignatureJob(const QString &filePath, qint64 blockSize, QObject *parent)
+        : DeltaSignatureJob(parent)
+    {
+        QTimer::singleShot(0, this, [this, filePath, blockSize]() {
+            if (isFinished()) return;
+            DeltaSignature signature;
+            QString error;
+            if (!DeltaSync::computeSignature(filePath, blockSize, signature, &error)) {
+                complete(false, error);
+                return;
+            }
+            setSignature(signature);
+            complete(true);
+        });
+    }
+};
+
+/**
+ * Firma por bloques calculada en el dispositivo con dd | md5sum (no hay suma rodante en toybox)
+ *
+ * La primera línea de la salida es el tamaño del archivo; después, un MD5 por bloque.
+ */
+class AdbDeltaSignatureJob : public DeltaSignatureJob
+{
+public:
+    AdbDeltaSignatureJob(const QString &program, const QString &deviceId, const QString &remotePath,
+                         qint64 blockSize, QObject *parent)
+        : DeltaSignatureJob(parent)
+        , m_remotePath(remotePath)
+        , m_blockSize(blockSize)
+    {
+        QString command = QString("f=%1; s=$(stat -c %s \"$f\") || exit 1; echo $s; n=$(( (s + %2 - 1) / %2 )); "
+                                  "i=0; while [ $i -lt $n ]; do dd if=\"$f\" bs=%2 skip=$i count=1 2>/dev/null | md5sum; "
+                                  "i=$((i+1)); done")
+            .arg(AdbProcessTransport::shellQuote(remotePath)).arg(blockSize);
+
+        connect(&m_process, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+                this, [this](int exitCode, QProcess::ExitStatus exitStatus) {
+            if (exitCode != 0 || exitStatus != QProcess::NormalExit) {
+                QString stdErr = QString::fromUtf8(m_process.readAllStandardError()).trimmed();
+                complete(false, QString("Firma de %1 falló: %2")
+                                    .arg(m_remotePath, stdErr.isEmpty() ? m_process.errorString() : stdErr));
+                return;
+            }
+            parseOutput(m_process.readAllStandardOutput());
+        });
+        connect(&m_process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+            // FailedToStart puede emitirse dentro de start(): diferir para no completar de forma síncrona
+            if (error == QProcess::FailedToStart) {
+                QString message = "Firma por bloques no pudo iniciarse: " + m_process.errorString();
+                QTimer::singleShot(0, this, [this, message]() { complete(false, message); });
+            }
+        });
+
+        QStringList arguments;
+        arguments << "-s" << deviceId << "exec-out" << command;
+        qDebug() << "Ejecutando:" << program << arguments.join(" ");
+        m_process.start(program, arguments);
+    }
+
+    void abort() override
+    {
+        if (m_process.state() != QProcess::NotRunning) {
+            m_process.blockSignals(true);
+            m_process.kill();
+            m_process.waitForFinished(500);
+            m_process.blockSignals(false);
+        }
+        complete(false, "Operación cancelada");
+    }
+
+private:
+    void parseOutput(const QByteArray &output)
+    {
+        const QList<QByteArray> lines = output.split('\n');
+        bool sizeOk = false;
+        qint64 fileSize = lines.value(0).trimmed().toLongLong(&sizeOk);
+        if (!sizeOk) {
+            complete(false, QString("No se pudo leer el tamaño de %1").arg(m_remotePath));
+            return;
+        }
+
+        DeltaSignature signature;
+        signature.blockSize = m_blockSize;
+        signature.fileSize = fileSize;
+        signature.hasWeak = false;
+        for (int i = 1; i < lines.size(); ++i) {
+            QByteArray hex = lines[i].trimmed().split(' ').value(0);
+            if (hex.size() != 32) continue;
+
+            DeltaBlockSignature block;
+            block.weak = 0;
+            block.strong = QByteArray::fromHex(hex);
+            signature.blocks.append(block);
+        }
+
+        qint64 blockCount = (fileSize + m_blockSize - 1) / m_blockSize;
+        if (signature.blocks.size() != blockCount) {
+            complete(false, QString("Firma incompleta de %1: %2 de %3 bloques")
+                                .arg(m_remotePath).arg(signature.blocks.size()).arg(blockCount));
+            return;
+        }
+        setSignature(signature);
+        complete(true);
+    }
+
+    QProcess m_process;
+    QString m_remotePath;
+    qint64 m_blockSize;
+};
+
+/**
+ * Registros completos con "adb exec-out content query" y la proyección del análisis
+ *
+ * Las filas se convierten a medida que llegan con el mismo parser que el análisis.
+ */
+class AdbRecordFetchJob : public RecordFetchJob
+{
+public:
+    AdbRecordFetchJob(const QString &program, const QStringList &arguments, const QString &dataType, QObject *parent)
+        : RecordFetchJob(parent)
+        , m_dataType(dataType)
+    {
+        connect(&m_process, &QProcess::readyReadStandardOutput, this, [this]() { parseOutput(false); });
+        connect(&m_process, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+                this, [this](int exitCode, QProcess::ExitStatus exitStatus) {
+            if (exitCode != 0 || exitStatus != QProcess::NormalExit) {
+                QString stdErr = QString::fromUtf8(m_process.readAllStandardError()).trimmed();
+                complete(false, "content query falló: " + (stdErr.isEmpty() ? m_process.errorString() : stdErr));
+                return;
+            }
+            parseOutput(true);
+            setRecords(m_parsed);
+            complete(true);
+        });
+        connect(&m_process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+            // FailedToStart puede emitirse dentro de start(): diferir para no completar de forma síncrona
+            if (error == QProcess::FailedToStart) {
+                QString message = "content query no pudo iniciarse: " + m_process.errorString();
+                QTimer::singleShot(0, this, [this, message]() { complete(false, message); });
+            }
+        });
+
+        qDebug() << "Ejecutando:" << program << arguments.join(" ").left(200);
+        m_process.start(program, arguments);
+    }
+
+    void abort() override
+    {
+        if (m_process.state() != QProcess::NotRunning) {
+            m_process.blockSignals(true);
+            m_process.kill();
+            m_process.waitForFinished(500);
+            m_process.blockSignals(false);
+        }
+        complete(false, "Operación cancelada");
+    }
+
+private:
+    void parseOutput(bool finished)
+    {
+        m_framer.append(m_process.readAllStandardOutput());
+        if (finished) m_framer.finish();
+
+        QByteArray line;
+        DataItem item;
+        while (m_framer.nextLine(line)) {
+            if (DataAnalyzer::parseAndroidRow(m_dataType, line, item)) {
+                m_parsed.append(item);
+            }
+        }
+    }
+
+    QProcess m_process;
+    LineFramer m_framer;
+    QString m_dataType;
+    QList<DataItem> m_parsed;
+};
+
+} // namespace
+
+/**
+ * Constructor de DeviceTransport
+ */
+DeviceTransport::DeviceTransport(const QString &deviceId, QObject *parent)
+    : QObject(parent)
+    , m_deviceId(deviceId)
+{
+}
+
+QString DeviceTransport::deviceId() const
+{
+    return m_deviceId;
+}
+
+int DeviceTransport::maxConcurrentJobs() const
+{
+    return 1;
+}
+
+TransportJob *DeviceTransport::writeItem(const QString &dataType, const DataItem &item,
+                                         const QString &localPath, const QString &remotePath)
+{
+    Q_UNUSED(dataType);
+    Q_UNUSED(item);
+    return writeFromFile(localPath, remotePath);
+}
+
+bool DeviceTransport::supportsRecords() const
+{
+    return false;
+}
+
+bool DeviceTransport::storeRecord(const QString &dataType, const DataItem &item, QString *errorMessage)
+{
+    Q_UNUSED(dataType);
+    Q_UNUSED(item);
+    if (errorMessage) *errorMessage = QString("El transporte %1 no admite registros").arg(kind());
+    return false;
+}
+
+RecordFetchJob *DeviceTransport::fetchRecords(const QString &dataType, const QStringList &ids)
+{
+    Q_UNUSED(ids);
+    return new FailedRecordFetchJob(QString("El transporte %1 no puede leer registros de %2").arg(kind(), dataType), this);
+}
+
+bool DeviceTransport::finalize(QString *errorMessage)
+{
+    Q_UNUSED(errorMessage);
+    return true;
+}
+
+bool DeviceTransport::supportsRangedReads() const
+{
+    return false;
+}
+
+bool DeviceTransport::supportsRangedWrites() const
+{
+    return false;
+}
+
+int DeviceTransport::maxConcurrentRangeJobs() const
+{
+    return maxConcurrentJobs();
+}
+
+TransportJob *DeviceTransport::readRange(const QString &remotePath, qint64 offset, qint64 length, const QString &localPath)
+{
+    Q_UNUSED(offset);
+    Q_UNUSED(length);
+    Q_UNUSED(localPath);
+    return new FailedTransportJob(QString("El transporte %1 no admite lectura por rangos: %2").arg(kind(), remotePath), this);
+}
+
+bool DeviceTransport::prepareRangedWrite(const QString &remotePath, qint64 size, QString *errorMessage)
+{
+    Q_UNUSED(size);
+    if (errorMessage) *errorMessage = QString("El transporte %1 no admite escritura por rangos: %2").arg(kind(), remotePath);
+    return false;
+}
+
+TransportJob *DeviceTransport::writeRange(const QString &localPath, const QString &remotePath, qint64 offset, qint64 length)
+{
+    Q_UNUSED(localPath);
+    Q_UNUSED(offset);
+    Q_UNUSED(length);
+    return new FailedTransportJob(QString("El transporte %1 no admite escritura por rangos: %2").arg(kind(), remotePath), this);
+}
+
+bool DeviceTransport::supportsDelta() const
+{
+    return false;
+}
+
+DeltaSignatureJob *DeviceTransport::blockSignature(const QString &remotePath, qint64 blockSize)
+{
+    Q_UNUSED(blockSize);
+    return new FailedDeltaSignatureJob(QString("El transporte %1 no admite deltas: %2").arg(kind(), remotePath), this);
+}
+
+TransportJob *DeviceTransport::applyDelta(const QString &localPath, const QString &remotePath, const QList<DeltaOp> &ops)
+{
+    Q_UNUSED(localPath);
+    Q_UNUSED(ops);
+    return new FailedTransportJob(QString("El transporte %1 no admite deltas: %2").arg(kind(), remotePath), this);
+}
+
+/**
+ * Crea el transporte adecuado para un dispositivo
+ */
+DeviceTransport *DeviceTransport::create(DeviceManager *deviceManager, const QString &deviceId,
+                                         bool preferBridge, QObject *parent)
+{
+    if (!deviceManager) return nullptr;
+
+    DeviceInfo device = deviceManager->getDeviceInfo(deviceId);
+
+    if (device.type == "local" || device.type == "archive") {
+        QString rootPath = deviceManager->getLocalDevicePath(deviceId);
+        if (rootPath.isEmpty()) return nullptr;
+        if (device.type == "archive") {
+            return new ArchiveTransport(deviceId, rootPath, parent);
+        }
+        return new LocalDirectoryTransport(deviceId, rootPath, parent);
+    }
+
+    if (device.type == "android") {
+        QString adbPath = deviceManager->getAdbPath();
+        if (adbPath.isEmpty()) return nullptr;
+
+        if (preferBridge && deviceManager->isBridgeClientConnected(deviceId)) {
+            return new BridgeClientTransport(deviceId, adbPath, deviceManager->getBridgeClient(deviceId), parent);
+        }
+        return new AdbProcessTransport(deviceId, adbPath, parent);
+    }
+
+    // iOS: pendiente de implementar un transporte basado en libimobiledevice
+    return nullptr;
+}
+
+/**
+ * Constructor de AdbProcessTransport
+ */
+AdbProcessTransport::AdbProcessTransport(const QString &deviceId, const QString &adbPath, QObject *parent)
+    : DeviceTransport(deviceId, parent)
+    , m_adbPath(adbPath)
+{
+}
+
+QString AdbProcessTransport::kind() const
+{
+    return "adb";
+}
+
+/**
+ * Escapa una ruta para el shell del dispositivo
+ */
+QString AdbProcessTransport::shellQuote(const QString &path)
+{
+    QString escaped = path;
+    escaped.replace("'", "'\\''");
+    return "'" + escaped + "'";
+}
+
+/**
+ * Ejecuta adb de forma síncrona
+ */
+bool AdbProcessTransport::runAdb(const QStringList &arguments, QByteArray *output, QString *errorMessage, int timeoutMs)
+{
+    QProcess process;
+    QStringList args;
+    args << "-s" << deviceId() << arguments;
+    process.start(m_adbPath, args);
+
+    if (!process.waitForFinished(timeoutMs)) {
+        process.kill();
+        process.waitForFinished(500);
+        if (errorMessage) *errorMessage = QString("Timeout ejecutando adb %1").arg(arguments.join(" "));
+        return false;
+    }
+
+    if (output) *output = process.readAllStandardOutput();
+
+    if (process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0) {
+        if (errorMessage) {
+            *errorMessage = QString::fromUtf8(process.readAllStandardError()).trimmed();
+            if (errorMessage->isEmpty()) *errorMessage = process.errorString();
+        }
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Crea (sin iniciar) un job de proceso adb
+ */
+ProcessTransportJob *AdbProcessTransport::createAdbJob(const QStringList &arguments, const QString &description)
+{
+    QStringList args;
+    args << "-s" << deviceId() << arguments;
+    return new ProcessTransportJob(m_adbPath, args, description, this);
+}
+
+/**
+ * Lee una página de registros con la misma consulta que el análisis y una condición sobre _id
+ */
+RecordFetchJob *AdbProcessTransport::fetchRecords(const QString &dataType, const QStringList &ids)
+{
+    QString query = DataAnalyzer::androidRecordQuery(dataType);
+    if (query.isEmpty()) return DeviceTransport::fetchRecords(dataType, ids);
+
+    // Los _id de los proveedores son enteros: cualquier otra cosa no se pasa al shell
+    QStringList numericIds;
+    for (const QString &id : ids) {
+        bool ok = false;
+        id.toLongLong(&ok);
+        if (ok) numericIds.append(id);
+    }
+    if (numericIds.isEmpty()) {
+        return new FailedRecordFetchJob(QString("Ids de %1 no válidos para content query").arg(dataType), this);
+    }
+
+    QString command = QString("%1 --where \"_id IN (%2)\"").arg(query, numericIds.join(','));
+    return new AdbRecordFetchJob(m_adbPath, QStringList() << "-s" << deviceId() << "exec-out" << command,
+                                 dataType, this);
+}
+
+/**
+ * Lista un directorio con una sola llamada a find en el dispositivo
+ */
+bool AdbProcessTransport::listDirectory(const QString &path, QList<TransportEntry> &entries, QString *errorMessage)
+{
+    QByteArray output;
+    QString command = QString("find %1 -mindepth 1 -maxdepth 1 -printf '%y\\t%s\\t%T@\\t%p\\n'").arg(shellQuote(path));
+    if (!runAdb(QStringList() << "exec-out" << command, &output, errorMessage)) {
+        return false;
+    }
+
+    entries.clear();
+    const QList<QByteArray> lines = output.split('\n');
+    for (const QByteArray &line : lines) {
+        QList<QByteArray> fields = line.split('\t');
+        if (fields.size() < 4) continue;
+
+        TransportEntry entry;
+        entry.isDirectory = fields[0] == "d";
+        entry.size = fields[1].toLongLong();
+        entry.modified = QDateTime::fromSecsSinceEpoch(static_cast<qint64>(fields[2].toDouble()));
+        // La ruta puede contener tabuladores: unir el resto de campos
+        entry.path = QString::fromUtf8(line.mid(fields[0].size() + fields[1].size() + fields[2].size() + 3));
+        entries.append(entry);
+    }
+    return true;
+}
+
+/**
+ * Obtiene información de una ruta con stat
+ */
+bool AdbProcessTransport::statPath(const QString &path, TransportEntry &entry, QString *errorMessage)
+{
+    QByteArray output;
+    QString command = QString("stat -c '%F\\t%s\\t%Y' %1").arg(shellQuote(path));
+    if (!runAdb(QStringList() << "exec-out" << command, &output, errorMessage)) {
+        return false;
+    }
+
+    QList<QByteArray> fields = output.trimmed().split('\t');
+    if (fields.size() < 3) {
+        if (errorMessage) *errorMessage = QString("Salida de stat inesperada para %1").arg(path);
+        return false;
+    }
+
+    entry.path = path;
+    entry.isDirectory = fields[0] == "directory";
+    entry.size = fields[1].toLongLong();
+    entry.modified = QDateTime::fromSecsSinceEpoch(fields[2].toLongLong());
+    return true;
+}
+
+bool AdbProcessTransport::makeDirectory(const QString &path, QString *errorMessage)
+{
+    return runAdb(QStringList() << "shell" << "mkdir" << "-p" << shellQuote(path), nullptr, errorMessage);
+}
+
+bool AdbProcessTransport::removePath(const QString &path, QString *errorMessage)
+{
+    return runAdb(QStringList() << "shell" << "rm" << "-rf" << shellQuote(path), nullptr, errorMessage);
+}
+
+/**
+ * Inicia adb pull
+ */
+TransportJob *AdbProcessTransport::readToFile(const QString &remotePath, const QString &localPath)
+{
+    ProcessTransportJob *job = createAdbJob(QStringList() << "pull" << remotePath << localPath,
+                                            QString("adb pull '%1'").arg(remotePath));
+    job->start();
+    return job;
+}
+
+/**
+ * Inicia adb push
+ */
+TransportJob *AdbProcessTransport::writeFromFile(const QString &localPath, const QString &remotePath)
+{
+    ProcessTransportJob *job = createAdbJob(QStringList() << "push" << localPath << remotePath,
+                                            QString("adb push '%1'").arg(remotePath));
+    job->start();
+    return job;
+}
+
+int AdbProcessTransport::maxConcurrentJobs() const
+{
+    // Cada pull/push es un proceso adb independiente sobre el mismo enlace USB
+    return 2;
+}
+
+bool AdbProcessTransport::supportsRangedReads() const
+{
+    return true;
+}
+
+bool AdbProcessTransport::supportsRangedWrites() const
+{
+    return true;
+}
+
+int AdbProcessTransport::maxConcurrentRangeJobs() const
+{
+    // Varios flujos dd en paralelo ocultan la latencia por flujo del enlace adb
+    return 4;
+}
+
+/**
+ * Comando dd del dispositivo que vuelca un rango de bytes por stdout
+ */
+static QString ddReadCommand(const QString &path, qint64 offset, qint64 length)
+{
+    return QString("dd if=%1 bs=1048576 iflag=skip_bytes,count_bytes skip=%2 count=%3 2>/dev/null")
+        .arg(AdbProcessTransport::shellQuote(path)).arg(offset).arg(length);
+}
+
+/**
+ * Lee un rango con dd (exec-out) y lo verifica con md5sum en el dispositivo
+ */
+TransportJob *AdbProcessTransport::readRange(const QString &remotePath, qint64 offset, qint64 length, const QString &localPath)
+{
+    AdbRangeReadJob *job = new AdbRangeReadJob(m_adbPath, deviceId(), ddReadCommand(remotePath, offset, length),
+                                               localPath, offset, length, this);
+    job->setVerifyCommand(ddReadCommand(remotePath, offset, length) + " | md5sum");
+    job->start();
+    return job;
+}
+
+/**
+ * Crea el archivo remoto con su tamaño final para poder escribir rangos en cualquier orden
+ */
+bool AdbProcessTransport::prepareRangedWrite(const QString &remotePath, qint64 size, QString *errorMessage)
+{
+    QString directory = QFileInfo(remotePath).path();
+    QString command = QString("mkdir -p %1 && truncate -s %2 %3")
+        .arg(shellQuote(directory)).arg(size).arg(shellQuote(remotePath));
+    return runAdb(QStringList() << "shell" << command, nullptr, errorMessage);
+}
+
+/**
+ * Escribe un rango con dd (exec-in) sin truncar y lo verifica con md5sum
+ */
+TransportJob *AdbProcessTransport::writeRange(const QString &localPath, const QString &remotePath, qint64 offset, qint64 length)
+{
+    QString writeCommand = QString("dd of=%1 bs=1048576 oflag=seek_bytes seek=%2 conv=notrunc 2>/dev/null")
+        .arg(shellQuote(remotePath)).arg(offset);
+    AdbRangeWriteJob *job = new AdbRangeWriteJob(m_adbPath, deviceId(), writeCommand,
+                                                 ddReadCommand(remotePath, offset, length) + " | md5sum",
+                                                 localPath, offset, length, this);
+    job->start();
+    return job;
+}
+
+bool AdbProcessTransport::supportsDelta() const
+{
+    return true;
+}
+
+/**
+ * Firma por bloques calculada en el dispositivo, sin bloquear el hilo del motor
+ */
+DeltaSignatureJob *AdbProcessTransport::blockSignature(const QString &remotePath, qint64 blockSize)
+{
+    return new AdbDeltaSignatureJob(m_adbPath, deviceId(), remotePath, blockSize, this);
+}
+
+namespace {
+
+/**
+ * Delta con adb: copia del archivo actual (.mdbpart), rangos literales sobre la copia y mv
+ *
+ * El archivo existente no se toca hasta el mv final; si algo falla la copia se borra.
+ */
+class AdbDeltaApplyJob : public TransportJob
+{
+public:
+    AdbDeltaApplyJob(AdbProcessTransport *transport, const QString &adbPath, const QString &localPath,
+                     const QString &remotePath, const QList<QPair<qint64, qint64>> &literalRanges, QObject *parent)
+        : TransportJob(parent)
+        , m_transport(transport)
+        , m_adbPath(adbPath)
+        , m_localPath(localPath)
+        , m_remotePath(remotePath)
+        , m_partPath(remotePath + ".mdbpart")
+        , m_literalRanges(literalRanges)
+    {
+    }
+
+    void start()
+    {
+        runShell(QString("cp %1 %2").arg(AdbProcessTransport::shellQuote(m_remotePath),
+                                         AdbProcessTransport::shellQuote(m_partPath)),
+                 "Copia del archivo base", [this]() { writeLiterals(); });
+    }
+
+    void abort() override
+    {
+        if (m_step) {
+            disconnect(m_step, nullptr, this, nullptr);
+            m_step->abort();
+        }
+        fail("Operación cancelada");
+    }
+
+private:
+    void runShell(const QString &command, const QString &description, std::function<void()> next)
+    {
+        QStringList arguments;
+        arguments << "-s" << m_transport->deviceId() << "shell" << command;
+        ProcessTransportJob *job = new ProcessTransportJob(m_adbPath, arguments, description, this);
+        track(job, next);
+        job->start();
+    }
+
+    void writeLiterals()
+    {
+        RangedTransferJob *job = new RangedTransferJob(m_transport, RangedTransferJob::Write, m_partPath, m_localPath,
+                                                       RangedTransferJob::DEFAULT_RANGE_SIZE, this);
+        job->setRanges(m_literalRanges);
+        connect(job, &TransportJob::progress, this, &TransportJob::progress);
+        track(job, [this]() {
+            runShell(QString("mv -f %1 %2").arg(AdbProcessTransport::shellQuote(m_partPath),
+                                                AdbProcessTransport::shellQuote(m_remotePath)),
+                     "Sustitución del archivo", [this]() { complete(true); });
+        });
+        job->start();
+    }
+
+    void track(TransportJob *job, std::function<void()> next)
+    {
+        m_step = job;
+        connect(job, &TransportJob::finished, job, &QObject::deleteLater);
+        connect(job, &TransportJob::finished, this, [this, next](bool success, const QString &errorMessage) {
+            m_step = nullptr;
+            if (!success) {
+                fail(errorMessage);
+                return;
+            }
+            next();
+        });
+    }
+
+    void fail(const QString &errorMessage)
+    {
+        if (isFinished()) return;
+
+        // Sin esperar al borrado: la versión anterior sigue intacta en su sitio
+        QProcess::startDetached(m_adbPath, QStringList() << "-s" << m_transport->deviceId() << "shell"
+                                                         << "rm -f " + AdbProcessTransport::shellQuote(m_partPath));
+        complete(false, errorMessage);
+    }
+
+    AdbProcessTransport *m_transport;
+    QString m_adbPath;
+    QString m_localPath;
+    QString m_remotePath;
+    QString m_partPath;
+    QList<QPair<qint64, qint64>> m_literalRanges;
+    QPointer<TransportJob> m_step;
+};
+
+} // namespace
+
+/**
+ * Aplica el delta sobre una copia del archivo en el dispositivo y la mueve a su sitio
+ */
+TransportJob *AdbProcessTransport::applyDelta(const QString &localPath, const QString &remotePath, const QList<DeltaOp> &ops)
+{
+    // La copia conserva los bloques en su posición: los que se movieron se envían como literales
+    QList<QPair<qint64, qint64>> literalRanges;
+    for (const DeltaOp &op : ops) {
+        if (op.type == DeltaOp::Literal || op.basisOffset != op.offset) {
+            literalRanges.append(qMakePair(op.offset, op.length));
+        }
+    }
+
+    AdbDeltaApplyJob *job = new AdbDeltaApplyJob(this, m_adbPath, localPath, remotePath, literalRanges, this);
+    job->start();
+    return job;
+}
+
+namespace {
+
+/**
+ * Ejecuta una petición sobre AdbSocketClient en el hilo de su socket, sin bloquear
+ *
+ * El motor de transferencia corre en su propio hilo y AdbSocketClient pertenece al
+ * hilo de la interfaz (que a su vez encola la escritura en su hilo de E/S): la llamada
+ * se encola allí y, si falla, onFailure se ejecuta de vuelta en el hilo del job
+ * (nunca de forma síncrona).
+ */
+void postToBridgeClient(AdbSocketClient *client, QObject *job,
+                        std::function<bool(AdbSocketClient*)> call, std::function<void()> onFailure)
+{
+    QPointer<QObject> guard(job);
+    if (!client) {
+        QMetaObject::invokeMethod(job, onFailure, Qt::QueuedConnection);
+        return;
+    }
+    QMetaObject::invokeMethod(client, [client, guard, call, onFailure]() {
+        if (call(client)) return;
+        if (guard) QMetaObject::invokeMethod(guard, onFailure, Qt::QueuedConnection);
+    }, Qt::QueuedConnection);
+}
+
+/**
+ * Lectura vía Bridge Client: GET_FILE -> FILE_READY (ruta de intercambio) -> adb pull
+ */
+class BridgeReadJob : public TransportJob
+{
+public:
+    BridgeReadJob(AdbSocketClient *client, const QString &remotePath, QObject *parent,
+                  std::function<ProcessTransportJob*(const QString&)> makePull)
+        : TransportJob(parent)
+        , m_client(client)
+        , m_remotePath(remotePath)
+        , m_makePull(makePull)
+    {
+    }
+
+    void start()
+    {
+        if (!m_client) {
+            QTimer::singleShot(0, this, [this]() { complete(false, "Bridge Client no disponible"); });
+            return;
+        }
+
+        connect(m_client, &AdbSocketClient::fileReady, this, [this](const QString &stagedPath) {
+            if (m_pull || isFinished()) return;
+            disconnect(m_client, nullptr, this, nullptr);
+            m_pull = m_makePull(stagedPath);
+            connect(m_pull, &TransportJob::finished, this, [this](bool success, const QString &error) {
+                complete(success, error);
+            });
+            m_pull->start();
+        });
+        connect(m_client, &AdbSocketClient::fileTransferProgress, this,
+                [this](const QString &, qint64 bytesReceived, qint64 totalBytes) {
+            emit progress(bytesReceived, totalBytes);
+        });
+        connect(m_client, &AdbSocketClient::errorOccurred, this, [this](const QString &error) {
+            if (m_pull) return;
+            disconnect(m_client, nullptr, this, nullptr);
+            complete(false, "Error en Bridge Client: " + error);
+        });
+
+        QString remotePath = m_remotePath;
+        postToBridgeClient(m_client, this, [remotePath](AdbSocketClient *client) {
+            if (!client->isConnected()) return false;
+            client->setRole("source");
+            return client->requestFile(remotePath);
+        }, [this]() {
+            if (m_client) disconnect(m_client, nullptr, this, nullptr);
+            complete(false, "No se pudo solicitar el archivo a Bridge Client");
+        });
+    }
+
+    void abort() override
+    {
+        if (m_client) disconnect(m_client, nullptr, this, nullptr);
+        if (m_pull) m_pull->abort();
+        complete(false, "Operación cancelada");
+    }
+
+private:
+    QPointer<AdbSocketClient> m_client;
+    QString m_remotePath;
+    std::function<ProcessTransportJob*(const QString&)> m_makePull;
+    QPointer<ProcessTransportJob> m_pull;
+};
+
+/**
+ * Escritura vía Bridge Client: adb push a la ruta de intercambio -> SAVE_FILE -> FILE_SAVED
+ */
+class BridgeWriteJob : public TransportJob
+{
+public:
+    BridgeWriteJob(AdbSocketClient *client, ProcessTransportJob *push, const QString &stagedPath,
+                   const QString &remotePath, qint64 size, QObject *parent)
+        : TransportJob(parent)
+        , m_client(client)
+        , m_push(push)
+        , m_stagedPath(stagedPath)
+        , m_remotePath(remotePath)
+        , m_size(size)
+    {
+    }
+
+    void start()
+    {
+        connect(m_push, &TransportJob::finished, this, [this](bool success, const QString &error) {
+            if (!success) {
+                complete(false, error);
+                return;
+            }
+            requestSave();
+        });
+        m_push->start();
+    }
+
+    void abort() override
+    {
+        if (m_client) disconnect(m_client, nullptr, this, nullptr);
+        if (m_push) m_push->abort();
+        complete(false, "Operación cancelada");
+    }
+
+private:
+    void requestSave()
+    {
+        if (!m_client) {
+            complete(false, "Bridge Client destino no disponible");
+            return;
+        }
+
+        connect(m_client, &AdbSocketClient::fileSaved, this, [this](const QString &result) {
+            disconnect(m_client, nullptr, this, nullptr);
+            if (result.startsWith("OK")) {
+                complete(true);
+            } else {
+                complete(false, "Bridge Client no pudo guardar el archivo: " + result);
+            }
+        });
+        connect(m_client, &AdbSocketClient::errorOccurred, this, [this](const QString &error) {
+            disconnect(m_client, nullptr, this, nullptr);
+            complete(false, "Error en Bridge Client: " + error);
+        });
+
+        QJsonObject fileInfo;
+        fileInfo["path"] = m_stagedPath;
+        fileInfo["name"] = QFileInfo(m_remotePath).fileName();
+        fileInfo["destination"] = m_remotePath;
+        fileInfo["size"] = m_size;
+
+        QString fileInfoJson = QString::fromUtf8(QJsonDocument(fileInfo).toJson(QJsonDocument::Compact));
+        postToBridgeClient(m_client, this, [fileInfoJson](AdbSocketClient *client) {
+            if (!client->isConnected()) return false;
+            client->setRole("destination");
+            return client->saveFile(fileInfoJson);
+        }, [this]() {
+            if (m_client) disconnect(m_client, nullptr, this, nullptr);
+            complete(false, "No se pudo enviar SAVE_FILE a Bridge Client");
+        });
+    }
+
+    QPointer<AdbSocketClient> m_client;
+    QPointer<ProcessTransportJob> m_push;
+    QString m_stagedPath;
+    QString m_remotePath;
+    qint64 m_size;
+};
+
+/**
+ * Registros completos vía Bridge Client: GET_CONTACTS/GET_MESSAGES con una página de ids
+ */
+class BridgeRecordFetchJob : public RecordFetchJob
+{
+public:
+    BridgeRecordFetchJob(AdbSocketClient *client, const QString &dataType, const QStringList &ids, QObject *parent)
+        : RecordFetchJob(parent)
+        , m_client(client)
+        , m_dataType(dataType)
+        , m_ids(ids)
+        , m_requested(false)
+    {
+        m_timeout.setSingleShot(true);
+        m_timeout.setInterval(REQUEST_TIMEOUT);
+        connect(&m_timeout, &QTimer::timeout, this, [this]() {
+            if (m_client) disconnect(m_client, nullptr, this, nullptr);
+            complete(false, "Bridge Client no respondió a tiempo a la petición de registros");
+        });
+    }
+
+    void start()
+    {
+        if (!m_client) {
+            QTimer::singleShot(0, this, [this]() { complete(false, "Bridge Client no disponible"); });
+            return;
+        }
+
+        // Las respuestas no llevan etiqueta: durante un escaneo del análisis, los lotes de
+        // contactos/mensajes serían los suyos. Se espera a que termine para pedir la página.
+        if (m_client->isScanning()) {
+            qDebug() << "Esperando a que termine el escaneo de Bridge Client para pedir registros";
+            connect(m_client, &AdbSocketClient::scanCompleted, this, [this]() { request(); });
+            connect(m_client, &AdbSocketClient::scanError, this, [this]() { request(); });
+            connect(m_client, &AdbSocketClient::disconnected, this, [this]() { request(); });
+            if (m_client->isScanning()) return;
+        }
+        request();
+    }
+
+    void abort() override
+    {
+        m_timeout.stop();
+        if (m_client) disconnect(m_client, nullptr, this, nullptr);
+        complete(false, "Operación cancelada");
+    }
+
+private:
+    void request()
+    {
+        if (m_requested || isFinished()) return;
+        if (!m_client) {
+            complete(false, "Bridge Client no disponible");
+            return;
+        }
+        m_requested = true;
+        disconnect(m_client, nullptr, this, nullptr);
+
+        if (m_dataType == "contacts") {
+            connect(m_client, &AdbSocketClient::contactsDataReceived, this, [this](const QList<DataItem> &items) {
+                finish(items);
+            });
+        } else {
+            connect(m_client, &AdbSocketClient::messagesDataReceived, this, [this](const QList<DataItem> &items) {
+                finish(items);
+            });
+        }
+        connect(m_client, &AdbSocketClient::errorOccurred, this, [this](const QString &error) {
+            disconnect(m_client, nullptr, this, nullptr);
+            complete(false, "Error en Bridge Client: " + error);
+        });
+
+        QString dataType = m_dataType;
+        QStringList ids = m_ids;
+        m_timeout.start();
+        postToBridgeClient(m_client, this, [dataType, ids](AdbSocketClient *client) {
+            if (!client->isConnected()) return false;
+            return dataType == "contacts" ? client->requestContacts(ids) : client->requestMessages(ids);
+        }, [this]() {
+            m_timeout.stop();
+            if (m_client) disconnect(m_client, nullptr, this, nullptr);
+            complete(false, "No se pudieron solicitar los registros a Bridge Client");
+        });
+    }
+
+    void finish(const QList<DataItem> &records)
+    {
+        m_timeout.stop();
+        if (m_client) disconnect(m_client, nullptr, this, nullptr);
+        setRecords(records);
+        complete(true);
+    }
+
+    QPointer<AdbSocketClient> m_client;
+    QString m_dataType;
+    QStringList m_ids;
+    bool m_requested;
+    QTimer m_timeout;
+
+    static const int REQUEST_TIMEOUT = 60000; // Una página de registros completos
+};
+
+} // namespace
+
+/**
+ * Constructor de BridgeClientTransport
+ */
+BridgeClientTransport::BridgeClientTransport(const QString &deviceId, const QString &adbPath,
+                                             AdbSocketClient *bridgeClient, QObject *parent)
+    : AdbProcessTransport(deviceId, adbPath, parent)
+    , m_bridgeClient(bridgeClient)
+{
+}
+
+QString BridgeClientTransport::kind() const
+{
+    return "bridge";
+}
+
+QString BridgeClientTransport::stagingDirectory()
+{
+    return "/sdcard/MobileDataBridge/.incoming/";
+}
+
+TransportJob *BridgeClientTransport::readToFile(const QString &remotePath, const QString &localPath)
+{
+    BridgeReadJob *job = new BridgeReadJob(m_bridgeClient, remotePath, this,
+                                           [this, localPath](const QString &stagedPath) {
+        return createAdbJob(QStringList() << "pull" << stagedPath << localPath,
+                            QString("adb pull '%1'").arg(stagedPath));
+    });
+    job->start();
+    return job;
+}
+
+TransportJob *BridgeClientTransport::writeFromFile(const QString &localPath, const QString &remotePath)
+{
+    makeDirectory(stagingDirectory());
+
+    QString stagedPath = stagingDirectory() + QFileInfo(remotePath).fileName();
+    ProcessTransportJob *push = createAdbJob(QStringList() << "push" << localPath << stagedPath,
+                                             QString("adb push '%1'").arg(stagedPath));
+    BridgeWriteJob *job = new BridgeWriteJob(m_bridgeClient, push, stagedPath, remotePath,
+                                             QFileInfo(localPath).size(), this);
+    job->start();
+    return job;
+}
+
+int BridgeClientTransport::maxConcurrentJobs() const
+{
+    // Las respuestas FILE_READY/FILE_SAVED no identifican la petición: una a la vez
+    return 1;
+}
+
+bool BridgeClientTransport::supportsRangedReads() const
+{
+    // Bridge Client aún no implementa GET_FILE_RANGE: los archivos grandes van enteros con GET_FILE
+    return false;
+}
+
+bool BridgeClientTransport::supportsRangedWrites() const
+{
+    // SAVE_FILE solo admite archivos completos
+    return false;
+}
+
+bool BridgeClientTransport::supportsDelta() const
+{
+    return false;
+}
+
+/**
+ * Contactos y mensajes se piden a Bridge Client (sus ids son los de Bridge); el resto, por adb
+ */
+RecordFetchJob *BridgeClientTransport::fetchRecords(const QString &dataType, const QStringList &ids)
+{
+    if (dataType != "contacts" && dataType != "messages") {
+        return AdbProcessTransport::fetchRecords(dataType, ids);
+    }
+
+    BridgeRecordFetchJob *job = new BridgeRecordFetchJob(m_bridgeClient, dataType, ids, this);
+    job->start();
+    return job;
+}
+
+/**
+ * Constructor de LocalDirectoryTransport
+ */
+LocalDirectoryTransport::LocalDirectoryTransport(const QString &deviceId, const QString &rootPath, QObject *parent)
+    : DeviceTransport(deviceId, parent)
+    , m_rootPath(QDir::cleanPath(QFileInfo(rootPath).absoluteFilePath()))
+{
+}
+
+QString LocalDirectoryTransport::kind() const
+{
+    return "local";
+}
+
+/**
+ * Resuelve una ruta del dispositivo dentro de la raíz local
+ */
+QString LocalDirectoryTransport::hostPath(const QString &path) const
+{
+    QString resolved = QDir::cleanPath(m_rootPath + "/" + path);
+    if (resolved != m_rootPath && !resolved.startsWith(m_rootPath + "/")) {
+        qWarning() << "Ruta fuera de la raíz del dispositivo local:" << path;
+        return QString();
+    }
+    return resolved;
+}
+
+bool LocalDirectoryTransport::listDirectory(const QString &path, QList<TransportEntry> &entries, QString *errorMessage)
+{
+    QString dirPath = hostPath(path);
+    QDir dir(dirPath);
+    if (dirPath.isEmpty() || !dir.exists()) {
+        if (errorMessage) *errorMessage = QString("Directorio no encontrado: %1").arg(path);
+        return false;
+    }
+
+    entries.clear();
+    const QFileInfoList infos = dir.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden);
+    for (const QFileInfo &info : infos) {
+        TransportEntry entry;
+        entry.path = QDir::cleanPath(path + "/" + info.fileName());
+        entry.size = info.size();
+        entry.modified = info.lastModified();
+        entry.isDirectory = info.isDir();
+        entries.append(entry);
+    }
+    return true;
+}
+
+bool LocalDirectoryTransport::statPath(const QString &path, TransportEntry &entry, QString *errorMessage)
+{
+    QString filePath = hostPath(path);
+    QFileInfo info(filePath);
+    if (filePath.isEmpty() || !info.exists()) {
+        if (errorMessage) *errorMessage = QString("Ruta no encontrada: %1").arg(path);
+        return false;
+    }
+
+    entry.path = path;
+    entry.size = info.size();
+    entry.modified = info.lastModified();
+    entry.isDirectory = info.isDir();
+    return true;
+}
+
+bool LocalDirectoryTransport::makeDirectory(const QString &path, QString *errorMessage)
+{
+    QString dirPath = hostPath(path);
+    if (dirPath.isEmpty() || !QDir().mkpath(dirPath)) {
+        if (errorMessage) *errorMessage = QString("No se pudo crear el directorio: %1").arg(path);
+        return false;
+    }
+    return true;
+}
+
+bool LocalDirectoryTransport::removePath(const QString &path, QString *errorMessage)
+{
+    QString filePath = hostPath(path);
+    QFileInfo info(filePath);
+    if (filePath.isEmpty() || filePath == m_rootPath) {
+        if (errorMessage) *errorMessage = QString("Ruta no válida para borrar: %1").arg(path);
+        return false;
+    }
+
+    bool removed = info.isDir() ? QDir(filePath).removeRecursively() : QFile::remove(filePath);
+    if (!removed && errorMessage) *errorMessage = QString("No se pudo borrar: %1").arg(path);
+    return removed;
+}
+
+TransportJob *LocalDirectoryTransport::readToFile(const QString &remotePath, const QString &localPath)
+{
+    LocalCopyJob *job = new LocalCopyJob(hostPath(remotePath), localPath, this);
+    job->start();
+    return job;
+}
+
+TransportJob *LocalDirectoryTransport::writeFromFile(const QString &localPath, const QString &remotePath)
+{
+    QString destPath = hostPath(remotePath);
+    if (!destPath.isEmpty()) {
+        QDir().mkpath(QFileInfo(destPath).absolutePath());
+    }
+    LocalCopyJob *job = new LocalCopyJob(localPath, destPath, this);
+    job->start();
+    return job;
+}
+
+int LocalDirectoryTransport::maxConcurrentJobs() const
+{
+    return 4;
+}
+
+bool LocalDirectoryTransport::supportsRangedReads() const
+{
+    return true;
+}
+
+bool LocalDirectoryTransport::supportsRangedWrites() const
+{
+    return true;
+}
+
+TransportJob *LocalDirectoryTransport::readRange(const QString &remotePath, qint64 offset, qint64 length, const QString &localPath)
+{
+    LocalCopyJob *job = LocalCopyJob::createRangeCopy(hostPath(remotePath), offset, length, localPath, this);
+    job->start();
+    return job;
+}
+
+bool LocalDirectoryTransport::prepareRangedWrite(const QString &remotePath, qint64 size, QString *errorMessage)
+{
+    QString destPath = hostPath(remotePath);
+    if (destPath.isEmpty() || !QDir().mkpath(QFileInfo(destPath).absolutePath())) {
+        if (errorMessage) *errorMessage = QString("Ruta de destino no válida: %1").arg(remotePath);
+        return false;
+    }
+
+    QFile file(destPath);
+    if (!file.open(QIODevice::ReadWrite) || !file.resize(size)) {
+        if (errorMessage) *errorMessage = QString("No se pudo preparar %1: %2").arg(remotePath, file.errorString());
+        return false;
+    }
+    return true;
+}
+
+TransportJob *LocalDirectoryTransport::writeRange(const QString &localPath, const QString &remotePath, qint64 offset, qint64 length)
+{
+    LocalCopyJob *job = LocalCopyJob::createRangeCopy(localPath, offset, length, hostPath(remotePath), this);
+    job->start();
+    return job;
+}
+
+bool LocalDirectoryTransport::supportsDelta() const
+{
+    return true;
+}
+
+DeltaSignatureJob *LocalDirectoryTransport::blockSignature(const QString &remotePath, qint64 blockSize)
+{
+    QString filePath = hostPath(remotePath);
+    if (filePath.isEmpty() || !QFileInfo(filePath).isFile()) {
+        return new FailedDeltaSignatureJob(QString("Archivo no encontrado: %1").arg(remotePath), this);
+    }
+    return new LocalDeltaSignatureJob(filePath, blockSize, this);
+}
+
+TransportJob *LocalDirectoryTransport::applyDelta(const QString &localPath, const QString &remotePath, const QList<DeltaOp> &ops)
+{
+    DeltaApplyJob *job = new DeltaApplyJob(hostPath(remotePath), localPath, ops, this);
+    job->start();
+    return job;
+}
+
+/**
+ * Constructor de ArchiveTransport
+ */
+ArchiveTransport::ArchiveTransport(const QString &deviceId, const QString &archivePath, QObject *parent)
+    : DeviceTransport(deviceId, parent)
+    , m_archivePath(archivePath)
+    , m_reader(nullptr)
+    , m_writer(nullptr)
+{
+}
+
+ArchiveTransport::~ArchiveTransport()
+{
+    finalize();
+}
+
+QString ArchiveTransport::kind() const
+{
+    return "archive";
+}
+
+bool ArchiveTransport::ensureReader(QString *errorMessage)
+{
+    if (m_reader) return true;
+
+    m_reader = new BackupArchiveReader();
+    if (!m_reader->open(m_archivePath, errorMessage)) {
+        delete m_reader;
+        m_reader = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool ArchiveTransport::ensureWriter(QString *errorMessage)
+{
+    if (m_writer) return true;
+
+    // El lector no debe mantener mapeado un índice que va a quedar obsoleto
+    delete m_reader;
+    m_reader = nullptr;
+
+    m_writer = new BackupArchiveWriter();
+    if (!m_writer->open(m_archivePath, errorMessage)) {
+        delete m_writer;
+        m_writer = nullptr;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Lista las rutas del índice que cuelgan directamente de un directorio
+ */
+bool ArchiveTransport::listDirectory(const QString &path, QList<TransportEntry> &entries, QString *errorMessage)
+{
+    if (!ensureReader(errorMessage)) return false;
+
+    QString prefix = path.endsWith('/') ? path : path + '/';
+    entries.clear();
+    for (int i = 0; i < m_reader->entryCount(); ++i) {
+        BackupArchiveEntry archived = m_reader->entry(i);
+        const QString &filePath = archived.item.filePath;
+        if (!filePath.startsWith(prefix) || filePath.indexOf('/', prefix.size()) != -1) continue;
+
+        TransportEntry entry;
+        entry.path = filePath;
+        entry.size = archived.dataSize;
+        entry.modified = archived.item.dateTime;
+        entry.isDirectory = false;
+        entries.append(entry);
+    }
+    return true;
+}
+
+bool ArchiveTransport::statPath(const QString &path, TransportEntry &entry, QString *errorMessage)
+{
+    if (!ensureReader(errorMessage)) return false;
+
+    int index = m_reader->findEntry(path);
+    if (index < 0) {
+        if (errorMessage) *errorMessage = QString("Ruta no encontrada en el respaldo: %1").arg(path);
+        return false;
+    }
+
+    BackupArchiveEntry archived = m_reader->entry(index);
+    entry.path = path;
+    entry.size = archived.dataSize;
+    entry.modified = archived.item.dateTime;
+    entry.isDirectory = false;
+    return true;
+}
+
+bool ArchiveTransport::makeDirectory(const QString &path, QString *errorMessage)
+{
+    // Los directorios no existen como tales dentro del respaldo
+    Q_UNUSED(path);
+    Q_UNUSED(errorMessage);
+    return true;
+}
+
+bool ArchiveTransport::removePath(const QString &path, QString *errorMessage)
+{
+    // Formato append-only: no se borran entradas
+    if (errorMessage) *errorMessage = QString("No se puede borrar %1 de un archivo de respaldo").arg(path);
+    return false;
+}
+
+/**
+ * Extrae el contenido de una entrada copiando solo su rango de bytes
+ */
+TransportJob *ArchiveTransport::readToFile(const QString &remotePath, const QString &localPath)
+{
+    QString error;
+    int index = ensureReader(&error) ? m_reader->findEntry(remotePath) : -1;
+    if (index < 0) {
+        LocalCopyJob *job = new LocalCopyJob(QString(), localPath, this);
+        job->start(); // Falla de forma diferida con ruta vacía
+        return job;
+    }
+
+    BackupArchiveEntry archived = m_reader->entry(index);
+    LocalCopyJob *job = new LocalCopyJob(m_archivePath, archived.dataOffset, archived.dataSize, localPath, this);
+    job->start();
+    return job;
+}
+
+TransportJob *ArchiveTransport::writeFromFile(const QString &localPath, const QString &remotePath)
+{
+    DataItem item;
+    item.id = remotePath;
+    item.displayName = QFileInfo(remotePath).fileName();
+    item.filePath = remotePath;
+    item.size = QFileInfo(localPath).size();
+    return writeItem(QString(), item, localPath, remotePath);
+}
+
+/**
+ * Añade el contenido y los metadatos del elemento al final del respaldo
+ */
+TransportJob *ArchiveTransport::writeItem(const QString &dataType, const DataItem &item,
+                                          const QString &localPath, const QString &remotePath)
+{
+    Q_UNUSED(remotePath); // Se conserva la ruta original del elemento para poder restaurarlo
+
+    QString error;
+    if (!ensureWriter(&error) || !m_writer->beginEntry(dataType, item)) {
+        qWarning() << "No se pudo escribir en el respaldo:" << m_archivePath << error;
+        LocalCopyJob *job = new LocalCopyJob(localPath, QString(), this);
+        job->start(); // Falla de forma diferida con destino vacío
+        return job;
+    }
+
+    LocalCopyJob *job = new LocalCopyJob(localPath, m_writer, this);
+    job->start();
+    return job;
+}
+
+bool ArchiveTransport::supportsRecords() const
+{
+    return true;
+}
+
+bool ArchiveTransport::storeRecord(const QString &dataType, const DataItem &item, QString *errorMessage)
+{
+    if (!ensureWriter(errorMessage)) return false;
+    return m_writer->appendRecord(dataType, item);
+}
+
+/**
+ * Escribe el índice si se añadió algo y libera lector/escritor
+ */
+bool ArchiveTransport::finalize(QString *errorMessage)
+{
+    bool ok = true;
+    if (m_writer) {
+        ok = m_writer->finish(errorMessage);
+        delete m_writer;
+        m_writer = nullptr;
+    }
+    delete m_reader;
+    m_reader = nullptr;
+    return ok;
+}
+
+/**
+ * Constructor de LocalCopyJob
+ */
+LocalCopyJob::LocalCopyJob(const QString &sourcePath, const QString &destPath, QObject *parent)
+    : TransportJob(parent)
+    , m_source(sourcePath)
+    , m_dest(destPath)
+    , m_archiveWriter(nullptr)
+    , m_sourceOffset(0)
+    , m_length(-1)
+    , m_copied(0)
+    , m_total(0)
+    , m_destOffset(-1)
+    , m_hash(QCryptographicHash::Md5)
+    , m_aborted(false)
+{
+}
+
+LocalCopyJob::LocalCopyJob(const QString &sourcePath, qint64 sourceOffset, qint64 length,
+                           const QString &destPath, QObject *parent)
+    : LocalCopyJob(sourcePath, destPath, parent)
+{
+    m_sourceOffset = sourceOffset;
+    m_length = length;
+}
+
+LocalCopyJob::LocalCopyJob(const QString &sourcePath, BackupArchiveWriter *writer, QObject *parent)
+    : LocalCopyJob(sourcePath, QString(), parent)
+{
+    m_archiveWriter = writer;
+}
+
+LocalCopyJob *LocalCopyJob::createRangeCopy(const QString &sourcePath, qint64 offset, qint64 length,
+                                            const QString &destPath, QObject *parent)
+{
+    LocalCopyJob *job = new LocalCopyJob(sourcePath, offset, length, destPath, parent);
+    job->m_destOffset = offset;
+    return job;
+}
+
+void LocalCopyJob::start()
+{
+    if (m_source.fileName().isEmpty() || (m_dest.fileName().isEmpty() && !m_archiveWriter)) {
+        QTimer::singleShot(0, this, [this]() { fail("Ruta de origen o destino no válida"); });
+        return;
+    }
+    if (!m_source.open(QIODevice::ReadOnly) || !m_source.seek(m_sourceOffset)) {
+        QString error = QString("No se pudo abrir %1: %2").arg(m_source.fileName(), m_source.errorString());
+        QTimer::singleShot(0, this, [this, error]() { fail(error); });
+        return;
+    }
+    bool destOpened = m_archiveWriter
+        || (m_destOffset >= 0 ? m_dest.open(QIODevice::ReadWrite) && m_dest.seek(m_destOffset)
+                              : m_dest.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    if (!destOpened) {
+        QString error = QString("No se pudo crear %1: %2").arg(m_dest.fileName(), m_dest.errorString());
+        QTimer::singleShot(0, this, [this, error]() { fail(error); });
+        return;
+    }
+
+    m_total = m_length >= 0 ? m_length : m_source.size() - m_sourceOffset;
+    QTimer::singleShot(0, this, &LocalCopyJob::copyNextBlock);
+}
+
+void LocalCopyJob::abort()
+{
+    m_aborted = true;
+    fail("Operación cancelada");
+}
+
+/**
+ * Cierra los archivos, descarta el destino parcial y termina con error
+ */
+void LocalCopyJob::fail(const QString &errorMessage)
+{
+    if (isFinished()) return;
+
+    m_source.close();
+    if (m_dest.isOpen()) {
+        m_dest.close();
+        // En escritura posicional el destino contiene otros rangos válidos
+        if (m_destOffset < 0) m_dest.remove();
+    }
+    if (m_archiveWriter) {
+        m_archiveWriter->abortEntry();
+    }
+    complete(false, errorMessage);
+}
+
+/**
+ * Copia un bloque y reprograma la siguiente iteración
+ */
+void LocalCopyJob::copyNextBlock()
+{
+    if (m_aborted || isFinished()) return;
+
+    QByteArray block = m_source.read(qMin(BLOCK_SIZE, m_total - m_copied));
+    if (!block.isEmpty()) {
+        if (m_destOffset >= 0) m_hash.addData(block);
+        bool written = m_archiveWriter ? m_archiveWriter->writeData(block.constData(), block.size())
+                                       : m_dest.write(block) == block.size();
+        if (!written) {
+            fail(QString("Error escribiendo %1: %2").arg(m_dest.fileName(), m_dest.errorString()));
+            return;
+        }
+    }
+
+    m_copied += block.size();
+    emit progress(m_copied, m_total);
+
+    if (block.isEmpty() || m_copied >= m_total) {
+        if (m_copied < m_total) {
+            fail(QString("Lectura incompleta de %1").arg(m_source.fileName()));
+            return;
+        }
+        if (m_destOffset >= 0 && !verifyDestinationRange()) {
+            fail(QString("Verificación MD5 fallida en %1 (offset %2)").arg(m_dest.fileName()).arg(m_destOffset));
+            return;
+        }
+        m_source.close();
+        if (m_archiveWriter) {
+            m_archiveWriter->endEntry();
+        } else {
+            m_dest.close();
+        }
+        complete(true);
+        return;
+    }
+
+    QTimer::singleShot(0, this, &LocalCopyJob::copyNextBlock);
+}
+
+/**
+ * Relee el rango escrito y compara su MD5 con el de los bytes de origen
+ */
+bool LocalCopyJob::verifyDestinationRange()
+{
+    if (!m_dest.flush() || !m_dest.seek(m_destOffset)) return false;
+
+    QCryptographicHash written(QCryptographicHash::Md5);
+    qint64 remaining = m_total;
+    while (remaining > 0) {
+        QByteArray block = m_dest.read(qMin(BLOCK_SIZE, remaining));
+        if (block.isEmpty()) return false;
+        written.addData(block);
+        remaining -= block.size();
+    }
+    return written.result() == m_hash.result();
+}
@@ -0,0 +1,624 @@
+#ifndef DEVICETRANSPORT_H
+#define DEVICETRANSPORT_H
+
+#include <QObject>
+#include <QProcess>
+#include <QDateTime>
+#include <QList>
+#include <QFile>
+#include <QPointer>
+#include <QCryptographicHash>
+#include "dataitemstore.h"
+
+class DeviceManager;
+class AdbSocketClient;
+class BackupArchiveReader;
+class BackupArchiveWriter;
+class DeltaSignatureJob;
+struct DeltaOp;
+
+// Entrada de un listado de directorio o resultado de stat
+struct TransportEntry {
+    QString path;         // Ruta en el dispositivo (o relativa a la raíz en el backend local)
+    qint64 size;          // Tamaño en bytes
+    QDateTime modified;   // Fecha de última modificación
+    bool isDirectory;     // Si la entrada es un directorio
+};
+
+/**
+ * @class TransportJob
+ * @brief Operación asíncrona de lectura/escritura de un transporte
+ *
+ * Cada llamada a readToFile()/writeFromFile() devuelve un TransportJob que emite
+ * finished() exactamente una vez, nunca de forma síncrona dentro de la llamada que
+ * lo crea. El consumidor es responsable de liberarlo (normalmente con deleteLater()
+ * tras recibir finished()).
+ */
+class TransportJob : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief Constructor
+     * @param parent Objeto padre (opcional)
+     */
+    explicit TransportJob(QObject *parent = nullptr);
+
+    /**
+     * @brief Indica si la operación ya terminó
+     */
+    bool isFinished() const;
+
+    /**
+     * @brief Indica si la operación terminó correctamente
+     */
+    bool succeeded() const;
+
+    /**
+     * @brief Mensaje de error de la operación (vacío si tuvo éxito)
+     */
+    QString errorMessage() const;
+
+    /**
+     * @brief Aborta la operación en curso; finished() se emite con error
+     */
+    virtual void abort();
+
+signals:
+    /**
+     * @brief Señal emitida para reportar progreso de la operación
+     * @param bytesDone Bytes procesados
+     * @param bytesTotal Bytes totales (-1 si se desconoce)
+     */
+    void progress(qint64 bytesDone, qint64 bytesTotal);
+
+    /**
+     * @brief Señal emitida cuando la operación termina
+     * @param success true si fue exitosa
+     * @param errorMessage Mensaje de error (vacío si fue exitosa)
+     */
+    void finished(bool success, const QString &errorMessage);
+
+protected:
+    /**
+     * @brief Marca la operación como terminada y emite finished() una sola vez
+     * @param success true si fue exitosa
+     * @param errorMessage Mensaje de error
+     */
+    void complete(bool success, const QString &errorMessage = QString());
+
+private:
+    bool m_finished;
+    bool m_success;
+    QString m_errorMessage;
+};
+
+/**
+ * @class ProcessTransportJob
+ * @brief TransportJob respaldado por un proceso externo (adb pull/push, etc.)
+ */
+class ProcessTransportJob : public TransportJob
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief Constructor
+     * @param program Ejecutable a lanzar
+     * @param arguments Argumentos del proceso
+     * @param description Descripción de la operación para mensajes de error
+     * @param parent Objeto padre (opcional)
+     */
+    ProcessTransportJob(const QString &program, const QStringList &arguments,
+                        const QString &description, QObject *parent = nullptr);
+
+    /**
+     * @brief Lanza el proceso
+     */
+    void start();
+
+    void abort() override;
+
+private slots:
+    void onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void onProcessError(QProcess::ProcessError error);
+
+private:
+    QProcess m_process;
+    QString m_program;
+    QStringList m_arguments;
+    QString m_description;
+};
+
+/**
+ * @class RecordFetchJob
+ * @brief Lectura asíncrona de registros completos (ver DeviceTransport::fetchRecords())
+ */
+class RecordFetchJob : public TransportJob
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief Constructor
+     * @param parent Objeto padre (opcional)
+     */
+    explicit RecordFetchJob(QObject *parent = nullptr);
+
+    /**
+     * @brief Registros leídos (válido tras finished() con éxito)
+     *
+     * Puede tener menos elementos que los pedidos si alguno se borró en el dispositivo.
+     */
+    QList<DataItem> records() const;
+
+protected:
+    void setRecords(const QList<DataItem> &records);
+
+private:
+    QList<DataItem> m_records;
+};
+
+/**
+ * @class DeviceTransport
+ * @brief Interfaz de transporte de archivos hacia/desde un dispositivo
+ *
+ * Abstrae las operaciones básicas (listar, stat, leer, escribir, crear directorio
+ * y borrar) para que DataTransferManager no dependa del mecanismo concreto
+ * (adb CLI, Bridge Client o un directorio local del PC).
+ */
+class DeviceTransport : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief Constructor
+     * @param deviceId ID del dispositivo asociado
+     * @param parent Objeto padre (opcional)
+     */
+    explicit DeviceTransport(const QString &deviceId, QObject *parent = nullptr);
+
+    /**
+     * @brief ID del dispositivo asociado
+     */
+    QString deviceId() const;
+
+    /**
+     * @brief Identificador del backend ("adb", "bridge", "local")
+     */
+    virtual QString kind() const = 0;
+
+    /**
+     * @brief Lista el contenido de un directorio
+     * @param path Ruta del directorio
+     * @param entries Lista de salida con las entradas encontradas
+     * @param errorMessage Mensaje de error de salida (opcional)
+     * @return true si se pudo listar
+     */
+    virtual bool listDirectory(const QString &path, QList<TransportEntry> &entries, QString *errorMessage = nullptr) = 0;
+
+    /**
+     * @brief Obtiene información de una ruta
+     * @param path Ruta a consultar
+     * @param entry Entrada de salida
+     * @param errorMessage Mensaje de error de salida (opcional)
+     * @return true si la ruta existe
+     */
+    virtual bool statPath(const QString &path, TransportEntry &entry, QString *errorMessage = nullptr) = 0;
+
+    /**
+     * @brief Crea un directorio (y sus padres)
+     * @param path Ruta del directorio
+     * @param errorMessage Mensaje de error de salida (opcional)
+     * @return true si el directorio existe al terminar
+     */
+    virtual bool makeDirectory(const QString &path, QString *errorMessage = nullptr) = 0;
+
+    /**
+     * @brief Borra un archivo o directorio
+     * @param path Ruta a borrar
+     * @param errorMessage Mensaje de error de salida (opcional)
+     * @return true si se borró
+     */
+    virtual bool removePath(const QString &path, QString *errorMessage = nullptr) = 0;
+
+    /**
+     * @brief Inicia la lectura de un archivo del dispositivo hacia un archivo local
+     * @param remotePath Ruta en el dispositivo
+     * @param localPath Ruta local de destino
+     * @return Operación en curso (nunca nullptr)
+     */
+    virtual TransportJob *readToFile(const QString &remotePath, const QString &localPath) = 0;
+
+    /**
+     * @brief Inicia la escritura de un archivo local en el dispositivo
+     * @param localPath Ruta local de origen
+     * @param remotePath Ruta de destino en el dispositivo
+     * @return Operación en curso (nunca nullptr)
+     */
+    virtual TransportJob *writeFromFile(const QString &localPath, const QString &remotePath) = 0;
+
+    /**
+     * @brief Número máximo de operaciones simultáneas que admite el backend
+     */
+    virtual int maxConcurrentJobs() const;
+
+    /**
+     * @brief Escribe un elemento conociendo su tipo y metadatos
+     *
+     * La implementación por defecto equivale a writeFromFile(); los backends que
+     * conservan metadatos (archivo de respaldo) la sobrescriben.
+     * @param dataType Tipo de datos
+     * @param item Elemento original
+     * @param localPath Ruta local con el contenido
+     * @param remotePath Ruta de destino propuesta
+     * @return Operación en curso (nunca nullptr)
+     */
+    virtual TransportJob *writeItem(const QString &dataType, const DataItem &item,
+                                    const QString &localPath, const QString &remotePath);
+
+    /**
+     * @brief Indica si el backend puede guardar registros sin archivo (contactos, mensajes...)
+     */
+    virtual bool supportsRecords() const;
+
+    /**
+     * @brief Guarda un registro sin archivo
+     * @param dataType Tipo de datos
+     * @param item Elemento a guardar
+     * @param errorMessage Mensaje de error de salida (opcional)
+     * @return true si se guardó
+     */
+    virtual bool storeRecord(const QString &dataType, const DataItem &item, QString *errorMessage = nullptr);
+
+    /**
+     * @brief Lee del dispositivo los registros completos de una página de ids
+     *
+     * Complementa el análisis ligero (DataAnalyzer::setLazyRecordFields()): los campos
+     * pesados solo se piden al transferir. La implementación por defecto falla.
+     * @param dataType Tipo de datos ("contacts", "messages"...)
+     * @param ids Ids de los registros tal como los dio el análisis
+     * @return Operación en curso (nunca nullptr)
+     */
+    virtual RecordFetchJob *fetchRecords(const QString &dataType, const QStringList &ids);
+
+    /**
+     * @brief Cierra el transporte dejando el destino consistente (p. ej. escribe el índice)
+     * @param errorMessage Mensaje de error de salida (opcional)
+     * @return true si no hubo errores
+     */
+    virtual bool finalize(QString *errorMessage = nullptr);
+
+    /**
+     * @brief Indica si el backend puede leer rangos de bytes de un archivo (readRange)
+     */
+    virtual bool supportsRangedReads() const;
+
+    /**
+     * @brief Indica si el backend puede escribir rangos de bytes en un archivo (writeRange)
+     */
+    virtual bool supportsRangedWrites() const;
+
+    /**
+     * @brief Número máximo de rangos que conviene transferir en paralelo
+     *
+     * Por defecto coincide con maxConcurrentJobs().
+     */
+    virtual int maxConcurrentRangeJobs() const;
+
+    /**
+     * @brief Lee un rango del archivo remoto y lo escribe en la misma posición del archivo local
+     *
+     * El archivo local debe existir con su tamaño final (ver RangedTransferJob). El job
+     * verifica el MD5 del rango antes de terminar con éxito.
+     * @param remotePath Ruta en el dispositivo
+     * @param offset Offset inicial del rango
+     * @param length Longitud del rango
+     * @param localPath Archivo local de destino
+     * @return Operación en curso (nunca nullptr)
+     */
+    virtual TransportJob *readRange(const QString &remotePath, qint64 offset, qint64 length, const QString &localPath);
+
+    /**
+     * @brief Prepara el archivo remoto para recibir rangos (lo crea con su tamaño final)
+     * @param remotePath Ruta de destino en el dispositivo
+     * @param size Tamaño final del archivo
+     * @param errorMessage Mensaje de error de salida (opcional)
+     * @return true si el archivo quedó preparado
+     */
+    virtual bool prepareRangedWrite(const QString &remotePath, qint64 size, QString *errorMessage = nullptr);
+
+    /**
+     * @brief Escribe un rango del archivo local en la misma posición del archivo remoto
+     * @param localPath Archivo local de origen
+     * @param remotePath Ruta en el dispositivo (preparada con prepareRangedWrite())
+     * @param offset Offset inicial del rango
+     * @param length Longitud del rango
+     * @return Operación en curso (nunca nullptr)
+     */
+    virtual TransportJob *writeRange(const QString &localPath, const QString &remotePath, qint64 offset, qint64 length);
+
+    /**
+     * @brief Indica si el backend puede actualizar un archivo existente enviando solo un delta
+     */
+    virtual bool supportsDelta() const;
+
+    /**
+     * @brief Calcula la firma por bloques de un archivo existente (ver deltasync.h)
+     *
+     * En el dispositivo implica leer el archivo completo: la operación es asíncrona
+     * para que el motor pueda cancelarla.
+     * @param remotePath Ruta del archivo en el dispositivo
+     * @param blockSize Tamaño de bloque
+     * @return Operación en curso (nunca nullptr)
+     */
+    virtual DeltaSignatureJob *blockSignature(const QString &remotePath, qint64 blockSize);
+
+    /**
+     * @brief Actualiza un archivo existente aplicando un delta
+     *
+     * El archivo nuevo se reconstruye aparte y solo sustituye al existente cuando
+     * está completo: un delta interrumpido no estropea la versión anterior.
+     * @param localPath Archivo local con el contenido nuevo completo
+     * @param remotePath Archivo a actualizar (el mismo cuya firma se calculó)
+     * @param ops Operaciones calculadas con DeltaSync::computeDelta()
+     * @return Operación en curso (nunca nullptr)
+     */
+    virtual TransportJob *applyDelta(const QString &localPath, const QString &remotePath, const QList<DeltaOp> &ops);
+
+    /**
+     * @brief Crea el transporte adecuado para un dispositivo
+     * @param deviceManager Gestor de dispositivos
+     * @param deviceId ID del dispositivo
+     * @param preferBridge Si es true y Bridge Client está conectado, se usa Bridge Client
+     * @param parent Objeto padre (opcional)
+     * @return Transporte creado, o nullptr si el tipo de dispositivo no está soportado
+     */
+    static DeviceTransport *create(DeviceManager *deviceManager, const QString &deviceId,
+                                   bool preferBridge, QObject *parent = nullptr);
+
+private:
+    QString m_deviceId;
+};
+
+/**
+ * @class AdbProcessTransport
+ * @brief Transporte basado en el ejecutable adb (pull/push/exec-out)
+ */
+class AdbProcessTransport : public DeviceTransport
+{
+    Q_OBJECT
+public:
+    AdbProcessTransport(const QString &deviceId, const QString &adbPath, QObject *parent = nullptr);
+
+    QString kind() const override;
+    bool listDirectory(const QString &path, QList<TransportEntry> &entries, QString *errorMessage = nullptr) override;
+    bool statPath(const QString &path, TransportEntry &entry, QString *errorMessage = nullptr) override;
+    bool makeDirectory(const QString &path, QString *errorMessage = nullptr) override;
+    bool removePath(const QString &path, QString *errorMessage = nullptr) override;
+    TransportJob *readToFile(const QString &remotePath, const QString &localPath) override;
+    TransportJob *writeFromFile(const QString &localPath, const QString &remotePath) override;
+    int maxConcurrentJobs() const override;
+    bool supportsRangedReads() const override;
+    bool supportsRangedWrites() const override;
+    int maxConcurrentRangeJobs() const override;
+    TransportJob *readRange(const QString &remotePath, qint64 offset, qint64 length, const QString &localPath) override;
+    bool prepareRangedWrite(const QString &remotePath, qint64 size, QString *errorMessage = nullptr) override;
+    TransportJob *writeRange(const QString &localPath, const QString &remotePath, qint64 offset, qint64 length) override;
+    bool supportsDelta() const override;
+    DeltaSignatureJob *blockSignature(const QString &remotePath, qint64 blockSize) override;
+    TransportJob *applyDelta(const QString &localPath, const QString &remotePath, const QList<DeltaOp> &ops) override;
+    RecordFetchJob *fetchRecords(const QString &dataType, const QStringList &ids) override;
+
+    /**
+     * @brief Escapa una ruta para usarla dentro de un comando de shell del dispositivo
+     * @param path Ruta a escapar
+     * @return Ruta entre comillas simples
+     */
+    static QString shellQuote(const QString &path);
+
+protected:
+    /**
+     * @brief Ejecuta adb de forma síncrona
+     * @param arguments Argumentos (sin "-s <id>")
+     * @param output Salida estándar (opcional)
+     * @param errorMessage Mensaje de error de salida (opcional)
+     * @param timeoutMs Tiempo máximo de espera
+     * @return true si el comando terminó con código 0
+     */
+    bool runAdb(const QStringList &arguments, QByteArray *output, QString *errorMessage, int timeoutMs = 10000);
+
+    /**
+     * @brief Crea (sin iniciar) un job de proceso adb para este dispositivo
+     */
+    ProcessTransportJob *createAdbJob(const QStringList &arguments, const QString &description);
+
+    QString m_adbPath;
+};
+
+/**
+ * @class BridgeClientTransport
+ * @brief Transporte que usa Bridge Client para preparar/guardar archivos en el dispositivo
+ *
+ * Bridge Client deja el archivo solicitado en una ruta de intercambio del dispositivo
+ * (FILE_READY) o lo mueve a su ubicación final (SAVE_FILE); el movimiento de bytes
+ * entre el dispositivo y el PC se hace con adb. Las operaciones de listado, stat,
+ * mkdir y borrado se heredan del transporte adb.
+ */
+class BridgeClientTransport : public AdbProcessTransport
+{
+    Q_OBJECT
+public:
+    BridgeClientTransport(const QString &deviceId, const QString &adbPath,
+                          AdbSocketClient *bridgeClient, QObject *parent = nullptr);
+
+    QString kind() const override;
+    TransportJob *readToFile(const QString &remotePath, const QString &localPath) override;
+    TransportJob *writeFromFile(const QString &localPath, const QString &remotePath) override;
+    int maxConcurrentJobs() const override;
+    bool supportsRangedReads() const override;
+    bool supportsRangedWrites() const override;
+    bool supportsDelta() const override;
+    RecordFetchJob *fetchRecords(const QString &dataType, const QStringList &ids) override;
+
+    /**
+     * @brief Directorio de intercambio usado por Bridge Client en el dispositivo
+     */
+    static QString stagingDirectory();
+
+private:
+    QPointer<AdbSocketClient> m_bridgeClient;
+};
+
+/**
+ * @class LocalDirectoryTransport
+ * @brief Transporte que trata un directorio del PC como si fuera un dispositivo
+ *
+ * Las rutas del "dispositivo" se resuelven relativas a la raíz configurada, lo que
+ * permite ejecutar el planificador y el pipeline completo sin teléfonos conectados.
+ */
+class LocalDirectoryTransport : public DeviceTransport
+{
+    Q_OBJECT
+public:
+    LocalDirectoryTransport(const QString &deviceId, const QString &rootPath, QObject *parent = nullptr);
+
+    QString kind() const override;
+    bool listDirectory(const QString &path, QList<TransportEntry> &entries, QString *errorMessage = nullptr) override;
+    bool statPath(const QString &path, TransportEntry &entry, QString *errorMessage = nullptr) override;
+    bool makeDirectory(const QString &path, QString *errorMessage = nullptr) override;
+    bool removePath(const QString &path, QString *errorMessage = nullptr) override;
+    TransportJob *readToFile(const QString &remotePath, const QString &localPath) override;
+    TransportJob *writeFromFile(const QString &localPath, const QString &remotePath) override;
+    int maxConcurrentJobs() const override;
+    bool supportsRangedReads() const override;
+    bool supportsRangedWrites() const override;
+    TransportJob *readRange(const QString &remotePath, qint64 offset, qint64 length, const QString &localPath) override;
+    bool prepareRangedWrite(const QString &remotePath, qint64 size, QString *errorMessage = nullptr) override;
+    TransportJob *writeRange(const QString &localPath, const QString &remotePath, qint64 offset, qint64 length) override;
+    bool supportsDelta() const override;
+    DeltaSignatureJob *blockSignature(const QString &remotePath, qint64 blockSize) override;
+    TransportJob *applyDelta(const QString &localPath, const QString &remotePath, const QList<DeltaOp> &ops) override;
+
+    /**
+     * @brief Resuelve una ruta del dispositivo a una ruta del PC dentro de la raíz
+     * @param path Ruta del dispositivo
+     * @return Ruta absoluta en el PC, o cadena vacía si escapa de la raíz
+     */
+    QString hostPath(const QString &path) const;
+
+private:
+    QString m_rootPath;
+};
+
+/**
+ * @class ArchiveTransport
+ * @brief Transporte sobre un archivo de respaldo del PC (ver backuparchive.h)
+ *
+ * Como origen, las rutas son las rutas originales guardadas en el índice; como
+ * destino, cada elemento se añade al final del archivo y el índice se escribe en
+ * finalize().
+ */
+class ArchiveTransport : public DeviceTransport
+{
+    Q_OBJECT
+public:
+    ArchiveTransport(const QString &deviceId, const QString &archivePath, QObject *parent = nullptr);
+    ~ArchiveTransport();
+
+    QString kind() const override;
+    bool listDirectory(const QString &path, QList<TransportEntry> &entries, QString *errorMessage = nullptr) override;
+    bool statPath(const QString &path, TransportEntry &entry, QString *errorMessage = nullptr) override;
+    bool makeDirectory(const QString &path, QString *errorMessage = nullptr) override;
+    bool removePath(const QString &path, QString *errorMessage = nullptr) override;
+    TransportJob *readToFile(const QString &remotePath, const QString &localPath) override;
+    TransportJob *writeFromFile(const QString &localPath, const QString &remotePath) override;
+    TransportJob *writeItem(const QString &dataType, const DataItem &item,
+                            const QString &localPath, const QString &remotePath) override;
+    bool supportsRecords() const override;
+    bool storeRecord(const QString &dataType, const DataItem &item, QString *errorMessage = nullptr) override;
+    bool finalize(QString *errorMessage = nullptr) override;
+
+private:
+    bool ensureReader(QString *errorMessage);
+    bool ensureWriter(QString *errorMessage);
+
+    QString m_archivePath;
+    BackupArchiveReader *m_reader;
+    BackupArchiveWriter *m_writer;
+};
+
+/**
+ * @class LocalCopyJob
+ * @brief Copia de archivo local a local por bloques grandes, sin bloquear el bucle de eventos
+ *
+ * Opcionalmente copia solo un rango del origen (offset/longitud) o escribe en un
+ * BackupArchiveWriter en lugar de en un archivo.
+ */
+class LocalCopyJob : public TransportJob
+{
+    Q_OBJECT
+public:
+    LocalCopyJob(const QString &sourcePath, const QString &destPath, QObject *parent = nullptr);
+
+    /**
+     * @brief Copia un rango del origen
+     * @param sourcePath Archivo de origen
+     * @param sourceOffset Offset inicial
+     * @param length Bytes a copiar
+     * @param destPath Archivo de destino
+     * @param parent Objeto padre
+     */
+    LocalCopyJob(const QString &sourcePath, qint64 sourceOffset, qint64 length,
+                 const QString &destPath, QObject *parent = nullptr);
+
+    /**
+     * @brief Copia un archivo completo en la entrada abierta de un archivo de respaldo
+     * @param sourcePath Archivo de origen
+     * @param writer Escritor con beginEntry() ya llamado; el job llama a endEntry()/abortEntry()
+     * @param parent Objeto padre
+     */
+    LocalCopyJob(const QString &sourcePath, BackupArchiveWriter *writer, QObject *parent = nullptr);
+
+    /**
+     * @brief Copia un rango del origen a la misma posición de un destino ya dimensionado
+     *
+     * El destino no se trunca ni se borra si la copia falla. Al terminar se relee el
+     * rango escrito y se compara su MD5 con el de los bytes leídos del origen.
+     * @param sourcePath Archivo de origen
+     * @param offset Offset del rango (en origen y destino)
+     * @param length Bytes a copiar
+     * @param destPath Archivo de destino existente
+     * @param parent Objeto padre
+     * @return Job sin iniciar
+     */
+    static LocalCopyJob *createRangeCopy(const QString &sourcePath, qint64 offset, qint64 length,
+                                         const QString &destPath, QObject *parent = nullptr);
+
+    /**
+     * @brief Inicia la copia en la siguiente iteración del bucle de eventos
+     */
+    void start();
+
+    void abort() override;
+
+private slots:
+    void copyNextBlock();
+
+private:
+    void fail(const QString &errorMessage);
+    bool verifyDestinationRange();
+
+    QFile m_source;
+    QFile m_dest;
+    BackupArchiveWriter *m_archiveWriter;
+    qint64 m_sourceOffset;
+    qint64 m_length;
+    qint64 m_copied;
+    qint64 m_total;
+    qint64 m_destOffset;  // -1: el destino se trunca; >= 0: escritura posicional verificada
+    QCryptographicHash m_hash;
+    bool m_aborted;
+
+    static constexpr qint64 BLOCK_SIZE = 4 * 1024 * 1024; // 4 MB por iteración
+};
+
+#endif // DEVICETRANSPORT_H
@@ -0,0 +1,54 @@
+#include "itemfeed.h"
+#include <QMutexLocker>
+
+ItemFeed::ItemFeed(QObject *parent)
+    : QObject(parent)
+    , m_closed(false)
+{
+}
+
+void ItemFeed::push(const QList<DataItem> &items)
+{
+    if (items.isEmpty()) return;
+
+    QMutexLocker locker(&m_mutex);
+    if (m_closed) return;
+    m_items.append(items);
+    locker.unlock();
+
+    emit itemsAvailable();
+}
+
+/**
+ * Cierra la cola; el consumidor aún retira lo que quede
+ */
+void ItemFeed::close(const QString &errorMessage)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_closed) return;
+    m_closed = true;
+    m_errorMessage = errorMessage;
+    locker.unlock();
+
+    emit itemsAvailable();
+}
+
+QList<DataItem> ItemFeed::takeAll()
+{
+    QMutexLocker locker(&m_mutex);
+    QList<DataItem> items;
+    items.swap(m_items);
+    return items;
+}
+
+bool ItemFeed::isFinished() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_closed && m_items.isEmpty();
+}
+
+QString ItemFeed::errorMessage() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_errorMessage;
+}
@@ -0,0 +1,64 @@
+#ifndef ITEMFEED_H
+#define ITEMFEED_H
+
+#include <QObject>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include "dataitemstore.h"
+
+/**
+ * @class ItemFeed
+ * @brief Cola productor/consumidor de los elementos que un análisis va descubriendo
+ *
+ * DataAnalyzer añade los elementos de cada bloque publicado y cierra la cola al
+ * terminar el tipo; DataTransferManager los retira desde su propio hilo. Cada
+ * cambio emite itemsAvailable(), que llega encolada al hilo del consumidor.
+ */
+class ItemFeed : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ItemFeed(QObject *parent = nullptr);
+
+    /**
+     * @brief Añade elementos descubiertos (productor)
+     */
+    void push(const QList<DataItem> &items);
+
+    /**
+     * @brief Da por terminado el análisis del tipo
+     * @param errorMessage Error del análisis (vacío si terminó bien)
+     */
+    void close(const QString &errorMessage = QString());
+
+    /**
+     * @brief Retira todos los elementos pendientes (consumidor)
+     */
+    QList<DataItem> takeAll();
+
+    /**
+     * @brief Indica si la cola está cerrada y ya no quedan elementos por retirar
+     */
+    bool isFinished() const;
+
+    /**
+     * @brief Error con el que se cerró la cola (vacío si no hubo)
+     */
+    QString errorMessage() const;
+
+signals:
+    /**
+     * @brief Señal emitida al añadir elementos o cerrar la cola
+     */
+    void itemsAvailable();
+
+private:
+    mutable QMutex m_mutex;
+    QList<DataItem> m_items;
+    bool m_closed;
+    QString m_errorMessage;
+};
+
+#endif // ITEMFEED_H
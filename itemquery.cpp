@@ -0,0 +1,171 @@
+#include "itemquery.h"
+#include <QMimeDatabase>
+#include <QFileInfo>
+#include <algorithm>
+#include <limits>
+
+ItemIndex::ItemIndex()
+    : m_size(0)
+{
+}
+
+int ItemIndex::size() const
+{
+    return m_size;
+}
+
+/**
+ * Una pasada sobre los elementos: claves ordenables, tipo MIME y contactos
+ */
+void ItemIndex::build(const DataItemStore &items)
+{
+    *this = ItemIndex();
+    m_size = items.size();
+    m_sizes.reserve(m_size);
+    m_bySize.reserve(m_size);
+    m_byDate.reserve(m_size);
+
+    QMimeDatabase mimeDatabase;
+    QHash<QString, QString> mimeBySuffix; // La base MIME solo se consulta una vez por extensión
+
+    for (int i = 0; i < m_size; ++i) {
+        const DataItem item = items.at(i);
+        m_sizes.append(item.size);
+        m_bySize.append({item.size, i});
+        if (item.dateTime.isValid()) {
+            m_byDate.append({item.dateTime.toMSecsSinceEpoch(), i});
+        }
+
+        if (!item.filePath.isEmpty()) {
+            int slash = item.filePath.lastIndexOf('/');
+            m_byFolder.append({slash > 0 ? item.filePath.left(slash) : QString("/"), i});
+
+            QString mimeType = item.data.value("mimeType").toString();
+            if (mimeType.isEmpty()) {
+                QString suffix = QFileInfo(item.filePath).suffix().toLower();
+                auto cached = mimeBySuffix.constFind(suffix);
+                if (cached == mimeBySuffix.constEnd()) {
+                    cached = mimeBySuffix.insert(suffix, mimeDatabase.mimeTypeForFile(item.filePath,
+                                                                                      QMimeDatabase::MatchExtension).name());
+                }
+                mimeType = cached.value();
+            }
+            QBitArray &bits = m_mimeBitmaps[mimeType.toLower()];
+            if (bits.isEmpty()) bits.resize(m_size);
+            bits.setBit(i);
+        }
+
+        // Contacto o conversación: la otra parte de un mensaje o llamada, o el propio contacto
+        QStringList keys;
+        for (const char *field : {"address", "number", "threadId"}) {
+            QString value = item.data.value(QLatin1String(field)).toString();
+            if (!value.isEmpty()) keys << value.toLower();
+        }
+        if (keys.isEmpty() && item.filePath.isEmpty() && !item.displayName.isEmpty()) {
+            keys << item.displayName.toLower();
+        }
+        for (const QString &key : qAsConst(keys)) {
+            m_contactItems[key].append(i);
+        }
+    }
+
+    std::sort(m_bySize.begin(), m_bySize.end());
+    std::sort(m_byDate.begin(), m_byDate.end());
+    std::sort(m_byFolder.begin(), m_byFolder.end());
+}
+
+/**
+ * Elementos cuya clave está en [low, high]
+ */
+QBitArray ItemIndex::rangeBits(const QVector<SortedKey> &sorted, qint64 low, qint64 high) const
+{
+    QBitArray bits(m_size);
+    auto begin = std::lower_bound(sorted.constBegin(), sorted.constEnd(), SortedKey{low, 0});
+    auto end = std::upper_bound(begin, sorted.constEnd(), SortedKey{high, 0});
+    for (auto it = begin; it != end; ++it) {
+        bits.setBit(it->index);
+    }
+    return bits;
+}
+
+/**
+ * Marca los elementos cuyo directorio está en [low, high)
+ */
+void ItemIndex::markFolderRange(QBitArray &bits, const QString &low, const QString &high) const
+{
+    auto begin = std::lower_bound(m_byFolder.constBegin(), m_byFolder.constEnd(), FolderKey{low, 0});
+    auto end = std::lower_bound(begin, m_byFolder.constEnd(), FolderKey{high, 0});
+    for (auto it = begin; it != end; ++it) {
+        bits.setBit(it->index);
+    }
+}
+
+/**
+ * Intersección de los filtros; dentro de cada filtro, unión de sus valores
+ */
+ItemSelection ItemIndex::select(const ItemQuery &query) const
+{
+    ItemSelection selection;
+    selection.itemCount = m_size;
+
+    QBitArray result(m_size, true);
+
+    if (query.from.isValid() || query.to.isValid()) {
+        qint64 low = query.from.isValid() ? query.from.toMSecsSinceEpoch() : std::numeric_limits<qint64>::min();
+        qint64 high = query.to.isValid() ? query.to.toMSecsSinceEpoch() : std::numeric_limits<qint64>::max();
+        result &= rangeBits(m_byDate, low, high);
+    }
+
+    if (query.minSize >= 0 || query.maxSize >= 0) {
+        qint64 low = query.minSize >= 0 ? query.minSize : std::numeric_limits<qint64>::min();
+        qint64 high = query.maxSize >= 0 ? query.maxSize : std::numeric_limits<qint64>::max();
+        result &= rangeBits(m_bySize, low, high);
+    }
+
+    if (!query.mimeTypes.isEmpty()) {
+        QBitArray matches(m_size);
+        for (const QString &pattern : query.mimeTypes) {
+            QString wanted = pattern.toLower();
+            bool family = wanted.endsWith("/*");
+            if (family) wanted.chop(1); // "video/*" -> "video/"
+            for (auto it = m_mimeBitmaps.constBegin(); it != m_mimeBitmaps.constEnd(); ++it) {
+                if (family ? it.key().startsWith(wanted) : it.key() == wanted) matches |= it.value();
+            }
+        }
+        result &= matches;
+    }
+
+    if (!query.folders.isEmpty()) {
+        // El directorio exacto y, a continuación en el orden, los que empiezan por "dir/"
+        // ('0' es el carácter siguiente a '/')
+        QBitArray matches(m_size);
+        for (QString folder : query.folders) {
+            while (folder.size() > 1 && folder.endsWith('/')) folder.chop(1);
+            markFolderRange(matches, folder, folder + QChar(0));
+            if (folder == "/") {
+                markFolderRange(matches, "/", "0");
+            } else {
+                markFolderRange(matches, folder + "/", folder + "0");
+            }
+        }
+        result &= matches;
+    }
+
+    if (!query.contacts.isEmpty()) {
+        QBitArray matches(m_size);
+        for (const QString &contact : query.contacts) {
+            const QVector<int> positions = m_contactItems.value(contact.toLower());
+            for (int index : positions) {
+                matches.setBit(index);
+            }
+        }
+        result &= matches;
+    }
+
+    for (int i = 0; i < m_size; ++i) {
+        if (!result.testBit(i)) continue;
+        selection.indexes.append(i);
+        selection.totalSize += m_sizes.at(i);
+    }
+    return selection;
+}
@@ -0,0 +1,98 @@
+#ifndef ITEMQUERY_H
+#define ITEMQUERY_H
+
+#include <QBitArray>
+#include <QDateTime>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "dataitemstore.h"
+
+// Filtros de una selección; los vacíos no restringen
+struct ItemQuery {
+    QDateTime from;              // Fecha mínima (inválida: sin límite)
+    QDateTime to;                // Fecha máxima, incluida (inválida: sin límite)
+    qint64 minSize = -1;         // Tamaño mínimo en bytes (-1: sin límite)
+    qint64 maxSize = -1;         // Tamaño máximo en bytes, incluido (-1: sin límite)
+    QStringList mimeTypes;       // "image/jpeg" o familias como "video/*"
+    QStringList folders;         // Directorios del dispositivo, con sus subdirectorios
+    QStringList contacts;        // Dirección o número (mensajes, llamadas), hilo o nombre de contacto
+
+    bool isEmpty() const {
+        return !from.isValid() && !to.isValid() && minSize < 0 && maxSize < 0
+               && mimeTypes.isEmpty() && folders.isEmpty() && contacts.isEmpty();
+    }
+};
+
+// Resultado de una consulta: posiciones de los elementos elegidos en su DataSet
+struct ItemSelection {
+    QString deviceId;
+    QString dataType;
+    QVector<int> indexes;        // Posiciones en DataSet::items, en orden ascendente
+    int itemCount = 0;           // Elementos del DataSet al seleccionar (detecta análisis posteriores)
+    quint64 generation = 0;      // DataSet::generation al seleccionar (detecta un DataSet reemplazado)
+    qint64 totalSize = 0;        // Suma de tamaños de los elementos elegidos
+};
+
+/**
+ * @class ItemIndex
+ * @brief Índices de los elementos de un DataSet para evaluar consultas sin recorrerlos
+ *
+ * Fecha y tamaño se guardan ordenados (clave + posición), así que un rango es una
+ * búsqueda binaria y marcar las posiciones que caen dentro. Los directorios también se
+ * ordenan: un directorio con sus subdirectorios es un tramo contiguo. Cada tipo MIME
+ * (pocos valores) tiene un mapa de bits; los contactos (muchos valores) una lista de
+ * posiciones. Cada filtro produce un mapa de bits (unión de sus valores) y la
+ * consulta es la intersección de todos ellos.
+ *
+ * Se construye una vez por DataSet (una pasada sobre los elementos) y DataAnalyzer lo
+ * descarta cuando el DataSet cambia.
+ */
+class ItemIndex
+{
+public:
+    ItemIndex();
+
+    /**
+     * @brief Construye los índices de un almacén de elementos
+     */
+    void build(const DataItemStore &items);
+
+    /**
+     * @brief Número de elementos indexados
+     */
+    int size() const;
+
+    /**
+     * @brief Evalúa una consulta
+     * @param query Filtros
+     * @return Selección con posiciones y tamaño total (sin dispositivo ni tipo)
+     */
+    ItemSelection select(const ItemQuery &query) const;
+
+private:
+    struct SortedKey {
+        qint64 key;
+        int index;
+        bool operator<(const SortedKey &other) const { return key < other.key; }
+    };
+    struct FolderKey {
+        QString folder;
+        int index;
+        bool operator<(const FolderKey &other) const { return folder < other.folder; }
+    };
+
+    QBitArray rangeBits(const QVector<SortedKey> &sorted, qint64 low, qint64 high) const;
+    void markFolderRange(QBitArray &bits, const QString &low, const QString &high) const;
+
+    int m_size;
+    QVector<SortedKey> m_byDate;                 // Solo elementos con fecha
+    QVector<SortedKey> m_bySize;
+    QVector<FolderKey> m_byFolder;               // Solo elementos con ruta
+    QVector<qint64> m_sizes;                     // Por posición, para el total
+    QHash<QString, QBitArray> m_mimeBitmaps;     // Tipo MIME -> elementos
+    QHash<QString, QVector<int>> m_contactItems; // Dirección, hilo o nombre (en minúsculas) -> elementos
+};
+
+#endif // ITEMQUERY_H
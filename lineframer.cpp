@@ -0,0 +1,72 @@
+#include "lineframer.h"
+#include <cstring>
+
+LineFramer::LineFramer()
+    : m_position(0)
+{
+}
+
+/**
+ * Añade datos, descartando antes lo ya consumido
+ */
+void LineFramer::append(const QByteArray &data)
+{
+    if (m_position > 0) {
+        m_buffer.remove(0, m_position);
+        m_position = 0;
+    }
+    m_buffer.append(data);
+}
+
+/**
+ * Devuelve la siguiente línea completa sin copiarla
+ */
+bool LineFramer::nextLine(QByteArray &line)
+{
+    if (m_position >= m_buffer.size()) return false;
+
+    const char *start = m_buffer.constData() + m_position;
+    const char *end = static_cast<const char *>(memchr(start, '\n', m_buffer.size() - m_position));
+    if (!end) return false;
+
+    int length = static_cast<int>(end - start);
+    m_position += length + 1;
+    if (length > 0 && start[length - 1] == '\r') {
+        --length; // Salida de un shell con PTY
+    }
+    line = QByteArray::fromRawData(start, length);
+    return true;
+}
+
+/**
+ * Devuelve los siguientes count bytes sin copiarlos
+ */
+bool LineFramer::takeBytes(int count, QByteArray &data)
+{
+    if (count < 0 || pendingBytes() < count) return false;
+
+    data = QByteArray::fromRawData(m_buffer.constData() + m_position, count);
+    m_position += count;
+    return true;
+}
+
+/**
+ * Completa la última línea si la salida no terminaba en '\n'
+ */
+void LineFramer::finish()
+{
+    if (m_position < m_buffer.size() && !m_buffer.endsWith('\n')) {
+        append(QByteArray(1, '\n'));
+    }
+}
+
+void LineFramer::clear()
+{
+    m_buffer.clear();
+    m_position = 0;
+}
+
+int LineFramer::pendingBytes() const
+{
+    return m_buffer.size() - m_position;
+}
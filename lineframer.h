@@ -0,0 +1,61 @@
+#ifndef LINEFRAMER_H
+#define LINEFRAMER_H
+
+#include <QByteArray>
+
+/**
+ * @class LineFramer
+ * @brief Separa en líneas una salida que llega por trozos (p. ej. de un QProcess)
+ *
+ * Los datos se acumulan en un único búfer y las líneas se devuelven sin copiarlas;
+ * la parte ya consumida se descarta en bloque al añadir más datos, de modo que el
+ * coste total es lineal en el tamaño de la salida.
+ */
+class LineFramer
+{
+public:
+    LineFramer();
+
+    /**
+     * @brief Añade un trozo de salida
+     *
+     * Invalida las líneas devueltas anteriormente por nextLine().
+     */
+    void append(const QByteArray &data);
+
+    /**
+     * @brief Extrae la siguiente línea completa
+     * @param line Línea sin '\n' ni '\r' final; apunta al búfer interno y es válida
+     *             hasta la siguiente llamada a append() o finish()
+     * @return false si no queda ninguna línea completa
+     */
+    bool nextLine(QByteArray &line);
+
+    /**
+     * @brief Extrae un bloque binario de longitud conocida (p. ej. tras una cabecera de texto)
+     * @param data Bloque; apunta al búfer interno con la misma validez que nextLine()
+     * @return false si aún no han llegado count bytes
+     */
+    bool takeBytes(int count, QByteArray &data);
+
+    /**
+     * @brief Da la salida por terminada: una última línea sin '\n' pasa a ser completa
+     */
+    void finish();
+
+    /**
+     * @brief Descarta todo el contenido pendiente
+     */
+    void clear();
+
+    /**
+     * @brief Bytes recibidos y aún no devueltos como línea
+     */
+    int pendingBytes() const;
+
+private:
+    QByteArray m_buffer;
+    int m_position;     // Inicio de la primera línea no consumida
+};
+
+#endif // LINEFRAMER_H
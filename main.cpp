@@ -1,5 +1,7 @@
 #include "mainwindow.h"
+#include "benchmarks.h"
 #include <QApplication>
+#include <QCoreApplication>
 #include <QDebug>
 
 void myMessageHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg)
@@ -29,6 +31,27 @@ void myMessageHandler(QtMsgType type, const QMessageLogContext &context, const Q
 
 int main(int argc, char *argv[])
 {
+    // Modos de medición sin interfaz
+    for (int i = 1; i < argc; ++i) {
+        int count = (i + 1 < argc) ? QByteArray(argv[i + 1]).toInt() : 0;
+        if (qstrcmp(argv[i], "--benchmark-transfer") == 0) {
+            QCoreApplication app(argc, argv);
+            return runTransferBenchmark(count > 0 ? count : 10000);
+        }
+        if (qstrcmp(argv[i], "--benchmark-parsers") == 0) {
+            QCoreApplication app(argc, argv);
+            return runParserBenchmark(count > 0 ? count : 200000);
+        }
+        if (qstrcmp(argv[i], "--benchmark-merge") == 0) {
+            QCoreApplication app(argc, argv);
+            return runMergeBenchmark(count > 0 ? count : 200000);
+        }
+        if (qstrcmp(argv[i], "--benchmark-scan-payload") == 0) {
+            QCoreApplication app(argc, argv);
+            return runScanPayloadBenchmark(count > 0 ? count : 200000);
+        }
+    }
+
     qInstallMessageHandler(myMessageHandler);
     qDebug() << "Iniciando la aplicación con" << argc << "argumentos.";
     QApplication a(argc, argv);
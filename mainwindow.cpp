@@ -9,6 +9,8 @@
 #include <QResizeEvent>
 #include "transferstatisticsdialog.h"
 #include <QProgressDialog>
+#include <QFileDialog>
+#include <QThread>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -16,6 +18,7 @@ MainWindow::MainWindow(QWidget *parent)
     , sourceDeviceId("")
     , destDeviceId("")
     , m_statisticsDialog(nullptr)
+    , m_transferThread(nullptr)
     , isTransferInProgress(false)
     , m_analysisProgressDialog(nullptr)
     , m_analysisSuccessful(false)
@@ -30,6 +33,15 @@ MainWindow::MainWindow(QWidget *parent)
     connect(ui->actionSalir, &QAction::triggered, this, &MainWindow::close);
     connect(ui->actionAcerca_de, &QAction::triggered, this, &MainWindow::on_actionAcerca_de_triggered);
 
+    // Respaldo en archivo del PC: el archivo aparece como un dispositivo más (origen o destino)
+    QAction *newArchiveAction = new QAction("Nuevo respaldo en archivo...", this);
+    QAction *openArchiveAction = new QAction("Abrir respaldo...", this);
+    ui->menuFile->insertAction(ui->actionSalir, newArchiveAction);
+    ui->menuFile->insertAction(ui->actionSalir, openArchiveAction);
+    ui->menuFile->insertSeparator(ui->actionSalir);
+    connect(newArchiveAction, &QAction::triggered, this, &MainWindow::onNewArchiveTriggered);
+    connect(openArchiveAction, &QAction::triggered, this, &MainWindow::onOpenArchiveTriggered);
+
     // Configurar botón flip
     ui->flipButton->setIcon(QApplication::style()->standardIcon(QStyle::SP_BrowserReload));
     ui->flipButton->setToolTip("Swap Source and Destination");
@@ -57,9 +69,23 @@ MainWindow::MainWindow(QWidget *parent)
     connect(dataAnalyzer, &DataAnalyzer::analysisComplete, this, &MainWindow::onAnalysisComplete);
     connect(dataAnalyzer, &DataAnalyzer::analysisError, this, &MainWindow::onAnalysisError);
     connect(dataAnalyzer, &DataAnalyzer::dataSetUpdated, this, &MainWindow::onDataSetUpdated);
+    connect(dataAnalyzer, &DataAnalyzer::backgroundAnalysisFinished, this, [this](const QString &deviceId) {
+        // Resultados preparados mientras el usuario elegía destino: se aprovechan sin volver a analizar
+        if (deviceId == sourceDeviceId
+            && StateManager::instance().getAppState() == StateManager::BothDevicesConnected) {
+            configureForCurrentState();
+        }
+    });
 
     // --- DataTransferManager Connections ---
-    dataTransferManager = new DataTransferManager(deviceManager, dataAnalyzer, this);
+    // El motor de transferencia corre en su propio hilo: los diálogos modales y los
+    // repintados no retrasan sus pasos, y sus señales llegan encoladas a la interfaz
+    m_transferThread = new QThread(this);
+    m_transferThread->setObjectName("TransferEngine");
+    dataTransferManager = new DataTransferManager(deviceManager, dataAnalyzer);
+    dataTransferManager->moveToThread(m_transferThread);
+    connect(m_transferThread, &QThread::finished, dataTransferManager, &QObject::deleteLater);
+    m_transferThread->start();
     connect(dataTransferManager, &DataTransferManager::transferStarted, this, &MainWindow::onTransferStarted);
     connect(dataTransferManager, &DataTransferManager::transferProgress, this, &MainWindow::onTransferProgress);
     connect(dataTransferManager, &DataTransferManager::transferTaskStarted, this, &MainWindow::onTransferTaskStarted);
@@ -79,6 +105,10 @@ MainWindow::MainWindow(QWidget *parent)
             connect(m_statisticsDialog, &QDialog::finished, this, &MainWindow::onStatisticsDialogClosed);
         }
         isTransferInProgress = false;
+        dataAnalyzer->setTransferActive(false);
+        if (!destDeviceId.isEmpty()) {
+            dataAnalyzer->analyzeDestination(destDeviceId); // El destino cambió: el inventario ya no vale
+        }
         updateStartButtonState();
         ui->flipButton->setEnabled(true);
 
@@ -117,6 +147,11 @@ MainWindow::~MainWindow()
     if (deviceManager) {
         deviceManager->stopDeviceDetection();
     }
+    if (m_transferThread) {
+        // El destructor del motor (deleteLater al terminar el hilo) cancela lo que quede en curso
+        m_transferThread->quit();
+        m_transferThread->wait();
+    }
     delete ui;
 }
 
@@ -559,7 +594,7 @@ void MainWindow::updateDataTypesList()
 
     for (const QString &type : displayOrder) {
         DataSet dataSet = dataAnalyzer->getDataSet(sourceDeviceId, type);
-        int count = dataSet.items.size();
+        int count = dataSet.itemCount();
         qint64 size = dataSet.totalSize;
 
         qDebug() << "Processing data type:" << type << "Count:" << count << "Size:" << size
@@ -578,6 +613,11 @@ void MainWindow::updateDataTypesList()
             if (size > 0) {
                 displayText += QString(" - %1").arg(sizeString);
             }
+            if (dataSet.duplicateCount > 0) {
+                displayText += QString(" - %1 duplicados, %2 ahorrados")
+                                   .arg(dataSet.duplicateCount)
+                                   .arg(TransferStatisticsDialog::formatSize(dataSet.duplicateSize));
+            }
             displayText += ")";
         }
 
@@ -754,7 +794,7 @@ void MainWindow::on_startTransferButton_clicked()
             if (!internalName.isEmpty()) {
                 selectedTypes.append(internalName);
                 DataSet ds = dataAnalyzer->getDataSet(sourceDeviceId, internalName);
-                estimatedTotalSize += ds.totalSize > 0 ? ds.totalSize : ds.items.size();
+                estimatedTotalSize += ds.totalSize > 0 ? ds.totalSize : ds.itemCount();
             }
         }
     }
@@ -764,6 +804,15 @@ void MainWindow::on_startTransferButton_clicked()
         return;
     }
 
+    // Tras un análisis rápido solo hay recuentos: los elementos se enumeran mientras se transfiere
+    bool needsFullScan = false;
+    for (const QString &type : selectedTypes) {
+        if (dataAnalyzer->getDataSet(sourceDeviceId, type).summaryOnly) {
+            needsFullScan = true;
+            break;
+        }
+    }
+
     bool clearBeforeCopy = ui->clearBeforeCopyCheckBox->isChecked();
     QString confirmationMessage = QString("Transfer from %1 to %2:\n").arg(sourceDev.name).arg(destDev.name);
     for (const QString& type : selectedTypes) {
@@ -804,8 +853,12 @@ void MainWindow::on_startTransferButton_clicked()
         connect(dataTransferManager, &DataTransferManager::transferFinished, m_statisticsDialog, &TransferStatisticsDialog::onTransferFinished);
         connect(m_statisticsDialog, &TransferStatisticsDialog::transferCancelledRequested, dataTransferManager, &DataTransferManager::cancelTransfer);
 
+        if (needsFullScan) {
+            dataAnalyzer->analyzeDevice(sourceDeviceId);
+        }
         if (dataTransferManager->startTransfer(sourceDeviceId, destDeviceId, selectedTypes, clearBeforeCopy)) {
             isTransferInProgress = true;
+            dataAnalyzer->setTransferActive(true);
             updateStartButtonState();
             ui->flipButton->setEnabled(false);
             ui->dataTypesList->setEnabled(false);
@@ -861,6 +914,30 @@ void MainWindow::on_actionAcerca_de_triggered()
                        "Esta aplicación permite transferir datos entre dispositivos móviles.");
 }
 
+void MainWindow::onNewArchiveTriggered()
+{
+    QString path = QFileDialog::getSaveFileName(this, "Nuevo respaldo", QString(),
+                                                "Respaldo Mobile Data Bridge (*.mdbarchive)");
+    if (path.isEmpty()) return;
+    if (!path.endsWith(".mdbarchive")) path += ".mdbarchive";
+
+    if (deviceManager->addArchiveDevice(path).isEmpty()) {
+        QMessageBox::warning(this, "Respaldo", "No se pudo crear el respaldo en:\n" + path);
+    }
+}
+
+void MainWindow::onOpenArchiveTriggered()
+{
+    QString path = QFileDialog::getOpenFileName(this, "Abrir respaldo", QString(),
+                                                "Respaldo Mobile Data Bridge (*.mdbarchive)");
+    if (path.isEmpty()) return;
+
+    QString archiveId = deviceManager->addArchiveDevice(path);
+    if (archiveId.isEmpty() || !dataAnalyzer->loadArchive(archiveId)) {
+        QMessageBox::warning(this, "Respaldo", "El archivo seleccionado no es un respaldo válido:\n" + path);
+    }
+}
+
 void MainWindow::onDeviceConnected(const DeviceInfo &device)
 {
     qDebug() << "Dispositivo conectado:" << device.id << device.name << "Tipo:" << device.type;
@@ -992,6 +1069,7 @@ void MainWindow::onAnalysisStarted(const QString &deviceId)
 void MainWindow::onAnalysisProgress(const QString &deviceId, const QString &dataType, int progress)
 {
     qDebug() << "Progreso del análisis:" << deviceId << dataType << progress << "%";
+    if (dataAnalyzer->isBackgroundAnalysis(deviceId) || isTransferInProgress) return;
 
     // Actualizar diálogo de progreso
     if (m_analysisProgressDialog) {
@@ -1015,6 +1093,12 @@ void MainWindow::onAnalysisComplete(const QString &deviceId)
 
     m_analysisSuccessful = true;
 
+    // Análisis lanzado junto con la transferencia, que ya consume sus resultados
+    if (isTransferInProgress) {
+        updateDataTypesList();
+        return;
+    }
+
     // Preparar interfaz para transferencia
     StateManager::instance().setAppState(StateManager::ReadyForTransfer);
 
@@ -1022,16 +1106,20 @@ void MainWindow::onAnalysisComplete(const QString &deviceId)
     QStringList dataTypes = {"photos", "videos", "contacts", "messages", "calls", "calendar", "music"};
     int totalItems = 0;
     qint64 totalSize = 0;
+    int duplicateCount = 0;
+    qint64 duplicateSize = 0;
     QStringList foundTypes;
 
     for (const QString& type : dataTypes) {
         DataSet ds = dataAnalyzer->getDataSet(deviceId, type);
-        if (ds.items.size() > 0) {
-            totalItems += ds.items.size();
+        if (ds.itemCount() > 0) {
+            totalItems += ds.itemCount();
             totalSize += ds.totalSize;
+            duplicateCount += ds.duplicateCount;
+            duplicateSize += ds.duplicateSize;
             foundTypes << translateDataTypeForUI(type);
 
-            qDebug() << "Encontrado tipo de dato:" << type << "Elementos:" << ds.items.size()
+            qDebug() << "Encontrado tipo de dato:" << type << "Elementos:" << ds.itemCount()
                      << "Tamaño:" << ds.totalSize
                      << "Soportado:" << ds.isSupported;
         }
@@ -1048,6 +1136,11 @@ void MainWindow::onAnalysisComplete(const QString &deviceId)
                               .arg(totalItems)
                               .arg(TransferStatisticsDialog::formatSize(totalSize))
                               .arg(foundTypes.join(", "));
+        if (duplicateCount > 0) {
+            message += QString("\n\n%1 duplicados, %2 ahorrados: cada archivo repetido se copiará una sola vez.")
+                           .arg(duplicateCount)
+                           .arg(TransferStatisticsDialog::formatSize(duplicateSize));
+        }
 
         QMessageBox::information(this, "Análisis Completado", message);
     } else {
@@ -1062,6 +1155,7 @@ void MainWindow::onAnalysisComplete(const QString &deviceId)
 void MainWindow::onAnalysisError(const QString &deviceId, const QString &dataType, const QString &errorMessage)
 {
     qDebug() << "Error de análisis:" << deviceId << dataType << errorMessage;
+    if (dataAnalyzer->isBackgroundAnalysis(deviceId)) return; // Se reintentará al analizar a petición del usuario
 
     // Cerrar diálogo de progreso si existe
     if (m_analysisProgressDialog) {
@@ -1216,11 +1310,23 @@ void MainWindow::updateUIForState(StateManager::AppState state) {
         break;
 
     case StateManager::BothDevicesConnected:
-        // Iniciar análisis automáticamente si no se ha hecho
+        // Inventario del destino (espacio, archivos existentes) mientras se analiza el origen
+        dataAnalyzer->analyzeDestination(destDeviceId);
+
+        // Resultados del análisis en segundo plano del origen
+        if (!m_analysisSuccessful && dataAnalyzer->hasAnalysisResults(sourceDeviceId)) {
+            m_analysisSuccessful = true;
+            updateDataTypesList();
+            StateManager::instance().setAppState(StateManager::ReadyForTransfer);
+            break;
+        }
+        // Iniciar análisis automáticamente si no se ha hecho (o esperar al de segundo plano)
         if (!m_analysisSuccessful) {
-            QTimer::singleShot(500, this, [this]() {
-                onAnalyzeSourceDevice();
-            });
+            if (!dataAnalyzer->isBackgroundAnalysis(sourceDeviceId)) {
+                QTimer::singleShot(500, this, [this]() {
+                    onAnalyzeSourceDevice();
+                });
+            }
         } else {
             ui->dataTypesList->setEnabled(true);
             ui->clearBeforeCopyCheckBox->setEnabled(true);
@@ -1297,8 +1403,12 @@ void MainWindow::onAnalyzeSourceDevice() {
         StateManager::instance().setAppState(StateManager::BothDevicesConnected);
     });
 
-    // Iniciar análisis
+    // Iniciar análisis (y el inventario del destino a la vez)
     m_analysisSuccessful = false;
     dataAnalyzer->analyzeDevice(sourceId);
+    QString destId = StateManager::instance().getDestDeviceId();
+    if (!destId.isEmpty()) {
+        dataAnalyzer->analyzeDestination(destId);
+    }
 }
 
@@ -22,6 +22,7 @@ class DeviceManager;
 class DataAnalyzer;
 class DataTransferManager;
 class TransferStatisticsDialog;
+class QThread;
 
 // Luego incluir los archivos de cabecera
 #include "devicemanager.h"
@@ -55,6 +56,8 @@ private slots:
 
     // Slots para acciones del menú
     void on_actionAcerca_de_triggered();
+    void onNewArchiveTriggered();
+    void onOpenArchiveTriggered();
 
     // Slots para eventos del DeviceManager
     void onDeviceConnected(const DeviceInfo &device);
@@ -93,6 +96,7 @@ private:
     DataAnalyzer *dataAnalyzer;
     DataTransferManager *dataTransferManager;
     TransferStatisticsDialog *m_statisticsDialog;
+    QThread *m_transferThread; // Hilo del motor de transferencia
 
     // Funciones privadas para la lógica de la aplicación
     void setupInitialUI();
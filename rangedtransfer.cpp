@@ -0,0 +1,473 @@
+#include "rangedtransfer.h"
+#include <QDebug>
+#include <QFileInfo>
+#include <QTimer>
+
+/**
+ * Constructor de RangedTransferJob
+ */
+RangedTransferJob::RangedTransferJob(DeviceTransport *transport, Direction direction, const QString &remotePath,
+                                     const QString &localPath, qint64 rangeSize, QObject *parent)
+    : TransportJob(parent)
+    , m_transport(transport)
+    , m_direction(direction)
+    , m_remotePath(remotePath)
+    , m_localPath(localPath)
+    , m_rangeSize(qMax<qint64>(rangeSize, 1024 * 1024))
+    , m_totalSize(0)
+    , m_completedBytes(0)
+    , m_maxParallel(transport ? qMax(1, transport->maxConcurrentRangeJobs()) : 1)
+    , m_maxRetries(3)
+    , m_running(0)
+    , m_completedRanges(0)
+    , m_retries(0)
+    , m_hasRequestedRanges(false)
+{
+}
+
+void RangedTransferJob::setMaxParallel(int maxParallel)
+{
+    m_maxParallel = qMax(1, maxParallel);
+}
+
+void RangedTransferJob::setMaxRetries(int maxRetries)
+{
+    m_maxRetries = qMax(0, maxRetries);
+}
+
+void RangedTransferJob::setRanges(const QList<QPair<qint64, qint64>> &ranges)
+{
+    m_requestedRanges = ranges;
+    m_hasRequestedRanges = true;
+}
+
+int RangedTransferJob::rangeCount() const
+{
+    return m_ranges.size();
+}
+
+int RangedTransferJob::retryCount() const
+{
+    return m_retries;
+}
+
+/**
+ * Obtiene el tamaño real del archivo y dimensiona el destino
+ */
+bool RangedTransferJob::prepare(QString *errorMessage)
+{
+    if (!m_transport) {
+        *errorMessage = "Transporte no disponible";
+        return false;
+    }
+
+    if (m_direction == Read) {
+        TransportEntry entry;
+        if (!m_transport->statPath(m_remotePath, entry, errorMessage)) return false;
+        m_totalSize = entry.size;
+
+        // Preasignar el archivo local para que cada rango se escriba en su posición
+        QFile localFile(m_localPath);
+        if (!localFile.open(QIODevice::WriteOnly | QIODevice::Truncate) || !localFile.resize(m_totalSize)) {
+            *errorMessage = QString("No se pudo preparar %1: %2").arg(m_localPath, localFile.errorString());
+            return false;
+        }
+        return true;
+    }
+
+    QFileInfo localInfo(m_localPath);
+    if (!localInfo.exists()) {
+        *errorMessage = QString("Archivo local no encontrado: %1").arg(m_localPath);
+        return false;
+    }
+    m_totalSize = localInfo.size();
+    return m_transport->prepareRangedWrite(m_remotePath, m_totalSize, errorMessage);
+}
+
+/**
+ * Divide el archivo en rangos e inicia los primeros
+ */
+void RangedTransferJob::start()
+{
+    QString error;
+    if (!prepare(&error)) {
+        QTimer::singleShot(0, this, [this, error]() { fail(error); });
+        return;
+    }
+
+    QList<QPair<qint64, qint64>> spans = m_requestedRanges;
+    if (!m_hasRequestedRanges) {
+        spans.append(qMakePair(qint64(0), m_totalSize));
+    }
+
+    // Cada tramo se parte en rangos de como mucho m_rangeSize bytes
+    m_totalSize = 0;
+    for (const QPair<qint64, qint64> &span : spans) {
+        for (qint64 offset = span.first; offset < span.first + span.second; offset += m_rangeSize) {
+            Range range;
+            range.offset = offset;
+            range.length = qMin(m_rangeSize, span.first + span.second - offset);
+            range.done = 0;
+            range.attempts = 0;
+            m_pending.enqueue(m_ranges.size());
+            m_ranges.append(range);
+            m_totalSize += range.length;
+        }
+    }
+
+    qDebug() << "Transferencia por rangos de" << m_remotePath << ":" << m_ranges.size() << "rangos de"
+             << m_rangeSize << "bytes," << m_maxParallel << "en paralelo via" << m_transport->kind();
+
+    QTimer::singleShot(0, this, &RangedTransferJob::startPendingRanges);
+}
+
+/**
+ * Lanza rangos pendientes hasta llenar el número de operaciones simultáneas
+ */
+void RangedTransferJob::startPendingRanges()
+{
+    if (isFinished()) return;
+
+    if (m_completedRanges == m_ranges.size()) {
+        complete(true);
+        return;
+    }
+
+    while (m_running < m_maxParallel && !m_pending.isEmpty()) {
+        int index = m_pending.dequeue();
+        Range &range = m_ranges[index];
+        range.attempts++;
+        range.done = 0;
+
+        TransportJob *job = m_direction == Read
+            ? m_transport->readRange(m_remotePath, range.offset, range.length, m_localPath)
+            : m_transport->writeRange(m_localPath, m_remotePath, range.offset, range.length);
+        connect(job, &TransportJob::finished, job, &QObject::deleteLater);
+        connect(job, &TransportJob::progress, this, [this, index](qint64 bytesDone, qint64) {
+            onRangeProgress(index, bytesDone);
+        });
+        connect(job, &TransportJob::finished, this, [this, index](bool success, const QString &error) {
+            onRangeFinished(index, success, error);
+        });
+        range.job = job;
+        m_running++;
+    }
+}
+
+void RangedTransferJob::onRangeProgress(int index, qint64 bytesDone)
+{
+    Range &range = m_ranges[index];
+    range.done = qMin(bytesDone, range.length);
+
+    qint64 inFlight = 0;
+    for (const Range &r : qAsConst(m_ranges)) {
+        if (r.job) inFlight += r.done;
+    }
+    emit progress(m_completedBytes + inFlight, m_totalSize);
+}
+
+/**
+ * Contabiliza un rango terminado; si falló se vuelve a encolar solo ese rango
+ */
+void RangedTransferJob::onRangeFinished(int index, bool success, const QString &errorMessage)
+{
+    if (isFinished()) return;
+
+    Range &range = m_ranges[index];
+    range.job = nullptr;
+    m_running--;
+
+    if (success) {
+        range.done = range.length;
+        m_completedBytes += range.length;
+        m_completedRanges++;
+        emit progress(m_completedBytes, m_totalSize);
+    } else if (range.attempts > m_maxRetries) {
+        fail(QString("El rango %1-%2 de %3 falló tras %4 intentos: %5")
+             .arg(range.offset).arg(range.offset + range.length).arg(m_remotePath)
+             .arg(range.attempts).arg(errorMessage));
+        return;
+    } else {
+        qWarning() << "Reintentando rango" << range.offset << "+" << range.length << "de" << m_remotePath
+                   << ":" << errorMessage;
+        range.done = 0;
+        m_retries++;
+        m_pending.enqueue(index);
+    }
+
+    startPendingRanges();
+}
+
+void RangedTransferJob::abort()
+{
+    fail("Operación cancelada");
+}
+
+/**
+ * Aborta los rangos en curso y termina con error
+ */
+void RangedTransferJob::fail(const QString &errorMessage)
+{
+    if (isFinished()) return;
+
+    m_pending.clear();
+    for (Range &range : m_ranges) {
+        if (range.job) {
+            disconnect(range.job, nullptr, this, nullptr);
+            range.job->abort();
+            range.job = nullptr;
+        }
+    }
+    m_running = 0;
+
+    // El archivo local preasignado no contiene datos útiles
+    if (m_direction == Read) {
+        QFile::remove(m_localPath);
+    }
+    complete(false, errorMessage);
+}
+
+/**
+ * Constructor de AdbRangeJob
+ */
+AdbRangeJob::AdbRangeJob(const QString &adbPath, const QString &deviceId, const QString &localPath,
+                         qint64 offset, qint64 length, QObject *parent)
+    : TransportJob(parent)
+    , m_adbPath(adbPath)
+    , m_deviceId(deviceId)
+    , m_localFile(localPath)
+    , m_offset(offset)
+    , m_length(length)
+    , m_hash(QCryptographicHash::Md5)
+{
+    connect(&m_process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            QString message = "adb no pudo iniciarse: " + m_process.errorString();
+            QTimer::singleShot(0, this, [this, message]() { complete(false, message); });
+        }
+    });
+}
+
+void AdbRangeJob::startAdbCommand(QProcess &process, const QString &mode, const QString &command)
+{
+    process.start(m_adbPath, QStringList() << "-s" << m_deviceId << mode << command);
+}
+
+QString AdbRangeJob::processError(QProcess &process, const QString &description)
+{
+    if (process.exitStatus() == QProcess::NormalExit && process.exitCode() == 0) return QString();
+
+    QString stdErr = QString::fromUtf8(process.readAllStandardError()).trimmed();
+    return QString("%1 falló: %2").arg(description, stdErr.isEmpty() ? process.errorString() : stdErr);
+}
+
+/**
+ * Ejecuta el comando de verificación y compara su MD5 con el local
+ */
+void AdbRangeJob::verifyRemoteMd5(const QString &verifyCommand, const QByteArray &localMd5)
+{
+    connect(&m_verifyProcess, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+            this, [this, localMd5](int, QProcess::ExitStatus) {
+        QString error = processError(m_verifyProcess, "Verificación MD5");
+        if (!error.isEmpty()) {
+            complete(false, error);
+            return;
+        }
+        QString output = QString::fromLatin1(m_verifyProcess.readAllStandardOutput()).trimmed();
+        completeWithChecksum(output.section(' ', 0, 0), localMd5);
+    });
+    connect(&m_verifyProcess, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) complete(false, "No se pudo verificar el rango: " + m_verifyProcess.errorString());
+    });
+    startAdbCommand(m_verifyProcess, "exec-out", verifyCommand);
+}
+
+void AdbRangeJob::completeWithChecksum(const QString &remoteMd5Hex, const QByteArray &localMd5)
+{
+    if (remoteMd5Hex.compare(QString::fromLatin1(localMd5.toHex()), Qt::CaseInsensitive) != 0) {
+        complete(false, QString("MD5 no coincide en el rango %1+%2 (remoto %3, local %4)")
+                 .arg(m_offset).arg(m_length).arg(remoteMd5Hex, QString::fromLatin1(localMd5.toHex())));
+        return;
+    }
+    complete(true);
+}
+
+/**
+ * Aborta los procesos en curso
+ */
+void AdbRangeJob::abort()
+{
+    for (QProcess *process : { &m_process, &m_verifyProcess }) {
+        if (process->state() != QProcess::NotRunning) {
+            process->blockSignals(true);
+            process->kill();
+            process->waitForFinished(500);
+            process->blockSignals(false);
+        }
+    }
+    m_localFile.close();
+    complete(false, "Operación cancelada");
+}
+
+/**
+ * Constructor de AdbRangeReadJob
+ */
+AdbRangeReadJob::AdbRangeReadJob(const QString &adbPath, const QString &deviceId, const QString &readCommand,
+                                 const QString &localPath, qint64 offset, qint64 length, QObject *parent)
+    : AdbRangeJob(adbPath, deviceId, localPath, offset, length, parent)
+    , m_readCommand(readCommand)
+    , m_received(0)
+{
+    connect(&m_process, &QProcess::readyReadStandardOutput, this, &AdbRangeReadJob::onReadyRead);
+    connect(&m_process, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+            this, &AdbRangeReadJob::onFinished);
+}
+
+void AdbRangeReadJob::setExpectedMd5(const QString &md5Hex)
+{
+    m_expectedMd5 = md5Hex;
+}
+
+void AdbRangeReadJob::setVerifyCommand(const QString &verifyCommand)
+{
+    m_verifyCommand = verifyCommand;
+}
+
+void AdbRangeReadJob::start()
+{
+    if (!m_localFile.open(QIODevice::ReadWrite) || !m_localFile.seek(m_offset)) {
+        QString error = QString("No se pudo abrir %1: %2").arg(m_localFile.fileName(), m_localFile.errorString());
+        QTimer::singleShot(0, this, [this, error]() { complete(false, error); });
+        return;
+    }
+    startAdbCommand(m_process, "exec-out", m_readCommand);
+}
+
+/**
+ * Escribe en su posición los bytes recibidos y actualiza el MD5
+ */
+void AdbRangeReadJob::onReadyRead()
+{
+    if (isFinished()) return;
+
+    QByteArray data = m_process.readAllStandardOutput();
+    if (data.isEmpty()) return;
+
+    if (m_received + data.size() > m_length) {
+        m_process.kill();
+        complete(false, QString("El dispositivo envió más de %1 bytes para el rango").arg(m_length));
+        return;
+    }
+    if (m_localFile.write(data) != data.size()) {
+        m_process.kill();
+        complete(false, QString("Error escribiendo %1: %2").arg(m_localFile.fileName(), m_localFile.errorString()));
+        return;
+    }
+
+    m_hash.addData(data);
+    m_received += data.size();
+    emit progress(m_received, m_length);
+}
+
+void AdbRangeReadJob::onFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    Q_UNUSED(exitCode);
+    Q_UNUSED(exitStatus);
+    if (isFinished()) return;
+
+    onReadyRead();
+    m_localFile.close();
+
+    QString error = processError(m_process, "Lectura del rango");
+    if (!error.isEmpty()) {
+        complete(false, error);
+        return;
+    }
+    if (m_received != m_length) {
+        complete(false, QString("Rango incompleto: %1 de %2 bytes").arg(m_received).arg(m_length));
+        return;
+    }
+
+    if (!m_expectedMd5.isEmpty()) {
+        completeWithChecksum(m_expectedMd5, m_hash.result());
+    } else if (!m_verifyCommand.isEmpty()) {
+        verifyRemoteMd5(m_verifyCommand, m_hash.result());
+    } else {
+        complete(true);
+    }
+}
+
+/**
+ * Constructor de AdbRangeWriteJob
+ */
+AdbRangeWriteJob::AdbRangeWriteJob(const QString &adbPath, const QString &deviceId, const QString &writeCommand,
+                                   const QString &verifyCommand, const QString &localPath,
+                                   qint64 offset, qint64 length, QObject *parent)
+    : AdbRangeJob(adbPath, deviceId, localPath, offset, length, parent)
+    , m_writeCommand(writeCommand)
+    , m_verifyCommand(verifyCommand)
+    , m_sent(0)
+    , m_inputClosed(false)
+{
+    connect(&m_process, &QProcess::started, this, &AdbRangeWriteJob::feedInput);
+    connect(&m_process, &QProcess::bytesWritten, this, &AdbRangeWriteJob::feedInput);
+    connect(&m_process, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+            this, &AdbRangeWriteJob::onFinished);
+}
+
+void AdbRangeWriteJob::start()
+{
+    if (!m_localFile.open(QIODevice::ReadOnly) || !m_localFile.seek(m_offset)) {
+        QString error = QString("No se pudo abrir %1: %2").arg(m_localFile.fileName(), m_localFile.errorString());
+        QTimer::singleShot(0, this, [this, error]() { complete(false, error); });
+        return;
+    }
+    startAdbCommand(m_process, "exec-in", m_writeCommand);
+}
+
+/**
+ * Mantiene acotado el búfer de stdin del proceso y lo cierra al enviar el rango
+ */
+void AdbRangeWriteJob::feedInput()
+{
+    if (isFinished() || m_inputClosed) return;
+
+    while (m_sent < m_length && m_process.bytesToWrite() < MAX_PENDING_INPUT) {
+        QByteArray chunk = m_localFile.read(qMin(CHUNK_SIZE, m_length - m_sent));
+        if (chunk.isEmpty()) {
+            m_process.kill();
+            complete(false, QString("Lectura incompleta de %1").arg(m_localFile.fileName()));
+            return;
+        }
+        m_hash.addData(chunk);
+        m_process.write(chunk);
+        m_sent += chunk.size();
+    }
+
+    emit progress(m_sent - m_process.bytesToWrite(), m_length);
+
+    if (m_sent >= m_length) {
+        m_inputClosed = true;
+        m_localFile.close();
+        m_process.closeWriteChannel();
+    }
+}
+
+void AdbRangeWriteJob::onFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    Q_UNUSED(exitCode);
+    Q_UNUSED(exitStatus);
+    if (isFinished()) return;
+
+    QString error = processError(m_process, "Escritura del rango");
+    if (!error.isEmpty()) {
+        complete(false, error);
+        return;
+    }
+    if (!m_inputClosed) {
+        complete(false, QString("El dispositivo cerró la escritura tras %1 de %2 bytes").arg(m_sent).arg(m_length));
+        return;
+    }
+
+    verifyRemoteMd5(m_verifyCommand, m_hash.result());
+}
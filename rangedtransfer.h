@@ -0,0 +1,258 @@
+#ifndef RANGEDTRANSFER_H
+#define RANGEDTRANSFER_H
+
+#include <QObject>
+#include <QProcess>
+#include <QFile>
+#include <QPointer>
+#include <QQueue>
+#include <QVector>
+#include <QCryptographicHash>
+#include "devicetransport.h"
+
+/**
+ * @class RangedTransferJob
+ * @brief Transferencia de un archivo grande dividida en rangos de bytes paralelos
+ *
+ * El archivo se parte en rangos de tamaño fijo que se leen (readRange) o escriben
+ * (writeRange) en paralelo, hasta DeviceTransport::maxConcurrentRangeJobs() a la vez.
+ * Cada rango se escribe en su posición del archivo de destino, ya dimensionado, y se
+ * verifica con su MD5; si un rango falla solo se reintenta ese rango.
+ */
+class RangedTransferJob : public TransportJob
+{
+    Q_OBJECT
+public:
+    enum Direction {
+        Read,   // Dispositivo -> archivo local
+        Write   // Archivo local -> dispositivo
+    };
+
+    /**
+     * @brief Constructor
+     * @param transport Transporte del dispositivo (debe admitir rangos en la dirección dada)
+     * @param direction Dirección de la transferencia
+     * @param remotePath Ruta en el dispositivo
+     * @param localPath Ruta local
+     * @param rangeSize Tamaño de cada rango en bytes
+     * @param parent Objeto padre (opcional)
+     */
+    RangedTransferJob(DeviceTransport *transport, Direction direction, const QString &remotePath,
+                      const QString &localPath, qint64 rangeSize, QObject *parent = nullptr);
+
+    /**
+     * @brief Establece el número máximo de rangos simultáneos (por defecto el del transporte)
+     */
+    void setMaxParallel(int maxParallel);
+
+    /**
+     * @brief Establece cuántas veces se reintenta un mismo rango antes de abandonar
+     */
+    void setMaxRetries(int maxRetries);
+
+    /**
+     * @brief Limita la transferencia a unos rangos concretos (offset, longitud)
+     *
+     * En escritura el archivo remoto se ajusta igualmente al tamaño del local, pero
+     * el resto de su contenido no se toca (usado para aplicar deltas).
+     */
+    void setRanges(const QList<QPair<qint64, qint64>> &ranges);
+
+    /**
+     * @brief Determina el tamaño, prepara el destino e inicia los primeros rangos
+     */
+    void start();
+
+    void abort() override;
+
+    /**
+     * @brief Número de rangos en que se dividió el archivo
+     */
+    int rangeCount() const;
+
+    /**
+     * @brief Número de reintentos de rango realizados
+     */
+    int retryCount() const;
+
+    /**
+     * @brief Tamaño mínimo recomendado para dividir un archivo en rangos (256 MB)
+     */
+    static constexpr qint64 DEFAULT_THRESHOLD = 256LL * 1024 * 1024;
+
+    /**
+     * @brief Tamaño de rango por defecto (32 MB)
+     */
+    static constexpr qint64 DEFAULT_RANGE_SIZE = 32LL * 1024 * 1024;
+
+private slots:
+    void startPendingRanges();
+
+private:
+    struct Range {
+        qint64 offset;
+        qint64 length;
+        qint64 done;
+        int attempts;
+        QPointer<TransportJob> job;
+    };
+
+    bool prepare(QString *errorMessage);
+    void onRangeFinished(int index, bool success, const QString &errorMessage);
+    void onRangeProgress(int index, qint64 bytesDone);
+    void fail(const QString &errorMessage);
+
+    QPointer<DeviceTransport> m_transport;
+    Direction m_direction;
+    QString m_remotePath;
+    QString m_localPath;
+    qint64 m_rangeSize;
+    qint64 m_totalSize;
+    qint64 m_completedBytes;
+    int m_maxParallel;
+    int m_maxRetries;
+    int m_running;
+    int m_completedRanges;
+    int m_retries;
+    QVector<Range> m_ranges;
+    QQueue<int> m_pending;
+    QList<QPair<qint64, qint64>> m_requestedRanges;
+    bool m_hasRequestedRanges;
+};
+
+/**
+ * @class AdbRangeJob
+ * @brief Base de las transferencias de rango con adb: proceso de datos + verificación MD5
+ */
+class AdbRangeJob : public TransportJob
+{
+    Q_OBJECT
+public:
+    AdbRangeJob(const QString &adbPath, const QString &deviceId, const QString &localPath,
+                qint64 offset, qint64 length, QObject *parent = nullptr);
+
+    void abort() override;
+
+protected:
+    /**
+     * @brief Lanza un comando de shell del dispositivo con adb exec-out/exec-in
+     */
+    void startAdbCommand(QProcess &process, const QString &mode, const QString &command);
+
+    /**
+     * @brief Compara un MD5 local con el del rango remoto y termina el job
+     * @param verifyCommand Comando del dispositivo cuya salida empieza por el MD5 en hex
+     * @param localMd5 MD5 (binario) de los bytes transferidos
+     */
+    void verifyRemoteMd5(const QString &verifyCommand, const QByteArray &localMd5);
+
+    /**
+     * @brief Compara dos MD5 y termina el job
+     * @param remoteMd5Hex MD5 remoto en hexadecimal
+     * @param localMd5 MD5 local (binario)
+     */
+    void completeWithChecksum(const QString &remoteMd5Hex, const QByteArray &localMd5);
+
+    /**
+     * @brief Mensaje de error de un proceso terminado, o vacío si terminó bien
+     */
+    static QString processError(QProcess &process, const QString &description);
+
+    QString m_adbPath;
+    QString m_deviceId;
+    QFile m_localFile;
+    qint64 m_offset;
+    qint64 m_length;
+    QProcess m_process;
+    QProcess m_verifyProcess;
+    QCryptographicHash m_hash;
+};
+
+/**
+ * @class AdbRangeReadJob
+ * @brief Vuelca la salida de un comando del dispositivo en una posición del archivo local
+ *
+ * La salida se escribe a medida que llega, sin archivos intermedios. El rango se
+ * verifica con un MD5 conocido (p. ej. el enviado por Bridge Client) o ejecutando un
+ * comando de verificación en el dispositivo.
+ */
+class AdbRangeReadJob : public AdbRangeJob
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief Constructor
+     * @param adbPath Ruta de adb
+     * @param deviceId ID del dispositivo
+     * @param readCommand Comando del dispositivo que escribe exactamente el rango en stdout
+     * @param localPath Archivo local ya dimensionado
+     * @param offset Posición del rango
+     * @param length Longitud del rango
+     * @param parent Objeto padre (opcional)
+     */
+    AdbRangeReadJob(const QString &adbPath, const QString &deviceId, const QString &readCommand,
+                    const QString &localPath, qint64 offset, qint64 length, QObject *parent = nullptr);
+
+    /**
+     * @brief MD5 esperado del rango en hexadecimal
+     */
+    void setExpectedMd5(const QString &md5Hex);
+
+    /**
+     * @brief Comando del dispositivo que calcula el MD5 del rango
+     */
+    void setVerifyCommand(const QString &verifyCommand);
+
+    void start();
+
+private slots:
+    void onReadyRead();
+    void onFinished(int exitCode, QProcess::ExitStatus exitStatus);
+
+private:
+    QString m_readCommand;
+    QString m_expectedMd5;
+    QString m_verifyCommand;
+    qint64 m_received;
+};
+
+/**
+ * @class AdbRangeWriteJob
+ * @brief Envía un rango del archivo local al stdin de un comando del dispositivo
+ */
+class AdbRangeWriteJob : public AdbRangeJob
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief Constructor
+     * @param adbPath Ruta de adb
+     * @param deviceId ID del dispositivo
+     * @param writeCommand Comando del dispositivo que escribe stdin en la posición del rango
+     * @param verifyCommand Comando del dispositivo que calcula el MD5 del rango escrito
+     * @param localPath Archivo local de origen
+     * @param offset Posición del rango
+     * @param length Longitud del rango
+     * @param parent Objeto padre (opcional)
+     */
+    AdbRangeWriteJob(const QString &adbPath, const QString &deviceId, const QString &writeCommand,
+                     const QString &verifyCommand, const QString &localPath,
+                     qint64 offset, qint64 length, QObject *parent = nullptr);
+
+    void start();
+
+private slots:
+    void feedInput();
+    void onFinished(int exitCode, QProcess::ExitStatus exitStatus);
+
+private:
+    QString m_writeCommand;
+    QString m_verifyCommand;
+    qint64 m_sent;
+    bool m_inputClosed;
+
+    static constexpr qint64 CHUNK_SIZE = 256 * 1024;
+    static constexpr qint64 MAX_PENDING_INPUT = 4 * 1024 * 1024;
+};
+
+#endif // RANGEDTRANSFER_H
@@ -0,0 +1,721 @@
+#include "scanpayload.h"
+#include <QCborStreamReader>
+#include <QCborValue>
+#include <QCborMap>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QStringList>
+#include <QJsonDocument>
+#include <climits>
+#include <cctype>
+#include <cstring>
+
+namespace {
+
+// Campos de un elemento del lote, leídos de JSON o de CBOR
+struct ScanRecord {
+    // Medios y archivos
+    QString path;
+    QString name;
+    QString type;
+    QString mimeType;
+    qint64 size = 0;
+    QVariantMap metadata;
+    bool hasMetadata = false;
+
+    // Contactos y mensajes
+    QString id;
+    QString displayName;
+    QStringList phones;
+    QStringList emails;
+    QString photoUri;
+    bool hasPhones = false;
+    bool hasEmails = false;
+    bool hasPhotoUri = false;
+    QString threadId;
+    QString address;
+    QString body;
+    bool isRead = false;
+    int messageType = 0;
+
+    qint64 date = 0; // dateModified (archivos) o date (mensajes), en ms
+};
+
+/**
+ * Construye el DataItem de un registro; false si le faltan los campos esenciales
+ */
+bool toDataItem(ScanPayload::Kind kind, const ScanRecord &record, DataItem &item)
+{
+    switch (kind) {
+    case ScanPayload::Media:
+    case ScanPayload::Files: {
+        if (record.path.isEmpty() || record.name.isEmpty()) {
+            return false; // Saltar elementos sin información esencial
+        }
+        item.id = record.path; // Usar ruta como ID único
+        item.displayName = record.name;
+        item.filePath = record.path;
+        item.size = record.size;
+        item.dateTime = QDateTime::fromMSecsSinceEpoch(record.date);
+
+        // Mapear tipos de archivo a categorías
+        if (kind == ScanPayload::Media) {
+            if (record.type == "IMAGE") {
+                item.data["mediaType"] = "photos";
+            } else if (record.type == "VIDEO") {
+                item.data["mediaType"] = "videos";
+            } else if (record.type == "AUDIO") {
+                item.data["mediaType"] = "music";
+            } else {
+                item.data["mediaType"] = "other";
+            }
+        } else {
+            if (record.type == "DOCUMENT") {
+                item.data["fileType"] = "documents";
+            } else if (record.type == "APK") {
+                item.data["fileType"] = "applications";
+            } else if (record.type == "ARCHIVE") {
+                item.data["fileType"] = "archives";
+            } else {
+                item.data["fileType"] = "other";
+            }
+        }
+        item.data["mimeType"] = record.mimeType;
+
+        // Metadatos adicionales (solo medios)
+        if (kind == ScanPayload::Media && record.hasMetadata) {
+            for (auto it = record.metadata.constBegin(); it != record.metadata.constEnd(); ++it) {
+                item.data[it.key()] = it.value();
+            }
+        }
+        return true;
+    }
+    case ScanPayload::Contacts:
+        if (record.id.isEmpty() || record.displayName.isEmpty()) {
+            return false; // Saltar contactos sin información esencial
+        }
+        item.id = record.id;
+        item.displayName = record.displayName;
+        item.size = 1024; // Tamaño estimado para contactos
+        if (record.hasPhones) item.data["phones"] = record.phones;
+        if (record.hasEmails) item.data["emails"] = record.emails;
+        if (record.hasPhotoUri) item.data["photoUri"] = record.photoUri;
+        return true;
+    case ScanPayload::Messages:
+        if (record.id.isEmpty() || record.body.isEmpty()) {
+            return false; // Saltar mensajes sin información esencial
+        }
+        item.id = record.id;
+        item.displayName = QString("Mensaje de %1").arg(record.address);
+        item.size = record.body.length() + record.address.length(); // Tamaño aproximado
+        item.dateTime = QDateTime::fromMSecsSinceEpoch(record.date);
+        item.data["threadId"] = record.threadId;
+        item.data["address"] = record.address;
+        item.data["body"] = record.body;
+        item.data["isRead"] = record.isRead;
+        item.data["type"] = record.messageType;
+        return true;
+    }
+    return false;
+}
+
+QStringList jsonTextList(const QJsonValue &value)
+{
+    QStringList list;
+    const QJsonArray array = value.toArray();
+    for (int i = 0; i < array.size(); ++i) {
+        list.append(array[i].toString());
+    }
+    return list;
+}
+
+/**
+ * Registro desde un objeto JSON (misma conversión de tipos que QJsonValue)
+ */
+ScanRecord jsonRecord(ScanPayload::Kind kind, const QJsonObject &obj)
+{
+    ScanRecord record;
+    if (kind == ScanPayload::Media || kind == ScanPayload::Files) {
+        record.path = obj["path"].toString();
+        record.name = obj["name"].toString();
+        record.size = obj["size"].toVariant().toLongLong();
+        record.type = obj["type"].toString();
+        record.date = obj["dateModified"].toVariant().toLongLong();
+        record.mimeType = obj["mimeType"].toString();
+        record.hasMetadata = obj.contains("metadata");
+        if (record.hasMetadata) record.metadata = obj["metadata"].toObject().toVariantMap();
+    } else if (kind == ScanPayload::Contacts) {
+        record.id = obj["id"].toString();
+        record.displayName = obj["displayName"].toString();
+        record.hasPhones = obj.contains("phoneNumbers");
+        if (record.hasPhones) record.phones = jsonTextList(obj["phoneNumbers"]);
+        record.hasEmails = obj.contains("emails");
+        if (record.hasEmails) record.emails = jsonTextList(obj["emails"]);
+        record.hasPhotoUri = obj.contains("photoUri");
+        if (record.hasPhotoUri) record.photoUri = obj["photoUri"].toString();
+    } else {
+        record.id = obj["id"].toString();
+        record.threadId = obj["threadId"].toString();
+        record.address = obj["address"].toString();
+        record.date = obj["date"].toVariant().toLongLong();
+        record.body = obj["body"].toString();
+        record.isRead = obj["isRead"].toBool();
+        record.messageType = obj["type"].toInt();
+    }
+    return record;
+}
+
+// Lectores de valores CBOR: consumen el valor actual, sea del tipo esperado o no
+
+QString cborText(QCborStreamReader &reader)
+{
+    if (!reader.isString()) {
+        reader.next();
+        return QString();
+    }
+    QString text;
+    auto chunk = reader.readString();
+    while (chunk.status == QCborStreamReader::Ok) {
+        text += chunk.data;
+        chunk = reader.readString();
+    }
+    return text;
+}
+
+/**
+ * Entero con la conversión de QJsonValue::toVariant().toLongLong()
+ */
+qint64 cborLong(QCborStreamReader &reader)
+{
+    qint64 value = 0;
+    if (reader.isString()) {
+        return cborText(reader).toLongLong();
+    }
+    if (reader.isInteger()) {
+        value = reader.toInteger();
+    } else if (reader.isDouble()) {
+        value = qRound64(reader.toDouble());
+    } else if (reader.isBool()) {
+        value = reader.toBool() ? 1 : 0;
+    }
+    reader.next();
+    return value;
+}
+
+/**
+ * Entero con la conversión de QJsonValue::toInt(): solo números enteros
+ */
+int cborInt(QCborStreamReader &reader)
+{
+    int value = 0;
+    if (reader.isInteger()) {
+        qint64 number = reader.toInteger();
+        if (number >= INT_MIN && number <= INT_MAX) value = static_cast<int>(number);
+    } else if (reader.isDouble()) {
+        double number = reader.toDouble();
+        if (number >= INT_MIN && number <= INT_MAX && static_cast<int>(number) == number) {
+            value = static_cast<int>(number);
+        }
+    }
+    reader.next();
+    return value;
+}
+
+bool cborBool(QCborStreamReader &reader)
+{
+    bool value = reader.isBool() && reader.toBool();
+    reader.next();
+    return value;
+}
+
+QStringList cborTextList(QCborStreamReader &reader)
+{
+    QStringList list;
+    if (!reader.isArray() || !reader.enterContainer()) {
+        reader.next();
+        return list;
+    }
+    while (reader.lastError() == QCborError::NoError && reader.hasNext()) {
+        list.append(cborText(reader));
+    }
+    reader.leaveContainer();
+    return list;
+}
+
+// Valores de un campo CBOR para readField()
+struct CborFields {
+    QCborStreamReader &reader;
+
+    QString text() { return cborText(reader); }
+    qint64 longValue() { return cborLong(reader); }
+    int intValue() { return cborInt(reader); }
+    bool boolean() { return cborBool(reader); }
+    QStringList textList() { return cborTextList(reader); }
+    // Poco frecuente y de forma libre: se convierte con la semántica de JSON
+    QVariantMap object() { return QCborValue::fromCbor(reader).toMap().toJsonObject().toVariantMap(); }
+    void skip() { reader.next(); }
+};
+
+/**
+ * Cursor de solo avance sobre el texto JSON de un lote, para leer los campos sin DOM
+ *
+ * Los límites de las cadenas se buscan con memchr, que las libc habituales recorren
+ * con instrucciones vectoriales; solo se decodifican los valores que se usan. Comprueba
+ * la estructura del documento, pero no cada carácter (p. ej. controles sin escapar).
+ */
+class JsonCursor
+{
+public:
+    JsonCursor(const char *begin, const char *end)
+        : m_p(begin), m_end(end), m_ok(true) {}
+
+    bool ok() const { return m_ok; }
+    bool atEnd() { skipSpace(); return m_p == m_end; }
+    char peek() { skipSpace(); return m_p < m_end ? *m_p : '\0'; }
+
+    bool consume(char c)
+    {
+        skipSpace();
+        if (m_p < m_end && *m_p == c) {
+            ++m_p;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char c)
+    {
+        if (!consume(c)) m_ok = false;
+    }
+
+    /**
+     * Cadena entre comillas sin decodificar; escaped indica si contiene secuencias '\'
+     */
+    bool rawString(const char *&start, int &length, bool &escaped)
+    {
+        if (!consume('"')) {
+            m_ok = false;
+            return false;
+        }
+        start = m_p;
+        const char *p = m_p;
+        forever {
+            const char *quote = static_cast<const char *>(memchr(p, '"', m_end - p));
+            if (!quote) {
+                m_ok = false;
+                return false;
+            }
+            // Comilla escapada si la precede un número impar de '\'
+            const char *slash = quote;
+            while (slash > start && slash[-1] == '\\') --slash;
+            if ((quote - slash) % 2 == 0) {
+                length = static_cast<int>(quote - start);
+                escaped = memchr(start, '\\', length) != nullptr;
+                m_p = quote + 1;
+                return true;
+            }
+            p = quote + 1;
+        }
+    }
+
+    QString decodeString(const char *start, int length, bool escaped)
+    {
+        if (!escaped) return QString::fromUtf8(start, length);
+
+        QString text;
+        text.reserve(length);
+        const char *p = start;
+        const char *end = start + length;
+        while (p < end) {
+            const char *slash = static_cast<const char *>(memchr(p, '\\', end - p));
+            if (!slash) {
+                text += QString::fromUtf8(p, static_cast<int>(end - p));
+                break;
+            }
+            text += QString::fromUtf8(p, static_cast<int>(slash - p));
+            if (slash + 1 >= end) {
+                m_ok = false;
+                break;
+            }
+            p = slash + 2;
+            switch (slash[1]) {
+            case '"': text += QLatin1Char('"'); break;
+            case '\\': text += QLatin1Char('\\'); break;
+            case '/': text += QLatin1Char('/'); break;
+            case 'b': text += QLatin1Char('\b'); break;
+            case 'f': text += QLatin1Char('\f'); break;
+            case 'n': text += QLatin1Char('\n'); break;
+            case 'r': text += QLatin1Char('\r'); break;
+            case 't': text += QLatin1Char('\t'); break;
+            case 'u': {
+                // Los pares sustitutos quedan como dos QChar consecutivos
+                bool ok = false;
+                ushort code = end - p >= 4 ? QByteArray(p, 4).toUShort(&ok, 16) : 0;
+                if (!ok) {
+                    m_ok = false;
+                    return text;
+                }
+                text += QChar(code);
+                p += 4;
+                break;
+            }
+            default:
+                m_ok = false;
+                return text;
+            }
+        }
+        return text;
+    }
+
+    /**
+     * Salta un valor completo, validando su estructura
+     */
+    void skip()
+    {
+        char c = peek();
+        if (c == '"') {
+            const char *start;
+            int length;
+            bool escaped;
+            rawString(start, length, escaped);
+        } else if (c == '{' || c == '[') {
+            char close = c == '{' ? '}' : ']';
+            ++m_p;
+            if (consume(close)) return;
+            do {
+                if (c == '{') {
+                    const char *key;
+                    int length;
+                    bool escaped;
+                    if (!rawString(key, length, escaped)) return;
+                    expect(':');
+                }
+                if (m_ok) skip();
+            } while (m_ok && consume(','));
+            expect(close);
+        } else {
+            const char *start;
+            int length;
+            scalar(start, length);
+        }
+    }
+
+    // Valores de un campo para readField(), con las conversiones de QJsonValue
+
+    QString text()
+    {
+        if (peek() != '"') {
+            skip();
+            return QString(); // toString() de un valor que no es cadena
+        }
+        const char *start;
+        int length;
+        bool escaped;
+        if (!rawString(start, length, escaped)) return QString();
+        return decodeString(start, length, escaped);
+    }
+
+    qint64 longValue()
+    {
+        char c = peek();
+        if (c == '"') return text().toLongLong();
+        if (c == '{' || c == '[') {
+            skip();
+            return 0;
+        }
+        const char *start;
+        int length;
+        if (!scalar(start, length)) return 0;
+        if (isLiteral(start, length, "true")) return 1;
+        if (isLiteral(start, length, "false") || isLiteral(start, length, "null")) return 0;
+
+        qint64 value;
+        if (parseInteger(start, length, value)) return value;
+        bool ok = false;
+        double number = QByteArray::fromRawData(start, length).toDouble(&ok);
+        if (!ok) m_ok = false;
+        return qRound64(number); // Como QVariant(double).toLongLong()
+    }
+
+    int intValue()
+    {
+        char c = peek();
+        if (c == '"' || c == '{' || c == '[') {
+            skip();
+            return 0;
+        }
+        const char *start;
+        int length;
+        if (!scalar(start, length)) return 0;
+        if (isLiteral(start, length, "true") || isLiteral(start, length, "false")
+            || isLiteral(start, length, "null")) {
+            return 0;
+        }
+
+        bool ok = false;
+        double number = QByteArray::fromRawData(start, length).toDouble(&ok);
+        if (!ok) {
+            m_ok = false;
+            return 0;
+        }
+        // toInt() solo convierte números enteros
+        if (number >= INT_MIN && number <= INT_MAX && static_cast<int>(number) == number) {
+            return static_cast<int>(number);
+        }
+        return 0;
+    }
+
+    bool boolean()
+    {
+        if (peek() != 't') {
+            skip();
+            return false;
+        }
+        const char *start;
+        int length;
+        return scalar(start, length) && isLiteral(start, length, "true");
+    }
+
+    QStringList textList()
+    {
+        QStringList list;
+        if (peek() != '[') {
+            skip();
+            return list;
+        }
+        consume('[');
+        if (consume(']')) return list;
+        do {
+            list.append(text());
+        } while (m_ok && consume(','));
+        expect(']');
+        return list;
+    }
+
+    QVariantMap object()
+    {
+        char c = peek();
+        const char *start = m_p;
+        skip();
+        if (c != '{' || !m_ok) return QVariantMap();
+        // Metadatos poco frecuentes y de forma libre: se delegan en el parser de Qt
+        QByteArray json(start, static_cast<int>(m_p - start));
+        return QJsonDocument::fromJson(json).object().toVariantMap();
+    }
+
+private:
+    void skipSpace()
+    {
+        while (m_p < m_end && (*m_p == ' ' || *m_p == '\n' || *m_p == '\r' || *m_p == '\t')) ++m_p;
+    }
+
+    /**
+     * Número o literal (true, false, null)
+     */
+    bool scalar(const char *&start, int &length)
+    {
+        skipSpace();
+        start = m_p;
+        while (m_p < m_end && (isalnum(static_cast<unsigned char>(*m_p)) || *m_p == '-'
+                               || *m_p == '+' || *m_p == '.')) {
+            ++m_p;
+        }
+        length = static_cast<int>(m_p - start);
+        bool valid = length > 0 && (*start == '-' || isdigit(static_cast<unsigned char>(*start))
+                                    || isLiteral(start, length, "true") || isLiteral(start, length, "false")
+                                    || isLiteral(start, length, "null"));
+        if (!valid) m_ok = false;
+        return valid;
+    }
+
+    static bool isLiteral(const char *start, int length, const char *literal)
+    {
+        return length == static_cast<int>(strlen(literal)) && memcmp(start, literal, length) == 0;
+    }
+
+    /**
+     * Entero decimal sin signo '+', decimales ni exponente (hasta 18 cifras)
+     */
+    static bool parseInteger(const char *start, int length, qint64 &value)
+    {
+        bool negative = length > 0 && *start == '-';
+        int i = negative ? 1 : 0;
+        if (i == length || length - i > 18) return false;
+        value = 0;
+        for (; i < length; ++i) {
+            if (!isdigit(static_cast<unsigned char>(start[i]))) return false;
+            value = value * 10 + (start[i] - '0');
+        }
+        if (negative) value = -value;
+        return true;
+    }
+
+    const char *m_p;
+    const char *m_end;
+    bool m_ok;
+};
+
+/**
+ * Asigna un campo del registro leyendo su valor con el lector de la codificación
+ * (CborFields o JsonCursor); los campos que no se usan se saltan sin decodificarlos
+ */
+template <typename Key, typename Fields>
+void readField(ScanPayload::Kind kind, const Key &key, Fields &fields, ScanRecord &record)
+{
+    bool files = kind == ScanPayload::Media || kind == ScanPayload::Files;
+
+    if (files && key == QLatin1String("path")) record.path = fields.text();
+    else if (files && key == QLatin1String("name")) record.name = fields.text();
+    else if (files && key == QLatin1String("size")) record.size = fields.longValue();
+    else if (files && key == QLatin1String("type")) record.type = fields.text();
+    else if (files && key == QLatin1String("dateModified")) record.date = fields.longValue();
+    else if (files && key == QLatin1String("mimeType")) record.mimeType = fields.text();
+    else if (files && key == QLatin1String("metadata")) {
+        record.hasMetadata = true;
+        record.metadata = fields.object();
+    }
+    else if (!files && key == QLatin1String("id")) record.id = fields.text();
+    else if (kind == ScanPayload::Contacts && key == QLatin1String("displayName")) record.displayName = fields.text();
+    else if (kind == ScanPayload::Contacts && key == QLatin1String("phoneNumbers")) {
+        record.hasPhones = true;
+        record.phones = fields.textList();
+    }
+    else if (kind == ScanPayload::Contacts && key == QLatin1String("emails")) {
+        record.hasEmails = true;
+        record.emails = fields.textList();
+    }
+    else if (kind == ScanPayload::Contacts && key == QLatin1String("photoUri")) {
+        record.hasPhotoUri = true;
+        record.photoUri = fields.text();
+    }
+    else if (kind == ScanPayload::Messages && key == QLatin1String("threadId")) record.threadId = fields.text();
+    else if (kind == ScanPayload::Messages && key == QLatin1String("address")) record.address = fields.text();
+    else if (kind == ScanPayload::Messages && key == QLatin1String("date")) record.date = fields.longValue();
+    else if (kind == ScanPayload::Messages && key == QLatin1String("body")) record.body = fields.text();
+    else if (kind == ScanPayload::Messages && key == QLatin1String("isRead")) record.isRead = fields.boolean();
+    else if (kind == ScanPayload::Messages && key == QLatin1String("type")) record.messageType = fields.intValue();
+    else fields.skip();
+}
+
+/**
+ * Lee un mapa CBOR campo a campo
+ */
+ScanRecord cborRecord(ScanPayload::Kind kind, QCborStreamReader &reader)
+{
+    ScanRecord record;
+    CborFields fields{reader};
+
+    while (reader.lastError() == QCborError::NoError && reader.hasNext()) {
+        if (!reader.isString()) {
+            reader.next(); // Clave no textual: se saltan clave y valor
+            reader.next();
+            continue;
+        }
+        const QString key = cborText(reader);
+        readField(kind, key, fields, record);
+    }
+    return record;
+}
+
+/**
+ * Lee un objeto JSON campo a campo (el cursor está sobre '{')
+ */
+ScanRecord jsonTextRecord(ScanPayload::Kind kind, JsonCursor &cursor)
+{
+    ScanRecord record;
+    cursor.expect('{');
+    if (cursor.consume('}')) return record;
+
+    do {
+        const char *key;
+        int keyLength;
+        bool escaped;
+        if (!cursor.rawString(key, keyLength, escaped)) break;
+        cursor.expect(':');
+        if (!cursor.ok()) break;
+
+        if (escaped) {
+            readField(kind, cursor.decodeString(key, keyLength, escaped), cursor, record);
+        } else {
+            readField(kind, QLatin1String(key, keyLength), cursor, record);
+        }
+    } while (cursor.ok() && cursor.consume(','));
+    cursor.expect('}');
+    return record;
+}
+
+} // namespace
+
+/**
+ * Lote JSON: un objeto por elemento
+ */
+QList<DataItem> ScanPayload::fromJson(Kind kind, const QJsonArray &array)
+{
+    QList<DataItem> items;
+    items.reserve(array.size());
+    for (int i = 0; i < array.size(); ++i) {
+        DataItem item;
+        if (toDataItem(kind, jsonRecord(kind, array[i].toObject()), item)) {
+            items.append(item);
+        }
+    }
+    return items;
+}
+
+/**
+ * Lote JSON en texto, leído sin DOM; ante cualquier error de estructura no añade nada
+ */
+bool ScanPayload::fromJsonText(Kind kind, const QByteArray &json, QList<DataItem> &items)
+{
+    JsonCursor cursor(json.constData(), json.constData() + json.size());
+    if (!cursor.consume('[')) return false;
+
+    QList<DataItem> parsed;
+    if (!cursor.consume(']')) {
+        do {
+            if (cursor.peek() != '{') {
+                cursor.skip(); // toObject() de otro valor: objeto vacío, sin elemento
+                continue;
+            }
+            ScanRecord record = jsonTextRecord(kind, cursor);
+            if (!cursor.ok()) break;
+
+            DataItem item;
+            if (toDataItem(kind, record, item)) {
+                parsed.append(item);
+            }
+        } while (cursor.ok() && cursor.consume(','));
+        cursor.expect(']');
+    }
+
+    if (!cursor.ok() || !cursor.atEnd()) return false;
+    items.append(parsed);
+    return true;
+}
+
+/**
+ * Lote CBOR: array (de longitud fija o indefinida) de mapas con los campos del JSON
+ */
+bool ScanPayload::fromCbor(Kind kind, const QByteArray &payload, QList<DataItem> &items)
+{
+    QCborStreamReader reader(payload);
+    if (!reader.isArray()) return false;
+    if (reader.isLengthKnown()) items.reserve(items.size() + static_cast<int>(reader.length()));
+    if (!reader.enterContainer()) return false;
+
+    while (reader.lastError() == QCborError::NoError && reader.hasNext()) {
+        if (!reader.isMap() || !reader.enterContainer()) {
+            reader.next();
+            continue;
+        }
+        ScanRecord record = cborRecord(kind, reader);
+        reader.leaveContainer();
+
+        DataItem item;
+        if (toDataItem(kind, record, item)) {
+            items.append(item);
+        }
+    }
+    if (reader.lastError() == QCborError::NoError) reader.leaveContainer();
+    return reader.lastError() == QCborError::NoError;
+}
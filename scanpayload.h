@@ -0,0 +1,55 @@
+#ifndef SCANPAYLOAD_H
+#define SCANPAYLOAD_H
+
+#include <QByteArray>
+#include <QJsonArray>
+#include <QList>
+#include "dataitemstore.h"
+
+/**
+ * @class ScanPayload
+ * @brief Convierte los lotes de datos de Bridge Client (MEDIA_DATA, FILES_DATA,
+ *        CONTACTS_DATA, MESSAGES_DATA) en DataItems
+ *
+ * Los lotes llegan como un array de objetos con los mismos campos en JSON (texto en una
+ * línea) o en CBOR (binario, si se negoció al conectar). El CBOR se lee en flujo con
+ * QCborStreamReader: cada campo va directamente a un registro plano, sin construir un
+ * documento intermedio. Ambas codificaciones producen exactamente los mismos DataItems.
+ *
+ * El JSON en texto puede leerse igual, sin DOM (fromJsonText()), extrayendo solo los
+ * campos que se usan; fromJson() sobre un QJsonArray queda como alternativa segura.
+ */
+class ScanPayload
+{
+public:
+    enum Kind {
+        Media,      ///< Fotos, vídeos y audio (MEDIA_DATA)
+        Files,      ///< Documentos, APKs y otros archivos (FILES_DATA)
+        Contacts,   ///< Contactos (CONTACTS_DATA)
+        Messages    ///< Mensajes (MESSAGES_DATA)
+    };
+
+    /**
+     * @brief Convierte un lote JSON ya decodificado
+     */
+    static QList<DataItem> fromJson(Kind kind, const QJsonArray &array);
+
+    /**
+     * @brief Lee un lote JSON directamente del texto, sin construir QJsonDocument
+     * @param json Texto del array JSON
+     * @param items Elementos leídos (se añaden al final)
+     * @return false si el texto no tiene la estructura esperada; items no se modifica
+     *         y el lote debe decodificarse con QJsonDocument y fromJson()
+     */
+    static bool fromJsonText(Kind kind, const QByteArray &json, QList<DataItem> &items);
+
+    /**
+     * @brief Decodifica un lote CBOR
+     * @param payload Array CBOR de mapas
+     * @param items Elementos decodificados (se añaden al final)
+     * @return false si el CBOR no es válido; items conserva lo leído hasta el error
+     */
+    static bool fromCbor(Kind kind, const QByteArray &payload, QList<DataItem> &items);
+};
+
+#endif // SCANPAYLOAD_H